@@ -0,0 +1,51 @@
+// Decode a keycard flight recorder file (keycard-flight-recorder.bin, written
+// next to the pairings file) and print one event per line.
+//
+// Usage: flight_recorder_dump <file> [seconds]
+#include <status-keycard-qt/status_keycard.h>
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <flight-recorder-file> [seconds]\n", argv[0]);
+        return 2;
+    }
+
+    QJsonObject params;
+    params["path"] = QString::fromLocal8Bit(argv[1]);
+    if (argc > 2) {
+        params["seconds"] = QString::fromLocal8Bit(argv[2]).toDouble();
+    }
+
+    QJsonObject request;
+    request["jsonrpc"] = "2.0";
+    request["id"] = "1";
+    request["method"] = "keycard.DumpFlightRecorder";
+    request["params"] = QJsonArray { params };
+
+    Free(KeycardInitializeRPC());
+    char* response = KeycardCallRPC(QJsonDocument(request).toJson(QJsonDocument::Compact).constData());
+    if (!response) {
+        fprintf(stderr, "No response\n");
+        return 1;
+    }
+    QJsonObject reply = QJsonDocument::fromJson(response).object();
+    Free(response);
+
+    if (reply["error"].isObject()) {
+        fprintf(stderr, "%s\n", qPrintable(reply["error"].toObject()["message"].toString()));
+        return 1;
+    }
+
+    const QJsonArray events = reply["result"].toObject()["events"].toArray();
+    for (const QJsonValue& event : events) {
+        printf("%s\n", QJsonDocument(event.toObject()).toJson(QJsonDocument::Compact).constData());
+    }
+    return 0;
+}
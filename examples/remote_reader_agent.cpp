@@ -0,0 +1,52 @@
+// Serve the local card reader to a remote host. The host uses it by creating
+// its context with STATUS_KEYCARD_REMOTE_READER=<agent-host>:<port>.
+//
+// Usage: remote_reader_agent [port] [listen-address]
+//
+// Listens on 127.0.0.1 by default. Any other listen address needs a token in
+// STATUS_KEYCARD_REMOTE_READER_TOKEN, set to the same value on the host, so
+// that only hosts knowing it can use the reader. The link is authenticated
+// but not encrypted: expose it to other machines only through a trusted
+// network or a tunnel. With STATUS_KEYCARD_MOCKED set, a virtual card farm
+// with one inserted card is served instead of the real reader.
+#include "remote/remote_reader_agent.h"
+#include "mocked/virtual_card_farm.h"
+#include <keycard-qt/keycard_channel.h>
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <stdio.h>
+
+using namespace StatusKeycard;
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    quint16 port = RemoteProtocol::DefaultPort;
+    if (argc > 1 && !RemoteProtocol::parsePort(QString::fromLocal8Bit(argv[1]), port)) {
+        fprintf(stderr, "Invalid port: %s\n", argv[1]);
+        return 2;
+    }
+    QHostAddress address = argc > 2 ? QHostAddress(QString::fromLocal8Bit(argv[2])) : QHostAddress::LocalHost;
+    if (address.isNull()) {
+        fprintf(stderr, "Invalid listen address: %s\n", argv[2]);
+        return 2;
+    }
+
+    Keycard::KeycardChannel channel;
+    Keycard::KeycardChannelBackend* backend = channel.backend();
+    VirtualCardFarm farm;
+    if (qEnvironmentVariableIsSet("STATUS_KEYCARD_MOCKED")) {
+        farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                          VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject());
+        backend = &farm;
+    }
+
+    RemoteReaderAgent agent(backend);
+    agent.setAuthToken(qgetenv("STATUS_KEYCARD_REMOTE_READER_TOKEN"));
+    if (!agent.listen(address, port)) {
+        fprintf(stderr, "Cannot listen on %s:%u\n", qPrintable(address.toString()), port);
+        return 1;
+    }
+    printf("Serving %s on %s:%u\n", qPrintable(backend->backendName()), qPrintable(address.toString()), agent.port());
+    return app.exec();
+}
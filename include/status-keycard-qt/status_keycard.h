@@ -19,6 +19,9 @@ typedef struct StatusKeycardContextImpl* StatusKeycardContext;
 // Signal callback type
 typedef void (*SignalCallback)(const char* signal_json);
 
+// Signal subscriber callback type (see KeycardAddSignalSubscriber)
+typedef void (*SignalSubscriberCallback)(const char* signal_json, int length, void* user_data);
+
 // ============================================================================
 // Core RPC Functions (MUST match nim-keycard-go)
 // ============================================================================
@@ -51,9 +54,19 @@ void Free(void* param);
 
 /**
  * @brief Reset API state (compatibility wrapper - uses global context)
+ *
+ * Warm reset: clears session and authorization state but keeps the channel,
+ * reader detection and pairing cache. A connected card is reconnected with
+ * its cached pairing. The reset has finished when the call returns; off the
+ * Qt thread it waits for that thread's event loop to run it.
  */
 void ResetAPI(void);
 
+/**
+ * @brief Cold reset: stop the session and rebuild the RPC service
+ */
+void ResetAPICold(void);
+
 // ============================================================================
 // Context-Based API (For testing and advanced usage)
 // ============================================================================
@@ -74,17 +87,132 @@ char* KeycardCallRPCWithContext(StatusKeycardContext ctx, const char* payload_js
 
 /**
  * @brief Set signal event callback for specific context
+ *
+ * Each context has its own callback: it receives that context's status and
+ * channel signals (with their own status versions, see
+ * KeycardSetStatusDiffs()), plus flow signals if the context was passed to
+ * KeycardInitFlowWithContext().
+ *
  * @param ctx Context handle
  * @param callback Function pointer to receive signal events
  */
 void KeycardSetSignalEventCallbackWithContext(StatusKeycardContext ctx, SignalCallback callback);
 
 /**
- * @brief Reset API state for specific context
+ * @brief Switch signal delivery to a pull-based queue
+ *
+ * Signals are buffered (oldest dropped when full) instead of invoking the
+ * callback. The returned descriptor becomes readable while signals are
+ * pending; poll it from the host event loop and call KeycardDrainSignals().
+ *
+ * Each context has its own queue and descriptor, holding that context's
+ * status and channel signals; flow signals go to the context passed to
+ * KeycardInitFlowWithContext(). Calling this again on an enabled queue
+ * resizes it (dropping the oldest signals that no longer fit) and returns
+ * the same descriptor.
+ *
+ * @param ctx Context handle (NULL for the global context)
+ * @param capacity Maximum number of buffered signals
+ * @return Readiness file descriptor, or -1 if unsupported on this platform
+ */
+int KeycardEnableSignalQueue(StatusKeycardContext ctx, int capacity);
+
+/**
+ * @brief Return to callback delivery, discarding buffered signals
+ *
+ * Closes the readiness descriptor (once a KeycardDrainSignals() call in
+ * progress returns). Remove it from the host's poll set before calling:
+ * the descriptor number may be reused by the next file the process opens.
+ *
+ * @param ctx Context handle (NULL for the global context)
+ */
+void KeycardDisableSignalQueue(StatusKeycardContext ctx);
+
+/**
+ * @brief Take pending signals in one call
+ * @param ctx Context handle (NULL for the global context)
+ * @param buf Output buffer, filled with newline-separated signal JSON and a NUL
+ * @param cap Size of buf in bytes
+ * @return Number of signals written; 0 if none; -N if the next signal needs N bytes
+ */
+int KeycardDrainSignals(StatusKeycardContext ctx, char* buf, int cap);
+
+/**
+ * @brief Add an independent signal consumer next to the callback/queue
+ *
+ * Each subscriber gets its own delivery thread and bounded queue, so a slow
+ * subscriber drops its own oldest signals (see KeycardGetSignalSubscribers)
+ * and never delays the others. Every subscriber receives the same serialized
+ * signal; signal_json is NUL-terminated and only valid during the call.
+ *
+ * @param ctx Context handle (NULL for the global context)
+ * @param callback Called on the subscriber's delivery thread
+ * @param user_data Passed back to callback
+ * @param types Comma-separated signal types to deliver, NULL or "" for all;
+ *              a trailing '*' matches by prefix (e.g. "keycard.flow-*")
+ * @param capacity Maximum number of signals queued for this subscriber
+ * @return Subscriber id (> 0), or -1 on invalid arguments
+ */
+int KeycardAddSignalSubscriber(StatusKeycardContext ctx, SignalSubscriberCallback callback,
+                               void* user_data, const char* types, int capacity);
+
+/**
+ * @brief Remove a subscriber; its callback is not called after this returns
+ * @param ctx Context handle (NULL for the global context)
+ * @param subscriber_id Id returned by KeycardAddSignalSubscriber
+ * @return 1 if removed, 0 if unknown
+ */
+int KeycardRemoveSignalSubscriber(StatusKeycardContext ctx, int subscriber_id);
+
+/**
+ * @brief Delivery counters of every subscriber
+ * @param ctx Context handle (NULL for the global context)
+ * @return JSON array of {"id", "types", "capacity", "pending", "maxPending",
+ *         "delivered", "dropped"} (must be freed with Free())
+ */
+char* KeycardGetSignalSubscribers(StatusKeycardContext ctx);
+
+/**
+ * @brief Send status updates as versioned diffs
+ *
+ * Off by default: every update is a full "status-changed" signal. When on,
+ * a full "status-changed" snapshot carries an extra "version", and later
+ * updates are "status-diff" signals with {"baseVersion", "version",
+ * "changed"}, where "changed" holds only the top-level status fields
+ * (state, keycardInfo, keycardStatus, metadata) that differ, each replaced
+ * as a whole. Updates that change nothing are not sent. The next update
+ * after enabling is a snapshot. Versions are counted per context,
+ * and each context's updates go to its own callback or queue.
+ *
+ * @param ctx Context handle (NULL for the global context)
+ * @param enabled 1 to send diffs, 0 for the full format
+ */
+void KeycardSetStatusDiffs(StatusKeycardContext ctx, int enabled);
+
+/**
+ * @brief Send a full "status-changed" snapshot now
+ *
+ * For consumers that missed a diff ("baseVersion" differs from the last
+ * version they applied). Snapshots are also sent on their own after the
+ * signal queue dropped signals. Waits for a card operation in progress so
+ * the snapshot is consistent; safe to call from the signal callback.
+ *
+ * @param ctx Context handle (NULL for the global context)
+ */
+void KeycardRequestStatusSnapshot(StatusKeycardContext ctx);
+
+/**
+ * @brief Reset API state for specific context (warm, see ResetAPI)
  * @param ctx Context handle
  */
 void ResetAPIWithContext(StatusKeycardContext ctx);
 
+/**
+ * @brief Cold reset for specific context (see ResetAPICold)
+ * @param ctx Context handle
+ */
+void ResetAPIColdWithContext(StatusKeycardContext ctx);
+
 /**
  * @brief Destroy a keycard context and free resources
  * @param ctx Context handle
@@ -93,6 +221,17 @@ void KeycardDestroyContext(StatusKeycardContext ctx);
 
 // ============================================================================
 // Flow API (Deprecated, for compatibility) - Uses global context
+//
+// Start/Resume/Cancel called off the Qt thread do not block: they return
+// {"success": true, "accepted": true, "token": "N"} and the outcome follows
+// as a "keycard.flow-command-result" signal with the same token. There
+// "success" keeps the nim-keycard-go contract and only means the command
+// was accepted; callers that need the outcome match the token.
+//
+// Starting a flow while another one is active queues it (up to 8 waiting
+// flows). Optional params "queue-priority" (higher first) and
+// "queue-deadline-ms" (maximum wait) control the queue; progress is reported
+// by "keycard.flow-queued" and "keycard.flow-dequeued" signals.
 // ============================================================================
 
 char* KeycardInitFlow(const char* storageDir);
@@ -102,6 +241,13 @@ char* KeycardCancelFlow(void);
 
 // ============================================================================
 // Mocked Functions (For testing) - Uses global context
+//
+// Backed by a virtual reader/card farm when STATUS_KEYCARD_MOCKED is set in
+// the environment before the context is created; otherwise they return
+// {"success": false}. readerState and keycardState use the values of
+// status-keycard-go's MockedReaderState and MockedKeycardState. Virtual
+// cards answer an error status word to the few applet commands they do not
+// emulate (key pair templates in LOAD KEY, PIN-less signing, DUPLICATE KEY).
 // ============================================================================
 
 char* MockedLibRegisterKeycard(int cardIndex, int readerState, 
@@ -2,13 +2,21 @@
 #include "rpc/rpc_service.h"
 #include "session/session_manager.h"
 #include "signal_manager.h"
+#include "signal_queue.h"
+#include "request_decoder.h"
 #include "flow/flow_manager.h"
+#include "flow/flow_signals.h"
 #include "storage/file_pairing_storage.h"
+#include "mocked/virtual_card_farm.h"
+#ifdef STATUS_KEYCARD_REMOTE_READER
+#include "remote/remote_reader_backend.h"
+#endif
 #include <QString>
 #include <QObject>
 #include <QThread>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <memory>
 #include <cstring>
 
@@ -16,21 +24,52 @@
 struct StatusKeycardContextImpl {
     std::unique_ptr<StatusKeycard::RpcService> rpcService;
     StatusKeycard::SignalManager* signalManager;
+    std::shared_ptr<StatusKeycard::SignalManager::Delivery> delivery;  // This context's signal queue
+    StatusKeycard::SignalManager::StatusDiffs statusDiffs;  // This context's status stream
     SignalCallback signalCallback;
     std::shared_ptr<Keycard::CommandSet> sharedCommandSet;  // Shared between FlowManager and SessionManager
     std::shared_ptr<Keycard::KeycardChannel> channel;  // Global channel instance
     std::shared_ptr<Keycard::IPairingStorage> pairingStorage;
+    StatusKeycard::VirtualCardFarm* virtualCards;  // Owned by channel; null unless mocked
     
-    StatusKeycardContextImpl()
+    // The global context uses the signal manager's default delivery
+    explicit StatusKeycardContextImpl(bool global)
         : signalCallback(nullptr)
         , sharedCommandSet(nullptr)
+        , virtualCards(nullptr)
     {
         qDebug() << "StatusKeycardContextImpl: Constructor called";
         // Initialize Qt if needed
         int argc = 0;
         char* argv[] = {nullptr};
         
-        channel = std::make_shared<Keycard::KeycardChannel>();
+        // Mocked mode: cards come from the MockedLib* virtual card farm
+        if (qEnvironmentVariableIsSet("STATUS_KEYCARD_MOCKED")) {
+            virtualCards = new StatusKeycard::VirtualCardFarm();
+            channel = std::make_shared<Keycard::KeycardChannel>(virtualCards);
+            qDebug() << "C API: Using virtual card farm";
+        }
+#ifdef STATUS_KEYCARD_REMOTE_READER
+        else if (qEnvironmentVariableIsSet("STATUS_KEYCARD_REMOTE_READER")) {
+            // Remote mode: the reader is served by a RemoteReaderAgent ("host[:port]", "[v6]:port"),
+            // answering its challenge with STATUS_KEYCARD_REMOTE_READER_TOKEN when it requires one
+            QString spec = qEnvironmentVariable("STATUS_KEYCARD_REMOTE_READER");
+            QString address;
+            quint16 port = 0;
+            if (StatusKeycard::RemoteProtocol::parseAddress(spec, address, port)) {
+                StatusKeycard::RemoteReaderBackend::Options options;
+                options.authToken = qgetenv("STATUS_KEYCARD_REMOTE_READER_TOKEN");
+                channel = std::make_shared<Keycard::KeycardChannel>(
+                    new StatusKeycard::RemoteReaderBackend(address, port, options));
+                qDebug() << "C API: Using remote reader at" << address << port;
+            } else {
+                qWarning() << "C API: Invalid STATUS_KEYCARD_REMOTE_READER" << spec << "- using the local reader";
+            }
+        }
+#endif
+        if (!channel) {
+            channel = std::make_shared<Keycard::KeycardChannel>();
+        }
         
 // #if defined(Q_OS_ANDROID) || defined(Q_OS_IOS)
 //         pairingStorage = std::make_shared<StatusKeycard::SecurePairingStorage>();
@@ -49,27 +88,22 @@ struct StatusKeycardContextImpl {
         
         // Get signal manager instance
         signalManager = StatusKeycard::SignalManager::instance();
+        delivery = global ? signalManager->defaultDelivery()
+                          : std::make_shared<StatusKeycard::SignalManager::Delivery>();
         
         // Connect SessionManager signals to SignalManager
         QObject::connect(rpcService->sessionManager(), &StatusKeycard::SessionManager::stateChanged,
                         [this](StatusKeycard::SessionState, StatusKeycard::SessionState) {
             // Emit status-changed signal
             auto status = rpcService->sessionManager()->getStatus();
-            signalManager->emitStatusChanged(status);
+            signalManager->emitStatusChanged(*delivery, statusDiffs, status);
         });
         
         // Connect FlowManager signals to SignalManager
         QObject::connect(StatusKeycard::FlowManager::instance(), &StatusKeycard::FlowManager::flowSignal,
                         [this](const QString& type, const QJsonObject& event) {
-            // Build signal JSON
-            QJsonObject signal;
-            signal["type"] = type;
-            signal["event"] = event;
-            
-            QJsonDocument doc(signal);
-            QString jsonString = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-            
-            signalManager->emitSignal(jsonString);
+            // Serialized once, envelope included, and moved to the callback
+            signalManager->emitSerialized(*delivery, StatusKeycard::FlowSignals::serialize(type, event), type);
         });
         
         // Connect channel state changes to SignalManager
@@ -93,13 +127,14 @@ struct StatusKeycardContextImpl {
                     break;
             }
             qDebug() << "StatusKeycardContextImpl: Emitting channel state changed signal:" << stateStr;
-            signalManager->emitChannelStateChanged(stateStr);
+            signalManager->emitChannelStateChanged(*delivery, stateStr);
         });
 
     }
     
     ~StatusKeycardContextImpl() {
         qDebug() << "StatusKeycardContextImpl: Destructor called";
+        signalManager->resetFlowSignals(delivery.get());
     }
 };
 
@@ -113,9 +148,9 @@ extern "C" {
 static StatusKeycardContext g_global_context = nullptr;
 
 // Internal function that returns context (not exposed in header)
-static StatusKeycardContext KeycardInitializeRPCInternal(void) {
+static StatusKeycardContext KeycardInitializeRPCInternal(bool global) {
     try {
-        StatusKeycardContextImpl* ctx = new StatusKeycardContextImpl();
+        StatusKeycardContextImpl* ctx = new StatusKeycardContextImpl(global);
         qDebug() << "C API: Context created successfully";
         return reinterpret_cast<StatusKeycardContext>(ctx);
     } catch (...) {
@@ -127,10 +162,19 @@ static StatusKeycardContext KeycardInitializeRPCInternal(void) {
 // Initialize global context if needed
 static void ensure_global_context() {
     if (!g_global_context) {
-        g_global_context = KeycardInitializeRPCInternal();
+        g_global_context = KeycardInitializeRPCInternal(true);
     }
 }
 
+// NULL selects the global context used by the compatibility wrappers
+static StatusKeycardContextImpl* contextOrGlobal(StatusKeycardContext ctx) {
+    if (!ctx) {
+        ensure_global_context();
+        ctx = g_global_context;
+    }
+    return reinterpret_cast<StatusKeycardContextImpl*>(ctx);
+}
+
 // Public function that returns JSON string (matching nim-keycard-go expectation)
 char* KeycardInitializeRPC(void) {
     // Create global context if needed
@@ -143,7 +187,7 @@ char* KeycardInitializeRPC(void) {
 
 // Context-based API for testing and advanced usage
 StatusKeycardContext KeycardCreateContext(void) {
-    return KeycardInitializeRPCInternal();
+    return KeycardInitializeRPCInternal(false);
 }
 
 void KeycardDestroyContext(StatusKeycardContext ctx) {
@@ -183,7 +227,96 @@ void KeycardSetSignalEventCallbackWithContext(StatusKeycardContext ctx, SignalCa
     
     StatusKeycardContextImpl* impl = reinterpret_cast<StatusKeycardContextImpl*>(ctx);
     impl->signalCallback = callback;
-    impl->signalManager->setCallback(callback);
+    StatusKeycard::SignalManager::setCallback(*impl->delivery, callback);
+}
+
+int KeycardEnableSignalQueue(StatusKeycardContext ctx, int capacity) {
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (!impl || capacity <= 0) {
+        return -1;
+    }
+    return StatusKeycard::SignalManager::enableQueue(*impl->delivery, capacity);
+}
+
+void KeycardDisableSignalQueue(StatusKeycardContext ctx) {
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (impl) {
+        StatusKeycard::SignalManager::disableQueue(*impl->delivery);
+    }
+}
+
+int KeycardDrainSignals(StatusKeycardContext ctx, char* buf, int cap) {
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (!impl) {
+        return 0;
+    }
+    auto signalQueue = StatusKeycard::SignalManager::queue(*impl->delivery);
+    if (!signalQueue) {
+        return 0;
+    }
+    return signalQueue->drain(buf, cap);
+}
+
+int KeycardAddSignalSubscriber(StatusKeycardContext ctx, SignalSubscriberCallback callback,
+                               void* user_data, const char* types, int capacity) {
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (!impl || !callback || capacity <= 0) {
+        return -1;
+    }
+    
+    QStringList typeList;
+    for (const QString& type : QString::fromUtf8(types ? types : "").split(',', Qt::SkipEmptyParts)) {
+        typeList.append(type.trimmed());
+    }
+    return impl->signalManager->subscribers()->subscribe(
+        [callback, user_data](const QByteArray& signal) {
+            callback(signal.constData(), static_cast<int>(signal.size()), user_data);
+        },
+        typeList, capacity);
+}
+
+int KeycardRemoveSignalSubscriber(StatusKeycardContext ctx, int subscriber_id) {
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (!impl) {
+        return 0;
+    }
+    return impl->signalManager->subscribers()->unsubscribe(subscriber_id) ? 1 : 0;
+}
+
+char* KeycardGetSignalSubscribers(StatusKeycardContext ctx) {
+    QJsonArray result;
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (impl) {
+        for (const auto& stats : impl->signalManager->subscribers()->stats()) {
+            QJsonObject subscriber;
+            subscriber["id"] = stats.id;
+            subscriber["types"] = QJsonArray::fromStringList(stats.types);
+            subscriber["capacity"] = stats.capacity;
+            subscriber["pending"] = stats.pending;
+            subscriber["maxPending"] = stats.maxPending;
+            subscriber["delivered"] = static_cast<qint64>(stats.delivered);
+            subscriber["dropped"] = static_cast<qint64>(stats.dropped);
+            result.append(subscriber);
+        }
+    }
+    return strdup(QJsonDocument(result).toJson(QJsonDocument::Compact).constData());
+}
+
+void KeycardSetStatusDiffs(StatusKeycardContext ctx, int enabled) {
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (impl) {
+        StatusKeycard::SignalManager::setStatusDiffs(impl->statusDiffs, enabled != 0);
+    }
+}
+
+void KeycardRequestStatusSnapshot(StatusKeycardContext ctx) {
+    StatusKeycardContextImpl* impl = contextOrGlobal(ctx);
+    if (!impl || !impl->rpcService) {
+        return;
+    }
+    // Not called from a session operation: read the status under its lock
+    auto status = impl->rpcService->sessionManager()->lockedStatus();
+    impl->signalManager->emitStatusSnapshot(*impl->delivery, impl->statusDiffs, status);
 }
 
 void Free(void* param) {
@@ -197,6 +330,30 @@ void ResetAPIWithContext(StatusKeycardContext ctx) {
         return;
     }
     
+    StatusKeycardContextImpl* impl = reinterpret_cast<StatusKeycardContextImpl*>(ctx);
+    if (!impl->rpcService || !impl->rpcService->sessionManager()) {
+        return;
+    }
+    
+    // Warm reset: keep channel, reader detection and pairing cache; only the
+    // logical session is dropped. Runs on the SessionManager thread and is
+    // finished before returning, so a following RPC (e.g. Authorize) cannot
+    // be wiped by a reset still in the event queue.
+    StatusKeycard::SessionManager* sessionManager = impl->rpcService->sessionManager();
+    if (QThread::currentThread() == sessionManager->thread()) {
+        sessionManager->resetSession();
+    } else {
+        QMetaObject::invokeMethod(sessionManager, [sessionManager]() {
+            sessionManager->resetSession();
+        }, Qt::BlockingQueuedConnection);
+    }
+}
+
+void ResetAPIColdWithContext(StatusKeycardContext ctx) {
+    if (!ctx) {
+        return;
+    }
+    
     StatusKeycardContextImpl* impl = reinterpret_cast<StatusKeycardContextImpl*>(ctx);
     
     // Stop the session
@@ -207,12 +364,13 @@ void ResetAPIWithContext(StatusKeycardContext ctx) {
     // Reset RPC service
     impl->rpcService.reset();
     impl->rpcService = std::make_unique<StatusKeycard::RpcService>();
+    impl->rpcService->setSharedCommandSet(impl->sharedCommandSet);
     
     // Reconnect signals
     QObject::connect(impl->rpcService->sessionManager(), &StatusKeycard::SessionManager::stateChanged,
                     [impl](StatusKeycard::SessionState, StatusKeycard::SessionState) {
         auto status = impl->rpcService->sessionManager()->getStatus();
-        impl->signalManager->emitStatusChanged(status);
+        impl->signalManager->emitStatusChanged(*impl->delivery, impl->statusDiffs, status);
     });
 }
 
@@ -238,45 +396,63 @@ char* KeycardInitFlowWithContext(StatusKeycardContext ctx, const char* storageDi
         const char* error = R"({"success": false, "error": "Failed to initialize FlowManager"})";
         return strdup(error);
     }
+    // Flow-side EXPORT KEY and SIGN calibrate the same model keycard.ExplainPlan uses
+    if (impl->rpcService) {
+        StatusKeycard::FlowManager::instance()->setCostModel(impl->rpcService->sessionManager()->sharedCostModel());
+    }
+    // Flow results and errors go to this context's signal queue
+    impl->signalManager->routeFlowSignals(impl->delivery);
     
     
     const char* response = R"({"success": true})";
     return strdup(response);
 }
 
+// Response for a command posted to FlowManager's mailbox: the command was
+// accepted, its outcome arrives as a keycard.flow-command-result signal.
+// "success" stays for nim-keycard-go callers and means accepted here.
+static char* acceptedResponse(quint64 token) {
+    QJsonObject obj;
+    obj["success"] = true;
+    obj["accepted"] = true;
+    obj["token"] = QString::number(token);
+    QByteArray json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    return strdup(json.constData());
+}
+
 char* KeycardStartFlowWithContext(StatusKeycardContext ctx, int flowType, const char* jsonParams) {
     if (!ctx) {
         const char* error = R"({"success": false, "error": "Invalid context"})";
         return strdup(error);
     }
     
-    // Parse JSON parameters
+    // Parse JSON parameters; large sign batches decode their hash/path
+    // arrays straight into typed buffers
     QJsonObject params;
+    std::shared_ptr<StatusKeycard::RequestBatch> batch;
     if (jsonParams && strlen(jsonParams) > 0) {
-        QJsonDocument doc = QJsonDocument::fromJson(QByteArray(jsonParams));
-        if (doc.isObject()) {
-            params = doc.object();
+        QByteArray payload = QByteArray::fromRawData(jsonParams, static_cast<int>(strlen(jsonParams)));
+        if (StatusKeycard::RequestDecoder::decodeFlowParams(static_cast<StatusKeycard::FlowType>(flowType),
+                                                           payload, params, batch)
+            == StatusKeycard::RequestDecoder::Result::Fallback) {
+            QJsonDocument doc = QJsonDocument::fromJson(payload);
+            if (doc.isObject()) {
+                params = doc.object();
+            }
         }
     }
     
-    // IMPORTANT: Marshal to Qt main thread!
-    // This function is called from Nim threads, but startFlow() creates Qt objects
-    // and manipulates state that must be on the Qt main thread.
-    bool success = false;
-    
-    // Check if we're already on the Qt main thread
+    // startFlow() creates Qt objects and manipulates state that must live on
+    // the Qt main thread. Nim threads post the command instead of blocking on
+    // the main thread; the outcome is delivered as a signal.
     auto flowManager = StatusKeycard::FlowManager::instance();
-    if (QThread::currentThread() == flowManager->thread()) {
-        // Already on Qt thread - call directly to avoid deadlock
-        success = flowManager->startFlow(flowType, params);
-    } else {
-        // Different thread - marshal to Qt thread
-        QMetaObject::invokeMethod(flowManager,
-                                 [flowType, params, &success]() {
-            success = StatusKeycard::FlowManager::instance()->startFlow(flowType, params);
-        }, Qt::BlockingQueuedConnection);
+    if (QThread::currentThread() != flowManager->thread()) {
+        return acceptedResponse(flowManager->postStartFlow(flowType, params, batch));
     }
     
+    // Already on Qt thread - call directly
+    bool success = flowManager->startFlow(flowType, params, batch);
+    
     if (success) {
         const char* response = R"({"success": true})";
         return strdup(response);
@@ -305,22 +481,15 @@ char* KeycardResumeFlowWithContext(StatusKeycardContext ctx, const char* jsonPar
         }
     }
     
-    // IMPORTANT: Marshal to Qt main thread (same reason as startFlow)
-    bool success = false;
-    
-    // Check if we're already on the Qt main thread
+    // Post from foreign threads (same reason as startFlow)
     auto flowManager = StatusKeycard::FlowManager::instance();
-    if (QThread::currentThread() == flowManager->thread()) {
-        // Already on Qt thread - call directly to avoid deadlock
-        success = flowManager->resumeFlow(params);
-    } else {
-        // Different thread - marshal to Qt thread
-        QMetaObject::invokeMethod(flowManager,
-                                 [params, &success]() {
-            success = StatusKeycard::FlowManager::instance()->resumeFlow(params);
-        }, Qt::BlockingQueuedConnection);
+    if (QThread::currentThread() != flowManager->thread()) {
+        return acceptedResponse(flowManager->postResumeFlow(params));
     }
     
+    // Already on Qt thread - call directly
+    bool success = flowManager->resumeFlow(params);
+    
     if (success) {
         const char* response = R"({"success": true})";
         return strdup(response);
@@ -340,22 +509,15 @@ char* KeycardCancelFlowWithContext(StatusKeycardContext ctx) {
         return strdup(error);
     }
     
-    // IMPORTANT: Marshal to Qt main thread (same reason as startFlow)
-    bool success = false;
-    
-    // Check if we're already on the Qt main thread
+    // Post from foreign threads (same reason as startFlow)
     auto flowManager = StatusKeycard::FlowManager::instance();
-    if (QThread::currentThread() == flowManager->thread()) {
-        // Already on Qt thread - call directly to avoid deadlock
-        success = flowManager->cancelFlow();
-    } else {
-        // Different thread - marshal to Qt thread
-        QMetaObject::invokeMethod(flowManager,
-                                 [&success]() {
-            success = StatusKeycard::FlowManager::instance()->cancelFlow();
-        }, Qt::BlockingQueuedConnection);
+    if (QThread::currentThread() != flowManager->thread()) {
+        return acceptedResponse(flowManager->postCancelFlow());
     }
     
+    // Already on Qt thread - call directly
+    bool success = flowManager->cancelFlow();
+    
     if (success) {
         const char* response = R"({"success": true})";
         return strdup(response);
@@ -369,42 +531,80 @@ char* KeycardCancelFlowWithContext(StatusKeycardContext ctx) {
 // Mocked Functions (For testing)
 // ============================================================================
 
+// Virtual card farm of a context created with STATUS_KEYCARD_MOCKED set
+static StatusKeycard::VirtualCardFarm* virtualCardFarm(StatusKeycardContext ctx) {
+    if (!ctx) {
+        return nullptr;
+    }
+    return reinterpret_cast<StatusKeycardContextImpl*>(ctx)->virtualCards;
+}
+
+static char* mockedResponse(StatusKeycard::VirtualCardFarm* farm, const QString& error) {
+    QJsonObject obj;
+    obj["success"] = error.isEmpty();
+    if (!error.isEmpty()) {
+        obj["error"] = error;
+    }
+    if (farm) {
+        obj["farm"] = farm->stats();
+    }
+    QByteArray json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    return strdup(json.constData());
+}
+
+static const char* kMockedDisabled = "Mocked mode disabled (set STATUS_KEYCARD_MOCKED before creating the context)";
+
 char* MockedLibRegisterKeycardWithContext(StatusKeycardContext ctx, int cardIndex, int readerState, 
                                 int keycardState, const char* mockedKeycard, 
                                 const char* mockedKeycardHelper) {
-    (void)ctx;
-    (void)cardIndex;
-    (void)readerState;
-    (void)keycardState;
-    (void)mockedKeycard;
+    // Secure-channel payloads are not emulated, so the helper (exported keys) is unused
     (void)mockedKeycardHelper;
-    const char* response = R"({"success": true, "message": "Mocked functions not implemented in Qt version"})";
-    return strdup(response);
+
+    auto farm = virtualCardFarm(ctx);
+    if (!farm) {
+        return mockedResponse(nullptr, kMockedDisabled);
+    }
+    if (readerState < 0 || readerState > static_cast<int>(StatusKeycard::VirtualCardFarm::ReaderState::KeycardInserted)) {
+        return mockedResponse(farm, "Invalid reader state");
+    }
+    if (keycardState < 0 || keycardState > static_cast<int>(StatusKeycard::VirtualCardFarm::CardState::KeycardWithMnemonicAndMetadata)) {
+        return mockedResponse(farm, "Invalid keycard state");
+    }
+
+    QJsonObject card;
+    if (mockedKeycard && strlen(mockedKeycard) > 0) {
+        QJsonDocument doc = QJsonDocument::fromJson(QByteArray(mockedKeycard));
+        if (!doc.isObject()) {
+            return mockedResponse(farm, "Invalid mockedKeycard JSON");
+        }
+        card = doc.object();
+    }
+
+    QString error = farm->registerCard(cardIndex,
+                                       static_cast<StatusKeycard::VirtualCardFarm::ReaderState>(readerState),
+                                       static_cast<StatusKeycard::VirtualCardFarm::CardState>(keycardState),
+                                       card);
+    return mockedResponse(farm, error);
 }
 
 char* MockedLibReaderPluggedInWithContext(StatusKeycardContext ctx) {
-    (void)ctx;
-    const char* response = R"({"success": true})";
-    return strdup(response);
+    auto farm = virtualCardFarm(ctx);
+    return farm ? mockedResponse(farm, farm->plugReader()) : mockedResponse(nullptr, kMockedDisabled);
 }
 
 char* MockedLibReaderUnpluggedWithContext(StatusKeycardContext ctx) {
-    (void)ctx;
-    const char* response = R"({"success": true})";
-    return strdup(response);
+    auto farm = virtualCardFarm(ctx);
+    return farm ? mockedResponse(farm, farm->unplugReader()) : mockedResponse(nullptr, kMockedDisabled);
 }
 
 char* MockedLibKeycardInsertedWithContext(StatusKeycardContext ctx, int cardIndex) {
-    (void)ctx;
-    (void)cardIndex;
-    const char* response = R"({"success": true})";
-    return strdup(response);
+    auto farm = virtualCardFarm(ctx);
+    return farm ? mockedResponse(farm, farm->insertCard(cardIndex)) : mockedResponse(nullptr, kMockedDisabled);
 }
 
 char* MockedLibKeycardRemovedWithContext(StatusKeycardContext ctx) {
-    (void)ctx;
-    const char* response = R"({"success": true})";
-    return strdup(response);
+    auto farm = virtualCardFarm(ctx);
+    return farm ? mockedResponse(farm, farm->removeCard()) : mockedResponse(nullptr, kMockedDisabled);
 }
 
 // ============================================================================
@@ -432,6 +632,12 @@ void ResetAPI() {
     }
 }
 
+void ResetAPICold() {
+    if (g_global_context) {
+        ResetAPIColdWithContext(g_global_context);
+    }
+}
+
 // Wrapper: keycardInitFlow (Nim expects this signature)
 char* KeycardInitFlow(const char* storageDir) {
     ensure_global_context();
@@ -0,0 +1,234 @@
+#include "card_decoder.h"
+
+namespace StatusKeycard {
+
+namespace {
+
+// Non-hardened BIP32 indexes only; metadata never refers to hardened wallets
+constexpr quint64 MaxWalletIndex = 0x7FFFFFFF;
+constexpr int MaxTlvLengthBytes = 2;
+constexpr int MaxFindTags = 64;
+
+// Unsigned LEB128 into 32 bits: at most 5 bytes, the last one using 4 bits
+DecodeError readLeb128(const QByteArray& data, int& offset, quint32& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (offset >= data.size()) {
+            return DecodeError::Truncated;
+        }
+        quint8 byte = static_cast<quint8>(data[offset++]);
+        if (shift == 28 && (byte & 0xF0) != 0) {
+            return DecodeError::Leb128Overflow;
+        }
+        value |= static_cast<quint32>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return DecodeError::None;
+        }
+    }
+    return DecodeError::Leb128Overflow;
+}
+
+DecodeError readDerInteger(const QByteArray& data, int& offset, QByteArray& value)
+{
+    if (offset + 2 > data.size() || static_cast<quint8>(data[offset]) != 0x02) {
+        return DecodeError::DerMalformed;
+    }
+    int length = static_cast<quint8>(data[offset + 1]);
+    offset += 2;
+    // 32 bytes, plus one zero byte when the high bit is set
+    if (length == 0 || length > 33 || offset + length > data.size()) {
+        return DecodeError::DerMalformed;
+    }
+    if (length == 33 && data[offset] != 0) {
+        return DecodeError::DerMalformed;
+    }
+
+    value = length == 33 ? data.mid(offset + 1, 32) : data.mid(offset, length);
+    offset += length;
+    if (value.size() < 32) {
+        value.prepend(QByteArray(32 - value.size(), '\0'));
+    }
+    return DecodeError::None;
+}
+
+} // namespace
+
+const DecodeLimits& DecodeLimits::defaults()
+{
+    static const DecodeLimits limits;
+    return limits;
+}
+
+const char* decodeErrorString(DecodeError error)
+{
+    switch (error) {
+    case DecodeError::None:               return "";
+    case DecodeError::Truncated:          return "truncated";
+    case DecodeError::UnsupportedVersion: return "unsupported-version";
+    case DecodeError::Leb128Overflow:     return "leb128-overflow";
+    case DecodeError::IndexOverflow:      return "index-overflow";
+    case DecodeError::TooManyRanges:      return "too-many-ranges";
+    case DecodeError::TooManyWallets:     return "too-many-wallets";
+    case DecodeError::TlvInvalidLength:   return "tlv-invalid-length";
+    case DecodeError::TlvTooLong:         return "tlv-too-long";
+    case DecodeError::TlvTooDeep:         return "tlv-too-deep";
+    case DecodeError::TlvTooManyElements: return "tlv-too-many-elements";
+    case DecodeError::DerTooLarge:        return "der-too-large";
+    case DecodeError::DerMalformed:       return "der-malformed";
+    }
+    return "decode-error";
+}
+
+QVector<quint32> DecodedMetadata::walletIndexes() const
+{
+    QVector<quint32> indexes;
+    indexes.reserve(walletCount);
+    for (const Range& range : ranges) {
+        for (quint64 i = range.start; i <= static_cast<quint64>(range.start) + range.count; ++i) {
+            indexes.append(static_cast<quint32>(i));
+        }
+    }
+    return indexes;
+}
+
+DecodeError CardDecoder::decodeMetadata(const QByteArray& data, DecodedMetadata& metadata,
+                                        const DecodeLimits& limits)
+{
+    metadata = DecodedMetadata();
+
+    // Format: [version+namelen][name][start/count pairs in LEB128]
+    //   Byte 0: version (3 bits) + name length (5 bits)
+    if (data.isEmpty()) {
+        return DecodeError::Truncated;
+    }
+    quint8 header = static_cast<quint8>(data[0]);
+    int nameLength = header & 0x1F;
+    if ((header >> 5) != 1) {
+        return DecodeError::UnsupportedVersion;
+    }
+    if (1 + nameLength > data.size()) {
+        return DecodeError::Truncated;
+    }
+    metadata.name = QString::fromUtf8(data.constData() + 1, nameLength);
+
+    int offset = 1 + nameLength;
+    quint64 total = 0;
+    while (offset < data.size()) {
+        DecodedMetadata::Range range;
+        DecodeError error = readLeb128(data, offset, range.start);
+        if (error == DecodeError::None) {
+            error = readLeb128(data, offset, range.count);
+        }
+        if (error != DecodeError::None) {
+            return error;
+        }
+
+        if (metadata.ranges.size() >= limits.maxRanges) {
+            return DecodeError::TooManyRanges;
+        }
+        if (static_cast<quint64>(range.start) + range.count > MaxWalletIndex) {
+            return DecodeError::IndexOverflow;
+        }
+        total += static_cast<quint64>(range.count) + 1;
+        if (total > static_cast<quint64>(limits.maxWallets)) {
+            return DecodeError::TooManyWallets;
+        }
+        metadata.ranges.append(range);
+    }
+
+    metadata.walletCount = static_cast<int>(total);
+    return DecodeError::None;
+}
+
+DecodeError CardDecoder::findTlvTags(const QByteArray& data, const quint8* tags, QByteArray* values, int count,
+                                     int depth, const DecodeLimits& limits)
+{
+    Q_ASSERT(count <= MaxFindTags);
+    for (int i = 0; i < count; ++i) {
+        values[i].clear();
+    }
+    if (depth > limits.maxTlvDepth) {
+        return DecodeError::TlvTooDeep;
+    }
+
+    const int size = static_cast<int>(data.size());
+    quint64 found = 0;
+    const quint64 all = count >= MaxFindTags ? ~quint64(0) : (quint64(1) << count) - 1;
+    int offset = 0;
+    int elements = 0;
+
+    while (offset < size && found != all) {
+        if (++elements > limits.maxTlvElements) {
+            return DecodeError::TlvTooManyElements;
+        }
+
+        quint8 tag = static_cast<quint8>(data[offset++]);
+        if (offset >= size) {
+            return DecodeError::TlvInvalidLength;
+        }
+
+        // BER length: short form, or 0x81/0x82 followed by one or two bytes
+        int length = static_cast<quint8>(data[offset++]);
+        if (length & 0x80) {
+            int lengthBytes = length & 0x7F;
+            if (lengthBytes == 0 || lengthBytes > MaxTlvLengthBytes || offset + lengthBytes > size) {
+                return DecodeError::TlvInvalidLength;
+            }
+            length = 0;
+            for (int i = 0; i < lengthBytes; ++i) {
+                length = (length << 8) | static_cast<quint8>(data[offset++]);
+            }
+        }
+        if (length > limits.maxTlvLength) {
+            return DecodeError::TlvTooLong;
+        }
+        if (length > size - offset) {
+            return DecodeError::TlvInvalidLength;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            quint64 bit = quint64(1) << i;
+            if (tags[i] == tag && !(found & bit)) {
+                values[i] = data.mid(offset, length);
+                found |= bit;
+            }
+        }
+        offset += length;
+    }
+    return DecodeError::None;
+}
+
+QByteArray CardDecoder::findTlvTag(const QByteArray& data, quint8 tag, int depth)
+{
+    QByteArray value;
+    findTlvTags(data, &tag, &value, 1, depth);
+    return value;
+}
+
+DecodeError CardDecoder::decodeDerSignature(const QByteArray& sequence, QByteArray& r, QByteArray& s,
+                                            const DecodeLimits& limits)
+{
+    r.clear();
+    s.clear();
+    // Tag and one length byte around the SEQUENCE contents
+    if (sequence.size() + 2 > limits.maxDerSize) {
+        return DecodeError::DerTooLarge;
+    }
+
+    int offset = 0;
+    DecodeError error = readDerInteger(sequence, offset, r);
+    if (error == DecodeError::None) {
+        error = readDerInteger(sequence, offset, s);
+    }
+    if (error == DecodeError::None && offset != sequence.size()) {
+        error = DecodeError::DerMalformed;
+    }
+    if (error != DecodeError::None) {
+        r.clear();
+        s.clear();
+    }
+    return error;
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Hard limits for decoding data returned by a card
+ *
+ * A card is untrusted input: metadata, TLV responses and DER signatures are
+ * checked against these limits before anything is allocated for them, so a
+ * corrupted or hostile card costs at most a bounded amount of time and
+ * memory. Defaults leave ample room for what real Keycards return.
+ */
+struct DecodeLimits {
+    int maxWallets = 1024;      // Wallet paths expanded from one metadata blob
+    int maxRanges = 128;        // start/count pairs in one metadata blob
+    int maxTlvDepth = 4;        // Nested templates
+    int maxTlvLength = 1024;    // One TLV value
+    int maxTlvElements = 32;    // Elements scanned on one level
+    int maxDerSize = 72;        // secp256k1 ECDSA signature, SEQUENCE included
+
+    static const DecodeLimits& defaults();
+};
+
+enum class DecodeError {
+    None,
+    Truncated,
+    UnsupportedVersion,
+    Leb128Overflow,       // Varint does not fit 32 bits
+    IndexOverflow,        // Wallet index past the non-hardened range
+    TooManyRanges,
+    TooManyWallets,
+    TlvInvalidLength,     // Indefinite, over-long or past the end of the data
+    TlvTooLong,
+    TlvTooDeep,
+    TlvTooManyElements,
+    DerTooLarge,
+    DerMalformed
+};
+
+/**
+ * @brief Error code reported to callers (e.g. "too-many-wallets")
+ */
+const char* decodeErrorString(DecodeError error);
+
+/**
+ * @brief Card metadata (status-keycard-go types/metadata.go format)
+ *
+ * Wallets are kept as ranges; walletCount is their validated total, so
+ * callers can expand them knowing the size up front.
+ */
+struct DecodedMetadata {
+    struct Range {
+        quint32 start = 0;
+        quint32 count = 0;  // Range covers start..start+count inclusive
+    };
+
+    QString name;
+    QVector<Range> ranges;
+    int walletCount = 0;
+
+    // Wallet indexes in order (walletCount entries)
+    QVector<quint32> walletIndexes() const;
+};
+
+/**
+ * @brief Decoders for card responses, bounded by DecodeLimits
+ *
+ * Each decoder is a single forward pass; nothing is allocated before the
+ * input has been checked against the limits.
+ */
+class CardDecoder {
+public:
+    /**
+     * @brief Parse a metadata blob (GET DATA, public)
+     */
+    static DecodeError decodeMetadata(const QByteArray& data, DecodedMetadata& metadata,
+                                      const DecodeLimits& limits = DecodeLimits::defaults());
+
+    /**
+     * @brief Find several single-byte tags on one TLV level in one pass
+     *
+     * values[i] receives the first value of tags[i] (empty if absent).
+     * depth is the nesting level of data, for the depth limit.
+     */
+    static DecodeError findTlvTags(const QByteArray& data, const quint8* tags, QByteArray* values, int count,
+                                   int depth = 0, const DecodeLimits& limits = DecodeLimits::defaults());
+
+    // Single tag; empty on absence or error
+    static QByteArray findTlvTag(const QByteArray& data, quint8 tag, int depth = 0);
+
+    /**
+     * @brief Parse an ECDSA signature into 32-byte r and s
+     *
+     * @param sequence Contents of the DER SEQUENCE (tag 0x30), without the
+     *                 tag and length
+     */
+    static DecodeError decodeDerSignature(const QByteArray& sequence, QByteArray& r, QByteArray& s,
+                                          const DecodeLimits& limits = DecodeLimits::defaults());
+};
+
+} // namespace StatusKeycard
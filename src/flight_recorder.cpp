@@ -0,0 +1,402 @@
+#include "flight_recorder.h"
+#include "flow/flow_stats.h"
+#include "session/session_state.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QJsonObject>
+#include <QVector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace StatusKeycard {
+
+namespace {
+
+constexpr char Magic[8] = { 'S', 'K', 'F', 'L', 'T', 'R', 'E', 'C' };
+constexpr quint32 FormatVersion = 2;  // 2: wall clock timestamps per record
+
+// Plain copy of a slot taken by the reader
+struct Snapshot {
+    quint64 sequence;
+    qint64 timestampNs;
+    quint32 durationUs;
+    quint16 event;
+    quint16 status;
+    quint32 code;
+    quint32 arg;
+    char tag[FlightRecorder::TagSize];
+};
+
+QString hexByte(quint32 value, int width)
+{
+    return "0x" + QString::number(value, 16).rightJustified(width, QChar('0')).toUpper();
+}
+
+const char* outcomeName(quint16 outcome)
+{
+    switch (static_cast<FlowStats::Outcome>(outcome)) {
+    case FlowStats::Outcome::Completed: return "completed";
+    case FlowStats::Outcome::Failed:    return "failed";
+    case FlowStats::Outcome::Cancelled: return "cancelled";
+    case FlowStats::Outcome::Restarted: return "restarted";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+// Layout shared by the heap ring and the mapped file; records follow it
+struct FlightRecorder::Header {
+    char magic[8];
+    quint32 version;
+    quint32 recordSize;
+    quint64 capacity;
+    std::atomic<quint64> next;   // Next write index
+    char reserved[32];
+};
+static_assert(sizeof(std::atomic<quint64>) == sizeof(quint64), "ring file layout needs plain 64-bit atomics");
+
+FlightRecorder* FlightRecorder::s_instance = nullptr;
+
+FlightRecorder* FlightRecorder::instance()
+{
+    if (!s_instance) {
+        s_instance = new FlightRecorder();
+    }
+    return s_instance;
+}
+
+FlightRecorder::FlightRecorder()
+    : m_ring(nullptr)
+    , m_wallOffsetNs(QDateTime::currentMSecsSinceEpoch() * 1000000 - nowNs())
+{
+    const quint64 capacity = DefaultCapacity;
+    m_heapStorage.reset(new char[sizeof(Header) + capacity * sizeof(Record)]());
+    m_heapRing = std::make_unique<Ring>();
+    m_heapRing->header = reinterpret_cast<Header*>(m_heapStorage.get());
+    m_heapRing->records = reinterpret_cast<Record*>(m_heapStorage.get() + sizeof(Header));
+    m_heapRing->capacity = capacity;
+    initHeader(m_heapRing->header, capacity);
+    m_ring.store(m_heapRing.get(), std::memory_order_release);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+}
+
+void FlightRecorder::initHeader(Header* header, quint64 capacity)
+{
+    std::memcpy(header->magic, Magic, sizeof(Magic));
+    header->version = FormatVersion;
+    header->recordSize = sizeof(Record);
+    header->capacity = capacity;
+    header->next.store(0, std::memory_order_relaxed);
+}
+
+qint64 FlightRecorder::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool FlightRecorder::open(const QString& path, int capacity)
+{
+    QMutexLocker locker(&m_openMutex);
+
+    // Writers may still hold the current mapping, so it is never replaced
+    if (m_fileRing) {
+        if (m_file.fileName() == path) {
+            return true;
+        }
+        qWarning() << "FlightRecorder: Already recording to" << m_file.fileName();
+        return false;
+    }
+
+    const quint64 slots = static_cast<quint64>(qMax(16, capacity));
+    const qint64 size = static_cast<qint64>(sizeof(Header) + slots * sizeof(Record));
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qWarning() << "FlightRecorder: Cannot open" << path << m_file.errorString();
+        return false;
+    }
+
+    bool reuse = false;
+    if (m_file.size() == size) {
+        Header existing;
+        if (m_file.read(reinterpret_cast<char*>(&existing), sizeof(Header)) == sizeof(Header)) {
+            reuse = std::memcmp(existing.magic, Magic, sizeof(Magic)) == 0
+                    && existing.version == FormatVersion
+                    && existing.recordSize == sizeof(Record)
+                    && existing.capacity == slots;
+        }
+    }
+    if (!reuse && (!m_file.resize(0) || !m_file.resize(size))) {
+        qWarning() << "FlightRecorder: Cannot size" << path << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    uchar* data = m_file.map(0, size);
+    if (!data) {
+        qWarning() << "FlightRecorder: Cannot map" << path << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    auto ring = std::make_unique<Ring>();
+    ring->header = reinterpret_cast<Header*>(data);
+    ring->records = reinterpret_cast<Record*>(data + sizeof(Header));
+    ring->capacity = slots;
+    if (!reuse) {
+        std::memset(data, 0, static_cast<size_t>(size));
+        initHeader(ring->header, slots);
+    }
+
+    // Carry over what was recorded before the file existed
+    const Ring& heap = *m_heapRing;
+    quint64 end = heap.header->next.load(std::memory_order_acquire);
+    for (quint64 i = end - std::min(end, heap.capacity); i < end; ++i) {
+        const Record& from = heap.records[i % heap.capacity];
+        if (from.sequence.load(std::memory_order_acquire) != i + 1) {
+            continue;
+        }
+        quint64 index = ring->header->next.fetch_add(1, std::memory_order_relaxed);
+        Record& to = ring->records[index % ring->capacity];
+        to.timestampNs = from.timestampNs;
+        to.durationUs = from.durationUs;
+        to.event = from.event;
+        to.status = from.status;
+        to.code = from.code;
+        to.arg = from.arg;
+        std::memcpy(to.tag, from.tag, TagSize);
+        to.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    m_fileRing = std::move(ring);
+    m_ring.store(m_fileRing.get(), std::memory_order_release);
+    qDebug() << "FlightRecorder: Recording to" << path << (reuse ? "(appending)" : "(new)");
+    return true;
+}
+
+QString FlightRecorder::path() const
+{
+    QMutexLocker locker(&m_openMutex);
+    return m_fileRing ? m_file.fileName() : QString();
+}
+
+void FlightRecorder::record(Event event, quint32 code, quint16 status, qint64 durationUs,
+                            const char* tag, quint32 arg)
+{
+    Ring* ring = m_ring.load(std::memory_order_acquire);
+    quint64 index = ring->header->next.fetch_add(1, std::memory_order_relaxed);
+    Record& slot = ring->records[index % ring->capacity];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Wall time taken per record: a reused file mixes records of several
+    // runs, and monotonic clocks restart at boot
+    slot.timestampNs = nowNs() + m_wallOffsetNs;
+    slot.durationUs = static_cast<quint32>(qBound<qint64>(0, durationUs, 0xFFFFFFFF));
+    slot.event = static_cast<quint16>(event);
+    slot.status = status;
+    slot.code = code;
+    slot.arg = arg;
+    int n = 0;
+    if (tag) {
+        for (; n < TagSize - 1 && tag[n]; ++n) {
+            slot.tag[n] = tag[n];
+        }
+    }
+    std::memset(slot.tag + n, 0, TagSize - n);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::record(Event event, quint32 code, quint16 status, qint64 durationUs,
+                            const QString& tag, quint32 arg)
+{
+    // Latin-1 copy on the stack; names are ASCII
+    char buffer[TagSize];
+    int n = qMin<int>(static_cast<int>(tag.size()), TagSize - 1);
+    const QChar* chars = tag.constData();
+    for (int i = 0; i < n; ++i) {
+        ushort c = chars[i].unicode();
+        buffer[i] = c < 0x80 ? static_cast<char>(c) : '?';
+    }
+    buffer[n] = '\0';
+    record(event, code, status, durationUs, buffer, arg);
+}
+
+QJsonArray FlightRecorder::decode(const Ring& ring, qint64 lastMs)
+{
+    const quint64 end = ring.header->next.load(std::memory_order_acquire);
+    const quint64 begin = end - std::min(end, ring.capacity);
+
+    QVector<Snapshot> events;
+    events.reserve(static_cast<int>(end - begin));
+    for (quint64 i = begin; i < end; ++i) {
+        const Record& slot = ring.records[i % ring.capacity];
+        quint64 before = slot.sequence.load(std::memory_order_acquire);
+        if (before != i + 1) {
+            continue;  // Empty, overwritten or being written
+        }
+        Snapshot s;
+        s.sequence = before;
+        s.timestampNs = slot.timestampNs;
+        s.durationUs = slot.durationUs;
+        s.event = slot.event;
+        s.status = slot.status;
+        s.code = slot.code;
+        s.arg = slot.arg;
+        std::memcpy(s.tag, slot.tag, TagSize);
+        s.tag[TagSize - 1] = '\0';
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) {
+            continue;
+        }
+        events.append(s);
+    }
+
+    // Window ends at the newest event, so a file from a dead process decodes the same way
+    qint64 newestNs = 0;
+    for (const Snapshot& s : events) {
+        newestNs = std::max(newestNs, s.timestampNs);
+    }
+    const qint64 cutoffNs = lastMs > 0 ? newestNs - lastMs * 1000000 : std::numeric_limits<qint64>::min();
+
+    QJsonArray result;
+    for (const Snapshot& s : events) {
+        if (s.timestampNs < cutoffNs) {
+            continue;
+        }
+        Event event = static_cast<Event>(s.event);
+        QString tag = QString::fromLatin1(s.tag);
+
+        QJsonObject json;
+        json["seq"] = static_cast<double>(s.sequence);
+        json["time"] = static_cast<double>(s.timestampNs / 1000) / 1000.0;
+        json["event"] = eventName(event);
+        if (s.durationUs > 0) {
+            json["durationUs"] = static_cast<double>(s.durationUs);
+        }
+
+        switch (event) {
+        case Event::RpcStart:
+            json["method"] = tag;
+            break;
+        case Event::RpcEnd:
+            json["method"] = tag;
+            if (s.status != 0) {
+                json["error"] = static_cast<qint16>(s.status);
+            }
+            break;
+        case Event::FlowStart:
+            json["flowType"] = static_cast<int>(s.code);
+            break;
+        case Event::FlowEnd:
+            json["flowType"] = static_cast<int>(s.code);
+            json["outcome"] = outcomeName(s.status);
+            break;
+        case Event::FlowStep:
+            json["flowType"] = static_cast<int>(s.code);
+            json["step"] = tag;
+            break;
+        case Event::SessionState:
+            json["state"] = tag;
+            json["from"] = sessionStateToString(static_cast<SessionState>(s.arg));
+            break;
+        case Event::Apdu:
+            json["ins"] = hexByte(s.code, 2);
+            if (s.status != 0) {
+                json["sw"] = hexByte(s.status, 4);
+            }
+            break;
+        case Event::Signal:
+            json["type"] = tag;
+            break;
+        default:
+            json["code"] = static_cast<double>(s.code);
+            json["status"] = s.status;
+            json["arg"] = static_cast<double>(s.arg);
+            json["tag"] = tag;
+            break;
+        }
+        result.append(json);
+    }
+    return result;
+}
+
+QJsonArray FlightRecorder::dump(qint64 lastMs) const
+{
+    return decode(*m_ring.load(std::memory_order_acquire), lastMs);
+}
+
+bool FlightRecorder::decodeFile(const QString& path, qint64 lastMs, QJsonArray& events, QString& error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("cannot open %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    QByteArray data = file.readAll();
+
+    if (data.size() < static_cast<int>(sizeof(Header))) {
+        error = "not a flight recorder file";
+        return false;
+    }
+    Header* header = reinterpret_cast<Header*>(data.data());
+    if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->recordSize != sizeof(Record)) {
+        error = "not a flight recorder file";
+        return false;
+    }
+    if (header->version != FormatVersion) {
+        error = QString("unsupported flight recorder version %1").arg(header->version);
+        return false;
+    }
+    if (header->capacity == 0
+        || static_cast<quint64>(data.size()) < sizeof(Header) + header->capacity * sizeof(Record)) {
+        error = "truncated flight recorder file";
+        return false;
+    }
+
+    Ring ring;
+    ring.header = header;
+    ring.records = reinterpret_cast<Record*>(data.data() + sizeof(Header));
+    ring.capacity = header->capacity;
+    events = decode(ring, lastMs);
+    return true;
+}
+
+const char* FlightRecorder::eventName(Event event)
+{
+    switch (event) {
+    case Event::RpcStart:     return "rpcStart";
+    case Event::RpcEnd:       return "rpcEnd";
+    case Event::FlowStart:    return "flowStart";
+    case Event::FlowEnd:      return "flowEnd";
+    case Event::FlowStep:     return "flowStep";
+    case Event::SessionState: return "sessionState";
+    case Event::Apdu:         return "apdu";
+    case Event::Signal:       return "signal";
+    }
+    return "unknown";
+}
+
+void FlightRecorder::reset()
+{
+    QMutexLocker locker(&m_openMutex);
+    m_ring.store(m_heapRing.get(), std::memory_order_release);
+    if (m_fileRing) {
+        m_file.unmap(reinterpret_cast<uchar*>(m_fileRing->header));
+        m_file.close();
+        m_fileRing.reset();
+    }
+    std::memset(m_heapRing->records, 0, m_heapRing->capacity * sizeof(Record));
+    initHeader(m_heapRing->header, m_heapRing->capacity);
+}
+
+} // namespace StatusKeycard
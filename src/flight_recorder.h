@@ -0,0 +1,121 @@
+#pragma once
+
+#include <QFile>
+#include <QJsonArray>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Always-on event recorder for post-mortem diagnostics
+ *
+ * Fixed-size binary records are written into a ring. The ring starts on the
+ * heap and moves into a memory-mapped file once open() is called (done by
+ * keycard.Start, next to the pairing storage), so the last few thousand
+ * events survive a crash or a hung process and can be decoded later with
+ * decodeFile().
+ *
+ * Recording is lock-free: one atomic increment, one clock read and a 64-byte
+ * copy. Each slot carries a sequence number written last, so readers can
+ * detect and skip slots that were being overwritten.
+ *
+ * Records hold only event kinds, names (RPC method, flow step, signal type),
+ * INS/SW bytes, enum values and durations. Never pass params, PINs, keys or
+ * card data as a tag.
+ */
+class FlightRecorder {
+public:
+    static constexpr int DefaultCapacity = 4096;
+    static constexpr int TagSize = 32;
+
+    enum class Event : quint16 {
+        RpcStart = 1,       // tag: method
+        RpcEnd = 2,         // tag: method, status: 0 or JSON-RPC error code
+        FlowStart = 3,      // code: flow type
+        FlowEnd = 4,        // code: flow type, status: FlowStats::Outcome
+        FlowStep = 5,       // code: flow type, tag: step name
+        SessionState = 6,   // code: new state, arg: old state, tag: new state name
+        Apdu = 7,           // code: INS, status: SW (0 when not seen)
+        Signal = 8          // tag: signal type
+    };
+
+    struct Record {
+        std::atomic<quint64> sequence;  // Write index + 1; 0 while empty or being written
+        qint64 timestampNs;             // Wall clock, advanced by the monotonic clock
+        quint32 durationUs;
+        quint16 event;
+        quint16 status;
+        quint32 code;
+        quint32 arg;
+        char tag[TagSize];              // NUL-padded, truncated
+    };
+    static_assert(sizeof(Record) == 64, "flight recorder records are one cache line");
+
+    static FlightRecorder* instance();
+
+    /**
+     * @brief Move the ring into a memory-mapped file
+     *
+     * An existing file with a matching layout is reused and appended to, so
+     * events from a previous run stay readable. Events recorded on the heap
+     * before the call are copied over.
+     *
+     * @return false if the file cannot be created or mapped (recording
+     *         continues on the heap)
+     */
+    bool open(const QString& path, int capacity = DefaultCapacity);
+    QString path() const;
+
+    void record(Event event, quint32 code = 0, quint16 status = 0, qint64 durationUs = 0,
+                const char* tag = nullptr, quint32 arg = 0);
+    void record(Event event, quint32 code, quint16 status, qint64 durationUs,
+                const QString& tag, quint32 arg = 0);
+
+    /**
+     * @brief Decoded events from the last lastMs milliseconds, oldest first
+     *
+     * lastMs <= 0 returns the whole ring.
+     */
+    QJsonArray dump(qint64 lastMs) const;
+
+    /**
+     * @brief Decode a ring file written by this or an earlier process
+     *
+     * @return false if the file is missing or not a flight recorder file
+     */
+    static bool decodeFile(const QString& path, qint64 lastMs, QJsonArray& events, QString& error);
+
+    static const char* eventName(Event event);
+    static qint64 nowNs();
+
+    // Drop the file mapping and all events (tests)
+    void reset();
+
+private:
+    struct Header;
+    struct Ring {
+        Header* header = nullptr;
+        Record* records = nullptr;
+        quint64 capacity = 0;
+    };
+
+    FlightRecorder();
+    ~FlightRecorder();
+
+    static QJsonArray decode(const Ring& ring, qint64 lastMs);
+    static void initHeader(Header* header, quint64 capacity);
+
+    std::atomic<Ring*> m_ring;
+    std::unique_ptr<Ring> m_heapRing;
+    std::unique_ptr<char[]> m_heapStorage;
+    std::unique_ptr<Ring> m_fileRing;
+    const qint64 m_wallOffsetNs;  // Wall clock minus monotonic clock at startup
+    QFile m_file;
+    mutable QMutex m_openMutex;
+    static FlightRecorder* s_instance;
+};
+
+} // namespace StatusKeycard
@@ -0,0 +1,54 @@
+#include "flow_command_mailbox.h"
+
+namespace StatusKeycard {
+
+FlowCommandMailbox::~FlowCommandMailbox()
+{
+    Node* node = m_head.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+bool FlowCommandMailbox::post(const FlowCommand& command)
+{
+    Node* node = new Node{command, nullptr};
+
+    Node* head = m_head.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!m_head.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+    return head == nullptr;
+}
+
+QVector<FlowCommand> FlowCommandMailbox::takeAll()
+{
+    Node* node = m_head.exchange(nullptr, std::memory_order_acquire);
+
+    // The stack is newest first; reverse into posting order
+    Node* ordered = nullptr;
+    int count = 0;
+    while (node) {
+        Node* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+        ++count;
+    }
+
+    QVector<FlowCommand> commands;
+    commands.reserve(count);
+    while (ordered) {
+        Node* next = ordered->next;
+        commands.append(std::move(ordered->command));
+        delete ordered;
+        ordered = next;
+    }
+
+    return commands;
+}
+
+} // namespace StatusKeycard
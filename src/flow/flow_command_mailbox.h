@@ -0,0 +1,74 @@
+#ifndef FLOW_COMMAND_MAILBOX_H
+#define FLOW_COMMAND_MAILBOX_H
+
+#include "../request_decoder.h"
+#include <QJsonObject>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Flow control command posted from a foreign thread
+ */
+struct FlowCommand {
+    enum class Kind {
+        Start,
+        Resume,
+        Cancel
+    };
+
+    quint64 token = 0;
+    Kind kind = Kind::Start;
+    int flowType = -1;       // Start only
+    QJsonObject params;      // Start/Resume
+    std::shared_ptr<const RequestBatch> batch;  // Start only, optional
+};
+
+/**
+ * @brief Lock-free multi-producer, single-consumer command mailbox
+ *
+ * Producers (C API callers on any thread) push onto an atomic singly linked
+ * stack; the consumer (FlowManager's thread) takes the whole stack with one
+ * exchange and reverses it, so commands are drained in posting order.
+ *
+ * post() returns true when the mailbox was empty, i.e. when the caller must
+ * schedule a drain; later posts piggyback on the already scheduled one.
+ */
+class FlowCommandMailbox {
+public:
+    FlowCommandMailbox() = default;
+    ~FlowCommandMailbox();
+    FlowCommandMailbox(const FlowCommandMailbox&) = delete;
+    FlowCommandMailbox& operator=(const FlowCommandMailbox&) = delete;
+
+    /**
+     * @brief Post a command (any thread)
+     * @return true if the mailbox was empty before this post
+     */
+    bool post(const FlowCommand& command);
+
+    /**
+     * @brief Take all pending commands in posting order (consumer thread only)
+     */
+    QVector<FlowCommand> takeAll();
+
+    /**
+     * @brief Allocate a new acceptance token (any thread)
+     */
+    quint64 nextToken() { return m_nextToken.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    struct Node {
+        FlowCommand command;
+        Node* next = nullptr;
+    };
+
+    std::atomic<Node*> m_head {nullptr};
+    std::atomic<quint64> m_nextToken {1};
+};
+
+} // namespace StatusKeycard
+
+#endif // FLOW_COMMAND_MAILBOX_H
@@ -1,26 +1,19 @@
 #include "flow_manager.h"
 #include "flow_signals.h"
 #include "flow_params.h"
+#include "flow_registry.h"
 #include "flows/flow_base.h"
-#include "flows/login_flow.h"
-#include "flows/get_app_info_flow.h"
-#include "flows/recover_account_flow.h"
-#include "flows/load_account_flow.h"
-#include "flows/sign_flow.h"
-#include "flows/change_pin_flow.h"
-#include "flows/change_puk_flow.h"
-#include "flows/change_pairing_flow.h"
-#include "flows/export_public_flow.h"
-#include "flows/get_metadata_flow.h"
-#include "flows/store_metadata_flow.h"
+#include "../hex_codec.h"
 #include <keycard-qt/keycard_channel.h>
 #include <keycard-qt/command_set.h>
 #include <keycard-qt/backends/keycard_channel_backend.h>  // For ChannelState enum
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QMutexLocker>
 #include <QThread>
 #include <QTimer>
 #include <QtConcurrent>
+#include <climits>
 
 namespace StatusKeycard {
 
@@ -54,7 +47,10 @@ FlowManager::FlowManager(QObject* parent)
     , m_currentFlowType(FlowType::GetAppInfo) // Default
     , m_waitingForCard(false)
     , m_currentCardUid("")
+    , m_queueTimer(new QTimer(this))
 {
+    m_queueTimer->setSingleShot(true);
+    connect(m_queueTimer, &QTimer::timeout, this, &FlowManager::expireQueuedFlows);
     qDebug() << "FlowManager: Created";
 }
 
@@ -92,7 +88,26 @@ bool FlowManager::init(std::shared_ptr<Keycard::CommandSet> commandSet)
     return true;
 }
 
-bool FlowManager::startFlow(int flowType, const QJsonObject& params)
+void FlowManager::setCostModel(std::shared_ptr<ApduCostModel> model)
+{
+    QMutexLocker locker(&m_costModelMutex);
+    m_costModel = std::move(model);
+}
+
+std::shared_ptr<ApduCostModel> FlowManager::costModel() const
+{
+    QMutexLocker locker(&m_costModelMutex);
+    return m_costModel;
+}
+
+bool FlowManager::startFlow(int flowType, const QJsonObject& params,
+                            std::shared_ptr<const RequestBatch> batch)
+{
+    return startFlow(flowType, params, std::move(batch), false);
+}
+
+bool FlowManager::startFlow(int flowType, const QJsonObject& params,
+                            std::shared_ptr<const RequestBatch> batch, bool fromQueue)
 {
     QMutexLocker locker(&m_mutex);
     
@@ -105,16 +120,50 @@ bool FlowManager::startFlow(int flowType, const QJsonObject& params)
         return false;
     }
     
-    // Check state
-    if (m_stateMachine->state() != FlowState::Idle) {
-        m_lastError = "Flow already running";
-        qWarning() << "FlowManager: Cannot start flow - already running";
+    // Check flow type against the registry
+    const FlowDescriptor* descriptor = FlowRegistry::find(flowType);
+    if (!descriptor || !descriptor->create) {
+        m_lastError = descriptor ? QString("Flow type not implemented: %1").arg(descriptor->name)
+                                 : QString("Unknown flow type: %1").arg(flowType);
+        qWarning() << "FlowManager: Cannot start flow -" << m_lastError;
         return false;
     }
     
+    // Queue options are for FlowManager only
+    QJsonObject flowParams = params;
+    const int priority = flowParams.take(FlowParams::QUEUE_PRIORITY).toInt(0);
+    const qint64 deadlineMs = static_cast<qint64>(flowParams.take(FlowParams::QUEUE_DEADLINE).toDouble(0));
+    
+    // Another flow is active (or earlier starts are still waiting): queue
+    // instead of failing
+    const bool busy = m_stateMachine->state() != FlowState::Idle;
+    if (busy || (!fromQueue && !m_queue.isEmpty())) {
+        const quint64 id = m_queue.enqueue(flowType, flowParams, std::move(batch), priority, deadlineMs);
+        if (id == 0) {
+            m_lastError = m_queue.capacity() > 0 ? QString("Flow queue full") : QString("Flow already running");
+            qWarning() << "FlowManager: Cannot start flow -" << m_lastError;
+            return false;
+        }
+        qDebug() << "FlowManager: Flow queued, id:" << id << "position:" << m_queue.position(id);
+        armQueueTimer();
+        
+        locker.unlock();
+        reportQueuePositions();
+        if (!busy) {
+            QMetaObject::invokeMethod(this, &FlowManager::startNextQueuedFlow, Qt::QueuedConnection);
+        }
+        return true;
+    }
+    
+    for (auto it = flowParams.begin(); it != flowParams.end(); ++it) {
+        if (!FlowRegistry::acceptsParam(*descriptor, it.key())) {
+            qDebug() << "FlowManager: Parameter not used by" << descriptor->name << "flow:" << it.key();
+        }
+    }
+    
     // Store flow info
     m_currentFlowType = static_cast<FlowType>(flowType);
-    m_currentParams = params;
+    m_currentParams = flowParams;
     
     // Create flow
     m_currentFlow = createFlow(m_currentFlowType, m_currentParams);
@@ -123,6 +172,7 @@ bool FlowManager::startFlow(int flowType, const QJsonObject& params)
         qCritical() << "FlowManager: Failed to create flow type:" << flowType;
         return false;
     }
+    m_currentFlow->setRequestBatch(std::move(batch));
     
     // Connect flow signals
     connect(m_currentFlow, &FlowBase::flowPaused,
@@ -210,9 +260,208 @@ bool FlowManager::cancelFlow()
     cleanupFlow();
     
     qDebug() << "FlowManager: Flow cancelled";
+    
+    // Queued flows are independent of the cancelled one
+    QMetaObject::invokeMethod(this, &FlowManager::startNextQueuedFlow, Qt::QueuedConnection);
     return true;
 }
 
+// ============================================================================
+// Flow queue
+// ============================================================================
+
+void FlowManager::setQueueCapacity(int capacity)
+{
+    QMutexLocker locker(&m_mutex);
+    m_queue.setCapacity(capacity);
+}
+
+int FlowManager::queueLength() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_queue.size();
+}
+
+void FlowManager::startNextQueuedFlow()
+{
+    while (true) {
+        QMutexLocker locker(&m_mutex);
+        if (m_stateMachine->state() != FlowState::Idle || m_currentFlow) {
+            return;
+        }
+        
+        QVector<QueuedFlow> expired = m_queue.takeExpired();
+        QueuedFlow next;
+        const bool hasNext = m_queue.takeNext(next);
+        const qint64 waitedMs = hasNext ? m_queue.waitedMs(next) : 0;
+        locker.unlock();
+        
+        reportExpired(expired);
+        if (!hasNext) {
+            return;
+        }
+        
+        QJsonObject event;
+        event["queue-id"] = QString::number(next.id);
+        event["flow-type"] = next.flowType;
+        event["waited-ms"] = static_cast<double>(waitedMs);
+        event["started"] = true;
+        emit flowSignal(FlowSignals::FLOW_DEQUEUED, event);
+        reportQueuePositions();
+        
+        if (startFlow(next.flowType, next.params, next.batch, true)) {
+            return;
+        }
+        
+        // The caller was told the start was accepted; report the failure as its result
+        QJsonObject result;
+        result[FlowParams::ERROR_KEY] = lastError();
+        FlowSignals::emitFlowResult(result);
+    }
+}
+
+void FlowManager::expireQueuedFlows()
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<QueuedFlow> expired = m_queue.takeExpired();
+    locker.unlock();
+    
+    reportExpired(expired);
+    if (!expired.isEmpty()) {
+        reportQueuePositions();
+    }
+}
+
+void FlowManager::reportExpired(const QVector<QueuedFlow>& expired)
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<QJsonObject> events;
+    for (const QueuedFlow& flow : expired) {
+        qWarning() << "FlowManager: Queued flow" << flow.id << "expired after" << m_queue.waitedMs(flow) << "ms";
+        QJsonObject event;
+        event["queue-id"] = QString::number(flow.id);
+        event["flow-type"] = flow.flowType;
+        event["waited-ms"] = static_cast<double>(m_queue.waitedMs(flow));
+        event["started"] = false;
+        event[FlowParams::ERROR_KEY] = QString("queue-deadline-expired");
+        events.append(event);
+    }
+    armQueueTimer();
+    locker.unlock();
+    
+    for (const QJsonObject& event : events) {
+        emit flowSignal(FlowSignals::FLOW_DEQUEUED, event);
+    }
+}
+
+void FlowManager::armQueueTimer()
+{
+    const qint64 untilDeadline = m_queue.msUntilNextDeadline();
+    if (untilDeadline >= 0) {
+        m_queueTimer->start(static_cast<int>(qMin<qint64>(untilDeadline, INT_MAX)));
+    } else {
+        m_queueTimer->stop();
+    }
+}
+
+void FlowManager::reportQueuePositions()
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<QJsonObject> events;
+    const QVector<QueuedFlow>& entries = m_queue.entries();
+    for (int i = 0; i < entries.size(); ++i) {
+        QJsonObject event;
+        event["queue-id"] = QString::number(entries[i].id);
+        event["flow-type"] = entries[i].flowType;
+        event["priority"] = entries[i].priority;
+        event["position"] = i;
+        event["queue-length"] = entries.size();
+        event["waited-ms"] = static_cast<double>(m_queue.waitedMs(entries[i]));
+        events.append(event);
+    }
+    locker.unlock();
+    
+    for (const QJsonObject& event : events) {
+        emit flowSignal(FlowSignals::FLOW_QUEUED, event);
+    }
+}
+
+// ============================================================================
+// Posted commands (non-blocking C API entry points)
+// ============================================================================
+
+quint64 FlowManager::postStartFlow(int flowType, const QJsonObject& params,
+                                   std::shared_ptr<const RequestBatch> batch)
+{
+    FlowCommand command;
+    command.kind = FlowCommand::Kind::Start;
+    command.flowType = flowType;
+    command.params = params;
+    command.batch = std::move(batch);
+    return postCommand(std::move(command));
+}
+
+quint64 FlowManager::postResumeFlow(const QJsonObject& params)
+{
+    FlowCommand command;
+    command.kind = FlowCommand::Kind::Resume;
+    command.params = params;
+    return postCommand(std::move(command));
+}
+
+quint64 FlowManager::postCancelFlow()
+{
+    FlowCommand command;
+    command.kind = FlowCommand::Kind::Cancel;
+    return postCommand(std::move(command));
+}
+
+quint64 FlowManager::postCommand(FlowCommand command)
+{
+    command.token = m_mailbox.nextToken();
+    const quint64 token = command.token;
+
+    // Only the post that makes the mailbox non-empty schedules a drain;
+    // the drain takes everything queued up to that point
+    if (m_mailbox.post(command)) {
+        QMetaObject::invokeMethod(this, "drainCommands", Qt::QueuedConnection);
+    }
+    return token;
+}
+
+void FlowManager::drainCommands()
+{
+    const QVector<FlowCommand> commands = m_mailbox.takeAll();
+
+    for (const FlowCommand& command : commands) {
+        bool success = false;
+        QString name;
+        switch (command.kind) {
+        case FlowCommand::Kind::Start:
+            name = "start";
+            success = startFlow(command.flowType, command.params, command.batch);
+            break;
+        case FlowCommand::Kind::Resume:
+            name = "resume";
+            success = resumeFlow(command.params);
+            break;
+        case FlowCommand::Kind::Cancel:
+            name = "cancel";
+            success = cancelFlow();
+            break;
+        }
+
+        QJsonObject event;
+        event["token"] = QString::number(command.token);
+        event["command"] = name;
+        event["success"] = success;
+        if (!success) {
+            event[FlowParams::ERROR_KEY] = lastError();
+        }
+        emit flowSignal(FlowSignals::FLOW_COMMAND_RESULT, event);
+    }
+}
+
 FlowState FlowManager::state() const
 {
     return m_stateMachine->state();
@@ -312,8 +561,9 @@ void FlowManager::onFlowCompleted(const QJsonObject& result)
     // Emit result signal
     FlowSignals::emitFlowResult(result);
     
-    // Cleanup
-    cleanupFlow();
+    // Cleanup and hand the card over to the next queued flow
+    cleanupFlow(canHandOver(result));
+    startNextQueuedFlow();
 }
 
 void FlowManager::onFlowError(const QString& error)
@@ -343,8 +593,9 @@ void FlowManager::onFlowError(const QString& error)
     // Emit error result
     FlowSignals::emitFlowResult(result);
     
-    // Cleanup
+    // The card may be in any state after an error; the next flow starts fresh
     cleanupFlow();
+    startNextQueuedFlow();
 }
 
 // ============================================================================
@@ -355,46 +606,14 @@ FlowBase* FlowManager::createFlow(FlowType flowType, const QJsonObject& params)
 {
     qDebug() << "FlowManager: Creating flow type:" << static_cast<int>(flowType);
     
-    switch (flowType) {
-        case FlowType::Login:
-            return new LoginFlow(this, params);
-            
-        case FlowType::GetAppInfo:
-            return new GetAppInfoFlow(this, params);
-            
-        case FlowType::RecoverAccount:
-            return new RecoverAccountFlow(this, params);
-            
-        case FlowType::LoadAccount:
-            return new LoadAccountFlow(this, params);
-            
-        case FlowType::Sign:
-            return new SignFlow(this, params);
-            
-        case FlowType::GetMetadata:
-            return new GetMetadataFlow(this, params);
-            
-        case FlowType::StoreMetadata:
-            return new StoreMetadataFlow(this, params);
-            
-        case FlowType::ChangePIN:
-            return new ChangePINFlow(this, params);
-            
-        case FlowType::ChangePUK:
-            return new ChangePUKFlow(this, params);
-            
-        case FlowType::ChangePairing:
-            return new ChangePairingFlow(this, params);
-            
-        case FlowType::ExportPublic:
-            return new ExportPublicFlow(this, params);
-            
-        default:
-            qWarning() << "FlowManager: Unknown flow type:" << static_cast<int>(flowType);
-            break;
+    const FlowDescriptor* descriptor = FlowRegistry::find(static_cast<int>(flowType));
+    if (!descriptor || !descriptor->create) {
+        qWarning() << "FlowManager: Unknown flow type:" << static_cast<int>(flowType);
+        return nullptr;
     }
     
-    return nullptr;
+    m_stats.recordStarted(flowType);
+    return descriptor->create(this, params);
 }
 
 void FlowManager::runFlowAsync()
@@ -425,13 +644,20 @@ void FlowManager::runFlowAsync()
                 flow->resetRestartFlag();
             }
             
-            // Execute flow
+            // Execute flow (timed without the time spent paused for user input)
+            FlowType flowType = flow->flowType();
+            QElapsedTimer timer;
+            timer.start();
+            qint64 pausedBefore = flow->pausedMs();
+            auto activeMs = [&]() { return timer.elapsed() - (flow->pausedMs() - pausedBefore); };
+            
             try {
                 result = flow->execute();
                 
                 // Check if cancelled
                 if (flow->isCancelled()) {
                     qDebug() << "FlowManager: Flow was cancelled";
+                    m_stats.recordExecution(flowType, activeMs(), FlowStats::Outcome::Cancelled);
                     return;  // Exit without emitting completion
                 }
                 
@@ -440,19 +666,25 @@ void FlowManager::runFlowAsync()
                 
                 if (shouldRestart) {
                     qDebug() << "FlowManager: Flow requested restart (card swap)";
+                    m_stats.recordExecution(flowType, activeMs(), FlowStats::Outcome::Restarted);
                     // Loop will restart execution
                 } else {
                     // Flow completed successfully
                     qDebug() << "FlowManager: Flow execution completed";
+                    bool failed = FlowResult::isError(result);
+                    m_stats.recordExecution(flowType, activeMs(),
+                                            failed ? FlowStats::Outcome::Failed : FlowStats::Outcome::Completed);
                     emit flow->flowCompleted(result);
                 }
                 
             } catch (const std::exception& e) {
                 qCritical() << "FlowManager: Exception in flow execution:" << e.what();
+                m_stats.recordExecution(flowType, activeMs(), FlowStats::Outcome::Failed);
                 emit flow->flowError(QString("Exception: %1").arg(e.what()));
                 return;  // Exit on exception
             } catch (...) {
                 qCritical() << "FlowManager: Unknown exception in flow execution";
+                m_stats.recordExecution(flowType, activeMs(), FlowStats::Outcome::Failed);
                 emit flow->flowError("Unknown exception");
                 return;  // Exit on exception
             }
@@ -463,13 +695,28 @@ void FlowManager::runFlowAsync()
     });
 }
 
-void FlowManager::cleanupFlow()
+bool FlowManager::canHandOver(const QJsonObject& result)
+{
+    if (FlowResult::isError(result)) {
+        return false;
+    }
+    
+    // Only entries that will actually run count
+    expireQueuedFlows();
+    
+    QMutexLocker locker(&m_mutex);
+    return !m_currentCardUid.isEmpty() && m_queue.size() > 0;
+}
+
+void FlowManager::cleanupFlow(bool handover)
 {
     qDebug() << "FlowManager: Cleaning up flow";
     
     // Interrupt any waiting operations by disconnecting channel
-    // This will cause waitForCard() to exit immediately
-    if (m_channel) {
+    // This will cause waitForCard() to exit immediately. On handover the
+    // flow has already finished, so the reader session (and the secure
+    // channel in the shared CommandSet) stays up for the next flow.
+    if (m_channel && !handover) {
         m_channel->setState(Keycard::ChannelState::Idle);
     }
     
@@ -491,8 +738,11 @@ void FlowManager::cleanupFlow()
     // Don't stop detection - it runs continuously
     // Detection will keep running for next flow
     
-    // Clear card tracking so next flow starts fresh
-    m_currentCardUid.clear();
+    // Clear card tracking so next flow starts fresh (a handed-over card is
+    // still connected, so keep it to avoid re-running detection)
+    if (!handover) {
+        m_currentCardUid.clear();
+    }
     
     if (m_currentFlow) {
         // Disconnect all signals to prevent callbacks on deleted object
@@ -522,11 +772,11 @@ QJsonObject FlowManager::buildCardInfoFromCommandSet() const
         Keycard::ApplicationInfo appInfo = m_commandSet->applicationInfo();
         
         if (!appInfo.instanceUID.isEmpty()) {
-            json[FlowParams::INSTANCE_UID] = QString::fromLatin1(appInfo.instanceUID.toHex());
+            json[FlowParams::INSTANCE_UID] = HexCodec::toHex(appInfo.instanceUID);
         }
         
         if (!appInfo.keyUID.isEmpty()) {
-            json[FlowParams::KEY_UID] = QString::fromLatin1(appInfo.keyUID.toHex());
+            json[FlowParams::KEY_UID] = HexCodec::toHex(appInfo.keyUID);
         }
         
         if (appInfo.availableSlots > 0) {
@@ -3,10 +3,14 @@
 
 #include "flow_types.h"
 #include "flow_state_machine.h"
+#include "flow_stats.h"
+#include "flow_command_mailbox.h"
+#include "flow_queue.h"
 #include <QObject>
 #include <QJsonObject>
 #include <QMutex>
 #include <QFuture>
+#include <QTimer>
 #include <memory>
 
 // Forward declarations
@@ -18,6 +22,7 @@ namespace Keycard {
 namespace StatusKeycard {
 
 class FlowBase;
+class ApduCostModel;
 
 /**
  * @brief Flow Manager - Main coordinator for Flow API
@@ -27,6 +32,7 @@ class FlowBase;
  * - Uses KeycardChannel and shared CommandSet
  * - Handles NFC events (card detected/removed)
  * - Routes signals to/from flows
+ * - Queues flow starts while a flow is active
  * - Integrates with C API
  * 
  * Thread-safe.
@@ -57,11 +63,19 @@ public:
     
     /**
      * @brief Start a flow
+     *
+     * If another flow is active the start is queued instead and begins as
+     * soon as that flow finishes (see FlowQueue). The optional
+     * "queue-priority" and "queue-deadline-ms" params order the queue and
+     * bound the wait; they are not passed on to the flow.
+     *
      * @param flowType Flow type to start
      * @param params Flow parameters
-     * @return true if started successfully
+     * @param batch Batch arrays decoded from the raw payload (optional)
+     * @return true if started or queued
      */
-    bool startFlow(int flowType, const QJsonObject& params);
+    bool startFlow(int flowType, const QJsonObject& params,
+                   std::shared_ptr<const RequestBatch> batch = nullptr);
     
     /**
      * @brief Resume paused flow
@@ -76,6 +90,31 @@ public:
      */
     bool cancelFlow();
     
+    /**
+     * @brief Post start/resume/cancel without waiting for the flow thread
+     *
+     * Safe to call from any thread: the command is pushed onto a lock-free
+     * mailbox and executed on FlowManager's thread. The returned token is
+     * echoed in the FLOW_COMMAND_RESULT signal carrying the outcome.
+     *
+     * @return Acceptance token (never 0)
+     */
+    quint64 postStartFlow(int flowType, const QJsonObject& params,
+                          std::shared_ptr<const RequestBatch> batch = nullptr);
+    quint64 postResumeFlow(const QJsonObject& params);
+    quint64 postCancelFlow();
+
+    /**
+     * @brief Maximum number of queued flow starts (0 restores rejecting
+     *        starts while a flow is active)
+     */
+    void setQueueCapacity(int capacity);
+
+    /**
+     * @brief Number of flows waiting to start
+     */
+    int queueLength() const;
+
     /**
      * @brief Get current flow state
      */
@@ -108,6 +147,21 @@ public:
      * across multiple flows, matching status-keycard-go's behavior.
      */
     std::shared_ptr<Keycard::CommandSet> commandSet() const { return m_commandSet; }
+
+    /**
+     * @brief Per-flow-type execution statistics (recorded automatically)
+     */
+    FlowStats& stats() { return m_stats; }
+    const FlowStats& stats() const { return m_stats; }
+
+    /**
+     * @brief Cost model fed by the EXPORT KEY and SIGN calls flows make
+     *
+     * The session's model (SessionManager::sharedCostModel), so that
+     * keycard.ExplainPlan estimates learn from flows too. Null until set.
+     */
+    void setCostModel(std::shared_ptr<ApduCostModel> model);
+    std::shared_ptr<ApduCostModel> costModel() const;
     
 signals:
     /**
@@ -128,6 +182,16 @@ private slots:
      * @brief Handle card removed event from NFC
      */
     void onCardRemoved();
+
+    /**
+     * @brief Execute all posted commands in order (FlowManager thread)
+     */
+    void drainCommands();
+
+    /**
+     * @brief Drop queued flows whose deadline passed (queue timer)
+     */
+    void expireQueuedFlows();
     
 private:
     /**
@@ -170,6 +234,37 @@ private:
      */
     FlowBase* createFlow(FlowType flowType, const QJsonObject& params);
     
+    /**
+     * @brief Push a command onto the mailbox and schedule a drain if needed
+     */
+    quint64 postCommand(FlowCommand command);
+
+    /**
+     * @brief Start a flow; fromQueue bypasses the queue for an entry just taken from it
+     */
+    bool startFlow(int flowType, const QJsonObject& params,
+                   std::shared_ptr<const RequestBatch> batch, bool fromQueue);
+
+    /**
+     * @brief Start the next queued flow if no flow is active
+     */
+    void startNextQueuedFlow();
+
+    /**
+     * @brief Emit FLOW_DEQUEUED for expired entries and re-arm the deadline timer
+     */
+    void reportExpired(const QVector<QueuedFlow>& expired);
+
+    /**
+     * @brief Schedule the queue timer for the earliest deadline (m_mutex held)
+     */
+    void armQueueTimer();
+
+    /**
+     * @brief Emit FLOW_QUEUED with the current position of every queued flow
+     */
+    void reportQueuePositions();
+
     /**
      * @brief Run flow in separate thread
      */
@@ -177,8 +272,17 @@ private:
     
     /**
      * @brief Cleanup current flow
+     * @param handover Next flow starts right away; keep the reader session
+     */
+    void cleanupFlow(bool handover = false);
+    
+    /**
+     * @brief Whether a finished flow may hand the card to the next queued one
+     *
+     * Only after success, with the card still connected and a flow queued
+     * once expired entries are dropped.
      */
-    void cleanupFlow();
+    bool canHandOver(const QJsonObject& result);
     
     // State
     FlowStateMachine* m_stateMachine;
@@ -190,10 +294,16 @@ private:
     bool m_continuousDetectionRunning;  // Track if continuous detection is active
     QString m_currentCardUid;  // Track current card to avoid duplicate detections
     QFuture<void> m_flowFuture;  // Track async flow execution to wait for completion
+    FlowStats m_stats;
+    FlowCommandMailbox m_mailbox;  // Commands posted from other threads
+    FlowQueue m_queue;  // Starts waiting for the active flow
+    QTimer* m_queueTimer;  // Fires at the earliest queue deadline
     
     // Resources
     std::shared_ptr<Keycard::KeycardChannel> m_channel;
     std::shared_ptr<Keycard::CommandSet> m_commandSet;  // Shared command set (maintains secure channel)
+    std::shared_ptr<ApduCostModel> m_costModel;
+    mutable QMutex m_costModelMutex;  // Flows read it while m_mutex may be held
     
     // Thread safety
     mutable QMutex m_mutex;
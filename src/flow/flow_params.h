@@ -48,6 +48,11 @@ const QString MNEMONIC_IDXS = "mnemonic-indexes";
 const QString TX_HASH = "tx-hash";
 const QString TX_SIGNATURE = "tx-signature";
 const QString BIP44_PATH = "bip44-path";
+const QString VERIFY_SIGNATURE = "verify-signature";
+const QString EXPECTED_PUBLIC_KEY = "expected-public-key";
+const QString SIGNATURE_VERIFIED = "verified";
+const QString ADDRESS = "address";                          // Sign: sender address instead of bip44-path
+const QString ADDRESS_SEARCH_LIMIT = "address-search-limit";
 
 // Metadata parameters
 const QString CARD_META = "card-metadata";
@@ -61,6 +66,15 @@ const QString RESOLVE_ADDR = "resolve-addresses";
 const QString EXPORT_MASTER = "export-master-address";
 const QString EXPORT_PRIV = "export-private";
 const QString SKIP_AUTH_UID = "skip-auth-uid";
+const QString SELECT_ONLY = "select-only";  // GetAppInfo: no pairing/secure channel
+
+// Flow queue (consumed by FlowManager, not passed to the flow)
+const QString QUEUE_PRIORITY = "queue-priority";
+const QString QUEUE_DEADLINE = "queue-deadline-ms";
+
+// Composite flow
+const QString COMPOSITE_STEPS = "steps";              // [{"flow-type": N, "params": {...}}, ...]
+const QString CONTINUE_ON_ERROR = "continue-on-error";
 
 // Application info
 const QString APP_INFO = "application-info";
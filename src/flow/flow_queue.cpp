@@ -0,0 +1,90 @@
+#include "flow_queue.h"
+
+namespace StatusKeycard {
+
+FlowQueue::FlowQueue(int capacity)
+    : m_capacity(qMax(0, capacity))
+{
+    m_clock.start();
+}
+
+quint64 FlowQueue::enqueue(int flowType, const QJsonObject& params, std::shared_ptr<const RequestBatch> batch,
+                           int priority, qint64 deadlineMs)
+{
+    if (m_entries.size() >= m_capacity) {
+        return 0;
+    }
+
+    QueuedFlow flow;
+    flow.id = m_nextId++;
+    flow.flowType = flowType;
+    flow.params = params;
+    flow.batch = std::move(batch);
+    flow.priority = priority;
+    flow.enqueuedMs = m_clock.elapsed();
+    flow.deadlineMs = deadlineMs > 0 ? flow.enqueuedMs + deadlineMs : -1;
+
+    // Insert after every entry of the same or higher priority
+    auto it = m_entries.begin();
+    while (it != m_entries.end() && it->priority >= priority) {
+        ++it;
+    }
+    m_entries.insert(it, flow);
+    return flow.id;
+}
+
+QVector<QueuedFlow> FlowQueue::takeExpired()
+{
+    QVector<QueuedFlow> expired;
+    const qint64 now = m_clock.elapsed();
+    for (int i = 0; i < m_entries.size();) {
+        if (m_entries[i].deadlineMs >= 0 && m_entries[i].deadlineMs <= now) {
+            expired.append(m_entries.takeAt(i));
+        } else {
+            ++i;
+        }
+    }
+    return expired;
+}
+
+bool FlowQueue::takeNext(QueuedFlow& next)
+{
+    if (m_entries.isEmpty()) {
+        return false;
+    }
+    next = m_entries.takeFirst();
+    return true;
+}
+
+QVector<QueuedFlow> FlowQueue::takeAll()
+{
+    QVector<QueuedFlow> all;
+    all.swap(m_entries);
+    return all;
+}
+
+int FlowQueue::position(quint64 id) const
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+qint64 FlowQueue::msUntilNextDeadline() const
+{
+    qint64 earliest = -1;
+    for (const QueuedFlow& flow : m_entries) {
+        if (flow.deadlineMs >= 0 && (earliest < 0 || flow.deadlineMs < earliest)) {
+            earliest = flow.deadlineMs;
+        }
+    }
+    if (earliest < 0) {
+        return -1;
+    }
+    return qMax<qint64>(0, earliest - m_clock.elapsed());
+}
+
+} // namespace StatusKeycard
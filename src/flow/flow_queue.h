@@ -0,0 +1,93 @@
+#ifndef FLOW_QUEUE_H
+#define FLOW_QUEUE_H
+
+#include "../request_decoder.h"
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QVector>
+#include <memory>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Flow waiting for the running flow to finish
+ */
+struct QueuedFlow {
+    quint64 id = 0;
+    int flowType = -1;
+    QJsonObject params;
+    std::shared_ptr<const RequestBatch> batch;
+    int priority = 0;
+    qint64 enqueuedMs = 0;   // Queue clock
+    qint64 deadlineMs = -1;  // Latest start time on the queue clock, -1 for none
+};
+
+/**
+ * @brief Bounded priority queue of pending flow starts
+ *
+ * Higher priority first, posting order within a priority. A deadline bounds
+ * how long a flow may wait to start; expired entries are handed back to the
+ * caller instead of being started. Not thread-safe (guarded by FlowManager).
+ */
+class FlowQueue {
+public:
+    static constexpr int DefaultCapacity = 8;
+
+    explicit FlowQueue(int capacity = DefaultCapacity);
+
+    /**
+     * @brief Maximum number of waiting flows (0 disables queueing)
+     */
+    void setCapacity(int capacity) { m_capacity = qMax(0, capacity); }
+    int capacity() const { return m_capacity; }
+
+    /**
+     * @brief Queue a flow start
+     * @param deadlineMs Maximum wait in ms, <= 0 for none
+     * @return Queue ID, or 0 when the queue is full
+     */
+    quint64 enqueue(int flowType, const QJsonObject& params, std::shared_ptr<const RequestBatch> batch,
+                    int priority, qint64 deadlineMs);
+
+    /**
+     * @brief Remove and return entries whose deadline has passed
+     */
+    QVector<QueuedFlow> takeExpired();
+
+    /**
+     * @brief Remove the next flow to start
+     * @return false if the queue is empty
+     */
+    bool takeNext(QueuedFlow& next);
+
+    /**
+     * @brief Remove all entries
+     */
+    QVector<QueuedFlow> takeAll();
+
+    /**
+     * @brief 0-based start position of a queued flow, -1 if not queued
+     */
+    int position(quint64 id) const;
+
+    /**
+     * @brief Time until the earliest deadline in ms, -1 if none
+     */
+    qint64 msUntilNextDeadline() const;
+
+    qint64 waitedMs(const QueuedFlow& flow) const { return m_clock.elapsed() - flow.enqueuedMs; }
+
+    const QVector<QueuedFlow>& entries() const { return m_entries; }
+    int size() const { return m_entries.size(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+
+private:
+    QVector<QueuedFlow> m_entries;  // Start order
+    QElapsedTimer m_clock;
+    int m_capacity;
+    quint64 m_nextId = 1;
+};
+
+} // namespace StatusKeycard
+
+#endif // FLOW_QUEUE_H
@@ -0,0 +1,141 @@
+#include "flow_registry.h"
+#include "flow_params.h"
+#include "flows/login_flow.h"
+#include "flows/get_app_info_flow.h"
+#include "flows/recover_account_flow.h"
+#include "flows/load_account_flow.h"
+#include "flows/sign_flow.h"
+#include "flows/change_pin_flow.h"
+#include "flows/change_puk_flow.h"
+#include "flows/change_pairing_flow.h"
+#include "flows/export_public_flow.h"
+#include "flows/get_metadata_flow.h"
+#include "flows/store_metadata_flow.h"
+#include "flows/composite_flow.h"
+
+namespace StatusKeycard {
+
+namespace {
+
+template <typename T>
+FlowBase* createFlow(FlowManager* manager, const QJsonObject& params)
+{
+    return new T(manager, params);
+}
+
+// Parameters read by FlowBase itself (PIN entry, unblock, initialization)
+constexpr const QString* COMMON_PARAMS[] = {
+    &FlowParams::PIN, &FlowParams::PUK, &FlowParams::NEW_PIN, &FlowParams::NEW_PUK,
+    &FlowParams::PAIRING_PASS, &FlowParams::NEW_PAIRING, &FlowParams::MNEMONIC,
+    &FlowParams::MNEMONIC_LEN, &FlowParams::OVERWRITE
+};
+
+constexpr const QString* GET_APP_INFO_PARAMS[] = {&FlowParams::FACTORY_RESET, &FlowParams::SELECT_ONLY};
+constexpr const QString* EXPORT_PUBLIC_PARAMS[] = {&FlowParams::BIP44_PATH};
+constexpr const QString* SIGN_PARAMS[] = {
+    &FlowParams::TX_HASH, &FlowParams::BIP44_PATH,
+    &FlowParams::VERIFY_SIGNATURE, &FlowParams::EXPECTED_PUBLIC_KEY,
+    &FlowParams::ADDRESS, &FlowParams::ADDRESS_SEARCH_LIMIT
+};
+constexpr const QString* CHANGE_PAIRING_PARAMS[] = {&FlowParams::NEW_PAIRING};
+constexpr const QString* STORE_METADATA_PARAMS[] = {&FlowParams::CARD_NAME, &FlowParams::WALLET_PATHS};
+constexpr const QString* GET_METADATA_PARAMS[] = {&FlowParams::RESOLVE_ADDR, &FlowParams::EXPORT_MASTER};
+constexpr const QString* COMPOSITE_PARAMS[] = {&FlowParams::COMPOSITE_STEPS, &FlowParams::CONTINUE_ON_ERROR};
+
+constexpr const char* SELECT_AUTH_STEPS[] = {"selectKeycard", "verifyPIN"};
+constexpr const char* AUTH_STEPS[] = {"verifyPIN"};
+constexpr const char* KEYS_STEPS[] = {"selectKeycard", "requireKeys", "verifyPIN"};
+constexpr const char* LOAD_ACCOUNT_STEPS[] = {"selectKeycard", "requireNoKeys", "verifyPIN", "loadMnemonic"};
+
+constexpr FlowDescriptor REGISTRY[] = {
+    {FlowType::GetAppInfo, "GetAppInfo", &createFlow<GetAppInfoFlow>,
+        makeSpan(GET_APP_INFO_PARAMS), makeSpan(SELECT_AUTH_STEPS)},
+    {FlowType::RecoverAccount, "RecoverAccount", &createFlow<RecoverAccountFlow>,
+        {}, makeSpan(KEYS_STEPS), true},
+    {FlowType::LoadAccount, "LoadAccount", &createFlow<LoadAccountFlow>,
+        {}, makeSpan(LOAD_ACCOUNT_STEPS)},
+    {FlowType::Login, "Login", &createFlow<LoginFlow>,
+        {}, makeSpan(KEYS_STEPS), true},
+    {FlowType::ExportPublic, "ExportPublic", &createFlow<ExportPublicFlow>,
+        makeSpan(EXPORT_PUBLIC_PARAMS), makeSpan(KEYS_STEPS), true},
+    {FlowType::Sign, "Sign", &createFlow<SignFlow>,
+        makeSpan(SIGN_PARAMS), makeSpan(KEYS_STEPS), true},
+    {FlowType::ChangePIN, "ChangePIN", &createFlow<ChangePINFlow>,
+        {}, makeSpan(AUTH_STEPS)},
+    {FlowType::ChangePUK, "ChangePUK", &createFlow<ChangePUKFlow>,
+        {}, makeSpan(SELECT_AUTH_STEPS)},
+    {FlowType::ChangePairing, "ChangePairing", &createFlow<ChangePairingFlow>,
+        makeSpan(CHANGE_PAIRING_PARAMS), makeSpan(AUTH_STEPS)},
+    {FlowType::UnpairThis, "UnpairThis", nullptr, {}, {}},
+    {FlowType::UnpairOthers, "UnpairOthers", nullptr, {}, {}},
+    {FlowType::DeleteAccountAndUnpair, "DeleteAccountAndUnpair", nullptr, {}, {}},
+    {FlowType::StoreMetadata, "StoreMetadata", &createFlow<StoreMetadataFlow>,
+        makeSpan(STORE_METADATA_PARAMS), makeSpan(AUTH_STEPS), true},
+    {FlowType::GetMetadata, "GetMetadata", &createFlow<GetMetadataFlow>,
+        makeSpan(GET_METADATA_PARAMS), makeSpan(AUTH_STEPS), true},
+    {FlowType::Composite, "Composite", &createFlow<CompositeFlow>,
+        makeSpan(COMPOSITE_PARAMS), makeSpan(KEYS_STEPS)},
+};
+
+constexpr std::size_t REGISTRY_SIZE = sizeof(REGISTRY) / sizeof(REGISTRY[0]);
+
+constexpr bool registryIndexedByType()
+{
+    for (std::size_t i = 0; i < REGISTRY_SIZE; ++i) {
+        if (static_cast<std::size_t>(REGISTRY[i].type) != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(registryIndexedByType(), "Flow registry entries must be ordered by FlowType value");
+static_assert(REGISTRY_SIZE == static_cast<std::size_t>(FlowType::Composite) + 1,
+              "Every FlowType needs a flow registry entry");
+
+} // namespace
+
+const FlowDescriptor* FlowRegistry::find(int flowType)
+{
+    if (flowType < 0 || static_cast<std::size_t>(flowType) >= REGISTRY_SIZE) {
+        return nullptr;
+    }
+    return &REGISTRY[flowType];
+}
+
+ConstSpan<FlowDescriptor> FlowRegistry::all()
+{
+    return makeSpan(REGISTRY);
+}
+
+ConstSpan<const QString*> FlowRegistry::commonParams()
+{
+    return makeSpan(COMMON_PARAMS);
+}
+
+bool FlowRegistry::acceptsParam(const FlowDescriptor& descriptor, const QString& key)
+{
+    for (const QString* param : commonParams()) {
+        if (*param == key) {
+            return true;
+        }
+    }
+    for (const QString* param : descriptor.params) {
+        if (*param == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FlowRegistry::runsStep(const FlowDescriptor& descriptor, const char* step)
+{
+    for (const char* name : descriptor.steps) {
+        if (qstrcmp(name, step) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,85 @@
+#ifndef FLOW_REGISTRY_H
+#define FLOW_REGISTRY_H
+
+#include "flow_types.h"
+#include <QString>
+#include <QJsonObject>
+#include <cstddef>
+
+namespace StatusKeycard {
+
+class FlowBase;
+class FlowManager;
+
+/**
+ * @brief Read-only view over a constexpr array
+ */
+template <typename T>
+struct ConstSpan {
+    const T* items = nullptr;
+    std::size_t count = 0;
+
+    constexpr const T* begin() const { return items; }
+    constexpr const T* end() const { return items + count; }
+    constexpr std::size_t size() const { return count; }
+};
+
+template <typename T, std::size_t N>
+constexpr ConstSpan<T> makeSpan(const T (&items)[N]) { return {items, N}; }
+
+using FlowFactory = FlowBase* (*)(FlowManager* manager, const QJsonObject& params);
+
+/**
+ * @brief Static description of a flow type
+ *
+ * params: flow-specific parameter keys the flow reads (FlowParams constants)
+ * steps:  FlowBase steps the flow runs, timed into FlowStats
+ * create: nullptr for flow types that are declared but not implemented
+ * composable: may run as a CompositeFlow step (leaves the card selected,
+ *             paired and authenticated)
+ */
+struct FlowDescriptor {
+    FlowType type;
+    const char* name;
+    FlowFactory create;
+    ConstSpan<const QString*> params;
+    ConstSpan<const char*> steps;
+    bool composable = false;
+};
+
+/**
+ * @brief Compile-time registry of all flow types
+ *
+ * The table is a constexpr array indexed by FlowType value; its ordering and
+ * completeness are checked with static_assert, so adding a FlowType without a
+ * registry entry fails to build.
+ */
+class FlowRegistry {
+public:
+    /**
+     * @brief Descriptor for a flow type
+     * @return nullptr if the value is not a FlowType
+     */
+    static const FlowDescriptor* find(int flowType);
+
+    static ConstSpan<FlowDescriptor> all();
+
+    /**
+     * @brief Parameter keys accepted by every flow (PIN, PUK, pairing, ...)
+     */
+    static ConstSpan<const QString*> commonParams();
+
+    /**
+     * @brief Whether a parameter key is part of the flow's schema
+     */
+    static bool acceptsParam(const FlowDescriptor& descriptor, const QString& key);
+
+    /**
+     * @brief Whether the flow runs the given FlowBase step
+     */
+    static bool runsStep(const FlowDescriptor& descriptor, const char* step);
+};
+
+} // namespace StatusKeycard
+
+#endif // FLOW_REGISTRY_H
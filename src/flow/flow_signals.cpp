@@ -22,49 +22,59 @@ const QString FlowSignals::ENTER_PATH = "keycard.action.enter-bip44-path";
 const QString FlowSignals::ENTER_MNEMONIC = "keycard.action.enter-mnemonic";
 const QString FlowSignals::ENTER_NAME = "keycard.action.enter-cardname";
 const QString FlowSignals::ENTER_WALLETS = "keycard.action.enter-wallets";
-
-QJsonObject FlowSignals::buildSignal(const QString& type, const QJsonObject& event)
-{
-    QJsonObject signal;
-    signal["type"] = type;
-    signal["event"] = event;
+const QString FlowSignals::FLOW_COMMAND_RESULT = "keycard.flow-command-result";
+const QString FlowSignals::FLOW_QUEUED = "keycard.flow-queued";
+const QString FlowSignals::FLOW_DEQUEUED = "keycard.flow-dequeued";
+
+QByteArray FlowSignals::serialize(const QString& type, const QJsonObject& event)
+{
+    // Keys are written in sorted order, so the envelope is a fixed prefix
+    // and a suffix carrying the type around the compact event
+    static const QByteArray prefix("{\"event\":");
+    static const QByteArray typeKey(",\"type\":\"");
+
+    const QByteArray eventJson = QJsonDocument(event).toJson(QJsonDocument::Compact);
+    QByteArray signal;
+    signal.reserve(prefix.size() + eventJson.size() + typeKey.size() + type.size() + 2);
+    signal.append(prefix).append(eventJson).append(typeKey);
+    for (QChar c : type) {
+        Q_ASSERT(c.unicode() < 0x80 && c != QLatin1Char('"') && c != QLatin1Char('\\'));
+        signal.append(static_cast<char>(c.unicode()));
+    }
+    signal.append("\"}", 2);
     return signal;
 }
 
-void FlowSignals::emitSignal(const QJsonObject& signal)
+void FlowSignals::emitSignal(const QString& type, const QJsonObject& event)
 {
-    QString json = QJsonDocument(signal).toJson(QJsonDocument::Compact);
-    qDebug() << "FlowSignals: Emitting signal:" << json;
-    SignalManager::instance()->emitSignal(json);
+    QByteArray signal = serialize(type, event);
+    qDebug() << "FlowSignals: Emitting signal:" << type << signal.size() << "bytes";
+    SignalManager::instance()->emitSerialized(std::move(signal), type);
 }
 
 void FlowSignals::emitFlowResult(const QJsonObject& result)
 {
-    QJsonObject signal = buildSignal(FLOW_RESULT, result);
-    emitSignal(signal);
+    emitSignal(FLOW_RESULT, result);
 }
 
 void FlowSignals::emitInsertCard()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "connection-error";
-    QJsonObject signal = buildSignal(INSERT_CARD, event);
-    emitSignal(signal);
+    emitSignal(INSERT_CARD, event);
 }
 
 void FlowSignals::emitCardInserted()
 {
     QJsonObject event;
-    QJsonObject signal = buildSignal(CARD_INSERTED, event);
-    emitSignal(signal);
+    emitSignal(CARD_INSERTED, event);
 }
 
 void FlowSignals::emitSwapCard(const QString& error, const QJsonObject& cardInfo)
 {
     QJsonObject event = cardInfo;
     event[FlowParams::ERROR_KEY] = error;
-    QJsonObject signal = buildSignal(SWAP_CARD, event);
-    emitSignal(signal);
+    emitSignal(SWAP_CARD, event);
 }
 
 void FlowSignals::emitEnterPairing(int retriesLeft)
@@ -74,8 +84,7 @@ void FlowSignals::emitEnterPairing(int retriesLeft)
     if (retriesLeft >= 0) {
         event[FlowParams::FREE_SLOTS] = retriesLeft;
     }
-    QJsonObject signal = buildSignal(ENTER_PAIRING, event);
-    emitSignal(signal);
+    emitSignal(ENTER_PAIRING, event);
 }
 
 void FlowSignals::emitEnterPIN(int retriesLeft)
@@ -83,8 +92,7 @@ void FlowSignals::emitEnterPIN(int retriesLeft)
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-pin";
     event[FlowParams::PIN_RETRIES] = retriesLeft;
-    QJsonObject signal = buildSignal(ENTER_PIN, event);
-    emitSignal(signal);
+    emitSignal(ENTER_PIN, event);
 }
 
 void FlowSignals::emitEnterPUK(int retriesLeft)
@@ -92,72 +100,63 @@ void FlowSignals::emitEnterPUK(int retriesLeft)
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-puk";
     event[FlowParams::PUK_RETRIES] = retriesLeft;
-    QJsonObject signal = buildSignal(ENTER_PUK, event);
-    emitSignal(signal);
+    emitSignal(ENTER_PUK, event);
 }
 
 void FlowSignals::emitEnterNewPairing()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-new-pairing";
-    QJsonObject signal = buildSignal(ENTER_NEW_PAIRING, event);
-    emitSignal(signal);
+    emitSignal(ENTER_NEW_PAIRING, event);
 }
 
 void FlowSignals::emitEnterNewPIN()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-new-pin";
-    QJsonObject signal = buildSignal(ENTER_NEW_PIN, event);
-    emitSignal(signal);
+    emitSignal(ENTER_NEW_PIN, event);
 }
 
 void FlowSignals::emitEnterNewPUK()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-new-puk";
-    QJsonObject signal = buildSignal(ENTER_NEW_PUK, event);
-    emitSignal(signal);
+    emitSignal(ENTER_NEW_PUK, event);
 }
 
 void FlowSignals::emitEnterTxHash()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-tx-hash";
-    QJsonObject signal = buildSignal(ENTER_TX_HASH, event);
-    emitSignal(signal);
+    emitSignal(ENTER_TX_HASH, event);
 }
 
 void FlowSignals::emitEnterPath()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-bip44-path";
-    QJsonObject signal = buildSignal(ENTER_PATH, event);
-    emitSignal(signal);
+    emitSignal(ENTER_PATH, event);
 }
 
 void FlowSignals::emitEnterMnemonic()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-mnemonic";
-    QJsonObject signal = buildSignal(ENTER_MNEMONIC, event);
-    emitSignal(signal);
+    emitSignal(ENTER_MNEMONIC, event);
 }
 
 void FlowSignals::emitEnterName()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-cardname";
-    QJsonObject signal = buildSignal(ENTER_NAME, event);
-    emitSignal(signal);
+    emitSignal(ENTER_NAME, event);
 }
 
 void FlowSignals::emitEnterWallets()
 {
     QJsonObject event;
     event[FlowParams::ERROR_KEY] = "enter-wallets";
-    QJsonObject signal = buildSignal(ENTER_WALLETS, event);
-    emitSignal(signal);
+    emitSignal(ENTER_WALLETS, event);
 }
 
 } // namespace StatusKeycard
@@ -1,6 +1,7 @@
 #ifndef FLOW_SIGNALS_H
 #define FLOW_SIGNALS_H
 
+#include <QByteArray>
 #include <QString>
 #include <QJsonObject>
 
@@ -41,6 +42,20 @@ public:
     static const QString ENTER_MNEMONIC;       // "keycard.action.enter-mnemonic"
     static const QString ENTER_NAME;           // "keycard.action.enter-cardname"
     static const QString ENTER_WALLETS;        // "keycard.action.enter-wallets"
+    static const QString FLOW_COMMAND_RESULT;  // "keycard.flow-command-result" (posted start/resume/cancel outcome)
+    static const QString FLOW_QUEUED;          // "keycard.flow-queued" (queue position of a waiting flow)
+    static const QString FLOW_DEQUEUED;        // "keycard.flow-dequeued" (waiting flow started or expired)
+    
+    /**
+     * @brief Serialize a signal as compact UTF-8 JSON
+     * 
+     * Byte-identical to QJsonDocument({"event": event, "type": type}) in
+     * compact form, without building and re-serializing the wrapper object.
+     * The result is what the C callback receives.
+     * @param type Signal type (one of the constants above)
+     * @param event Event data
+     */
+    static QByteArray serialize(const QString& type, const QJsonObject& event);
     
     /**
      * @brief Emit flow result (completion)
@@ -125,18 +140,11 @@ public:
     
 private:
     /**
-     * @brief Build signal JSON
+     * @brief Serialize and hand the signal to SignalManager
      * @param type Signal type
      * @param event Event data
-     * @return Complete signal JSON
-     */
-    static QJsonObject buildSignal(const QString& type, const QJsonObject& event);
-    
-    /**
-     * @brief Emit signal via SignalManager
-     * @param signal Signal JSON
      */
-    static void emitSignal(const QJsonObject& signal);
+    static void emitSignal(const QString& type, const QJsonObject& event);
 };
 
 } // namespace StatusKeycard
@@ -0,0 +1,126 @@
+#include "flow_stats.h"
+#include "flow_registry.h"
+#include "../flight_recorder.h"
+#include <QJsonArray>
+#include <QMutexLocker>
+
+namespace StatusKeycard {
+
+void FlowStats::Histogram::record(qint64 ms)
+{
+    if (ms < 0) {
+        ms = 0;
+    }
+
+    ++count;
+    totalMs += ms;
+    if (ms > maxMs) {
+        maxMs = ms;
+    }
+
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && ms >= (qint64(1) << bucket)) {
+        ++bucket;
+    }
+    ++buckets[bucket];
+}
+
+QJsonObject FlowStats::Histogram::toJson() const
+{
+    QJsonObject json;
+    json["count"] = static_cast<double>(count);
+    json["totalMs"] = static_cast<double>(totalMs);
+    json["maxMs"] = static_cast<double>(maxMs);
+    json["avgMs"] = count > 0 ? static_cast<double>(totalMs) / count : 0.0;
+
+    QJsonArray bucketArray;
+    for (quint64 bucket : buckets) {
+        bucketArray.append(static_cast<double>(bucket));
+    }
+    json["buckets"] = bucketArray;
+
+    return json;
+}
+
+void FlowStats::recordStarted(FlowType type)
+{
+    FlightRecorder::instance()->record(FlightRecorder::Event::FlowStart, static_cast<quint32>(type));
+
+    QMutexLocker locker(&m_mutex);
+    ++m_stats[static_cast<int>(type)].started;
+}
+
+void FlowStats::recordExecution(FlowType type, qint64 activeMs, Outcome outcome)
+{
+    FlightRecorder::instance()->record(FlightRecorder::Event::FlowEnd, static_cast<quint32>(type),
+                                       static_cast<quint16>(outcome), activeMs * 1000);
+
+    QMutexLocker locker(&m_mutex);
+    TypeStats& stats = m_stats[static_cast<int>(type)];
+
+    stats.execute.record(activeMs);
+
+    switch (outcome) {
+        case Outcome::Completed: ++stats.completed; break;
+        case Outcome::Failed:    ++stats.failed; break;
+        case Outcome::Cancelled: ++stats.cancelled; break;
+        case Outcome::Restarted: ++stats.restarted; break;
+    }
+}
+
+void FlowStats::recordStep(FlowType type, const QString& step, qint64 activeMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats[static_cast<int>(type)].steps[step].record(activeMs);
+}
+
+FlowStats::TypeStats FlowStats::stats(FlowType type) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats.value(static_cast<int>(type));
+}
+
+QJsonObject FlowStats::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QJsonObject json;
+    for (const FlowDescriptor& desc : FlowRegistry::all()) {
+        if (!desc.create) {
+            continue;
+        }
+
+        TypeStats stats = m_stats.value(static_cast<int>(desc.type));
+
+        // Declared steps are always listed so unused steps show up with zero counts
+        QJsonObject steps;
+        for (const char* step : desc.steps) {
+            steps[QString::fromLatin1(step)] = stats.steps.value(QString::fromLatin1(step)).toJson();
+        }
+        for (auto it = stats.steps.constBegin(); it != stats.steps.constEnd(); ++it) {
+            steps[it.key()] = it.value().toJson();
+        }
+
+        QJsonObject typeJson;
+        typeJson["type"] = static_cast<int>(desc.type);
+        typeJson["started"] = static_cast<double>(stats.started);
+        typeJson["completed"] = static_cast<double>(stats.completed);
+        typeJson["failed"] = static_cast<double>(stats.failed);
+        typeJson["cancelled"] = static_cast<double>(stats.cancelled);
+        typeJson["restarted"] = static_cast<double>(stats.restarted);
+        typeJson["execute"] = stats.execute.toJson();
+        typeJson["steps"] = steps;
+
+        json[QString::fromLatin1(desc.name)] = typeJson;
+    }
+
+    return json;
+}
+
+void FlowStats::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats.clear();
+}
+
+} // namespace StatusKeycard
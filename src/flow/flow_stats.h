@@ -0,0 +1,72 @@
+#ifndef FLOW_STATS_H
+#define FLOW_STATS_H
+
+#include "flow_types.h"
+#include <QString>
+#include <QJsonObject>
+#include <QHash>
+#include <QMutex>
+#include <array>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Per-flow-type execution statistics
+ *
+ * Records counters and latency histograms for each flow type, for the whole
+ * execute() call and for each step (selectKeycard, verifyPIN, ...). Time spent
+ * paused waiting for user input is excluded, so latencies reflect card and
+ * host work only.
+ *
+ * Histogram buckets are powers of two in milliseconds: bucket i counts
+ * samples below 2^i ms, the last bucket everything above.
+ *
+ * Thread-safe.
+ */
+class FlowStats {
+public:
+    static constexpr int BucketCount = 18;  // < 1ms ... < 65.5s, overflow
+
+    enum class Outcome {
+        Completed,
+        Failed,
+        Cancelled,
+        Restarted
+    };
+
+    struct Histogram {
+        quint64 count = 0;
+        qint64 totalMs = 0;
+        qint64 maxMs = 0;
+        std::array<quint64, BucketCount> buckets {};
+
+        void record(qint64 ms);
+        QJsonObject toJson() const;
+    };
+
+    struct TypeStats {
+        quint64 started = 0;
+        quint64 completed = 0;
+        quint64 failed = 0;
+        quint64 cancelled = 0;
+        quint64 restarted = 0;
+        Histogram execute;
+        QHash<QString, Histogram> steps;
+    };
+
+    void recordStarted(FlowType type);
+    void recordExecution(FlowType type, qint64 activeMs, Outcome outcome);
+    void recordStep(FlowType type, const QString& step, qint64 activeMs);
+
+    TypeStats stats(FlowType type) const;
+    QJsonObject toJson() const;
+    void reset();
+
+private:
+    mutable QMutex m_mutex;
+    QHash<int, TypeStats> m_stats;
+};
+
+} // namespace StatusKeycard
+
+#endif // FLOW_STATS_H
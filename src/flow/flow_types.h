@@ -23,7 +23,8 @@ enum class FlowType {
     UnpairOthers = 10,           // Unpair other slots (not used by status-desktop)
     DeleteAccountAndUnpair = 11, // Delete account + unpair (not used by status-desktop)
     StoreMetadata = 12,          // Store metadata to card
-    GetMetadata = 13             // Get metadata from card
+    GetMetadata = 13,            // Get metadata from card
+    Composite = 14               // Several flows in one card session (status-keycard-qt only)
 };
 
 /**
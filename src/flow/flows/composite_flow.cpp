@@ -0,0 +1,186 @@
+#include "composite_flow.h"
+#include "../flow_manager.h"
+#include "../flow_params.h"
+#include "../flow_registry.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <memory>
+
+namespace StatusKeycard {
+
+CompositeFlow::CompositeFlow(FlowManager* manager, const QJsonObject& params, QObject* parent)
+    : FlowBase(manager, FlowType::Composite, params, parent)
+    , m_manager(manager)
+    , m_activeStep(nullptr)
+{
+}
+
+CompositeFlow::~CompositeFlow()
+{
+}
+
+QString CompositeFlow::parseSteps(QVector<Step>& steps) const
+{
+    const QJsonValue value = params().value(FlowParams::COMPOSITE_STEPS);
+    if (!value.isArray() || value.toArray().isEmpty()) {
+        return "no-steps";
+    }
+
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue& entry : array) {
+        const QJsonObject object = entry.toObject();
+        const FlowDescriptor* descriptor = FlowRegistry::find(object.value("flow-type").toInt(-1));
+        if (!descriptor || !descriptor->create || !descriptor->composable) {
+            return "invalid-step";
+        }
+        steps.append(Step{descriptor, object.value("params").toObject()});
+    }
+    return QString();
+}
+
+QJsonObject CompositeFlow::execute()
+{
+    qDebug() << "CompositeFlow: Starting execution";
+
+    QVector<Step> steps;
+    const QString stepsError = parseSteps(steps);
+    if (!stepsError.isEmpty()) {
+        QJsonObject error;
+        error[FlowParams::ERROR_KEY] = stepsError;
+        return error;
+    }
+
+    bool needsKeys = false;
+    bool needsAuth = false;
+    for (const Step& step : steps) {
+        needsKeys |= FlowRegistry::runsStep(*step.descriptor, "requireKeys");
+        needsAuth |= FlowRegistry::runsStep(*step.descriptor, "verifyPIN");
+    }
+
+    // Session steps, once for all sub-flows
+    if (!selectKeycard()) {
+        QJsonObject error;
+        error[FlowParams::ERROR_KEY] = "select-failed";
+        return error;
+    }
+
+    if (needsKeys && !requireKeys()) {
+        QJsonObject error;
+        error[FlowParams::ERROR_KEY] = "no-keys";
+        return error;
+    }
+
+    if (needsAuth && !verifyPIN()) {
+        QJsonObject error;
+        error[FlowParams::ERROR_KEY] = "auth-failed";
+        return error;
+    }
+
+    const bool continueOnError = params().value(FlowParams::CONTINUE_ON_ERROR).toBool();
+    bool failed = false;
+    QJsonArray results;
+    for (const Step& step : steps) {
+        if (isCancelled()) {
+            break;
+        }
+
+        if (failed && !continueOnError) {
+            QJsonObject skipped;
+            skipped["flow-type"] = static_cast<int>(step.descriptor->type);
+            skipped[FlowParams::ERROR_KEY] = "skipped";
+            results.append(skipped);
+            continue;
+        }
+
+        QJsonObject entry = runStep(step);
+        failed |= entry.contains(FlowParams::ERROR_KEY);
+        results.append(entry);
+    }
+
+    // Steps that ran before a cancel may have changed the card: report them too
+    QJsonObject result = buildCardInfoJson();
+    result[FlowParams::COMPOSITE_STEPS] = results;
+    if (isCancelled() && (failed || results.size() < steps.size())) {
+        result[FlowParams::ERROR_KEY] = "cancelled";
+    } else if (failed && !continueOnError) {
+        result[FlowParams::ERROR_KEY] = "step-failed";
+    }
+
+    qDebug() << "CompositeFlow: Execution completed," << results.size() << "steps";
+    return result;
+}
+
+QJsonObject CompositeFlow::runStep(const Step& step)
+{
+    qDebug() << "CompositeFlow: Running step" << step.descriptor->name;
+
+    // Composite params (PIN, pairing, ...) with the step's own params on top
+    QJsonObject stepParams = params();
+    stepParams.remove(FlowParams::COMPOSITE_STEPS);
+    stepParams.remove(FlowParams::CONTINUE_ON_ERROR);
+    for (auto it = step.params.begin(); it != step.params.end(); ++it) {
+        stepParams[it.key()] = it.value();
+    }
+
+    std::unique_ptr<FlowBase> flow(step.descriptor->create(m_manager, stepParams));
+    flow->setSessionShared(true);
+
+    // The step runs on this thread; forward its pauses to FlowManager and
+    // keep its errors in the step result
+    QString stepError;
+    connect(flow.get(), &FlowBase::flowPaused, this, &FlowBase::flowPaused, Qt::DirectConnection);
+    connect(flow.get(), &FlowBase::flowError, flow.get(),
+            [&stepError](const QString& error) { stepError = error; }, Qt::DirectConnection);
+
+    {
+        QMutexLocker locker(&m_stepMutex);
+        m_activeStep = flow.get();
+    }
+    if (isCancelled()) {
+        flow->cancel();
+    }
+
+    // No restart inside a shared session: a swapped card fails the step
+    QJsonObject stepResult = flow->execute();
+    if (flow->shouldRestart() && stepError.isEmpty()) {
+        stepError = "card-swapped";
+    }
+
+    {
+        QMutexLocker locker(&m_stepMutex);
+        m_activeStep = nullptr;
+    }
+
+    QJsonObject entry;
+    entry["flow-type"] = static_cast<int>(step.descriptor->type);
+    if (stepError.isEmpty() && FlowResult::isError(stepResult)) {
+        stepError = stepResult.value(FlowParams::ERROR_KEY).toString();
+    }
+    if (!stepError.isEmpty()) {
+        entry[FlowParams::ERROR_KEY] = stepError;
+    }
+    entry["result"] = stepResult;
+    return entry;
+}
+
+void CompositeFlow::resume(const QJsonObject& newParams)
+{
+    FlowBase::resume(newParams);
+
+    QMutexLocker locker(&m_stepMutex);
+    if (m_activeStep) {
+        m_activeStep->resume(newParams);
+    }
+}
+
+void CompositeFlow::cancel()
+{
+    FlowBase::cancel();
+
+    QMutexLocker locker(&m_stepMutex);
+    if (m_activeStep) {
+        m_activeStep->cancel();
+    }
+}
+
+} // namespace StatusKeycard
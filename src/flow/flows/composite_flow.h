@@ -0,0 +1,78 @@
+#ifndef COMPOSITE_FLOW_H
+#define COMPOSITE_FLOW_H
+
+#include "flow_base.h"
+#include <QMutex>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Composite Flow - run several flows in one card session
+ *
+ * Takes an ordered list of composable flows (see FlowDescriptor::composable)
+ * and runs them against one SELECT, one PIN verification and one secure
+ * channel. Session steps the sub-flows would repeat (selectKeycard,
+ * requireKeys, verifyPIN) run once up front; each step then executes with
+ * its own params merged over the composite's (PIN, pairing, ...).
+ *
+ * Pauses of a step (e.g. enter-bip44-path) are forwarded as usual; resume
+ * and cancel reach the step that is running.
+ *
+ * Params:
+ * {
+ *   "steps": [{"flow-type": 3}, {"flow-type": 13, "params": {"resolve-addresses": true}}],
+ *   "continue-on-error": false   // default: remaining steps are skipped
+ * }
+ *
+ * Result format:
+ * {
+ *   "instance-uid": "...",
+ *   "key-uid": "...",
+ *   "steps": [
+ *     {"flow-type": 3, "result": {...}},
+ *     {"flow-type": 13, "error": "...", "result": {...}},
+ *     {"flow-type": 4, "error": "skipped"}
+ *   ],
+ *   "error": "step-failed"   // a step failed without continue-on-error
+ * }
+ *
+ * A cancelled composite returns "error": "cancelled" with the steps that
+ * ran before the cancel.
+ */
+class CompositeFlow : public FlowBase {
+    Q_OBJECT
+
+public:
+    CompositeFlow(FlowManager* manager, const QJsonObject& params, QObject* parent = nullptr);
+    ~CompositeFlow();
+
+    QJsonObject execute() override;
+    void resume(const QJsonObject& newParams) override;
+    void cancel() override;
+
+private:
+    struct Step {
+        const FlowDescriptor* descriptor = nullptr;
+        QJsonObject params;
+    };
+
+    /**
+     * @brief Validate the step list
+     * @return Empty string, or the error for the flow result
+     */
+    QString parseSteps(QVector<Step>& steps) const;
+
+    /**
+     * @brief Run one step inside the shared session
+     * @return Step entry for the "steps" result array
+     */
+    QJsonObject runStep(const Step& step);
+
+    FlowManager* m_manager;
+    QMutex m_stepMutex;
+    FlowBase* m_activeStep;  // Step currently executing (guarded by m_stepMutex)
+};
+
+} // namespace StatusKeycard
+
+#endif // COMPOSITE_FLOW_H
@@ -2,6 +2,8 @@
 #include "../flow_manager.h"
 #include "../flow_params.h"
 #include "../flow_signals.h"
+#include "../../hex_codec.h"
+#include "../../plan/execution_planner.h"
 #include <keycard-qt/command_set.h>
 #include <QJsonArray>
 #include <QCryptographicHash>
@@ -66,8 +68,14 @@ QJsonObject ExportPublicFlow::execute()
     
     // Export keys for all paths
     QJsonArray exportedKeys;
+    auto model = costModel();
     for (const QString& path : paths) {
-        QByteArray keyData = commandSet()->exportKey(true, false, path, Keycard::APDU::P2ExportKeyPublicOnly);
+        QByteArray keyData;
+        {
+            ApduTimer timer(model.get(), ApduCostModel::ExportKey, ExecutionPlanner::pathDepth(path));
+            keyData = commandSet()->exportKey(true, false, path, Keycard::APDU::P2ExportKeyPublicOnly);
+            timer.succeeded(!keyData.isEmpty());
+        }
         if (keyData.isEmpty()) {
             QJsonObject error;
             error[FlowParams::ERROR_KEY] = "export-failed";
@@ -82,8 +90,8 @@ QJsonObject ExportPublicFlow::execute()
         }
         
         QJsonObject keyPair;
-        keyPair["publicKey"] = QString("0x") + publicKey.toHex();
-        keyPair["address"] = FlowBase::publicKeyToAddress(publicKey);
+        keyPair["publicKey"] = HexCodec::toHex(publicKey, true);
+        keyPair["address"] = indexAddress(path, publicKey);
         
         exportedKeys.append(keyPair);
     }
@@ -1,6 +1,11 @@
 #include "flow_base.h"
 #include "../flow_manager.h"
 #include "../flow_signals.h"
+#include "../flow_registry.h"
+#include "../../flight_recorder.h"
+#include "../../card_decoder.h"
+#include "../../hex_codec.h"
+#include "../../session/address_index.h"
 #include <keycard-qt/keycard_channel.h>
 #include <QDebug>
 #include <QThread>
@@ -18,16 +23,47 @@ FlowBase::FlowBase(FlowManager* manager, FlowType type, const QJsonObject& param
     , m_manager(manager)
     , m_flowType(type)
     , m_params(params)
+    , m_sessionShared(false)
+    , m_eagerAuthorized(false)
+    , m_eagerPINRejected(false)
+    , m_pinAttempted(false)
     , m_paused(false)
     , m_cancelled(false)
     , m_shouldRestart(false)
+    , m_pausedMs(0)
+    , m_stepDepth(0)
 {
+    m_clock.start();
 }
 
 FlowBase::~FlowBase()
 {
 }
 
+FlowBase::StepTimer::StepTimer(FlowBase* flow, const char* step)
+    : m_flow(flow)
+    , m_step(step)
+    , m_outermost(flow->m_stepDepth++ == 0)
+    , m_startMs(flow->m_clock.elapsed())
+    , m_startPausedMs(flow->m_pausedMs)
+{
+}
+
+FlowBase::StepTimer::~StepTimer()
+{
+    --m_flow->m_stepDepth;
+
+    // Nested and recursive steps (verifyPIN retries) count toward the outer one
+    if (!m_outermost || !m_flow->m_manager) {
+        return;
+    }
+
+    qint64 activeMs = (m_flow->m_clock.elapsed() - m_startMs) - (m_flow->m_pausedMs - m_startPausedMs);
+    FlightRecorder::instance()->record(FlightRecorder::Event::FlowStep, static_cast<quint32>(m_flow->m_flowType),
+                                       0, activeMs * 1000, m_step);
+    m_flow->m_manager->stats().recordStep(m_flow->m_flowType, QString::fromLatin1(m_step), activeMs);
+}
+
 const FlowBase::CardInfo FlowBase::cardInfo() const {
     return buildCardInfo();
 }
@@ -74,6 +110,11 @@ std::shared_ptr<Keycard::CommandSet> FlowBase::commandSet() const {
     return m_manager->commandSet();
 }
 
+std::shared_ptr<ApduCostModel> FlowBase::costModel() const
+{
+    return m_manager ? m_manager->costModel() : nullptr;
+}
+
 // ============================================================================
 // Pause/Resume mechanism
 // ============================================================================
@@ -116,16 +157,21 @@ void FlowBase::pauseAndWaitWithStatus(const QString& action, const QString& erro
         event[FlowParams::PUK_RETRIES] = info.pukRetries;
     }
     
-    // Emit pause signal
+    // Paused before the signal goes out: a resume() from another thread may
+    // arrive before this thread starts waiting
+    {
+        QMutexLocker locker(&m_resumeMutex);
+        m_paused = true;
+    }
     emit flowPaused(action, event);
     
     // Wait for resume or cancel
     QMutexLocker locker(&m_resumeMutex);
-    m_paused = true;
-    
+    qint64 pauseStart = m_clock.elapsed();
     while (m_paused && !m_cancelled) {
         m_resumeCondition.wait(&m_resumeMutex);
     }
+    m_pausedMs += m_clock.elapsed() - pauseStart;
 }
 
 void FlowBase::pauseAndRestart(const QString& action, const QString& error)
@@ -140,6 +186,10 @@ void FlowBase::pauseAndRestart(const QString& action, const QString& error)
 
 bool FlowBase::selectKeycard()
 {
+    if (m_sessionShared) {
+        return true;
+    }
+    StepTimer step(this, "selectKeycard");
     qDebug() << "FlowBase::selectKeycard()";
     
     if (!commandSet()) {
@@ -148,19 +198,57 @@ bool FlowBase::selectKeycard()
         return false;
     }
     
-    // Select keycard applet
+    // Select keycard applet (a new SELECT drops any earlier authentication)
+    m_eagerAuthorized = false;
+    m_pinAttempted = false;
     Keycard::ApplicationInfo appInfo = commandSet()->select();
     if (!appInfo.installed) {
         qCritical() << "FlowBase: Keycard applet not installed!";
         emit flowError("Keycard applet not installed");
         return false;
     }
+    m_capabilities = AppletCapabilities::forApplet(appInfo.appVersion, appInfo.appVersionMinor);
     
+    verifyPINEagerly(appInfo);
     return true;
 }
 
+void FlowBase::verifyPINEagerly(const Keycard::ApplicationInfo& appInfo)
+{
+    const QString pin = m_params[FlowParams::PIN].toString();
+    const FlowDescriptor* descriptor = FlowRegistry::find(static_cast<int>(m_flowType));
+    
+    // Only for flows that authenticate anyway, on cards they would accept:
+    // uninitialized cards go through initialization and keyless cards are
+    // swapped before verifyPIN() is ever reached
+    if (pin.isEmpty() || !descriptor || !FlowRegistry::runsStep(*descriptor, "verifyPIN")
+        || !appInfo.initialized || appInfo.keyUID.isEmpty()) {
+        return;
+    }
+    
+    StepTimer step(this, "verifyPINEager");
+    m_pinAttempted = true;
+    if (commandSet()->verifyPIN(pin)) {
+        qDebug() << "FlowBase: PIN verified eagerly after SELECT";
+        m_eagerAuthorized = true;
+        return;
+    }
+    
+    // Wrong or blocked: verifyPIN() handles it, with a fresh status read
+    qWarning() << "FlowBase: Up-front PIN rejected";
+    m_params.remove(FlowParams::PIN);
+    m_eagerPINRejected = true;
+}
+
+bool FlowResult::isError(const QJsonObject& result)
+{
+    const QString error = result.value(FlowParams::ERROR_KEY).toString();
+    return !error.isEmpty() && error != QLatin1String("ok");
+}
+
 FlowResult FlowBase::initializeKeycard()
 {
+    StepTimer step(this, "initializeKeycard");
     // Check if card is initialized (pre-initialized cards need initialization first)
     // This matches status-keycard-go behavior: pause and ask for PIN/PUK/pairing
     QJsonObject result = buildCardInfoJson();
@@ -203,6 +291,7 @@ FlowResult FlowBase::initializeKeycard()
 
 bool FlowBase::unblockPIN()
 {
+    StepTimer step(this, "unblockPIN");
     qDebug() << "FlowBase: Unblocking PIN...";
     if (!commandSet()) {
         qCritical() << "FlowBase: No CommandSet available";
@@ -217,6 +306,7 @@ bool FlowBase::unblockPIN()
         if (m_cancelled) {
             return false;
         }
+        puk = m_params[FlowParams::PUK].toString();
     }
 
     QString newPIN = m_params[FlowParams::NEW_PIN].toString();
@@ -248,6 +338,10 @@ bool FlowBase::unblockPIN()
 
 bool FlowBase::verifyPIN(bool giveup)
 {
+    if (m_sessionShared || m_eagerAuthorized) {
+        return true;
+    }
+    StepTimer step(this, "verifyPIN");
     qDebug() << "FlowBase: Verifying PIN...";
     if (!commandSet()) {
         qCritical() << "FlowBase: No CommandSet available";
@@ -263,7 +357,14 @@ bool FlowBase::verifyPIN(bool giveup)
         return true;
     }
 
-    auto appStatus = commandSet()->getStatus(Keycard::APDU::P1GetStatusApplication);
+    // Applets that report status with the secure channel need no GET STATUS
+    // until a PIN attempt changes the retry counter
+    Keycard::ApplicationStatus appStatus;
+    if (m_capabilities.combinedStatus && !m_pinAttempted && commandSet()->hasCachedStatus()) {
+        appStatus = commandSet()->cachedApplicationStatus();
+    } else {
+        appStatus = commandSet()->getStatus(Keycard::APDU::P1GetStatusApplication);
+    }
     if (appStatus.pinRetryCount == 0 && appStatus.valid) {
         qWarning() << "FlowBase: PIN blocked!";
         auto ok = unblockPIN();
@@ -280,8 +381,10 @@ bool FlowBase::verifyPIN(bool giveup)
     QString pin = m_params[FlowParams::PIN].toString();
     
     if (pin.isEmpty()) {
-        // Request PIN (empty error means normal PIN request, not an error condition)
-        pauseAndWait(FlowSignals::ENTER_PIN, "");
+        // Request PIN (empty error means normal PIN request, not an error
+        // condition; "pin" if the up-front PIN was rejected)
+        pauseAndWait(FlowSignals::ENTER_PIN, m_eagerPINRejected ? "pin" : "");
+        m_eagerPINRejected = false;
         
         if (m_cancelled) {
             return false;
@@ -297,6 +400,7 @@ bool FlowBase::verifyPIN(bool giveup)
     }
     
     // Verify PIN
+    m_pinAttempted = true;
     auto response = commandSet()->verifyPIN(pin);
     if (!response) {
         qCritical() << "FlowBase: PIN verification failed!";
@@ -317,6 +421,7 @@ bool FlowBase::verifyPIN(bool giveup)
 
 bool FlowBase::requireKeys()
 {
+    StepTimer step(this, "requireKeys");
     if (!cardInfo().keyUID.isEmpty()) {
         qDebug() << "FlowBase: Card has keys";
         return true;
@@ -333,6 +438,7 @@ bool FlowBase::requireKeys()
 
 FlowResult FlowBase::requireNoKeys()
 {
+    StepTimer step(this, "requireNoKeys");
     QJsonObject result = buildCardInfoJson();
     if (cardInfo().keyUID.isEmpty()) {
         qDebug() << "FlowBase: Card has no keys (as required)";
@@ -397,6 +503,7 @@ QByteArray FlowBase::mnemonicToSeed(const QString& mnemonic, const QString& pass
 
 FlowResult FlowBase::loadMnemonic()
 {
+    StepTimer step(this, "loadMnemonic");
     // Get mnemonic from params (or generate indexes and pause to request it)
     QString mnemonic = m_params[FlowParams::MNEMONIC].toString();
     if (mnemonic.isEmpty()) {
@@ -451,7 +558,7 @@ FlowResult FlowBase::loadMnemonic()
         return FlowResult{false, result};
     }
 
-    result[FlowParams::KEY_UID] = QString("0x") + keyUID.toHex();
+    result[FlowParams::KEY_UID] = HexCodec::toHex(keyUID, true);
 
     return FlowResult{true, result};
 }
@@ -469,8 +576,8 @@ FlowBase::CardInfo FlowBase::buildCardInfo() const
     auto appInfo = commandSet()->applicationInfo();
     auto appStatus = commandSet()->cachedApplicationStatus();
 
-    result.instanceUID = appInfo.instanceUID.toHex();
-    result.keyUID = appInfo.keyUID.toHex();
+    result.instanceUID = HexCodec::toHex(appInfo.instanceUID);
+    result.keyUID = HexCodec::toHex(appInfo.keyUID);
     result.initialized = appInfo.initialized;
     result.freeSlots = appInfo.availableSlots;
     result.keyInitialized = !appInfo.keyUID.isEmpty();
@@ -520,67 +627,27 @@ QString FlowBase::publicKeyToAddress(const QByteArray& pubKey) {
     QByteArray hash = QCryptographicHash::hash(pubKeyData, QCryptographicHash::Keccak_256);
     QByteArray address = hash.right(20);
     
-    return QString("0x") + address.toHex();
+    return HexCodec::toHex(address, true);
 }
 
-// Helper to parse TLV length (BER-TLV format)
-static quint32 parseTlvLength(const QByteArray& data, int& offset) {
-    if (offset >= data.size()) {
-        return 0;
-    }
-    
-    uint8_t firstByte = static_cast<uint8_t>(data[offset]);
-    offset++;
-    
-    if ((firstByte & 0x80) == 0) {
-        // Short form: length is in the lower 7 bits
-        return firstByte;
-    }
-    
-    // Long form: lower 7 bits indicate number of length bytes
-    int numLengthBytes = firstByte & 0x7F;
-    if (numLengthBytes > 4 || offset + numLengthBytes > data.size()) {
-        return 0;
-    }
-    
-    quint32 length = 0;
-    for (int i = 0; i < numLengthBytes; i++) {
-        length = (length << 8) | static_cast<uint8_t>(data[offset]);
-        offset++;
-    }
-    
-    return length;
+QString FlowBase::indexAddress(const QString& path, const QByteArray& pubKey) const {
+    QString address = publicKeyToAddress(pubKey);
+    AddressIndex::instance()->insert(cardInfo().keyUID, address, path);
+    return address;
 }
 
-// Helper to find a TLV tag in data
-static QByteArray findTlvTag(const QByteArray& data, uint8_t targetTag) {
-    int offset = 0;
-    
-    while (offset < data.size()) {
-        if (offset >= data.size()) {
-            break;
-        }
-        
-        uint8_t tag = static_cast<uint8_t>(data[offset]);
-        offset++;
-        
-        quint32 length = parseTlvLength(data, offset);
-        if (length == 0 && offset >= data.size()) {
-            break;
-        }
-        
-        if (offset + static_cast<int>(length) > data.size()) {
-            break;
-        }
-        
-        if (tag == targetTag) {
-            return data.mid(offset, length);
-        }
-        
-        offset += length;
+QString FlowBase::exportPublicKey(const QString& path, QByteArray& publicKey) {
+    // Pre-2.0 applets have no public-only export, and only release private
+    // keys below the EIP-1581 root (same rule as SessionManager::exportKeys)
+    if (!m_capabilities.publicOnlyExport) {
+        return "public-export-not-supported";
     }
-    
-    return QByteArray();
+    QByteArray keyData = commandSet()->exportKey(true, false, path, Keycard::APDU::P2ExportKeyPublicOnly);
+    QByteArray privateKey;
+    if (keyData.isEmpty() || !parseExportedKey(keyData, publicKey, privateKey)) {
+        return "export-failed";
+    }
+    return QString();
 }
 
 bool FlowBase::parseExportedKey(const QByteArray& data, QByteArray& publicKey, QByteArray& privateKey) {
@@ -593,17 +660,22 @@ bool FlowBase::parseExportedKey(const QByteArray& data, QByteArray& publicKey, Q
     }
     
     // Find template tag 0xA1
-    QByteArray template_ = findTlvTag(data, 0xA1);
+    QByteArray template_ = CardDecoder::findTlvTag(data, 0xA1);
     if (template_.isEmpty()) {
         qWarning() << "parseExportedKey: Failed to find template tag 0xA1";
         return false;
     }
     
-    // Find public key (0x80)
-    publicKey = findTlvTag(template_, 0x80);
-    
-    // Find private key (0x81) if available
-    privateKey = findTlvTag(template_, 0x81);
+    // Public key (0x80) and, if available, private key (0x81) in one pass
+    const quint8 tags[] = { 0x80, 0x81 };
+    QByteArray values[2];
+    DecodeError error = CardDecoder::findTlvTags(template_, tags, values, 2, 1);
+    if (error != DecodeError::None) {
+        qWarning() << "parseExportedKey: Invalid key template:" << decodeErrorString(error);
+        return false;
+    }
+    publicKey = values[0];
+    privateKey = values[1];
     
     if (publicKey.isEmpty()) {
         qWarning() << "parseExportedKey: No public key found";
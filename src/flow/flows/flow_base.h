@@ -3,10 +3,13 @@
 
 #include "../flow_types.h"
 #include "../flow_params.h"
+#include "../../request_decoder.h"
+#include "../../session/applet_capabilities.h"
 #include <QObject>
 #include <QJsonObject>
 #include <QWaitCondition>
 #include <QMutex>
+#include <QElapsedTimer>
 #include <keycard-qt/command_set.h>
 #include <keycard-qt/types.h>
 
@@ -19,6 +22,7 @@ namespace StatusKeycard {
 
 // Forward declarations
 class FlowManager;
+class ApduCostModel;
 class PairingStorage;
 
 /**
@@ -36,6 +40,14 @@ class PairingStorage;
 struct FlowResult {
     bool ok;
     QJsonObject result;
+
+    /**
+     * @brief Whether a flow result reports a failure
+     *
+     * No "error" or an empty one is success, and so is "ok" (GetAppInfo
+     * reports success that way, as status-keycard-go does).
+     */
+    static bool isError(const QJsonObject& result);
 };
 
 class FlowBase : public QObject {
@@ -60,7 +72,7 @@ public:
      * @brief Resume flow after pause
      * @param newParams New parameters provided by user
      */
-    void resume(const QJsonObject& newParams);
+    virtual void resume(const QJsonObject& newParams);
 
     /**
      * @brief Pause and wait for user input
@@ -72,12 +84,25 @@ public:
     /**
      * @brief Cancel flow
      */
-    void cancel();
+    virtual void cancel();
     
     /**
      * @brief Get flow type
      */
     FlowType flowType() const { return m_flowType; }
+
+    /**
+     * @brief Attach batch arrays pre-decoded from the request payload
+     */
+    void setRequestBatch(std::shared_ptr<const RequestBatch> batch) { m_batch = std::move(batch); }
+
+    /**
+     * @brief Run inside a session a CompositeFlow already opened
+     *
+     * The card is selected and the PIN verified, so selectKeycard() and
+     * verifyPIN() succeed without talking to the card.
+     */
+    void setSessionShared(bool shared) { m_sessionShared = shared; }
     
 signals:
     /**
@@ -119,11 +144,22 @@ protected:
      * @return CommandSet for card operations (shared across all flows)
      */
     std::shared_ptr<Keycard::CommandSet> commandSet() const;
+
+    /**
+     * @brief Cost model to time EXPORT KEY and SIGN into (see ApduTimer)
+     * @return The manager's model; null when none is set
+     */
+    std::shared_ptr<ApduCostModel> costModel() const;
     
     /**
      * @brief Get flow parameters
      */
     QJsonObject params() const { return m_params; }
+
+    /**
+     * @brief Pre-decoded batch arrays (null when params carry them as JSON)
+     */
+    const RequestBatch* requestBatch() const { return m_batch.get(); }
     
     // ============================================================================
     // Pause/Resume mechanism
@@ -154,6 +190,11 @@ protected:
     
     /**
      * @brief Connect to card and select applet
+     *
+     * If the PIN was supplied up front and the flow authenticates, VERIFY PIN
+     * (which opens the secure channel) is sent right after SELECT; the later
+     * verifyPIN() then succeeds without another round trip.
+     *
      * @return true if successful
      */
     bool selectKeycard();
@@ -229,6 +270,21 @@ protected:
      * @brief Builds CardInfo from ApplicationInfo
      */
     FlowBase::CardInfo buildCardInfo() const;
+
+    /**
+     * @brief Capabilities of the applet found by the last selectKeycard()
+     */
+    const AppletCapabilities& capabilities() const { return m_capabilities; }
+
+private:
+    /**
+     * @brief Eager path: verify the up-front PIN straight after SELECT
+     *
+     * Skips the re-SELECT and GET STATUS verifyPIN() would send first; a
+     * rejected PIN is dropped from params so verifyPIN() asks for a new one
+     * instead of retrying it.
+     */
+    void verifyPINEagerly(const Keycard::ApplicationInfo& appInfo);
     
     // ============================================================================
     // Helper utilities
@@ -249,6 +305,13 @@ public:
      * @brief Reset restart flag (called before re-execution)
      */
     void resetRestartFlag() { m_shouldRestart = false; }
+
+    /**
+     * @brief Total time spent paused waiting for user input (ms)
+     *
+     * Used to exclude user think time from flow statistics.
+     */
+    qint64 pausedMs() const { return m_pausedMs; }
     
 protected:
     
@@ -265,6 +328,12 @@ protected:
      */
     static QString publicKeyToAddress(const QByteArray& pubKey);
 
+    /**
+     * @brief Address of an exported public key, recorded in AddressIndex
+     *        under the card's keyUID for sign-by-address
+     */
+    QString indexAddress(const QString& path, const QByteArray& pubKey) const;
+
     /**
      * @brief Parse exported key data from TLV format
      * @param data Raw TLV data from exportKey
@@ -274,10 +343,37 @@ protected:
      */
     static bool parseExportedKey(const QByteArray& data, QByteArray& publicKey, QByteArray& privateKey);
 
+    /**
+     * @brief Export the public key of a path with the variant the applet supports
+     * @return Error key ("public-export-not-supported", "export-failed"), empty on success
+     */
+    QString exportPublicKey(const QString& path, QByteArray& publicKey);
+
 private:
+    /**
+     * @brief Times a step into FlowStats (active time only, outermost step only)
+     */
+    class StepTimer {
+    public:
+        StepTimer(FlowBase* flow, const char* step);
+        ~StepTimer();
+    private:
+        FlowBase* m_flow;
+        const char* m_step;
+        bool m_outermost;
+        qint64 m_startMs;
+        qint64 m_startPausedMs;
+    };
+
     FlowManager* m_manager;
     FlowType m_flowType;
     QJsonObject m_params;
+    std::shared_ptr<const RequestBatch> m_batch;
+    bool m_sessionShared;
+    bool m_eagerAuthorized;    // PIN verified by the eager path since the last SELECT
+    bool m_eagerPINRejected;   // Up-front PIN was wrong; next PIN request reports "pin"
+    bool m_pinAttempted;       // VERIFY PIN sent since the last SELECT (cached status is stale)
+    AppletCapabilities m_capabilities;
     
     // Pause/resume synchronization
     QWaitCondition m_resumeCondition;
@@ -285,6 +381,11 @@ private:
     bool m_paused;
     bool m_cancelled;
     bool m_shouldRestart;
+
+    // Statistics
+    QElapsedTimer m_clock;
+    qint64 m_pausedMs;
+    int m_stepDepth;
 };
 
 } // namespace StatusKeycard
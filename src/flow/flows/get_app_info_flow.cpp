@@ -82,6 +82,15 @@ QJsonObject GetAppInfoFlow::execute()
     result[FlowParams::ERROR_KEY] = "ok";
     result[FlowParams::APP_INFO] = appInfo;
     
+    // Identification only: report whether this host holds a pairing instead of
+    // opening a secure channel (which could consume a pairing slot)
+    if (params().value(FlowParams::SELECT_ONLY).toBool()) {
+        auto storage = commandSet()->pairingStorage();
+        result[FlowParams::PAIRED] = storage && storage->load(cardInfo().instanceUID).isValid();
+        qDebug() << "GetAppInfoFlow: Select-only execution completed";
+        return result;
+    }
+    
     // 4. Try to authenticate (to check if paired)
     //    This may pause for pairing password or PIN
     //    If user cancels, that's OK - we just mark as not paired
@@ -1,62 +1,15 @@
 #include "get_metadata_flow.h"
 #include "../flow_manager.h"
 #include "../flow_params.h"
+#include "../../card_decoder.h"
+#include "../../hex_codec.h"
+#include "../../plan/execution_planner.h"
 #include <keycard-qt/command_set.h>
 #include <QJsonArray>
 #include <QCryptographicHash>
 
 namespace StatusKeycard {
 
-// Helper: Find TLV tag in data
-static QByteArray findTlvTag(const QByteArray& data, uint8_t tag) {
-    int offset = 0;
-    while (offset < data.size()) {
-        if (offset + 2 > data.size()) break;
-        
-        uint8_t t = static_cast<uint8_t>(data[offset]);
-        if (t == tag) {
-            // Found the tag, parse length
-            int lenOffset = offset + 1;
-            int length = static_cast<uint8_t>(data[lenOffset]);
-            int dataOffset = lenOffset + 1;
-            
-            // Handle extended length (if bit 7 is set)
-            if (length & 0x80) {
-                int numLengthBytes = length & 0x7F;
-                if (dataOffset + numLengthBytes > data.size()) break;
-                length = 0;
-                for (int i = 0; i < numLengthBytes; i++) {
-                    length = (length << 8) | static_cast<uint8_t>(data[dataOffset + i]);
-                }
-                dataOffset += numLengthBytes;
-            }
-            
-            if (dataOffset + length > data.size()) break;
-            return data.mid(dataOffset, length);
-        }
-        
-        // Skip this tag
-        int lenOffset = offset + 1;
-        if (lenOffset >= data.size()) break;
-        int length = static_cast<uint8_t>(data[lenOffset]);
-        int dataOffset = lenOffset + 1;
-        
-        if (length & 0x80) {
-            int numLengthBytes = length & 0x7F;
-            if (dataOffset + numLengthBytes > data.size()) break;
-            length = 0;
-            for (int i = 0; i < numLengthBytes; i++) {
-                length = (length << 8) | static_cast<uint8_t>(data[dataOffset + i]);
-            }
-            dataOffset += numLengthBytes;
-        }
-        
-        offset = dataOffset + length;
-    }
-    
-    return QByteArray();
-}
-
 GetMetadataFlow::GetMetadataFlow(FlowManager* mgr, const QJsonObject& params, QObject* parent)
     : FlowBase(mgr, FlowType::GetMetadata, params, parent) {}
 
@@ -92,81 +45,34 @@ QJsonObject GetMetadataFlow::execute()
     }
     
     // Parse metadata using Go's custom binary format (matching types/metadata.go ParseMetadata())
-    // Format: [version+namelen][name][start/count pairs in LEB128]
-    //   Byte 0: version (3 bits) + name length (5 bits)
-    //   Bytes 1..namelen: card name
-    //   Remaining: series of start/count LEB128 pairs for wallet paths
-    
     QJsonObject metadata;
     metadata["name"] = "";
     metadata["wallets"] = QJsonArray();
     
-    int offset = 0;
-    if (offset >= metadataData.size()) {
-        qDebug() << "GetMetadataFlow: Metadata too short";
+    DecodedMetadata decoded;
+    DecodeError decodeError = CardDecoder::decodeMetadata(metadataData, decoded);
+    if (decodeError == DecodeError::UnsupportedVersion || decodeError == DecodeError::Truncated) {
+        qWarning() << "GetMetadataFlow: Unreadable metadata:" << decodeErrorString(decodeError);
         QJsonObject result = buildCardInfoJson();
         result[FlowParams::CARD_META] = metadata;
         return result;
     }
-    
-    // Parse header byte
-    uint8_t header = static_cast<uint8_t>(metadataData[offset++]);
-    uint8_t version = header >> 5;
-    uint8_t namelen = header & 0x1F;
-    
-    if (version != 1) {
-        qWarning() << "GetMetadataFlow: Invalid metadata version:" << version;
+    if (decodeError != DecodeError::None) {
+        // Over the decoding limits: report instead of expanding it
+        qWarning() << "GetMetadataFlow: Rejected metadata:" << decodeErrorString(decodeError);
         QJsonObject result = buildCardInfoJson();
-        result[FlowParams::CARD_META] = metadata;
+        result[FlowParams::ERROR_KEY] = QString("invalid-metadata-%1").arg(decodeErrorString(decodeError));
         return result;
     }
     
-    // Parse card name
-    if (namelen > 0) {
-        if (offset + namelen > metadataData.size()) {
-            qWarning() << "GetMetadataFlow: Metadata too short for name";
-            QJsonObject result = buildCardInfoJson();
-            result[FlowParams::CARD_META] = metadata;
-            return result;
-        }
-        QByteArray nameData = metadataData.mid(offset, namelen);
-        metadata["name"] = QString::fromUtf8(nameData);
-        offset += namelen;
-        qDebug() << "GetMetadataFlow: Card name:" << metadata["name"].toString();
-    }
+    metadata["name"] = decoded.name;
     
-    // Parse wallet paths (LEB128 encoded start/count pairs)
+    // Expand the [start, start+count] ranges into wallet paths
     QJsonArray wallets;
-    while (offset < metadataData.size()) {
-        // Parse start index (LEB128)
-        uint32_t start = 0;
-        int shift = 0;
-        while (offset < metadataData.size()) {
-            uint8_t byte = static_cast<uint8_t>(metadataData[offset++]);
-            start |= (byte & 0x7F) << shift;
-            if ((byte & 0x80) == 0) break;
-            shift += 7;
-        }
-        
-        if (offset >= metadataData.size()) break;
-        
-        // Parse count (LEB128)
-        uint32_t count = 0;
-        shift = 0;
-        while (offset < metadataData.size()) {
-            uint8_t byte = static_cast<uint8_t>(metadataData[offset++]);
-            count |= (byte & 0x7F) << shift;
-            if ((byte & 0x80) == 0) break;
-            shift += 7;
-        }
-        
-        // Add all paths in range [start, start+count]
-        for (uint32_t i = start; i <= start + count; ++i) {
-            QString walletPath = QString("m/44'/60'/0'/0/%1").arg(i);
-            QJsonObject wallet;
-            wallet["path"] = walletPath;
-            wallets.append(wallet);
-        }
+    for (quint32 index : decoded.walletIndexes()) {
+        QJsonObject wallet;
+        wallet["path"] = QString("m/44'/60'/0'/0/%1").arg(index);
+        wallets.append(wallet);
     }
     
     metadata["wallets"] = wallets;
@@ -199,7 +105,13 @@ QJsonObject GetMetadataFlow::execute()
         bool exportMaster = params().value(FlowParams::EXPORT_MASTER).toBool();
         if (exportMaster) {
             qDebug() << "GetMetadataFlow: Exporting master address";
-            QByteArray masterKeyData = commandSet()->exportKey(true, false, "m");
+            auto model = costModel();
+            QByteArray masterKeyData;
+            {
+                ApduTimer timer(model.get(), ApduCostModel::ExportKey);
+                masterKeyData = commandSet()->exportKey(true, false, "m");
+                timer.succeeded(!masterKeyData.isEmpty());
+            }
             if (!masterKeyData.isEmpty()) {
                 // Parse TLV structure to extract public key, private key, and chain code
                 QByteArray publicKey;
@@ -238,16 +150,16 @@ QJsonObject GetMetadataFlow::execute()
                     QByteArray pubKeyData = publicKey.mid(1);  // Remove 0x04 prefix
                     QByteArray hash = QCryptographicHash::hash(pubKeyData, QCryptographicHash::Keccak_256);
                     QByteArray addressBytes = hash.right(20);  // Last 20 bytes
-                    QString masterAddress = QString("0x") + addressBytes.toHex();
+                    QString masterAddress = HexCodec::toHex(addressBytes, true);
                     
                     // Store master key data in metadata
                     metadata["masterAddress"] = masterAddress;
-                    metadata["masterPublicKey"] = QString::fromLatin1(publicKey.toHex());
+                    metadata["masterPublicKey"] = HexCodec::toHex(publicKey);
                     if (!privateKey.isEmpty()) {
-                        metadata["masterPrivateKey"] = QString::fromLatin1(privateKey.toHex());
+                        metadata["masterPrivateKey"] = HexCodec::toHex(privateKey);
                     }
                     if (!chainCode.isEmpty()) {
-                        metadata["masterChainCode"] = QString::fromLatin1(chainCode.toHex());
+                        metadata["masterChainCode"] = HexCodec::toHex(chainCode);
                     }
                 } else {
                     qWarning() << "GetMetadataFlow: Invalid master public key format, size=" << publicKey.size();
@@ -261,7 +173,13 @@ QJsonObject GetMetadataFlow::execute()
             QJsonObject wallet = wallets[i].toObject();
             QString walletPath = wallet["path"].toString();
             
-            QByteArray keyData = commandSet()->exportKey(true, false, walletPath);
+            auto model = costModel();
+            QByteArray keyData;
+            {
+                ApduTimer timer(model.get(), ApduCostModel::ExportKey, ExecutionPlanner::pathDepth(walletPath));
+                keyData = commandSet()->exportKey(true, false, walletPath);
+                timer.succeeded(!keyData.isEmpty());
+            }
             if (!keyData.isEmpty()) {
                 // Parse TLV structure to extract public key, private key, and chain code
                 // Format: Tag 0xA1 (template) -> Tag 0x80 (public key), Tag 0x81 (private key), Tag 0x82 (chain code)
@@ -298,17 +216,17 @@ QJsonObject GetMetadataFlow::execute()
                 
                 if (publicKey.size() == 65 && static_cast<uint8_t>(publicKey[0]) == 0x04) {
                     // Store hex-encoded public key
-                    wallet["publicKey"] = QString::fromLatin1(publicKey.toHex());
-                    wallet["address"] = FlowBase::publicKeyToAddress(publicKey);
+                    wallet["publicKey"] = HexCodec::toHex(publicKey);
+                    wallet["address"] = indexAddress(walletPath, publicKey);
                     
                     // Store hex-encoded private key (if present) - marked as omitempty in Go
                     if (!privateKey.isEmpty()) {
-                        wallet["privateKey"] = QString::fromLatin1(privateKey.toHex());
+                        wallet["privateKey"] = HexCodec::toHex(privateKey);
                     }
                     
                     // Store hex-encoded chain code (if present)
                     if (!chainCode.isEmpty()) {
-                        wallet["chainCode"] = QString::fromLatin1(chainCode.toHex());
+                        wallet["chainCode"] = HexCodec::toHex(chainCode);
                     }
                     
                 } else {
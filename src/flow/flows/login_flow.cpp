@@ -1,6 +1,8 @@
 #include "login_flow.h"
 #include "../flow_manager.h"
 #include "../flow_params.h"
+#include "../../hex_codec.h"
+#include "../../plan/execution_planner.h"
 #include <keycard-qt/command_set.h>
 #include <keycard-qt/types.h>
 #include <QDebug>
@@ -99,7 +101,13 @@ QJsonObject LoginFlow::exportKey(const QString& path, bool includePrivate)
         Keycard::APDU::P2ExportKeyPrivateAndPublic :
         Keycard::APDU::P2ExportKeyPublicOnly;
     
-    QByteArray keyData = cmdSet->exportKey(true, makeCurrent, path, exportType);
+    auto model = costModel();
+    QByteArray keyData;
+    {
+        ApduTimer timer(model.get(), ApduCostModel::ExportKey, ExecutionPlanner::pathDepth(path));
+        keyData = cmdSet->exportKey(true, makeCurrent, path, exportType);
+        timer.succeeded(!keyData.isEmpty());
+    }
     
     if (keyData.isEmpty()) {
         qCritical() << "LoginFlow: Export key returned empty data!";
@@ -115,11 +123,11 @@ QJsonObject LoginFlow::exportKey(const QString& path, bool includePrivate)
     }
     
     QJsonObject keyPair;
-    keyPair["publicKey"] = QString("0x") + publicKey.toHex();
-    keyPair["address"] = FlowBase::publicKeyToAddress(publicKey);
+    keyPair["publicKey"] = HexCodec::toHex(publicKey, true);
+    keyPair["address"] = indexAddress(path, publicKey);
     
     if (includePrivate && !privateKey.isEmpty()) {
-        keyPair["privateKey"] = QString("0x") + privateKey.toHex();
+        keyPair["privateKey"] = HexCodec::toHex(privateKey, true);
     } else if (includePrivate) {
         qCritical() << "LoginFlow: Private key requested but not found in exported data";
         return QJsonObject();
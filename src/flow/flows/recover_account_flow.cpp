@@ -1,6 +1,8 @@
 #include "recover_account_flow.h"
 #include "../flow_manager.h"
 #include "../flow_params.h"
+#include "../../hex_codec.h"
+#include "../../plan/execution_planner.h"
 #include <keycard-qt/command_set.h>
 #include <keycard-qt/types.h>
 #include <QDebug>
@@ -145,7 +147,13 @@ QJsonObject RecoverAccountFlow::exportKey(const QString& path, bool includePriva
         Keycard::APDU::P2ExportKeyPrivateAndPublic :
         Keycard::APDU::P2ExportKeyPublicOnly;
     
-    QByteArray keyData = cmdSet->exportKey(true, makeCurrent, path, exportType);
+    auto model = costModel();
+    QByteArray keyData;
+    {
+        ApduTimer timer(model.get(), ApduCostModel::ExportKey, ExecutionPlanner::pathDepth(path));
+        keyData = cmdSet->exportKey(true, makeCurrent, path, exportType);
+        timer.succeeded(!keyData.isEmpty());
+    }
     
     if (keyData.isEmpty()) {
         qCritical() << "RecoverAccountFlow: Export key returned empty data!";
@@ -160,11 +168,11 @@ QJsonObject RecoverAccountFlow::exportKey(const QString& path, bool includePriva
     }
     
     QJsonObject keyPair;
-    keyPair["publicKey"] = QString("0x") + publicKey.toHex();
-    keyPair["address"] = FlowBase::publicKeyToAddress(publicKey);
+    keyPair["publicKey"] = HexCodec::toHex(publicKey, true);
+    keyPair["address"] = indexAddress(path, publicKey);
     
     if (includePrivate && !privateKey.isEmpty()) {
-        keyPair["privateKey"] = QString("0x") + privateKey.toHex();
+        keyPair["privateKey"] = HexCodec::toHex(privateKey, true);
     } else if (includePrivate) {
         qCritical() << "RecoverAccountFlow: Private key requested but not found";
         return QJsonObject();
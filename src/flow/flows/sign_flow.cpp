@@ -2,124 +2,79 @@
 #include "../flow_manager.h"
 #include "../flow_params.h"
 #include "../flow_signals.h"
+#include "../signature_verifier.h"
+#include "../../card_decoder.h"
+#include "../../hex_codec.h"
+#include "../../plan/execution_planner.h"
+#include "../../session/address_index.h"
 #include <keycard-qt/command_set.h>
+#include <QJsonArray>
+#include <QHash>
 #include <QDebug>
 
-#include <openssl/ec.h>
-#include <openssl/ecdsa.h>
-#include <openssl/obj_mac.h>
-#include <openssl/bn.h>
-#include <openssl/evp.h>
-
 namespace StatusKeycard {
 
-// Helper function to calculate recovery ID (V value) from signature
-// Tries both possible V values (0 and 1) and returns the one that matches expectedPubKey
-// Returns -1 if neither works
-static int calculateRecoveryId(const QByteArray& hash, const QByteArray& r, const QByteArray& s, 
-                                const QByteArray& expectedPubKey)
+SignFlow::SignFlow(FlowManager* manager, const QJsonObject& params, QObject* parent)
+    : FlowBase(manager, FlowType::Sign, params, parent)
 {
-    if (hash.size() != 32 || r.size() != 32 || s.size() != 32 || expectedPubKey.size() != 65) {
-        return -1;
+}
+
+SignFlow::~SignFlow()
+{
+}
+
+QString SignFlow::signHash(const QByteArray& hashBytes, const QString& path,
+                           QByteArray& publicKey, QByteArray& r, QByteArray& s)
+{
+    // Sign with the specified path - use the full response version to get TLV data
+    auto cmdSet = commandSet();
+    auto model = costModel();
+    QByteArray tlvResponse;
+    {
+        ApduTimer timer(model.get(), ApduCostModel::Sign, ExecutionPlanner::pathDepth(path));
+        tlvResponse = cmdSet->signWithPathFullResponse(hashBytes, path);
+        timer.succeeded(!tlvResponse.isEmpty());
     }
     
-    // Create EC_KEY and set up for secp256k1
-    EC_KEY* eckey = EC_KEY_new_by_curve_name(NID_secp256k1);
-    if (!eckey) {
-        return -1;
+    if (tlvResponse.isEmpty()) {
+        return "sign-failed";
     }
     
-    const EC_GROUP* group = EC_KEY_get0_group(eckey);
-    
-    // Parse the expected public key
-    EC_POINT* expected_point = EC_POINT_new(group);
-    if (!expected_point || !EC_POINT_oct2point(group, expected_point, 
-            reinterpret_cast<const unsigned char*>(expectedPubKey.data()), 65, nullptr)) {
-        if (expected_point) EC_POINT_free(expected_point);
-        EC_KEY_free(eckey);
-        return -1;
+    // Extract signature and public key from TLV response
+    // The response format (like Go's status-keycard-go):
+    // - Template tag 0xA0 or 0xA1 contains:
+    //   - Tag 0x80 (65 bytes): Public key
+    //   - Tag 0x30 (variable): DER signature
+    QByteArray scanData = tlvResponse;
+    int depth = 0;
+    quint8 firstTag = static_cast<quint8>(tlvResponse[0]);
+    if (firstTag == 0xa0 || firstTag == 0xa1) {
+        scanData = CardDecoder::findTlvTag(tlvResponse, firstTag);
+        depth = 1;
+    } else {
+        qDebug() << "SignFlow: No template tag found, scanning raw response";
     }
     
-    // Convert r to a point on the curve
-    // For ECDSA recovery, we need to find the point R on the curve where R.x = r
-    // There are two possible points (with even and odd Y coordinates)
-    BIGNUM* r_bn = BN_bin2bn(reinterpret_cast<const unsigned char*>(r.data()), 32, nullptr);
-    BN_CTX* ctx = BN_CTX_new();
-    
-    int result = -1;
+    // Public key and signature in one pass over the template
+    const quint8 tags[] = { 0x80, 0x30 };
+    QByteArray values[2];
+    DecodeError decodeError = CardDecoder::findTlvTags(scanData, tags, values, 2, depth);
+    if (decodeError != DecodeError::None) {
+        qWarning() << "SignFlow: Invalid sign response:" << decodeErrorString(decodeError);
+    }
+    publicKey = values[0].size() == 65 ? values[0] : QByteArray();
     
-    // Try both possible Y coordinates (recovery ID 0 and 1)
-    for (int rec_id = 0; rec_id <= 1; rec_id++) {
-        EC_POINT* R = EC_POINT_new(group);
-        if (!R) continue;
-        
-        // Set R.x = r and calculate R.y using the curve equation
-        // y^2 = x^3 + 7 (for secp256k1)
-        if (EC_POINT_set_compressed_coordinates(group, R, r_bn, rec_id, ctx) == 1) {
-            // Now perform ECDSA recovery: Q = r^-1 * (s*R - e*G)
-            // Where Q is the public key, e is the hash, G is the generator
-            
-            BIGNUM* s_bn = BN_bin2bn(reinterpret_cast<const unsigned char*>(s.data()), 32, nullptr);
-            BIGNUM* e_bn = BN_bin2bn(reinterpret_cast<const unsigned char*>(hash.data()), 32, nullptr);
-            BIGNUM* order = BN_new();
-            BIGNUM* r_inv = BN_new();
-            
-            EC_GROUP_get_order(group, order, ctx);
-            
-            // Calculate r^-1 mod order
-            if (BN_mod_inverse(r_inv, r_bn, order, ctx)) {
-                // Calculate s*R
-                EC_POINT* sR = EC_POINT_new(group);
-                EC_POINT_mul(group, sR, nullptr, R, s_bn, ctx);
-                
-                // Calculate e*G
-                EC_POINT* eG = EC_POINT_new(group);
-                EC_POINT_mul(group, eG, e_bn, nullptr, nullptr, ctx);
-                
-                // Calculate s*R - e*G
-                EC_POINT_invert(group, eG, ctx);
-                EC_POINT_add(group, sR, sR, eG, ctx);
-                
-                // Calculate Q = r^-1 * (s*R - e*G)
-                EC_POINT* Q = EC_POINT_new(group);
-                EC_POINT_mul(group, Q, nullptr, sR, r_inv, ctx);
-                
-                // Compare with expected public key
-                if (EC_POINT_cmp(group, Q, expected_point, ctx) == 0) {
-                    result = rec_id;
-                }
-                
-                EC_POINT_free(Q);
-                EC_POINT_free(eG);
-                EC_POINT_free(sR);
-            }
-            
-            BN_free(r_inv);
-            BN_free(order);
-            BN_free(e_bn);
-            BN_free(s_bn);
-        }
-        
-        EC_POINT_free(R);
-        
-        if (result != -1) break;  // Found it!
+    if (values[1].isEmpty()) {
+        return "der-signature-not-found";
     }
     
-    BN_CTX_free(ctx);
-    BN_free(r_bn);
-    EC_POINT_free(expected_point);
-    EC_KEY_free(eckey);
+    // DER format: 30 <len> 02 <rlen> <r> 02 <slen> <s>
+    decodeError = CardDecoder::decodeDerSignature(values[1], r, s);
+    if (decodeError != DecodeError::None) {
+        return decodeErrorString(decodeError);
+    }
     
-    return result;
-}
-
-SignFlow::SignFlow(FlowManager* manager, const QJsonObject& params, QObject* parent)
-    : FlowBase(manager, FlowType::Sign, params, parent)
-{
-}
-
-SignFlow::~SignFlow()
-{
+    return QString();
 }
 
 QJsonObject SignFlow::execute()
@@ -138,9 +93,12 @@ QJsonObject SignFlow::execute()
         return error;
     }
     
-    // Get tx hash
-    QString txHash = params()[FlowParams::TX_HASH].toString();
-    if (txHash.isEmpty()) {
+    // Get tx hash (a string, or an array of hashes for batch signing;
+    // large arrays arrive pre-decoded in the request batch)
+    const RequestBatch* batch = requestBatch();
+    QJsonValue hashValue = params()[FlowParams::TX_HASH];
+    bool haveHashes = batch && batch->hasHashes();
+    if (!haveHashes && hashValue.toString().isEmpty() && !hashValue.isArray()) {
         // Request transaction hash (empty error = normal request)
         pauseAndWait(FlowSignals::ENTER_TX_HASH, "");
         if (isCancelled()) {
@@ -148,12 +106,51 @@ QJsonObject SignFlow::execute()
             error[FlowParams::ERROR_KEY] = "cancelled";
             return error;
         }
-        txHash = params()[FlowParams::TX_HASH].toString();
+        hashValue = params()[FlowParams::TX_HASH];
     }
     
-    // Get path
-    QString path = params()[FlowParams::BIP44_PATH].toString();
-    if (path.isEmpty()) {
+    QVector<QByteArray> txHashes;
+    if (haveHashes) {
+        txHashes.reserve(batch->hashCount);
+        for (int i = 0; i < batch->hashCount; ++i) {
+            txHashes.append(batch->hash(i));
+        }
+    } else {
+        const QJsonArray hashArray = hashValue.isArray() ? hashValue.toArray() : QJsonArray{hashValue};
+        txHashes.reserve(hashArray.size());
+        for (const QJsonValue& val : hashArray) {
+            QByteArray hash;
+            if (!RequestBatch::decodeHash(val.toString(), hash)) {
+                QJsonObject error;
+                error[FlowParams::ERROR_KEY] = "invalid-tx-hash";
+                return error;
+            }
+            txHashes.append(hash);
+        }
+    }
+    bool isBatch = haveHashes || hashValue.isArray();
+    
+    // Get path (a string used for every hash, or one path per hash)
+    QJsonValue pathValue = params()[FlowParams::BIP44_PATH];
+    bool havePaths = batch && batch->hasPaths;
+    
+    // Sender address instead of a path: resolve it the same shape (string or array)
+    QJsonValue addressValue = params()[FlowParams::ADDRESS];
+    if (!havePaths && pathValue.toString().isEmpty() && !pathValue.isArray()
+        && (addressValue.isArray() || !addressValue.toString().isEmpty())) {
+        const QJsonArray addresses = addressValue.isArray() ? addressValue.toArray() : QJsonArray{addressValue};
+        QJsonArray resolved;
+        QJsonValue failedAddress;
+        QString resolveError = resolveAddressPaths(addresses, resolved, failedAddress);
+        if (!resolveError.isEmpty()) {
+            QJsonObject error;
+            error[FlowParams::ERROR_KEY] = resolveError;
+            error[FlowParams::ADDRESS] = failedAddress;
+            return error;
+        }
+        pathValue = addressValue.isArray() ? QJsonValue(resolved) : resolved.first();
+    }
+    if (!havePaths && pathValue.toString().isEmpty() && !pathValue.isArray()) {
         // Request BIP44 path (empty error = normal request)
         pauseAndWait(FlowSignals::ENTER_PATH, "");
         if (isCancelled()) {
@@ -161,225 +158,192 @@ QJsonObject SignFlow::execute()
             error[FlowParams::ERROR_KEY] = "cancelled";
             return error;
         }
-        path = params()[FlowParams::BIP44_PATH].toString();
+        pathValue = params()[FlowParams::BIP44_PATH];
     }
     
-    // Sign with the specified path - use the full response version to get TLV data
-    auto cmdSet = commandSet();
-    QByteArray hashBytes = QByteArray::fromHex(txHash.toLatin1());
-    QByteArray tlvResponse = cmdSet->signWithPathFullResponse(hashBytes, path);
-    
-    if (tlvResponse.isEmpty()) {
-        QJsonObject error;
-        error[FlowParams::ERROR_KEY] = "sign-failed";
-        return error;
-    }
-    
-    // Extract signature and public key from TLV response
-    // The response format (like Go's status-keycard-go):
-    // - Template tag 0xA0 or 0xA1 contains:
-    //   - Tag 0x80 (65 bytes): Public key
-    //   - Tag 0x30 (variable): DER signature
-    //
-    // Strategy: Find template tag first, then scan inside it
-    
-    QByteArray publicKey;
-    QByteArray derSignature;
-    QByteArray scanData = tlvResponse;
-    
-    // First, check if response starts with template tag 0xA0 or 0xA1
-        qDebug() << "SignFlow: tlvResponse size:" << tlvResponse.size() << "first byte:" << QString("0x%1").arg((uint8_t)tlvResponse[0], 2, 16, QChar('0'));
-    if (tlvResponse.size() > 2) {
-        uint8_t firstTag = static_cast<uint8_t>(tlvResponse[0]);
-        qDebug() << "SignFlow: firstTag:" << QString("0x%1").arg(firstTag, 2, 16, QChar('0'));
-        if (firstTag == 0xa0 || firstTag == 0xa1) {
-            // Parse the template length and extract the inner data
-            int idx = 1;
-            uint8_t lenByte = static_cast<uint8_t>(tlvResponse[idx++]);
-            int templateLen = 0;
-            qDebug() << "SignFlow: Template lenByte:" << QString("0x%1").arg(lenByte, 2, 16, QChar('0'));
-            
-            if (lenByte & 0x80) {
-                // Multi-byte length
-                int numLenBytes = lenByte & 0x7F;
-                qDebug() << "SignFlow: Multi-byte length, numLenBytes:" << numLenBytes << "idx:" << idx << "tlvResponse.size:" << tlvResponse.size();
-                if (numLenBytes <= 3 && idx + numLenBytes <= tlvResponse.size()) {
-                    for (int i = 0; i < numLenBytes; i++) {
-                        templateLen = (templateLen << 8) | static_cast<uint8_t>(tlvResponse[idx++]);
-                    }
-                    qDebug() << "SignFlow: Found template tag, length:" << templateLen << "extracting from idx:" << idx;
-                    // Scan inside the template data
-                    scanData = tlvResponse.mid(idx, templateLen);
-                    qDebug() << "SignFlow: scanData size:" << scanData.size() << "first byte:" << QString("0x%1").arg((uint8_t)scanData[0], 2, 16, QChar('0'));
-                } else {
-                    qWarning() << "SignFlow: Template extraction failed - numLenBytes:" << numLenBytes << "check failed";
-                }
-            } else {
-                // Single-byte length
-                templateLen = lenByte;
-                qDebug() << "SignFlow: Found template tag, single-byte length:" << templateLen;
-                scanData = tlvResponse.mid(idx, templateLen);
-            }
+    QStringList paths;
+    if (havePaths || pathValue.isArray()) {
+        if (havePaths) {
+            paths = batch->paths;
         } else {
-            qDebug() << "SignFlow: No template tag found, scanning raw response";
-        }
-    }
-    
-    // Now scan the data (either template contents or raw response) for public key and DER signature
-    bool foundPubKey = false;
-    bool foundDERSig = false;
-    
-    int idx = 0;
-    while (idx < scanData.size() - 1 && !(foundPubKey && foundDERSig)) {
-        uint8_t tag = static_cast<uint8_t>(scanData[idx++]);
-        
-        // Parse length (for ALL tags, even ones we don't care about)
-        int length = 0;
-        if (idx >= scanData.size()) break;
-        uint8_t lenByte = static_cast<uint8_t>(scanData[idx++]);
-        if (lenByte & 0x80) {
-            int numLenBytes = lenByte & 0x7F;
-            if (numLenBytes > 3 || idx + numLenBytes > scanData.size()) {
-                qWarning() << "SignFlow: Invalid length encoding at idx" << (idx-1) << "numLenBytes:" << numLenBytes;
-                break;
-            }
-            for (int i = 0; i < numLenBytes; i++) {
-                length = (length << 8) | static_cast<uint8_t>(scanData[idx++]);
+            for (const QJsonValue& val : pathValue.toArray()) {
+                paths.append(val.toString());
             }
-        } else {
-            length = lenByte;
         }
-        
-        // Validate length
-        if (length < 0 || idx + length > scanData.size()) {
-            qWarning() << "SignFlow: TLV length" << length << "exceeds data at idx" << idx;
-            break;
+        if (paths.size() != txHashes.size()) {
+            QJsonObject error;
+            error[FlowParams::ERROR_KEY] = "path-count-mismatch";
+            return error;
         }
-        
-        // Process tags we care about (like Go's FindTag matching logic)
-        if (tag == 0x80 && length == 65) {
-            if (!foundPubKey) {
-                publicKey = scanData.mid(idx, 65);
-                foundPubKey = true;
-                qDebug() << "SignFlow: Found public key at idx" << idx;
-            }
-        } else if (tag == 0x30) {
-            // DER signature - include tag and length bytes
-            int derStart = idx - 2;
-            derSignature = scanData.mid(derStart, length + 2);
-            foundDERSig = true;
-            qDebug() << "SignFlow: Found DER signature at idx" << derStart << ", length:" << length;
-        } else {
-            // Unknown tag (including 0x00 null tags) - just log and skip
-            qDebug() << "SignFlow: Skipping tag" << QString("0x%1").arg(tag, 2, 16, QChar('0')) << "length" << length << "at idx" << (idx-2);
+    } else {
+        for (int i = 0; i < txHashes.size(); ++i) {
+            paths.append(pathValue.toString());
         }
-        
-        // ALWAYS advance by the data length (critical for proper parsing!)
-        idx += length;
     }
     
-    if (!foundDERSig) {
-        QJsonObject error;
-        error[FlowParams::ERROR_KEY] = "der-signature-not-found";
-        return error;
+    QVector<SignatureVerifier::Item> items;
+    items.reserve(txHashes.size());
+    for (int i = 0; i < txHashes.size(); ++i) {
+        SignatureVerifier::Item item;
+        item.hash = txHashes[i];
+        
+        QString signError = signHash(item.hash, paths[i], item.publicKey, item.r, item.s);
+        if (!signError.isEmpty()) {
+            QJsonObject error;
+            error[FlowParams::ERROR_KEY] = signError;
+            return error;
+        }
+        
+        items.append(item);
     }
     
-    // Parse DER signature to extract R and S
-    // DER format: 30 <len> 02 <rlen> <r> 02 <slen> <s>
-    // Like Go's DERSignatureToRS, find the first and second 0x02 tags
-    QByteArray r, s;
-    
-    int dIdx = 0;
-    if (derSignature.size() < 6 || derSignature[dIdx++] != 0x30) {
-        QJsonObject error;
-        error[FlowParams::ERROR_KEY] = "invalid-der-format";
-        return error;
+    // V from the key the card signed with (like Go's calculateV); 27 when
+    // the card returned no key or the signature does not match it
+    SignatureVerifier::computeRecoveryIds(items);
+    QJsonArray signatures;
+    for (const SignatureVerifier::Item& item : items) {
+        if (item.recoveryId < 0) {
+            qWarning() << "SignFlow: No recovery ID from the card's public key, defaulting V=27";
+        }
+        QJsonObject sigObj;
+        sigObj["r"] = HexCodec::toHex(item.r);
+        sigObj["s"] = HexCodec::toHex(item.s);
+        sigObj["v"] = 27 + qMax(0, item.recoveryId);
+        signatures.append(sigObj);
     }
     
-    // Skip DER sequence length byte
-    dIdx++;
-    
-    // Find first INTEGER (tag 0x02) for R
-    if (dIdx >= derSignature.size() || derSignature[dIdx++] != 0x02) {
-        QJsonObject error;
-        error[FlowParams::ERROR_KEY] = "der-r-tag-not-found";
-        return error;
+    // Optional host-side verification against the public key expected for each path
+    if (params()[FlowParams::VERIFY_SIGNATURE].toBool(false)) {
+        QString verifyError = verifySignatures(paths, items, signatures);
+        if (!verifyError.isEmpty()) {
+            QJsonObject error;
+            error[FlowParams::ERROR_KEY] = verifyError;
+            return error;
+        }
+        
+        if (!isBatch && !signatures[0].toObject()[FlowParams::SIGNATURE_VERIFIED].toBool()) {
+            QJsonObject error;
+            error[FlowParams::ERROR_KEY] = "signature-verification-failed";
+            return error;
+        }
     }
     
-    int rLen = static_cast<uint8_t>(derSignature[dIdx++]);
-    if (dIdx + rLen > derSignature.size()) {
-        QJsonObject error;
-        error[FlowParams::ERROR_KEY] = "der-r-length-invalid";
-        return error;
+    QJsonObject result = buildCardInfoJson();
+    // Array input -> array output, string input -> single signature (same as ExportPublic)
+    if (isBatch) {
+        result[FlowParams::TX_SIGNATURE] = signatures;
+    } else {
+        result[FlowParams::TX_SIGNATURE] = signatures[0];
     }
     
-    QByteArray rValue = derSignature.mid(dIdx, rLen);
-    dIdx += rLen;
-    
-    // DER pads with 0x00 if MSB is set - strip it to get 32 bytes
-    if (rValue.size() > 32) {
-        rValue = rValue.right(32);
+    qDebug() << "SignFlow: Complete";
+    return result;
+}
+
+QString SignFlow::resolveAddressPaths(const QJsonArray& addresses, QJsonArray& paths, QJsonValue& failedAddress)
+{
+    AddressIndex* index = AddressIndex::instance();
+    const QString keyUID = cardInfo().keyUID;
+    auto firstMissing = [&]() {
+        for (int i = 0; i < addresses.size(); ++i) {
+            if (index->path(keyUID, addresses[i].toString()).isEmpty()) {
+                return i;
+            }
+        }
+        return -1;
+    };
+    
+    // Not all indexed yet: derive the first wallet addresses once, indexing
+    // each, until every address is known
+    int missing = firstMissing();
+    if (missing >= 0) {
+        int limit = qBound(0, params()[FlowParams::ADDRESS_SEARCH_LIMIT].toInt(DEFAULT_ADDRESS_SEARCH_LIMIT),
+                           MAX_ADDRESS_SEARCH_LIMIT);
+        qDebug() << "SignFlow: Addresses not indexed, searching" << limit << "wallet paths";
+        for (int i = 0; i < limit && missing >= 0; ++i) {
+            QString candidate = QString("m/44'/60'/0'/0/%1").arg(i);
+            QByteArray publicKey;
+            QString exportError = exportPublicKey(candidate, publicKey);
+            if (!exportError.isEmpty()) {
+                failedAddress = addresses[missing];
+                return exportError;
+            }
+            indexAddress(candidate, publicKey);
+            missing = firstMissing();
+        }
     }
-    // Pad if needed
-    while (rValue.size() < 32) {
-        rValue.prepend('\0');
+    if (missing >= 0) {
+        failedAddress = addresses[missing];
+        return "address-not-found";
     }
-    r = rValue;
     
-    // Find second INTEGER (tag 0x02) for S
-    if (dIdx >= derSignature.size() || derSignature[dIdx++] != 0x02) {
-        QJsonObject error;
-        error[FlowParams::ERROR_KEY] = "der-s-tag-not-found";
-        return error;
+    for (const QJsonValue& address : addresses) {
+        paths.append(index->path(keyUID, address.toString()));
     }
-    
-    int sLen = static_cast<uint8_t>(derSignature[dIdx++]);
-    if (dIdx + sLen > derSignature.size()) {
-        QJsonObject error;
-        error[FlowParams::ERROR_KEY] = "der-s-length-invalid";
-        return error;
+    return QString();
+}
+
+QString SignFlow::verifySignatures(const QStringList& paths, QVector<SignatureVerifier::Item>& items,
+                                   QJsonArray& signatures)
+{
+    // Expected keys: caller-provided (string or one per hash), else exported once per path
+    QJsonValue expectedValue = params()[FlowParams::EXPECTED_PUBLIC_KEY];
+    QHash<QString, QByteArray> exportedKeys;
+    QVector<int> unresolved;
+    
+    for (int i = 0; i < items.size(); ++i) {
+        QString expectedHex = expectedValue.isArray() ?
+            expectedValue.toArray().at(i).toString() :
+            expectedValue.toString();
+        if (expectedHex.startsWith("0x")) {
+            expectedHex = expectedHex.mid(2);
+        }
+        
+        QByteArray expected;
+        if (!expectedHex.isEmpty()) {
+            expected = HexCodec::fromHex(expectedHex);
+        } else if (exportedKeys.contains(paths[i])) {
+            expected = exportedKeys.value(paths[i]);
+        } else {
+            QString exportError = exportPublicKey(paths[i], expected);
+            if (!exportError.isEmpty()) {
+                return exportError;
+            }
+            exportedKeys.insert(paths[i], expected);
+        }
+        
+        SignatureVerifier::Item& item = items[i];
+        if (item.recoveryId < 0) {
+            unresolved.append(i);
+        }
+        item.publicKey = expected;
     }
     
-    QByteArray sValue = derSignature.mid(dIdx, sLen);
-    
-    // DER pads with 0x00 if MSB is set - strip it to get 32 bytes
-    if (sValue.size() > 32) {
-        sValue = sValue.right(32);
-    }
-    // Pad if needed
-    while (sValue.size() < 32) {
-        sValue.prepend('\0');
+    // Card returned no usable public key: R's parity comes from the expected key
+    if (!unresolved.isEmpty()) {
+        QVector<SignatureVerifier::Item> pending;
+        for (int i : unresolved) {
+            pending.append(items[i]);
+        }
+        SignatureVerifier::computeRecoveryIds(pending);
+        for (int i = 0; i < unresolved.size(); ++i) {
+            items[unresolved[i]].recoveryId = pending[i].recoveryId;
+        }
     }
-    s = sValue;
     
-    // Calculate V using ECDSA recovery (like Go's calculateV)
-    // Try recovery IDs 0-3 and pick the one that recovers to the correct public key
-    uint8_t v = 27; // Default
+    QVector<bool> verified = SignatureVerifier::verifyBatch(items);
     
-    if (publicKey.isEmpty()) {
-        qWarning() << "SignFlow: No public key found, defaulting V=27";
-    } else {
-        int recoveryId = calculateRecoveryId(hashBytes, r, s, publicKey);
-        if (recoveryId == -1) {
-            qWarning() << "SignFlow: ECDSA recovery failed, defaulting V=27";
-        } else {
-            v = static_cast<uint8_t>(recoveryId + 27);
-            qDebug() << "SignFlow: Calculated V=" << v << "(recovery ID" << recoveryId << ")";
+    for (int i = 0; i < signatures.size(); ++i) {
+        QJsonObject sigObj = signatures[i].toObject();
+        sigObj[FlowParams::SIGNATURE_VERIFIED] = verified[i];
+        signatures[i] = sigObj;
+        
+        if (!verified[i]) {
+            qWarning() << "SignFlow: Signature" << i << "failed verification for path" << paths[i];
         }
     }
     
-    // Build signature object with r, s, v components
-    QJsonObject sigObj;
-    sigObj["r"] = QString::fromLatin1(r.toHex());
-    sigObj["s"] = QString::fromLatin1(s.toHex());
-    sigObj["v"] = static_cast<int>(v);
-    
-    QJsonObject result = buildCardInfoJson();
-    result[FlowParams::TX_SIGNATURE] = sigObj;
-    
-    qDebug() << "SignFlow: Complete";
-    return result;
+    return QString();
 }
 
 } // namespace StatusKeycard
-
@@ -2,11 +2,23 @@
 #define SIGN_FLOW_H
 
 #include "flow_base.h"
+#include "../signature_verifier.h"
+#include <QJsonArray>
 
 namespace StatusKeycard {
 
 /**
  * @brief Sign Flow - Sign transaction hash
+ *
+ * tx-hash may be an array to sign several hashes in one flow (bip44-path is
+ * then a single path or one path per hash). With verify-signature set, every
+ * signature is verified on the host against the expected public key for its
+ * path (expected-public-key, or the key exported from the card), as a batch.
+ *
+ * Instead of bip44-path, address (string or one per hash) names the signing
+ * key by its address. It is looked up in AddressIndex; an address not indexed
+ * yet is searched among the first address-search-limit wallet paths
+ * (m/44'/60'/0'/0/i), one search for all of them.
  */
 class SignFlow : public FlowBase {
     Q_OBJECT
@@ -16,6 +28,23 @@ public:
     ~SignFlow();
     
     QJsonObject execute() override;
+
+private:
+    // Sign one hash; returns an error key on failure. V is computed for the
+    // whole batch afterwards (SignatureVerifier::computeRecoveryIds()).
+    QString signHash(const QByteArray& hashBytes, const QString& path,
+                     QByteArray& publicKey, QByteArray& r, QByteArray& s);
+
+    static constexpr int DEFAULT_ADDRESS_SEARCH_LIMIT = 20;  // BIP44 gap limit
+    static constexpr int MAX_ADDRESS_SEARCH_LIMIT = 256;
+
+    // Path for each sender address, searching the wallet paths at most once;
+    // returns an error key on failure, with the address it concerns
+    QString resolveAddressPaths(const QJsonArray& addresses, QJsonArray& paths, QJsonValue& failedAddress);
+
+    // Fill in expected keys, batch-verify and mark each signature; returns an error key on failure
+    QString verifySignatures(const QStringList& paths, QVector<SignatureVerifier::Item>& items,
+                             QJsonArray& signatures);
 };
 
 } // namespace StatusKeycard
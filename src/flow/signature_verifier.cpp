@@ -0,0 +1,269 @@
+#include "signature_verifier.h"
+#include <QDebug>
+
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <openssl/bn.h>
+#include <openssl/rand.h>
+
+#include <vector>
+
+namespace StatusKeycard {
+
+namespace {
+
+// Per-signature terms: u1 = e/s, u2 = r/s (mod n), with Q and R as points
+struct Prepared {
+    BIGNUM* u1 = nullptr;
+    BIGNUM* u2 = nullptr;
+    EC_POINT* Q = nullptr;
+    EC_POINT* R = nullptr;
+};
+
+void freePrepared(Prepared& p)
+{
+    BN_free(p.u1);
+    BN_free(p.u2);
+    EC_POINT_free(p.Q);
+    EC_POINT_free(p.R);
+    p = Prepared();
+}
+
+// R is only rebuilt (from r and the recovery ID) when withR is set
+bool prepare(const EC_GROUP* group, const BIGNUM* order, const SignatureVerifier::Item& item,
+             Prepared& out, BN_CTX* ctx, bool withR = true)
+{
+    if (item.hash.size() != 32 || item.r.size() != 32 || item.s.size() != 32 ||
+        item.publicKey.size() != 65 || (withR && (item.recoveryId < 0 || item.recoveryId > 1))) {
+        return false;
+    }
+
+    BIGNUM* r = BN_bin2bn(reinterpret_cast<const unsigned char*>(item.r.constData()), 32, nullptr);
+    BIGNUM* s = BN_bin2bn(reinterpret_cast<const unsigned char*>(item.s.constData()), 32, nullptr);
+    BIGNUM* e = BN_bin2bn(reinterpret_cast<const unsigned char*>(item.hash.constData()), 32, nullptr);
+    BIGNUM* w = BN_new();
+    out.u1 = BN_new();
+    out.u2 = BN_new();
+    out.Q = EC_POINT_new(group);
+    out.R = withR ? EC_POINT_new(group) : nullptr;
+
+    bool ok = r && s && e && w && out.u1 && out.u2 && out.Q && (out.R || !withR)
+        && !BN_is_zero(r) && BN_cmp(r, order) < 0
+        && !BN_is_zero(s) && BN_cmp(s, order) < 0
+        && EC_POINT_oct2point(group, out.Q, reinterpret_cast<const unsigned char*>(item.publicKey.constData()),
+                              65, ctx) == 1
+        && (!withR || EC_POINT_set_compressed_coordinates(group, out.R, r, item.recoveryId, ctx) == 1)
+        && BN_mod_inverse(w, s, order, ctx) != nullptr
+        && BN_mod_mul(out.u1, e, w, order, ctx) == 1
+        && BN_mod_mul(out.u2, r, w, order, ctx) == 1;
+
+    BN_free(r);
+    BN_free(s);
+    BN_free(e);
+    BN_free(w);
+
+    if (!ok) {
+        freePrepared(out);
+    }
+    return ok;
+}
+
+// One multi-scalar multiplication over items [begin, end) (all prepared)
+bool checkRange(const EC_GROUP* group, const BIGNUM* order, const std::vector<Prepared>& prepared,
+                const std::vector<int>& indexes, int begin, int end, BN_CTX* ctx)
+{
+    int count = end - begin;
+    std::vector<const EC_POINT*> points;
+    std::vector<BIGNUM*> scalars;
+    points.reserve(count * 2);
+    scalars.reserve(count * 2);
+
+    BIGNUM* gScalar = BN_new();
+    BIGNUM* z = BN_new();
+    BIGNUM* tmp = BN_new();
+    EC_POINT* sum = EC_POINT_new(group);
+    bool ok = gScalar && z && tmp && sum;
+    if (ok) {
+        BN_zero(gScalar);
+    }
+
+    for (int i = begin; ok && i < end; ++i) {
+        const Prepared& p = prepared[indexes[i]];
+
+        // A single signature needs no weight
+        if (count == 1) {
+            BN_one(z);
+        } else {
+            ok = BN_rand(z, 128, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY) == 1;
+            if (ok && BN_is_zero(z)) {
+                BN_one(z);
+            }
+        }
+
+        BIGNUM* qScalar = BN_new();
+        BIGNUM* rScalar = BN_new();
+        ok = ok && qScalar && rScalar
+            && BN_mod_mul(tmp, z, p.u1, order, ctx) == 1
+            && BN_mod_add(gScalar, gScalar, tmp, order, ctx) == 1
+            && BN_mod_mul(qScalar, z, p.u2, order, ctx) == 1
+            && BN_mod_sub(rScalar, order, z, order, ctx) == 1;  // -z mod n
+
+        if (qScalar) {
+            points.push_back(p.Q);
+            scalars.push_back(qScalar);
+        }
+        if (rScalar) {
+            points.push_back(p.R);
+            scalars.push_back(rScalar);
+        }
+    }
+
+    ok = ok && EC_POINTs_mul(group, sum, gScalar, points.size(), points.data(),
+                             const_cast<const BIGNUM**>(scalars.data()), ctx) == 1
+        && EC_POINT_is_at_infinity(group, sum) == 1;
+
+    for (BIGNUM* scalar : scalars) {
+        BN_free(scalar);
+    }
+    EC_POINT_free(sum);
+    BN_free(tmp);
+    BN_free(z);
+    BN_free(gScalar);
+
+    return ok;
+}
+
+// Bisect failing ranges so every invalid signature is identified
+void verifyRange(const EC_GROUP* group, const BIGNUM* order, const std::vector<Prepared>& prepared,
+                 const std::vector<int>& indexes, int begin, int end, QVector<bool>& results, BN_CTX* ctx)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    if (checkRange(group, order, prepared, indexes, begin, end, ctx)) {
+        for (int i = begin; i < end; ++i) {
+            results[indexes[i]] = true;
+        }
+        return;
+    }
+
+    if (end - begin == 1) {
+        return;  // Invalid
+    }
+
+    int mid = begin + (end - begin) / 2;
+    verifyRange(group, order, prepared, indexes, begin, mid, results, ctx);
+    verifyRange(group, order, prepared, indexes, mid, end, results, ctx);
+}
+
+// secp256k1 group, order and a BN_CTX for one call
+struct Curve {
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    BN_CTX* ctx = BN_CTX_new();
+    BIGNUM* order = BN_new();
+
+    Curve() = default;
+    Curve(const Curve&) = delete;
+    Curve& operator=(const Curve&) = delete;
+    ~Curve()
+    {
+        BN_free(order);
+        BN_CTX_free(ctx);
+        EC_GROUP_free(group);
+    }
+
+    bool init()
+    {
+        if (!group || !ctx || !order || EC_GROUP_get_order(group, order, ctx) != 1) {
+            qWarning() << "SignatureVerifier: Failed to set up secp256k1";
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+bool SignatureVerifier::verify(const Item& item)
+{
+    return verifyBatch({item}).value(0, false);
+}
+
+QVector<bool> SignatureVerifier::verifyBatch(const QVector<Item>& items)
+{
+    QVector<bool> results(items.size(), false);
+    if (items.isEmpty()) {
+        return results;
+    }
+
+    Curve curve;
+    if (!curve.init()) {
+        return results;
+    }
+    EC_GROUP* group = curve.group;
+    BN_CTX* ctx = curve.ctx;
+    const BIGNUM* order = curve.order;
+
+    // Malformed items fail immediately; the rest go into the batch
+    std::vector<Prepared> prepared(items.size());
+    std::vector<int> indexes;
+    indexes.reserve(items.size());
+    for (int i = 0; i < items.size(); ++i) {
+        if (prepare(group, order, items[i], prepared[i], ctx)) {
+            indexes.push_back(i);
+        }
+    }
+
+    verifyRange(group, order, prepared, indexes, 0, static_cast<int>(indexes.size()), results, ctx);
+
+    for (Prepared& p : prepared) {
+        freePrepared(p);
+    }
+
+    return results;
+}
+
+void SignatureVerifier::computeRecoveryIds(QVector<Item>& items)
+{
+    for (Item& item : items) {
+        item.recoveryId = -1;
+    }
+
+    Curve curve;
+    if (items.isEmpty() || !curve.init()) {
+        return;
+    }
+
+    EC_POINT* R = EC_POINT_new(curve.group);
+    BIGNUM* x = BN_new();
+    BIGNUM* y = BN_new();
+    BIGNUM* r = BN_new();
+    if (R && x && y && r) {
+        for (Item& item : items) {
+            Prepared p;
+            if (!prepare(curve.group, curve.order, item, p, curve.ctx, false)) {
+                continue;
+            }
+
+            // R = u1*G + u2*Q; a valid signature has R.x == r (mod n)
+            bool ok = EC_POINT_mul(curve.group, R, p.u1, p.Q, p.u2, curve.ctx) == 1
+                && EC_POINT_is_at_infinity(curve.group, R) == 0
+                && EC_POINT_get_affine_coordinates(curve.group, R, x, y, curve.ctx) == 1
+                && BN_nnmod(x, x, curve.order, curve.ctx) == 1
+                && BN_bin2bn(reinterpret_cast<const unsigned char*>(item.r.constData()), 32, r) != nullptr
+                && BN_cmp(x, r) == 0;
+            if (ok) {
+                item.recoveryId = BN_is_odd(y) ? 1 : 0;
+            }
+            freePrepared(p);
+        }
+    }
+
+    BN_free(r);
+    BN_free(y);
+    BN_free(x);
+    EC_POINT_free(R);
+}
+
+} // namespace StatusKeycard
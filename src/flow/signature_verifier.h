@@ -0,0 +1,51 @@
+#ifndef SIGNATURE_VERIFIER_H
+#define SIGNATURE_VERIFIER_H
+
+#include <QByteArray>
+#include <QVector>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Host-side secp256k1 ECDSA signature verification
+ *
+ * Signatures are checked in point form, u1*G + u2*Q == R, where R is
+ * rebuilt from r and the recovery ID that SignFlow already computes.
+ *
+ * verifyBatch() checks n signatures with a single multi-scalar
+ * multiplication: with random 128-bit weights z_i,
+ *
+ *   (sum z_i*u1_i)*G + sum z_i*u2_i*Q_i - sum z_i*R_i == infinity
+ *
+ * holds for all valid signatures and fails (except with probability
+ * ~2^-128) if any is invalid. A failing batch is bisected, so per-item
+ * results are exact.
+ */
+class SignatureVerifier {
+public:
+    struct Item {
+        QByteArray hash;       // 32 bytes
+        QByteArray r;          // 32 bytes
+        QByteArray s;          // 32 bytes
+        int recoveryId = -1;   // 0 or 1 (V - 27)
+        QByteArray publicKey;  // 65 bytes, uncompressed, the key expected for the path
+    };
+
+    static bool verify(const Item& item);
+    static QVector<bool> verifyBatch(const QVector<Item>& items);
+
+    /**
+     * @brief Fill in recoveryId from each item's publicKey
+     *
+     * R = u1*G + u2*Q is the point the verification equation checks; when
+     * R.x == r its y parity is the recovery ID. That is one double-scalar
+     * multiplication per signature, where recovering the key from r and s
+     * takes a decompression and three multiplications per candidate.
+     * Items whose signature does not match publicKey get -1.
+     */
+    static void computeRecoveryIds(QVector<Item>& items);
+};
+
+} // namespace StatusKeycard
+
+#endif // SIGNATURE_VERIFIER_H
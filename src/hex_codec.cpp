@@ -0,0 +1,436 @@
+#include "hex_codec.h"
+#include <array>
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64)
+#define KEYCARD_HEX_SSE2 1
+#include <emmintrin.h>
+// AVX2 is compiled per function and enabled only if the CPU reports it
+#if defined(__GNUC__) || defined(__clang__)
+#define KEYCARD_HEX_AVX2 1
+#include <immintrin.h>
+#define KEYCARD_HEX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define KEYCARD_HEX_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace StatusKeycard {
+
+namespace {
+
+// Characters converted per chunk when the target is a QString
+constexpr int WideChunkBytes = 256;
+
+constexpr char Digits[] = "0123456789abcdef";
+
+constexpr std::array<qint8, 256> makeHexTable()
+{
+    std::array<qint8, 256> table {};
+    for (int i = 0; i < 256; ++i) {
+        table[i] = -1;
+    }
+    for (int i = 0; i < 10; ++i) {
+        table['0' + i] = static_cast<qint8>(i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        table['a' + i] = static_cast<qint8>(10 + i);
+        table['A' + i] = static_cast<qint8>(10 + i);
+    }
+    return table;
+}
+
+constexpr std::array<qint8, 256> HexTable = makeHexTable();
+
+// Kernels: encode size bytes into 2 * size digits; decode 2 * size digits
+// (no prefix) into size bytes, false on the first invalid digit
+
+void encodeScalar(const quint8* in, qsizetype size, char* out)
+{
+    for (qsizetype i = 0; i < size; ++i) {
+        out[2 * i] = Digits[in[i] >> 4];
+        out[2 * i + 1] = Digits[in[i] & 0x0F];
+    }
+}
+
+bool decodeScalar(const char* in, qsizetype size, quint8* out)
+{
+    for (qsizetype i = 0; i < size; ++i) {
+        qint8 hi = HexTable[static_cast<quint8>(in[2 * i])];
+        qint8 lo = HexTable[static_cast<quint8>(in[2 * i + 1])];
+        if ((hi | lo) < 0) {
+            return false;
+        }
+        out[i] = static_cast<quint8>((hi << 4) | lo);
+    }
+    return true;
+}
+
+#ifdef KEYCARD_HEX_SSE2
+
+// Nibbles 0-15 to '0'-'9', 'a'-'f'
+inline __m128i nibblesToAscii(__m128i nibbles)
+{
+    __m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+    __m128i ascii = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+    return _mm_add_epi8(ascii, _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+// Digits to nibbles; valid keeps 0xFF only where every digit so far was hex
+inline __m128i asciiToNibbles(__m128i chars, __m128i& valid)
+{
+    __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    // Only A-F and a-f land in 'a'-'f' once the case bit is set
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isLetter));
+    return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                        _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+// Adjacent nibble pairs (high first) to one byte per 16-bit lane
+inline __m128i joinNibbles(__m128i nibbles)
+{
+    __m128i high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4);
+    return _mm_or_si128(high, _mm_srli_epi16(nibbles, 8));
+}
+
+void encodeSse2(const quint8* in, qsizetype size, char* out)
+{
+    qsizetype i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i high = nibblesToAscii(_mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F)));
+        __m128i low = nibblesToAscii(_mm_and_si128(bytes, _mm_set1_epi8(0x0F)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+    }
+    encodeScalar(in + i, size - i, out + 2 * i);
+}
+
+bool decodeSse2(const char* in, qsizetype size, quint8* out)
+{
+    qsizetype i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i valid = _mm_set1_epi8(-1);
+        __m128i first = asciiToNibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)), valid);
+        __m128i second = asciiToNibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 16)), valid);
+        if (_mm_movemask_epi8(valid) != 0xFFFF) {
+            return false;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packus_epi16(joinNibbles(first), joinNibbles(second)));
+    }
+    return decodeScalar(in + 2 * i, size - i, out + i);
+}
+
+#endif // KEYCARD_HEX_SSE2
+
+#ifdef KEYCARD_HEX_AVX2
+
+KEYCARD_HEX_TARGET_AVX2 inline __m256i nibblesToAscii256(__m256i nibbles)
+{
+    __m256i letters = _mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9));
+    __m256i ascii = _mm256_add_epi8(nibbles, _mm256_set1_epi8('0'));
+    return _mm256_add_epi8(ascii, _mm256_and_si256(letters, _mm256_set1_epi8('a' - '0' - 10)));
+}
+
+KEYCARD_HEX_TARGET_AVX2 inline __m256i asciiToNibbles256(__m256i chars, __m256i& valid)
+{
+    __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+    __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+    valid = _mm256_and_si256(valid, _mm256_or_si256(isDigit, isLetter));
+    return _mm256_or_si256(_mm256_and_si256(isDigit, digit),
+                           _mm256_and_si256(isLetter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+KEYCARD_HEX_TARGET_AVX2 inline __m256i joinNibbles256(__m256i nibbles)
+{
+    __m256i high = _mm256_slli_epi16(_mm256_and_si256(nibbles, _mm256_set1_epi16(0x00FF)), 4);
+    return _mm256_or_si256(high, _mm256_srli_epi16(nibbles, 8));
+}
+
+KEYCARD_HEX_TARGET_AVX2 void encodeAvx2(const quint8* in, qsizetype size, char* out)
+{
+    qsizetype i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i high = nibblesToAscii256(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F)));
+        __m256i low = nibblesToAscii256(_mm256_and_si256(bytes, _mm256_set1_epi8(0x0F)));
+        // Unpacking works per 128-bit lane; put the lanes back in order
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    encodeSse2(in + i, size - i, out + 2 * i);
+}
+
+KEYCARD_HEX_TARGET_AVX2 bool decodeAvx2(const char* in, qsizetype size, quint8* out)
+{
+    qsizetype i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i valid = _mm256_set1_epi8(-1);
+        __m256i first = asciiToNibbles256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i)), valid);
+        __m256i second = asciiToNibbles256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i + 32)), valid);
+        if (_mm256_movemask_epi8(valid) != -1) {
+            return false;
+        }
+        // Packing also works per lane: qwords come out as 0, 2, 1, 3
+        __m256i packed = _mm256_packus_epi16(joinNibbles256(first), joinNibbles256(second));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return decodeSse2(in + 2 * i, size - i, out + i);
+}
+
+bool cpuHasAvx2()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // KEYCARD_HEX_AVX2
+
+#ifdef KEYCARD_HEX_NEON
+
+inline uint8x16_t asciiToNibblesNeon(uint8x16_t chars, uint8x16_t& valid)
+{
+    uint8x16_t digit = vsubq_u8(chars, vdupq_n_u8('0'));
+    uint8x16_t isDigit = vcleq_u8(digit, vdupq_n_u8(9));
+    uint8x16_t letter = vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    uint8x16_t isLetter = vcleq_u8(letter, vdupq_n_u8(5));
+    valid = vandq_u8(valid, vorrq_u8(isDigit, isLetter));
+    return vbslq_u8(isDigit, digit, vaddq_u8(letter, vdupq_n_u8(10)));
+}
+
+void encodeNeon(const quint8* in, qsizetype size, char* out)
+{
+    const uint8x16_t digits = vld1q_u8(reinterpret_cast<const uint8_t*>(Digits));
+    qsizetype i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t bytes = vld1q_u8(in + i);
+        uint8x16x2_t chars;
+        chars.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(bytes, 4));
+        chars.val[1] = vqtbl1q_u8(digits, vandq_u8(bytes, vdupq_n_u8(0x0F)));
+        // Interleaving store: high digit, low digit
+        vst2q_u8(reinterpret_cast<uint8_t*>(out + 2 * i), chars);
+    }
+    encodeScalar(in + i, size - i, out + 2 * i);
+}
+
+bool decodeNeon(const char* in, qsizetype size, quint8* out)
+{
+    qsizetype i = 0;
+    for (; i + 16 <= size; i += 16) {
+        // De-interleaving load: high digits in val[0], low digits in val[1]
+        uint8x16x2_t chars = vld2q_u8(reinterpret_cast<const uint8_t*>(in + 2 * i));
+        uint8x16_t valid = vdupq_n_u8(0xFF);
+        uint8x16_t high = asciiToNibblesNeon(chars.val[0], valid);
+        uint8x16_t low = asciiToNibblesNeon(chars.val[1], valid);
+        if (vminvq_u8(valid) != 0xFF) {
+            return false;
+        }
+        vst1q_u8(out + i, vorrq_u8(vshlq_n_u8(high, 4), low));
+    }
+    return decodeScalar(in + 2 * i, size - i, out + i);
+}
+
+#endif // KEYCARD_HEX_NEON
+
+HexCodec::Kernel selectKernel()
+{
+#if defined(KEYCARD_HEX_AVX2)
+    if (cpuHasAvx2()) {
+        return HexCodec::Kernel::Avx2;
+    }
+#endif
+#if defined(KEYCARD_HEX_SSE2)
+    return HexCodec::Kernel::Sse2;
+#else
+    // NEON is built and listed in supportedKernels(), but not the default
+    // until it has been tested on ARM hardware
+    return HexCodec::Kernel::Scalar;
+#endif
+}
+
+void encodeWith(HexCodec::Kernel kernel, const quint8* in, qsizetype size, char* out)
+{
+    switch (kernel) {
+#ifdef KEYCARD_HEX_AVX2
+    case HexCodec::Kernel::Avx2: encodeAvx2(in, size, out); return;
+#endif
+#ifdef KEYCARD_HEX_SSE2
+    case HexCodec::Kernel::Sse2: encodeSse2(in, size, out); return;
+#endif
+#ifdef KEYCARD_HEX_NEON
+    case HexCodec::Kernel::Neon: encodeNeon(in, size, out); return;
+#endif
+    default: encodeScalar(in, size, out); return;
+    }
+}
+
+bool decodeWith(HexCodec::Kernel kernel, const char* in, qsizetype size, quint8* out)
+{
+    switch (kernel) {
+#ifdef KEYCARD_HEX_AVX2
+    case HexCodec::Kernel::Avx2: return decodeAvx2(in, size, out);
+#endif
+#ifdef KEYCARD_HEX_SSE2
+    case HexCodec::Kernel::Sse2: return decodeSse2(in, size, out);
+#endif
+#ifdef KEYCARD_HEX_NEON
+    case HexCodec::Kernel::Neon: return decodeNeon(in, size, out);
+#endif
+    default: return decodeScalar(in, size, out);
+    }
+}
+
+template <typename Char>
+bool hasPrefix(const Char* hex, qsizetype size)
+{
+    return size >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X');
+}
+
+} // namespace
+
+HexCodec::Kernel HexCodec::activeKernel()
+{
+    static const Kernel kernel = selectKernel();
+    return kernel;
+}
+
+QVector<HexCodec::Kernel> HexCodec::supportedKernels()
+{
+    QVector<Kernel> kernels { Kernel::Scalar };
+#ifdef KEYCARD_HEX_SSE2
+    kernels.append(Kernel::Sse2);
+#endif
+#ifdef KEYCARD_HEX_AVX2
+    if (cpuHasAvx2()) {
+        kernels.append(Kernel::Avx2);
+    }
+#endif
+#ifdef KEYCARD_HEX_NEON
+    kernels.append(Kernel::Neon);
+#endif
+    return kernels;
+}
+
+const char* HexCodec::kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::Scalar: return "scalar";
+    case Kernel::Sse2:   return "sse2";
+    case Kernel::Avx2:   return "avx2";
+    case Kernel::Neon:   return "neon";
+    }
+    return "unknown";
+}
+
+void HexCodec::encode(const char* data, qsizetype size, char* out, Kernel kernel)
+{
+    encodeWith(kernel, reinterpret_cast<const quint8*>(data), size, out);
+}
+
+qsizetype HexCodec::decode(const char* hex, qsizetype size, char* out, Kernel kernel)
+{
+    if (hasPrefix(hex, size)) {
+        hex += 2;
+        size -= 2;
+    }
+    if (size % 2 != 0) {
+        return -1;
+    }
+    if (!decodeWith(kernel, hex, size / 2, reinterpret_cast<quint8*>(out))) {
+        return -1;
+    }
+    return size / 2;
+}
+
+QString HexCodec::toHex(const QByteArray& data, bool prefix)
+{
+    const qsizetype offset = prefix ? 2 : 0;
+    QString result(offset + 2 * data.size(), Qt::Uninitialized);
+    char16_t* out = reinterpret_cast<char16_t*>(result.data());
+    if (prefix) {
+        out[0] = u'0';
+        out[1] = u'x';
+    }
+    out += offset;
+
+    // Encode a chunk into a small byte buffer, then widen it into the string
+    char chunk[2 * WideChunkBytes];
+    const Kernel kernel = activeKernel();
+    for (qsizetype i = 0; i < data.size(); i += WideChunkBytes) {
+        const qsizetype count = qMin<qsizetype>(WideChunkBytes, data.size() - i);
+        encodeWith(kernel, reinterpret_cast<const quint8*>(data.constData() + i), count, chunk);
+        for (qsizetype j = 0; j < 2 * count; ++j) {
+            out[2 * i + j] = static_cast<char16_t>(chunk[j]);
+        }
+    }
+    return result;
+}
+
+QByteArray HexCodec::toHexBytes(const QByteArray& data)
+{
+    QByteArray result(2 * data.size(), Qt::Uninitialized);
+    encode(data.constData(), data.size(), result.data());
+    return result;
+}
+
+bool HexCodec::fromHex(const QByteArray& hex, QByteArray& out)
+{
+    out.resize(decodedSize(hex.size()));
+    qsizetype size = decode(hex.constData(), hex.size(), out.data());
+    if (size < 0) {
+        out.clear();
+        return false;
+    }
+    out.truncate(size);
+    return true;
+}
+
+bool HexCodec::fromHex(QStringView hex, QByteArray& out)
+{
+    if (hasPrefix(hex.utf16(), hex.size())) {
+        hex = hex.mid(2);
+    }
+    if (hex.size() % 2 != 0) {
+        out.clear();
+        return false;
+    }
+
+    out.resize(hex.size() / 2);
+    // Narrow a chunk of digits (anything past Latin-1 is invalid anyway),
+    // then decode it straight into the output
+    char chunk[2 * WideChunkBytes];
+    const Kernel kernel = activeKernel();
+    const char16_t* in = hex.utf16();
+    for (qsizetype i = 0; i < out.size(); i += WideChunkBytes) {
+        const qsizetype count = qMin<qsizetype>(WideChunkBytes, out.size() - i);
+        bool narrow = true;
+        for (qsizetype j = 0; j < 2 * count; ++j) {
+            char16_t c = in[2 * i + j];
+            narrow &= c < 0x80;
+            chunk[j] = static_cast<char>(c);
+        }
+        if (!narrow || !decodeWith(kernel, chunk, count, reinterpret_cast<quint8*>(out.data() + i))) {
+            out.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray HexCodec::fromHex(QStringView hex)
+{
+    QByteArray out;
+    fromHex(hex, out);
+    return out;
+}
+
+} // namespace StatusKeycard
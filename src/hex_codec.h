@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Hex encoding and decoding for keys, addresses, UIDs and hashes
+ *
+ * Kernels convert 16 (SSE2, NEON) or 32 (AVX2) bytes per step and fall back
+ * to a table-driven scalar loop for the tail and on other targets. The best
+ * kernel is picked once at startup (AVX2 is checked at runtime); the NEON
+ * kernel is only used when requested explicitly until it has run on ARM
+ * hardware, and ARM builds default to the scalar one. Output is
+ * written straight into a buffer sized up front, the optional "0x" prefix
+ * is part of the same buffer, and decoding validates every digit in the
+ * same pass: unlike QByteArray::fromHex, invalid input is rejected rather
+ * than skipped.
+ */
+class HexCodec {
+public:
+    enum class Kernel {
+        Scalar,
+        Sse2,
+        Avx2,
+        Neon
+    };
+
+    static Kernel activeKernel();
+    static QVector<Kernel> supportedKernels();
+    static const char* kernelName(Kernel kernel);
+
+    /**
+     * @brief Encode size bytes as 2 * size lowercase digits into out
+     */
+    static void encode(const char* data, qsizetype size, char* out, Kernel kernel = activeKernel());
+
+    /**
+     * @brief Decode hex digits (optional 0x/0X prefix) into out
+     *
+     * out must hold decodedSize(size) bytes.
+     * @return Bytes written, or -1 on odd length or a non-hex digit
+     */
+    static qsizetype decode(const char* hex, qsizetype size, char* out, Kernel kernel = activeKernel());
+
+    // Upper bound of decode() output for size input characters
+    static qsizetype decodedSize(qsizetype size) { return size / 2; }
+
+    /**
+     * @brief Lowercase hex string, optionally "0x"-prefixed (one allocation)
+     */
+    static QString toHex(const QByteArray& data, bool prefix = false);
+    static QByteArray toHexBytes(const QByteArray& data);
+
+    /**
+     * @brief Decode a hex string with optional 0x prefix
+     * @return false on odd length or a non-hex digit (out is cleared)
+     */
+    static bool fromHex(QStringView hex, QByteArray& out);
+    static bool fromHex(const QByteArray& hex, QByteArray& out);
+
+    // Empty on invalid input
+    static QByteArray fromHex(QStringView hex);
+};
+
+} // namespace StatusKeycard
@@ -0,0 +1,233 @@
+#include "virtual_card_crypto.h"
+#include <QMessageAuthenticationCode>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <openssl/rand.h>
+
+namespace StatusKeycard {
+namespace VirtualCardCrypto {
+
+namespace {
+
+constexpr int BlockSize = 16;
+
+const EC_GROUP* curve()
+{
+    // Never freed; EC_GROUP is immutable and safe to share between threads
+    static const EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    return group;
+}
+
+const unsigned char* bytes(const QByteArray& data)
+{
+    return reinterpret_cast<const unsigned char*>(data.constData());
+}
+
+QByteArray toBytes(const BIGNUM* value, int size)
+{
+    QByteArray out(size, 0);
+    BN_bn2binpad(value, reinterpret_cast<unsigned char*>(out.data()), size);
+    return out;
+}
+
+QByteArray pointBytes(const EC_POINT* point, point_conversion_form_t form, BN_CTX* ctx)
+{
+    QByteArray out(form == POINT_CONVERSION_COMPRESSED ? 33 : 65, 0);
+    if (EC_POINT_point2oct(curve(), point, form, reinterpret_cast<unsigned char*>(out.data()),
+                           out.size(), ctx) != static_cast<size_t>(out.size())) {
+        return QByteArray();
+    }
+    return out;
+}
+
+QByteArray publicKey(const QByteArray& privateKey, point_conversion_form_t form)
+{
+    if (privateKey.size() != 32) {
+        return QByteArray();
+    }
+    BN_CTX* ctx = BN_CTX_new();
+    BIGNUM* d = BN_bin2bn(bytes(privateKey), 32, nullptr);
+    EC_POINT* q = EC_POINT_new(curve());
+    QByteArray out;
+    if (EC_POINT_mul(curve(), q, d, nullptr, nullptr, ctx) == 1) {
+        out = pointBytes(q, form, ctx);
+    }
+    EC_POINT_free(q);
+    BN_clear_free(d);
+    BN_CTX_free(ctx);
+    return out;
+}
+
+QByteArray cbc(const QByteArray& key, const QByteArray& iv, const QByteArray& data, bool encrypting)
+{
+    if (key.size() != 32 || iv.size() != BlockSize || data.size() % BlockSize != 0) {
+        return QByteArray();
+    }
+    QByteArray out(data.size(), 0);
+    int written = 0;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    bool ok = EVP_CipherInit_ex(ctx, EVP_aes_256_cbc(), nullptr, bytes(key), bytes(iv), encrypting ? 1 : 0) == 1
+              && EVP_CIPHER_CTX_set_padding(ctx, 0) == 1
+              && EVP_CipherUpdate(ctx, reinterpret_cast<unsigned char*>(out.data()), &written,
+                                  bytes(data), data.size()) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    return ok && written == data.size() ? out : QByteArray();
+}
+
+} // namespace
+
+KeyPair generateKeyPair()
+{
+    KeyPair pair;
+    const BIGNUM* order = EC_GROUP_get0_order(curve());
+    BIGNUM* d = BN_new();
+    do {
+        BN_priv_rand_range(d, order);
+    } while (BN_is_zero(d));
+    pair.privateKey = toBytes(d, 32);
+    pair.publicKey = publicKey(pair.privateKey);
+    BN_clear_free(d);
+    return pair;
+}
+
+QByteArray publicKey(const QByteArray& privateKey)
+{
+    return publicKey(privateKey, POINT_CONVERSION_UNCOMPRESSED);
+}
+
+QByteArray ecdh(const QByteArray& privateKey, const QByteArray& peerPublicKey)
+{
+    if (privateKey.size() != 32) {
+        return QByteArray();
+    }
+    BN_CTX* ctx = BN_CTX_new();
+    EC_POINT* peer = EC_POINT_new(curve());
+    EC_POINT* shared = EC_POINT_new(curve());
+    BIGNUM* d = BN_bin2bn(bytes(privateKey), 32, nullptr);
+    BIGNUM* x = BN_new();
+
+    QByteArray secret;
+    if (EC_POINT_oct2point(curve(), peer, bytes(peerPublicKey), peerPublicKey.size(), ctx) == 1
+        && EC_POINT_mul(curve(), shared, nullptr, peer, d, ctx) == 1
+        && !EC_POINT_is_at_infinity(curve(), shared)
+        && EC_POINT_get_affine_coordinates(curve(), shared, x, nullptr, ctx) == 1) {
+        secret = toBytes(x, 32);
+    }
+
+    BN_free(x);
+    BN_clear_free(d);
+    EC_POINT_free(shared);
+    EC_POINT_free(peer);
+    BN_CTX_free(ctx);
+    return secret;
+}
+
+QByteArray encrypt(const QByteArray& key, const QByteArray& iv, const QByteArray& data)
+{
+    QByteArray padded = data;
+    padded.append(static_cast<char>(0x80));
+    padded.append(QByteArray((BlockSize - padded.size() % BlockSize) % BlockSize, 0));
+    return cbc(key, iv, padded, true);
+}
+
+bool decrypt(const QByteArray& key, const QByteArray& iv, const QByteArray& data, QByteArray& plain)
+{
+    plain = cbc(key, iv, data, false);
+    int end = plain.size() - 1;
+    while (end >= 0 && plain[end] == 0) {
+        --end;
+    }
+    if (end < 0 || static_cast<quint8>(plain[end]) != 0x80) {
+        plain.clear();
+        return false;
+    }
+    plain.truncate(end);
+    return true;
+}
+
+QByteArray mac(const QByteArray& key, const QByteArray& meta, const QByteArray& data)
+{
+    QByteArray out = cbc(key, QByteArray(BlockSize, 0), meta + data, true);
+    return out.isEmpty() ? out : out.right(BlockSize);
+}
+
+ExtendedKey masterKey(const QByteArray& seed)
+{
+    QByteArray digest = QMessageAuthenticationCode::hash(seed, "Bitcoin seed", QCryptographicHash::Sha512);
+    return ExtendedKey{digest.left(32), digest.mid(32)};
+}
+
+bool deriveChild(const ExtendedKey& parent, quint32 index, ExtendedKey& child)
+{
+    QByteArray data;
+    if (index & 0x80000000u) {
+        data.append(static_cast<char>(0));
+        data.append(parent.privateKey);
+    } else {
+        data.append(publicKey(parent.privateKey, POINT_CONVERSION_COMPRESSED));
+    }
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        data.append(static_cast<char>((index >> shift) & 0xFF));
+    }
+    QByteArray digest = QMessageAuthenticationCode::hash(data, parent.chainCode, QCryptographicHash::Sha512);
+
+    const BIGNUM* order = EC_GROUP_get0_order(curve());
+    BN_CTX* ctx = BN_CTX_new();
+    BIGNUM* tweak = BN_bin2bn(bytes(digest), 32, nullptr);
+    BIGNUM* key = BN_bin2bn(bytes(parent.privateKey), 32, nullptr);
+    BIGNUM* sum = BN_new();
+    bool ok = BN_cmp(tweak, order) < 0
+              && BN_mod_add(sum, tweak, key, order, ctx) == 1
+              && !BN_is_zero(sum);
+    if (ok) {
+        child.privateKey = toBytes(sum, 32);
+        child.chainCode = digest.mid(32);
+    }
+    BN_clear_free(sum);
+    BN_clear_free(key);
+    BN_clear_free(tweak);
+    BN_CTX_free(ctx);
+    return ok;
+}
+
+QByteArray sign(const QByteArray& privateKey, const QByteArray& hash)
+{
+    if (privateKey.size() != 32 || hash.size() != 32) {
+        return QByteArray();
+    }
+    EC_KEY* key = EC_KEY_new_by_curve_name(NID_secp256k1);
+    BIGNUM* d = BN_bin2bn(bytes(privateKey), 32, nullptr);
+    EC_KEY_set_private_key(key, d);
+
+    QByteArray der;
+    if (ECDSA_SIG* sig = ECDSA_do_sign(bytes(hash), hash.size(), key)) {
+        // Canonical form, as Ethereum requires
+        const BIGNUM* r = nullptr;
+        const BIGNUM* s = nullptr;
+        ECDSA_SIG_get0(sig, &r, &s);
+        const BIGNUM* order = EC_GROUP_get0_order(curve());
+        BIGNUM* half = BN_dup(order);
+        BN_rshift1(half, half);
+        if (BN_cmp(s, half) > 0) {
+            BIGNUM* lowS = BN_new();
+            BN_sub(lowS, order, s);
+            ECDSA_SIG_set0(sig, BN_dup(r), lowS);
+        }
+        BN_free(half);
+
+        der.resize(i2d_ECDSA_SIG(sig, nullptr));
+        unsigned char* out = reinterpret_cast<unsigned char*>(der.data());
+        i2d_ECDSA_SIG(sig, &out);
+        ECDSA_SIG_free(sig);
+    }
+
+    BN_clear_free(d);
+    EC_KEY_free(key);
+    return der;
+}
+
+} // namespace VirtualCardCrypto
+} // namespace StatusKeycard
@@ -0,0 +1,54 @@
+#ifndef VIRTUAL_CARD_CRYPTO_H
+#define VIRTUAL_CARD_CRYPTO_H
+
+#include <QByteArray>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Card-side cryptography for the virtual card farm
+ *
+ * The primitives a Keycard applet uses, on secp256k1 and AES-256: the
+ * secure channel (ECDH, AES-CBC with ISO 9797-1 M2 padding, CBC-MAC), BIP32
+ * private derivation for EXPORT KEY and ECDSA for SIGN. Keys are raw bytes:
+ * 32-byte private keys and 65-byte uncompressed public keys.
+ *
+ * Failures (an invalid point, a bad key size) return an empty QByteArray;
+ * decrypt() reports a bad padding separately, as the plaintext may be empty.
+ */
+namespace VirtualCardCrypto {
+
+struct KeyPair {
+    QByteArray privateKey;
+    QByteArray publicKey;
+};
+
+struct ExtendedKey {
+    QByteArray privateKey;
+    QByteArray chainCode;
+};
+
+KeyPair generateKeyPair();
+QByteArray publicKey(const QByteArray& privateKey);
+
+// X coordinate of privateKey * peerPublicKey
+QByteArray ecdh(const QByteArray& privateKey, const QByteArray& peerPublicKey);
+
+QByteArray encrypt(const QByteArray& key, const QByteArray& iv, const QByteArray& data);
+bool decrypt(const QByteArray& key, const QByteArray& iv, const QByteArray& data, QByteArray& plain);
+
+// Last block of AES-CBC (zero IV) over meta || data; data is block aligned
+QByteArray mac(const QByteArray& key, const QByteArray& meta, const QByteArray& data);
+
+// BIP32 master key from a seed, and one private child derivation step
+ExtendedKey masterKey(const QByteArray& seed);
+bool deriveChild(const ExtendedKey& parent, quint32 index, ExtendedKey& child);
+
+// DER ECDSA signature with a low S value
+QByteArray sign(const QByteArray& privateKey, const QByteArray& hash);
+
+} // namespace VirtualCardCrypto
+
+} // namespace StatusKeycard
+
+#endif // VIRTUAL_CARD_CRYPTO_H
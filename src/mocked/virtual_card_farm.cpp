@@ -0,0 +1,1028 @@
+#include "virtual_card_farm.h"
+#include "../flight_recorder.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QJsonArray>
+#include <QRandomGenerator>
+#include <QtEndian>
+#include <algorithm>
+#include <openssl/evp.h>
+
+namespace StatusKeycard {
+
+namespace {
+
+// Wallet paths in metadata are relative to this root
+const QString WalletRoot = "m/44'/60'/0'/0/";
+
+// EXPORT KEY only releases private keys under the EIP-1581 root
+const quint32 Eip1581Root[] = {0x8000002B, 0x8000003C, 0x8000062D};
+
+QByteArray buildTLV(quint8 tag, const QByteArray& value)
+{
+    QByteArray tlv;
+    tlv.append(static_cast<char>(tag));
+    if (value.size() > 0x7F) {
+        tlv.append(static_cast<char>(0x81));
+    }
+    tlv.append(static_cast<char>(value.size()));
+    tlv.append(value);
+    return tlv;
+}
+
+void writeLEB128(QByteArray& buf, quint32 value)
+{
+    do {
+        quint8 byte = value & 0x7F;
+        value >>= 7;
+        if (value != 0) {
+            byte |= 0x80;
+        }
+        buf.append(static_cast<char>(byte));
+    } while (value != 0);
+}
+
+// mockedKeycard metadata JSON to the blob SessionManager::storeMetadata()
+// writes: name header, then start/count ranges of wallet indexes
+QByteArray encodeMetadata(const QJsonObject& json)
+{
+    QByteArray name = json.value("name").toString().toUtf8().left(20);
+    QVector<quint32> indexes;
+    for (const QJsonValue& wallet : json.value("wallets").toArray()) {
+        QString path = wallet.toObject().value("path").toString();
+        bool ok = false;
+        quint32 index = path.startsWith(WalletRoot) ? path.mid(WalletRoot.size()).toUInt(&ok) : 0;
+        if (ok) {
+            indexes.append(index);
+        }
+    }
+    std::sort(indexes.begin(), indexes.end());
+
+    QByteArray blob;
+    blob.append(static_cast<char>(0x20 | name.size()));
+    blob.append(name);
+    for (int i = 0; i < indexes.size();) {
+        int last = i;
+        while (last + 1 < indexes.size() && indexes[last + 1] == indexes[last] + 1) {
+            ++last;
+        }
+        writeLEB128(blob, indexes[i]);
+        writeLEB128(blob, static_cast<quint32>(last - i));
+        i = last + 1;
+    }
+    return blob;
+}
+
+// Key path of EXPORT KEY and SIGN: P1 low nibble picks the current key or a
+// derivation, the high nibble where a derivation starts; data holds
+// big-endian 32-bit components. Returns a status word.
+quint16 resolvePath(const QVector<quint32>& current, quint8 p1, const QByteArray& data, QVector<quint32>& path)
+{
+    switch (p1 & 0x0F) {
+    case 0x00:
+        path = current;
+        return 0x9000;
+    case 0x01:  // Derive
+    case 0x02:  // Derive and make current
+        break;
+    default:
+        return 0x6A86;
+    }
+
+    if (data.isEmpty() || data.size() % 4 != 0) {
+        return 0x6A80;
+    }
+    QVector<quint32> relative;
+    for (int i = 0; i < data.size(); i += 4) {
+        relative.append(qFromBigEndian<quint32>(data.constData() + i));
+    }
+
+    switch (p1 & 0xF0) {
+    case 0x00:  // From master
+        path = relative;
+        break;
+    case 0x40:  // From parent
+        path = current;
+        if (!path.isEmpty()) {
+            path.removeLast();
+        }
+        path += relative;
+        break;
+    case 0x80:  // From current
+        path = current + relative;
+        break;
+    default:
+        return 0x6A86;
+    }
+    return path.size() <= 10 ? 0x9000 : 0x6A80;
+}
+
+bool deriveKey(const VirtualCardCrypto::ExtendedKey& master, const QVector<quint32>& path,
+               VirtualCardCrypto::ExtendedKey& key)
+{
+    key = master;
+    for (quint32 index : path) {
+        if (!VirtualCardCrypto::deriveChild(key, index, key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray randomBytes(int size)
+{
+    QByteArray bytes(size, 0);
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32*>(bytes.data()), size / 4);
+    return bytes;
+}
+
+// Key UID the applet reports: SHA-256 of the master public key
+QByteArray keyUIDFor(const VirtualCardCrypto::ExtendedKey& master)
+{
+    return QCryptographicHash::hash(VirtualCardCrypto::publicKey(master.privateKey), QCryptographicHash::Sha256);
+}
+
+QByteArray fromHexField(const QJsonObject& json, const QString& key)
+{
+    QString hex = json.value(key).toString();
+    if (hex.startsWith("0x")) {
+        hex = hex.mid(2);
+    }
+    return QByteArray::fromHex(hex.toLatin1());
+}
+
+// PBKDF2-HMAC-SHA256 pairing token, as in CommandSet. Cached per password:
+// load tests register thousands of cards sharing a handful of passwords.
+QByteArray pairingToken(const QString& password)
+{
+    static QMutex cacheMutex;
+    static QHash<QString, QByteArray> cache;
+
+    QMutexLocker locker(&cacheMutex);
+    auto it = cache.constFind(password);
+    if (it != cache.constEnd()) {
+        return *it;
+    }
+
+    const QByteArray salt = "Keycard Pairing Password Salt";
+    const QByteArray passwordBytes = password.toUtf8();
+    QByteArray token(32, 0);
+    PKCS5_PBKDF2_HMAC(passwordBytes.constData(), passwordBytes.size(),
+                      reinterpret_cast<const unsigned char*>(salt.constData()), salt.size(),
+                      50000, EVP_sha256(), token.size(),
+                      reinterpret_cast<unsigned char*>(token.data()));
+    cache.insert(password, token);
+    return token;
+}
+
+} // namespace
+
+// ============================================================================
+// VirtualCard
+// ============================================================================
+
+VirtualCardFarm::VirtualCard VirtualCardFarm::VirtualCard::fromJson(int cardIndex, CardState state,
+                                                                    const QJsonObject& json)
+{
+    VirtualCard card;
+    card.state = state;
+
+    const QByteArray seed = QByteArray::number(cardIndex);
+    card.instanceUID = fromHexField(json, "instanceUid");
+    if (card.instanceUID.isEmpty()) {
+        card.instanceUID = QCryptographicHash::hash("virtual-instance-" + seed, QCryptographicHash::Sha256).left(16);
+    }
+
+    card.secureChannelKey = VirtualCardCrypto::generateKeyPair();
+    if (state != CardState::EmptyKeycard && state != CardState::NotStatusKeycard && !json.value("keyless").toBool()) {
+        card.masterKey = VirtualCardCrypto::masterKey(
+            QCryptographicHash::hash("virtual-seed-" + seed, QCryptographicHash::Sha512));
+        card.keyUID = fromHexField(json, "keyUid");
+        if (card.keyUID.isEmpty()) {
+            card.keyUID = keyUIDFor(card.masterKey);
+        }
+    }
+
+    card.pin = json.value("pin").toString(card.pin);
+    card.puk = json.value("puk").toString(card.puk);
+    card.pairingSecret = pairingToken(json.value("pairingPassword").toString("KeycardDefaultPairing"));
+    card.freePairingSlots = json.value("freePairingSlots").toInt(card.freePairingSlots);
+    card.pinRetries = json.value("pinRetries").toInt(card.pinRetries);
+    card.pukRetries = json.value("pukRetries").toInt(card.pukRetries);
+
+    switch (state) {
+    case CardState::MaxPairingSlotsReached:
+        card.freePairingSlots = 0;
+        break;
+    case CardState::MaxPUKRetriesReached:
+        card.pukRetries = 0;
+        card.pinRetries = 0;
+        break;
+    case CardState::MaxPINRetriesReached:
+        card.pinRetries = 0;
+        break;
+    case CardState::KeycardWithMnemonicAndMetadata:
+        card.metadata = encodeMetadata(json.value("metadata").toObject());
+        break;
+    default:
+        break;
+    }
+
+    return card;
+}
+
+// ============================================================================
+// VirtualCardFarm
+// ============================================================================
+
+VirtualCardFarm::VirtualCardFarm(QObject* parent)
+    : KeycardChannelBackend(parent)
+    , m_readerPlugged(false)
+    , m_detecting(false)
+    , m_insertedIndex(-1)
+    , m_channelState(Keycard::ChannelState::Idle)
+    , m_insertions(0)
+    , m_removals(0)
+    , m_apdus(0)
+    , m_idleRequests(0)
+{
+}
+
+VirtualCardFarm::~VirtualCardFarm()
+{
+}
+
+QString VirtualCardFarm::registerCard(int cardIndex, ReaderState readerState, CardState cardState,
+                                      const QJsonObject& mockedKeycard)
+{
+    if (cardIndex < 0) {
+        return "invalid card index";
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cards.insert(cardIndex, VirtualCard::fromJson(cardIndex, cardState, mockedKeycard));
+    }
+
+    // Bring the reader into the requested state with the new card
+    switch (readerState) {
+    case ReaderState::NoReader:
+        return unplugReader();
+    case ReaderState::NoKeycard: {
+        QString error = plugReader();
+        return error.isEmpty() ? removeCard() : error;
+    }
+    case ReaderState::KeycardInserted: {
+        QString error = plugReader();
+        return error.isEmpty() ? insertCard(cardIndex) : error;
+    }
+    }
+    return "invalid reader state";
+}
+
+QString VirtualCardFarm::plugReader()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_readerPlugged) {
+        return QString();
+    }
+    m_readerPlugged = true;
+    locker.unlock();
+
+    emitReaderAvailability(true);
+    return QString();
+}
+
+QString VirtualCardFarm::unplugReader()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_readerPlugged) {
+        return QString();
+    }
+    bool hadCard = m_insertedIndex >= 0;
+    m_readerPlugged = false;
+    m_insertedIndex = -1;
+    m_session = Session();
+    if (hadCard) {
+        m_removals++;
+    }
+    locker.unlock();
+
+    if (hadCard) {
+        emitRemoved();
+    }
+    emitReaderAvailability(false);
+    return QString();
+}
+
+QString VirtualCardFarm::insertCard(int cardIndex)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_readerPlugged) {
+        return "no reader plugged in";
+    }
+    auto it = m_cards.constFind(cardIndex);
+    if (it == m_cards.constEnd()) {
+        return QString("card %1 is not registered").arg(cardIndex);
+    }
+    if (m_insertedIndex == cardIndex) {
+        return QString();
+    }
+
+    // Swapping cards: the old one leaves the field first
+    bool hadCard = m_insertedIndex >= 0;
+    if (hadCard) {
+        m_removals++;
+    }
+    m_insertedIndex = cardIndex;
+    m_session = Session();
+    m_insertions++;
+    QByteArray instanceUID = it->instanceUID;
+    bool detecting = m_detecting;
+    locker.unlock();
+
+    if (hadCard) {
+        emitRemoved();
+    }
+    if (detecting) {
+        emitInserted(instanceUID);
+    }
+    return QString();
+}
+
+QString VirtualCardFarm::removeCard()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_insertedIndex < 0) {
+        return QString();
+    }
+    m_insertedIndex = -1;
+    m_session = Session();
+    m_removals++;
+    locker.unlock();
+
+    emitRemoved();
+    return QString();
+}
+
+QJsonObject VirtualCardFarm::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonObject obj;
+    obj["registered"] = m_cards.size();
+    obj["readerPlugged"] = m_readerPlugged;
+    obj["insertedCard"] = m_insertedIndex;
+    obj["insertions"] = static_cast<qint64>(m_insertions);
+    obj["removals"] = static_cast<qint64>(m_removals);
+    obj["apdus"] = static_cast<qint64>(m_apdus);
+    obj["idleRequests"] = static_cast<qint64>(m_idleRequests);
+    QJsonObject commands;
+    for (auto it = m_commands.constBegin(); it != m_commands.constEnd(); ++it) {
+        commands[QString("%1").arg(it.key(), 2, 16, QChar('0'))] = static_cast<qint64>(it.value());
+    }
+    obj["commands"] = commands;
+    return obj;
+}
+
+void VirtualCardFarm::emitInserted(const QByteArray& instanceUID)
+{
+    QString uid = QString::fromLatin1(instanceUID.toHex());
+    QMetaObject::invokeMethod(this, [this, uid]() {
+        qDebug() << "[VirtualCardFarm] Card inserted:" << uid;
+        emit targetDetected(uid);
+    }, Qt::QueuedConnection);
+}
+
+void VirtualCardFarm::emitRemoved()
+{
+    QMetaObject::invokeMethod(this, [this]() {
+        qDebug() << "[VirtualCardFarm] Card removed";
+        emit cardRemoved();
+    }, Qt::QueuedConnection);
+}
+
+void VirtualCardFarm::emitReaderAvailability(bool available)
+{
+    QMetaObject::invokeMethod(this, [this, available]() {
+        qDebug() << "[VirtualCardFarm] Reader available:" << available;
+        emit readerAvailabilityChanged(available);
+    }, Qt::QueuedConnection);
+}
+
+// ============================================================================
+// KeycardChannelBackend interface
+// ============================================================================
+
+bool VirtualCardFarm::isConnected() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_insertedIndex >= 0;
+}
+
+void VirtualCardFarm::startDetection()
+{
+    QMutexLocker locker(&m_mutex);
+    m_detecting = true;
+    if (m_insertedIndex < 0) {
+        return;
+    }
+    // A card already in the reader is reported as soon as detection starts
+    QByteArray instanceUID = m_cards.value(m_insertedIndex).instanceUID;
+    locker.unlock();
+    emitInserted(instanceUID);
+}
+
+void VirtualCardFarm::stopDetection()
+{
+    QMutexLocker locker(&m_mutex);
+    m_detecting = false;
+}
+
+void VirtualCardFarm::disconnect()
+{
+    // The virtual card stays in the reader; only MockedLibKeycardRemoved takes it out
+}
+
+void VirtualCardFarm::setState(Keycard::ChannelState state)
+{
+    QMutexLocker locker(&m_mutex);
+    if (state == Keycard::ChannelState::Idle) {
+        m_idleRequests++;
+    }
+    m_channelState = state;
+}
+
+Keycard::ChannelState VirtualCardFarm::state() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_channelState;
+}
+
+void VirtualCardFarm::forceScan()
+{
+    startDetection();
+}
+
+QByteArray VirtualCardFarm::transmit(const QByteArray& apdu)
+{
+    const qint64 startNs = FlightRecorder::nowNs();
+    QMutexLocker locker(&m_mutex);
+    m_apdus++;
+
+    QByteArray response = handleApdu(apdu);
+
+    quint8 ins = apdu.size() > 1 ? static_cast<quint8>(apdu[1]) : 0;
+    m_commands[ins]++;
+    quint16 sw = response.size() >= 2
+        ? static_cast<quint16>((static_cast<quint8>(response[response.size() - 2]) << 8)
+                               | static_cast<quint8>(response[response.size() - 1]))
+        : 0;
+    FlightRecorder::instance()->record(FlightRecorder::Event::Apdu, ins, sw,
+                                       (FlightRecorder::nowNs() - startNs) / 1000);
+    return response;
+}
+
+QByteArray VirtualCardFarm::handleApdu(const QByteArray& apdu)
+{
+    if (m_insertedIndex < 0) {
+        qWarning() << "[VirtualCardFarm] APDU sent without a card";
+        return errorResponse(0x6F, 0x00);
+    }
+    if (apdu.size() < 4) {
+        return errorResponse(0x67, 0x00);
+    }
+
+    VirtualCard& card = m_cards[m_insertedIndex];
+    quint8 ins = static_cast<quint8>(apdu[1]);
+    quint8 p1 = static_cast<quint8>(apdu[2]);
+    quint8 p2 = static_cast<quint8>(apdu[3]);
+    QByteArray data;
+    if (apdu.size() > 5) {
+        data = apdu.mid(5, static_cast<quint8>(apdu[4]));
+        if (data.size() != static_cast<quint8>(apdu[4])) {
+            return errorResponse(0x67, 0x00);
+        }
+    }
+
+    if (card.state == CardState::NotStatusKeycard) {
+        return errorResponse(0x6A, 0x82);  // Applet not found
+    }
+
+    if (ins == 0xA4) {  // SELECT
+        m_session = Session();
+        return selectResponse(card);
+    }
+    if (card.state == CardState::EmptyKeycard) {
+        // Only INIT is accepted before initialization
+        return ins == 0xFE ? initResponse(card, data) : errorResponse(0x69, 0x85);
+    }
+
+    switch (ins) {
+    case 0x12:  // PAIR
+        return pairResponse(card, p1, data);
+    case 0x10:  // OPEN SECURE CHANNEL
+        return openSecureChannelResponse(card, p1, data);
+    default:
+        break;
+    }
+
+    if (m_session.open) {
+        return handleSecured(card, apdu);
+    }
+
+    // Without a secure channel only public data and a factory reset are allowed
+    if (ins == 0xCA || ins == 0xFD) {
+        return handleCommand(card, ins, p1, p2, data);
+    }
+    return errorResponse(0x69, 0x85);
+}
+
+QByteArray VirtualCardFarm::handleSecured(VirtualCard& card, const QByteArray& apdu)
+{
+    // Data is MAC (16) || AES-CBC payload; the MAC also covers the header
+    const int lc = apdu.size() > 4 ? static_cast<quint8>(apdu[4]) : 0;
+    QByteArray data = apdu.mid(5, lc);
+    if (lc < 32 || data.size() != lc || lc % 16 != 0) {
+        m_session = Session();
+        return errorResponse(0x69, 0x82);
+    }
+
+    QByteArray meta(16, 0);
+    meta.replace(0, 4, apdu.left(4));
+    meta[4] = static_cast<char>(lc);
+    QByteArray commandMac = data.left(16);
+    QByteArray payload = data.mid(16);
+
+    QByteArray plain;
+    if (VirtualCardCrypto::mac(m_session.macKey, meta, payload) != commandMac
+        || !VirtualCardCrypto::decrypt(m_session.encKey, m_session.iv, payload, plain)) {
+        qWarning() << "[VirtualCardFarm] Secure channel MAC or padding mismatch, closing the channel";
+        m_session = Session();
+        return errorResponse(0x69, 0x82);
+    }
+
+    // The command may close the channel (FACTORY RESET); answer with its keys
+    const QByteArray encKey = m_session.encKey;
+    const QByteArray macKey = m_session.macKey;
+    m_session.iv = commandMac;
+
+    QByteArray response = handleCommand(card, static_cast<quint8>(apdu[1]), static_cast<quint8>(apdu[2]),
+                                        static_cast<quint8>(apdu[3]), plain);
+
+    QByteArray encrypted = VirtualCardCrypto::encrypt(encKey, commandMac, response);
+    QByteArray responseMeta(16, 0);
+    responseMeta[0] = static_cast<char>(16 + encrypted.size());
+    QByteArray responseMac = VirtualCardCrypto::mac(macKey, responseMeta, encrypted);
+    if (m_session.open) {
+        m_session.iv = responseMac;
+    }
+    return successResponse(responseMac + encrypted);
+}
+
+QByteArray VirtualCardFarm::handleCommand(VirtualCard& card, quint8 ins, quint8 p1, quint8 p2,
+                                          const QByteArray& data)
+{
+    if (ins == 0x11) {  // MUTUALLY AUTHENTICATE
+        if (data.size() != 32) {
+            return errorResponse(0x6A, 0x80);
+        }
+        m_session.authenticated = true;
+        return successResponse(randomBytes(32));
+    }
+    if (m_session.open && !m_session.authenticated) {
+        return errorResponse(0x69, 0x85);
+    }
+
+    switch (ins) {
+    case 0xF2:  // GET STATUS
+        return getStatusResponse(card, p1);
+    case 0x20:  // VERIFY PIN
+        return verifyPINResponse(card, QString::fromUtf8(data));
+    case 0x21:  // CHANGE PIN
+        return changePINResponse(card, p1, data);
+    case 0x22:  // UNBLOCK PIN
+        return unblockPINResponse(card, data);
+    case 0xCA:  // GET DATA
+        return p1 == 0x00 ? successResponse(card.metadata) : errorResponse(0x6A, 0x86);
+    case 0xE2:  // STORE DATA
+        if (!m_session.pinVerified) {
+            return errorResponse(0x69, 0x85);
+        }
+        if (p1 != 0x00) {
+            return errorResponse(0x6A, 0x86);
+        }
+        card.metadata = data;
+        return successResponse();
+    case 0xC2:  // EXPORT KEY
+        return exportKeyResponse(card, p1, p2, data);
+    case 0xC0:  // SIGN
+        return signResponse(card, p1, data);
+    case 0x13:  // UNPAIR
+        return unpairResponse(card, p1);
+    case 0xD0:  // LOAD KEY
+        return loadKeyResponse(card, p1, data);
+    case 0xD1:  // DERIVE KEY
+        return deriveKeyResponse(card, p1, data);
+    case 0xD2:  // GENERATE MNEMONIC
+        return generateMnemonicResponse(p1);
+    case 0xD3:  // REMOVE KEY
+        if (!m_session.pinVerified) {
+            return errorResponse(0x69, 0x85);
+        }
+        card.keyUID.clear();
+        card.masterKey = VirtualCardCrypto::ExtendedKey();
+        card.currentPath.clear();
+        return successResponse();
+    case 0xD4:  // GENERATE KEY
+        if (!m_session.pinVerified) {
+            return errorResponse(0x69, 0x85);
+        }
+        setMasterKey(card, VirtualCardCrypto::masterKey(randomBytes(64)));
+        return successResponse(card.keyUID);
+    case 0xFD:  // FACTORY RESET
+        if (p1 != 0xAA || p2 != 0x55) {
+            return errorResponse(0x6A, 0x86);
+        }
+        factoryReset(card);
+        return successResponse();
+    default:
+        return errorResponse(0x6D, 0x00);
+    }
+}
+
+QByteArray VirtualCardFarm::selectResponse(const VirtualCard& card) const
+{
+    // Secure channel public key - 65 bytes uncompressed secp256k1 key
+    const QByteArray& publicKey = card.secureChannelKey.publicKey;
+
+    // Pre-initialized applet only reports its public key
+    if (card.state == CardState::EmptyKeycard) {
+        return successResponse(buildTLV(0x80, publicKey));
+    }
+
+    QByteArray inner;
+    inner.append(buildTLV(0x8F, card.instanceUID));
+    inner.append(buildTLV(0x80, publicKey));
+    inner.append(buildTLV(0x02, QByteArray() + static_cast<char>(card.versionMajor)
+                                             + static_cast<char>(card.versionMinor)));
+    inner.append(buildTLV(0x02, QByteArray(1, static_cast<char>(card.freePairingSlots))));
+    if (!card.keyUID.isEmpty()) {
+        inner.append(buildTLV(0x8E, card.keyUID));
+    }
+    return successResponse(buildTLV(0xA4, inner));
+}
+
+QByteArray VirtualCardFarm::initResponse(VirtualCard& card, const QByteArray& data)
+{
+    // Host public key (length prefixed), IV, then PIN || PUK || pairing secret
+    // encrypted under the ECDH secret with the card's secure channel key
+    const int keySize = data.isEmpty() ? 0 : static_cast<quint8>(data[0]);
+    const int payloadSize = data.size() - 1 - keySize - 16;
+    if (keySize == 0 || payloadSize < 16 || payloadSize % 16 != 0) {
+        return errorResponse(0x6A, 0x80);
+    }
+    QByteArray secret = VirtualCardCrypto::ecdh(card.secureChannelKey.privateKey, data.mid(1, keySize));
+    QByteArray plain;
+    if (secret.isEmpty()
+        || !VirtualCardCrypto::decrypt(secret, data.mid(1 + keySize, 16), data.mid(1 + keySize + 16), plain)
+        || plain.size() < 6 + 12 + 32) {
+        return errorResponse(0x6A, 0x80);
+    }
+
+    // Initialized without a key, as a card fresh from INIT
+    card.state = CardState::KeycardWithMnemonicOnly;
+    card.pin = QString::fromUtf8(plain.left(6));
+    card.puk = QString::fromUtf8(plain.mid(6, 12));
+    card.pairingSecret = plain.mid(18, 32);
+    card.pinRetries = MaxPINRetries;
+    card.pukRetries = MaxPUKRetries;
+    return successResponse();
+}
+
+QByteArray VirtualCardFarm::pairResponse(VirtualCard& card, quint8 p1, const QByteArray& data)
+{
+    if (p1 == 0x00) {
+        if (card.freePairingSlots <= 0) {
+            return errorResponse(0x6A, 0x84);  // No free slots
+        }
+        if (data.size() != 32) {
+            return errorResponse(0x6A, 0x80);
+        }
+
+        // Cryptogram over the card's secret: a wrong host password fails here
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(card.pairingSecret);
+        hash.addData(data);
+        m_session.pairingChallenge = randomBytes(32);
+        return successResponse(hash.result() + m_session.pairingChallenge);
+    }
+
+    if (p1 == 0x01) {
+        if (m_session.pairingChallenge.isEmpty()) {
+            return errorResponse(0x69, 0x85);
+        }
+        if (data.size() != 32) {
+            return errorResponse(0x6A, 0x80);
+        }
+        QCryptographicHash expected(QCryptographicHash::Sha256);
+        expected.addData(card.pairingSecret);
+        expected.addData(m_session.pairingChallenge);
+        m_session.pairingChallenge.clear();
+        if (data != expected.result()) {
+            return errorResponse(0x69, 0x82);
+        }
+        if (card.freePairingSlots <= 0) {
+            return errorResponse(0x6A, 0x84);
+        }
+
+        quint8 index = 0;
+        while (card.pairingKeys.contains(index)) {
+            ++index;
+        }
+        QByteArray salt = randomBytes(32);
+        card.pairingKeys.insert(index, QCryptographicHash::hash(card.pairingSecret + salt,
+                                                                QCryptographicHash::Sha256));
+        card.freePairingSlots--;
+        return successResponse(QByteArray(1, static_cast<char>(index)) + salt);
+    }
+
+    return errorResponse(0x6A, 0x86);
+}
+
+QByteArray VirtualCardFarm::openSecureChannelResponse(VirtualCard& card, quint8 p1, const QByteArray& data)
+{
+    m_session = Session();
+    auto pairingKey = card.pairingKeys.constFind(p1);
+    if (pairingKey == card.pairingKeys.constEnd()) {
+        return errorResponse(0x6A, 0x86);  // Unknown pairing index
+    }
+    QByteArray secret = VirtualCardCrypto::ecdh(card.secureChannelKey.privateKey, data);
+    if (secret.isEmpty()) {
+        return errorResponse(0x6A, 0x80);
+    }
+
+    // Session keys: SHA-512(secret || pairing key || salt) split in two
+    QByteArray salt = randomBytes(32);
+    QByteArray iv = randomBytes(16);
+    QByteArray keys = QCryptographicHash::hash(secret + *pairingKey + salt, QCryptographicHash::Sha512);
+    m_session.open = true;
+    m_session.encKey = keys.left(32);
+    m_session.macKey = keys.mid(32);
+    m_session.iv = iv;
+    return successResponse(salt + iv);
+}
+
+QByteArray VirtualCardFarm::getStatusResponse(const VirtualCard& card, quint8 p1) const
+{
+    if (p1 == 0x00) {
+        QByteArray inner;
+        inner.append(buildTLV(0x02, QByteArray(1, static_cast<char>(card.pinRetries))));
+        inner.append(buildTLV(0x02, QByteArray(1, static_cast<char>(card.pukRetries))));
+        inner.append(buildTLV(0x01, QByteArray(1, static_cast<char>(card.masterKey.privateKey.isEmpty() ? 0x00 : 0xFF))));
+        return successResponse(buildTLV(0xA3, inner));
+    }
+    if (p1 == 0x01) {  // Current key path
+        QByteArray path;
+        for (quint32 component : card.currentPath) {
+            char bytes[4];
+            qToBigEndian(component, bytes);
+            path.append(bytes, 4);
+        }
+        return successResponse(path);
+    }
+    return errorResponse(0x6A, 0x86);
+}
+
+QByteArray VirtualCardFarm::verifyPINResponse(VirtualCard& card, const QString& pin)
+{
+    if (card.pinRetries <= 0) {
+        return errorResponse(0x63, 0xC0);
+    }
+    if (pin == card.pin) {
+        // A correct PIN restores the full retry count, as on a real card
+        card.pinRetries = MaxPINRetries;
+        m_session.pinVerified = true;
+        return successResponse();
+    }
+    card.pinRetries--;
+    m_session.pinVerified = false;
+    return errorResponse(0x63, static_cast<quint8>(0xC0 | card.pinRetries));
+}
+
+QByteArray VirtualCardFarm::changePINResponse(VirtualCard& card, quint8 p1, const QByteArray& data)
+{
+    if (!m_session.pinVerified) {
+        return errorResponse(0x69, 0x85);
+    }
+    switch (p1) {
+    case 0x00:
+        if (data.size() != 6) {
+            return errorResponse(0x6A, 0x80);
+        }
+        card.pin = QString::fromUtf8(data);
+        return successResponse();
+    case 0x01:
+        if (data.size() != 12) {
+            return errorResponse(0x6A, 0x80);
+        }
+        card.puk = QString::fromUtf8(data);
+        return successResponse();
+    case 0x02:
+        if (data.size() != 32) {
+            return errorResponse(0x6A, 0x80);
+        }
+        card.pairingSecret = data;
+        return successResponse();
+    default:
+        return errorResponse(0x6A, 0x86);
+    }
+}
+
+QByteArray VirtualCardFarm::unblockPINResponse(VirtualCard& card, const QByteArray& data)
+{
+    if (card.pinRetries > 0) {
+        return errorResponse(0x69, 0x85);  // PIN not blocked
+    }
+    if (card.pukRetries <= 0) {
+        return errorResponse(0x63, 0xC0);
+    }
+    if (data.size() != 12 + 6) {
+        return errorResponse(0x6A, 0x80);
+    }
+    if (QString::fromUtf8(data.left(12)) != card.puk) {
+        card.pukRetries--;
+        return errorResponse(0x63, static_cast<quint8>(0xC0 | card.pukRetries));
+    }
+    card.pin = QString::fromUtf8(data.mid(12));
+    card.pinRetries = MaxPINRetries;
+    card.pukRetries = MaxPUKRetries;
+    return successResponse();
+}
+
+QByteArray VirtualCardFarm::exportKeyResponse(VirtualCard& card, quint8 p1, quint8 p2, const QByteArray& data)
+{
+    if (!m_session.pinVerified || card.masterKey.privateKey.isEmpty()) {
+        return errorResponse(0x69, 0x85);
+    }
+    QVector<quint32> path;
+    quint16 sw = resolvePath(card.currentPath, p1, data, path);
+    if (sw != 0x9000) {
+        return errorResponse(sw >> 8, sw & 0xFF);
+    }
+    VirtualCardCrypto::ExtendedKey key;
+    if (!deriveKey(card.masterKey, path, key)) {
+        return errorResponse(0x6F, 0x00);
+    }
+
+    QByteArray inner = buildTLV(0x80, VirtualCardCrypto::publicKey(key.privateKey));
+    switch (p2) {
+    case 0x00:  // Private and public
+        if (path.size() < 3 || !std::equal(Eip1581Root, Eip1581Root + 3, path.constBegin())) {
+            return errorResponse(0x69, 0x85);
+        }
+        inner.append(buildTLV(0x81, key.privateKey));
+        break;
+    case 0x01:  // Public only
+        break;
+    case 0x02:  // Extended public
+        inner.append(buildTLV(0x82, key.chainCode));
+        break;
+    default:
+        return errorResponse(0x6A, 0x86);
+    }
+
+    if ((p1 & 0x0F) == 0x02) {
+        card.currentPath = path;
+    }
+    return successResponse(buildTLV(0xA1, inner));
+}
+
+QByteArray VirtualCardFarm::signResponse(VirtualCard& card, quint8 p1, const QByteArray& data)
+{
+    if ((p1 & 0x0F) == 0x03) {
+        return errorResponse(0x6A, 0x86);  // PIN-less signing is not emulated
+    }
+    if (!m_session.pinVerified || card.masterKey.privateKey.isEmpty()) {
+        return errorResponse(0x69, 0x85);
+    }
+    if (data.size() < 32) {
+        return errorResponse(0x6A, 0x80);
+    }
+    QVector<quint32> path;
+    quint16 sw = resolvePath(card.currentPath, p1, data.mid(32), path);
+    if (sw != 0x9000) {
+        return errorResponse(sw >> 8, sw & 0xFF);
+    }
+    VirtualCardCrypto::ExtendedKey key;
+    if (!deriveKey(card.masterKey, path, key)) {
+        return errorResponse(0x6F, 0x00);
+    }
+
+    // Signature template: public key, then the DER signature as is
+    QByteArray inner = buildTLV(0x80, VirtualCardCrypto::publicKey(key.privateKey));
+    inner.append(VirtualCardCrypto::sign(key.privateKey, data.left(32)));
+    if ((p1 & 0x0F) == 0x02) {
+        card.currentPath = path;
+    }
+    return successResponse(buildTLV(0xA0, inner));
+}
+
+QByteArray VirtualCardFarm::loadKeyResponse(VirtualCard& card, quint8 p1, const QByteArray& data)
+{
+    if (!m_session.pinVerified) {
+        return errorResponse(0x69, 0x85);
+    }
+    if (p1 != 0x03) {
+        return errorResponse(0x6A, 0x86);  // Key pair templates are not emulated, only BIP39 seeds
+    }
+    if (data.size() != 64) {
+        return errorResponse(0x6A, 0x80);
+    }
+    setMasterKey(card, VirtualCardCrypto::masterKey(data));
+    return successResponse(card.keyUID);
+}
+
+QByteArray VirtualCardFarm::deriveKeyResponse(VirtualCard& card, quint8 p1, const QByteArray& data)
+{
+    if (!m_session.pinVerified || card.masterKey.privateKey.isEmpty()) {
+        return errorResponse(0x69, 0x85);
+    }
+    // P1 only picks where the derivation starts; the result becomes current
+    QVector<quint32> path;
+    quint16 sw = resolvePath(card.currentPath, static_cast<quint8>((p1 & 0xF0) | 0x02), data, path);
+    if (sw != 0x9000) {
+        return errorResponse(sw >> 8, sw & 0xFF);
+    }
+    VirtualCardCrypto::ExtendedKey key;
+    if (!deriveKey(card.masterKey, path, key)) {
+        return errorResponse(0x6F, 0x00);
+    }
+    card.currentPath = path;
+    return successResponse();
+}
+
+QByteArray VirtualCardFarm::generateMnemonicResponse(quint8 p1)
+{
+    // P1 is the checksum size in bits; three words per checksum bit
+    if (p1 < 4 || p1 > 8) {
+        return errorResponse(0x6A, 0x86);
+    }
+    QByteArray indexes;
+    for (int i = 0; i < p1 * 3; ++i) {
+        char bytes[2];
+        qToBigEndian(static_cast<quint16>(QRandomGenerator::global()->bounded(2048)), bytes);
+        indexes.append(bytes, 2);
+    }
+    return successResponse(indexes);
+}
+
+void VirtualCardFarm::setMasterKey(VirtualCard& card, const VirtualCardCrypto::ExtendedKey& masterKey)
+{
+    card.masterKey = masterKey;
+    card.keyUID = keyUIDFor(masterKey);
+    card.currentPath.clear();
+}
+
+QByteArray VirtualCardFarm::unpairResponse(VirtualCard& card, quint8 p1)
+{
+    if (!m_session.pinVerified) {
+        return errorResponse(0x69, 0x85);
+    }
+    if (card.pairingKeys.remove(p1) > 0) {
+        card.freePairingSlots++;
+    }
+    return successResponse();
+}
+
+void VirtualCardFarm::factoryReset(VirtualCard& card)
+{
+    card.state = CardState::EmptyKeycard;
+    card.keyUID.clear();
+    card.masterKey = VirtualCardCrypto::ExtendedKey();
+    card.currentPath.clear();
+    card.metadata.clear();
+    card.pairingKeys.clear();
+    card.freePairingSlots = MaxPairingSlots;
+    card.pinRetries = MaxPINRetries;
+    card.pukRetries = MaxPUKRetries;
+    m_session = Session();
+}
+
+QByteArray VirtualCardFarm::successResponse(const QByteArray& data)
+{
+    QByteArray response = data;
+    response.append(static_cast<char>(0x90));
+    response.append(static_cast<char>(0x00));
+    return response;
+}
+
+QByteArray VirtualCardFarm::errorResponse(quint8 sw1, quint8 sw2)
+{
+    QByteArray response;
+    response.append(static_cast<char>(sw1));
+    response.append(static_cast<char>(sw2));
+    return response;
+}
+
+} // namespace StatusKeycard
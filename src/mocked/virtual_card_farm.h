@@ -0,0 +1,186 @@
+#ifndef VIRTUAL_CARD_FARM_H
+#define VIRTUAL_CARD_FARM_H
+
+#include "virtual_card_crypto.h"
+#include <keycard-qt/backends/keycard_channel_backend.h>
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Virtual reader/card farm backing the MockedLib* C API
+ *
+ * A KeycardChannelBackend that serves any number of registered virtual cards
+ * through one virtual reader. Reader plug/unplug and card insert/remove are
+ * emitted as regular backend signals, so SessionManager, FlowManager and the
+ * pairing storage see the same event path as with real hardware.
+ *
+ * Each card emulates the Keycard applet far enough to drive a session: it
+ * has its own secure channel key pair and BIP32 master key, and answers
+ * SELECT, INIT (empty cards), PAIR, OPEN SECURE CHANNEL and, inside the
+ * secure channel (MACs checked, responses encrypted), MUTUALLY AUTHENTICATE,
+ * GET STATUS, VERIFY PIN, CHANGE PIN, UNBLOCK PIN, GET DATA, STORE DATA,
+ * EXPORT KEY, SIGN, LOAD KEY, DERIVE KEY, GENERATE KEY, GENERATE MNEMONIC,
+ * REMOVE KEY, UNPAIR and FACTORY RESET.
+ *
+ * Not emulated, and refused rather than approximated: LOAD KEY of a key pair
+ * template (only BIP39 seeds, P1 = 3) and PIN-less SIGN answer 6A86; SET
+ * PINLESS PATH, DUPLICATE KEY and any other INS answer 6D00.
+ *
+ * Control methods are thread-safe (MockedLib is called from Nim threads);
+ * signals are delivered on the farm's thread.
+ */
+class VirtualCardFarm : public Keycard::KeycardChannelBackend {
+    Q_OBJECT
+
+public:
+    // Matching status-keycard-go MockedReaderState
+    enum class ReaderState {
+        NoReader = 0,
+        NoKeycard = 1,
+        KeycardInserted = 2
+    };
+
+    // Matching status-keycard-go MockedKeycardState
+    enum class CardState {
+        NotStatusKeycard = 0,
+        EmptyKeycard = 1,
+        MaxPairingSlotsReached = 2,
+        MaxPINRetriesReached = 3,
+        MaxPUKRetriesReached = 4,
+        KeycardWithMnemonicOnly = 5,
+        KeycardWithMnemonicAndMetadata = 6
+    };
+
+    static constexpr int MaxPINRetries = 3;
+    static constexpr int MaxPUKRetries = 5;
+    static constexpr int MaxPairingSlots = 5;
+
+    struct VirtualCard {
+        CardState state = CardState::KeycardWithMnemonicOnly;
+        QByteArray instanceUID;
+        QByteArray keyUID;
+        QString pin = "000000";
+        QString puk = "000000000000";
+        QByteArray pairingSecret;  // PBKDF2 of the pairing password
+        int freePairingSlots = MaxPairingSlots;
+        int pinRetries = MaxPINRetries;
+        int pukRetries = MaxPUKRetries;
+        quint8 versionMajor = 3;
+        quint8 versionMinor = 1;
+        QByteArray metadata;  // Public data, in the GET DATA format
+
+        VirtualCardCrypto::KeyPair secureChannelKey;
+        VirtualCardCrypto::ExtendedKey masterKey;  // Empty without a key
+        QVector<quint32> currentPath;
+        QHash<quint8, QByteArray> pairingKeys;  // By pairing index
+
+        /**
+         * @brief Build a card from status-keycard-go's mockedKeycard JSON
+         *
+         * Missing fields keep defaults derived from the state (e.g. an empty
+         * keycard has no key UID). instanceUID and the master key are derived
+         * from cardIndex so that every registered card is distinct; keyUID is
+         * the hash of the master public key unless given. "keyless": true
+         * gives an initialized card with no key loaded yet.
+         */
+        static VirtualCard fromJson(int cardIndex, CardState state, const QJsonObject& json);
+    };
+
+    explicit VirtualCardFarm(QObject* parent = nullptr);
+    ~VirtualCardFarm() override;
+
+    // MockedLib control (any thread); return an empty string or an error
+    QString registerCard(int cardIndex, ReaderState readerState, CardState cardState,
+                         const QJsonObject& mockedKeycard);
+    QString plugReader();
+    QString unplugReader();
+    QString insertCard(int cardIndex);
+    QString removeCard();
+
+    /**
+     * @brief Farm counters for load tests (registered cards, events, APDUs)
+     *
+     * "commands" counts APDUs by INS (two lowercase hex digits), secured
+     * ones included, so tests can check the round trips a flow makes.
+     * "idleRequests" counts the host setting the channel Idle, which
+     * FlowManager does after a flow unless it hands the card over.
+     */
+    QJsonObject stats() const;
+
+    // KeycardChannelBackend interface
+    QByteArray transmit(const QByteArray& apdu) override;
+    bool isConnected() const override;
+    void startDetection() override;
+    void stopDetection() override;
+    void disconnect() override;
+    QString backendName() const override { return "Virtual Card Farm"; }
+    void setState(Keycard::ChannelState state) override;
+    Keycard::ChannelState state() const override;
+    void forceScan() override;
+
+private:
+    // Queue a backend signal onto the farm's thread
+    void emitInserted(const QByteArray& instanceUID);
+    void emitRemoved();
+    void emitReaderAvailability(bool available);
+
+    // Secure channel with the inserted card; reset by SELECT and removal
+    struct Session {
+        bool open = false;
+        bool authenticated = false;  // MUTUALLY AUTHENTICATE done
+        bool pinVerified = false;
+        QByteArray encKey;
+        QByteArray macKey;
+        QByteArray iv;
+        QByteArray pairingChallenge;  // Card challenge between the PAIR steps
+    };
+
+    // APDU handlers (m_mutex held)
+    QByteArray handleApdu(const QByteArray& apdu);
+    QByteArray handleSecured(VirtualCard& card, const QByteArray& apdu);
+    QByteArray handleCommand(VirtualCard& card, quint8 ins, quint8 p1, quint8 p2, const QByteArray& data);
+    QByteArray selectResponse(const VirtualCard& card) const;
+    QByteArray initResponse(VirtualCard& card, const QByteArray& data);
+    QByteArray pairResponse(VirtualCard& card, quint8 p1, const QByteArray& data);
+    QByteArray openSecureChannelResponse(VirtualCard& card, quint8 p1, const QByteArray& data);
+    QByteArray getStatusResponse(const VirtualCard& card, quint8 p1) const;
+    QByteArray verifyPINResponse(VirtualCard& card, const QString& pin);
+    QByteArray changePINResponse(VirtualCard& card, quint8 p1, const QByteArray& data);
+    QByteArray unblockPINResponse(VirtualCard& card, const QByteArray& data);
+    QByteArray exportKeyResponse(VirtualCard& card, quint8 p1, quint8 p2, const QByteArray& data);
+    QByteArray signResponse(VirtualCard& card, quint8 p1, const QByteArray& data);
+    QByteArray loadKeyResponse(VirtualCard& card, quint8 p1, const QByteArray& data);
+    QByteArray deriveKeyResponse(VirtualCard& card, quint8 p1, const QByteArray& data);
+    static QByteArray generateMnemonicResponse(quint8 p1);
+    static void setMasterKey(VirtualCard& card, const VirtualCardCrypto::ExtendedKey& masterKey);
+    QByteArray unpairResponse(VirtualCard& card, quint8 p1);
+    void factoryReset(VirtualCard& card);
+
+    static QByteArray successResponse(const QByteArray& data = QByteArray());
+    static QByteArray errorResponse(quint8 sw1, quint8 sw2);
+
+    mutable QMutex m_mutex;
+    QHash<int, VirtualCard> m_cards;
+    bool m_readerPlugged;
+    bool m_detecting;
+    int m_insertedIndex;  // -1 when no card is in the reader
+    Session m_session;
+    Keycard::ChannelState m_channelState;
+
+    // Counters
+    quint64 m_insertions;
+    quint64 m_removals;
+    quint64 m_apdus;
+    quint64 m_idleRequests;
+    QHash<quint8, quint64> m_commands;  // By INS
+};
+
+} // namespace StatusKeycard
+
+#endif // VIRTUAL_CARD_FARM_H
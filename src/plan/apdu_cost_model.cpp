@@ -0,0 +1,191 @@
+#include "apdu_cost_model.h"
+#include "../flight_recorder.h"
+#include <QMutexLocker>
+#include <QStringList>
+
+namespace StatusKeycard {
+
+namespace {
+
+struct DefaultCost {
+    quint8 ins;
+    double baseMs;
+    double perLevelMs;
+};
+
+// Typical latencies through a PC/SC reader with a 3.x applet, secure channel
+// overhead included where the command is wrapped
+constexpr DefaultCost DEFAULT_COSTS[] = {
+    {ApduCostModel::Select, 15, 0},
+    {ApduCostModel::OpenSecureChannel, 70, 0},
+    {ApduCostModel::MutuallyAuthenticate, 35, 0},
+    {ApduCostModel::Pair, 140, 0},
+    {ApduCostModel::GetStatus, 25, 0},
+    {ApduCostModel::VerifyPIN, 110, 0},
+    {ApduCostModel::Sign, 90, 45},
+    {ApduCostModel::ExportKey, 40, 45},
+    {ApduCostModel::GetData, 30, 0},
+    {ApduCostModel::StoreData, 85, 0},
+};
+
+double readerFactor(const QString& readerType)
+{
+    if (readerType == "nfc") {
+        return 1.8;
+    }
+    if (readerType == "virtual") {
+        return 0.05;
+    }
+    return 1.0;
+}
+
+} // namespace
+
+ApduCostModel::ApduCostModel()
+    : m_readerType(platformReaderType())
+{
+}
+
+QString ApduCostModel::platformReaderType()
+{
+#if defined(Q_OS_ANDROID) || defined(Q_OS_IOS)
+    return "nfc";
+#else
+    return "pcsc";
+#endif
+}
+
+QString ApduCostModel::readerTypeForBackend(const QString& backendName)
+{
+    const QString name = backendName.toLower();
+    if (name.contains("virtual") || name.contains("mock")) {
+        return "virtual";
+    }
+    if (name.contains("nfc")) {
+        return "nfc";
+    }
+    if (name.contains("pc/sc") || name.contains("pcsc")) {
+        return "pcsc";
+    }
+    return platformReaderType();
+}
+
+void ApduCostModel::setReaderType(const QString& readerType)
+{
+    QMutexLocker locker(&m_mutex);
+    m_readerType = readerType;
+}
+
+QString ApduCostModel::readerType() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_readerType;
+}
+
+ApduCostModel::Estimate ApduCostModel::defaultEstimate(quint8 ins, const QString& readerType) const
+{
+    Estimate estimate;
+    const double factor = readerFactor(readerType);
+    for (const DefaultCost& cost : DEFAULT_COSTS) {
+        if (cost.ins == ins) {
+            estimate.baseMs = cost.baseMs * factor;
+            estimate.perLevelMs = cost.perLevelMs;  // Card-side work, reader independent
+            return estimate;
+        }
+    }
+    estimate.baseMs = 50 * factor;
+    return estimate;
+}
+
+double ApduCostModel::estimate(quint8 ins, int derivedLevels, const QString& readerType) const
+{
+    QMutexLocker locker(&m_mutex);
+    const QString reader = readerType.isEmpty() ? m_readerType : readerType;
+
+    Estimate estimate = m_observed.value(reader).value(ins, defaultEstimate(ins, reader));
+    return estimate.baseMs + estimate.perLevelMs * qMax(0, derivedLevels);
+}
+
+void ApduCostModel::observe(quint8 ins, qint64 elapsedMs, int derivedLevels)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<quint8, Estimate>& table = m_observed[m_readerType];
+    auto it = table.find(ins);
+    if (it == table.end()) {
+        it = table.insert(ins, defaultEstimate(ins, m_readerType));
+    }
+
+    // The per-level slope stays fixed; the sample calibrates the base
+    const double base = qMax(0.0, elapsedMs - it->perLevelMs * qMax(0, derivedLevels));
+    it->baseMs = it->observations == 0 ? base
+                                       : it->baseMs + ObservationWeight * (base - it->baseMs);
+    it->observations++;
+}
+
+QJsonObject ApduCostModel::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QStringList readers = m_observed.keys();
+    if (!readers.contains(m_readerType)) {
+        readers.append(m_readerType);
+    }
+
+    QJsonObject json;
+    for (const QString& reader : readers) {
+        QJsonObject table;
+        for (const DefaultCost& cost : DEFAULT_COSTS) {
+            Estimate estimate = m_observed.value(reader).value(cost.ins, defaultEstimate(cost.ins, reader));
+            QJsonObject entry;
+            entry["baseMs"] = estimate.baseMs;
+            entry["perLevelMs"] = estimate.perLevelMs;
+            entry["observations"] = static_cast<double>(estimate.observations);
+            table[insName(cost.ins)] = entry;
+        }
+        json[reader] = table;
+    }
+    return json;
+}
+
+void ApduCostModel::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_observed.clear();
+}
+
+QString ApduCostModel::insName(quint8 ins)
+{
+    switch (ins) {
+    case Select: return "SELECT";
+    case OpenSecureChannel: return "OPEN SECURE CHANNEL";
+    case MutuallyAuthenticate: return "MUTUALLY AUTHENTICATE";
+    case Pair: return "PAIR";
+    case GetStatus: return "GET STATUS";
+    case VerifyPIN: return "VERIFY PIN";
+    case Sign: return "SIGN";
+    case ExportKey: return "EXPORT KEY";
+    case GetData: return "GET DATA";
+    case StoreData: return "STORE DATA";
+    }
+    return QString("INS %1").arg(ins, 2, 16, QChar('0'));
+}
+
+ApduTimer::ApduTimer(ApduCostModel* model, quint8 ins, int derivedLevels)
+    : m_model(model)
+    , m_ins(ins)
+    , m_derivedLevels(derivedLevels)
+    , m_succeeded(false)
+{
+    m_timer.start();
+}
+
+ApduTimer::~ApduTimer()
+{
+    if (m_model && m_succeeded) {
+        m_model->observe(m_ins, m_timer.elapsed(), m_derivedLevels);
+    }
+    // The SW is consumed inside CommandSet; only INS and timing are known here
+    FlightRecorder::instance()->record(FlightRecorder::Event::Apdu, m_ins, 0, m_timer.nsecsElapsed() / 1000);
+}
+
+} // namespace StatusKeycard
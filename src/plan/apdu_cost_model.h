@@ -0,0 +1,125 @@
+#ifndef APDU_COST_MODEL_H
+#define APDU_COST_MODEL_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Per-INS latency model for Keycard APDUs
+ *
+ * Estimates are kept per reader type ("pcsc", "nfc", "virtual") and per
+ * instruction byte. An estimate is base + perLevel * derivedLevels, where
+ * derivedLevels counts BIP32 levels the card has to derive (EXPORT KEY and
+ * SIGN only).
+ *
+ * Built-in defaults are used until a (reader, INS) pair has been observed;
+ * observations then move the base towards the measured latency with an
+ * exponentially weighted moving average.
+ *
+ * Thread-safe.
+ */
+class ApduCostModel {
+public:
+    // Instruction bytes of the Keycard applet
+    enum Ins : quint8 {
+        Select = 0xA4,
+        OpenSecureChannel = 0x10,
+        MutuallyAuthenticate = 0x11,
+        Pair = 0x12,
+        GetStatus = 0xF2,
+        VerifyPIN = 0x20,
+        Sign = 0xC0,
+        ExportKey = 0xC2,
+        GetData = 0xCA,
+        StoreData = 0xE2
+    };
+
+    struct Estimate {
+        double baseMs = 0;
+        double perLevelMs = 0;
+        quint64 observations = 0;
+    };
+
+    ApduCostModel();
+
+    /**
+     * @brief Reader type used when none is given (platform default)
+     */
+    void setReaderType(const QString& readerType);
+    QString readerType() const;
+
+    static QString platformReaderType();
+
+    /**
+     * @brief Reader type for a channel backend, from its backendName()
+     *
+     * The platform default when the name does not tell.
+     */
+    static QString readerTypeForBackend(const QString& backendName);
+
+    /**
+     * @brief Estimated latency of one APDU in ms
+     * @param readerType Reader type, empty for the current one
+     */
+    double estimate(quint8 ins, int derivedLevels = 0, const QString& readerType = QString()) const;
+
+    /**
+     * @brief Host-side BIP32 child derivation (no card round trip)
+     */
+    double hostDeriveMs() const { return HostDeriveMs; }
+
+    /**
+     * @brief Record a measured latency for the current reader type
+     */
+    void observe(quint8 ins, qint64 elapsedMs, int derivedLevels = 0);
+
+    /**
+     * @brief Estimates per reader type and INS, observed ones marked
+     */
+    QJsonObject toJson() const;
+
+    void reset();
+
+    static QString insName(quint8 ins);
+
+private:
+    static constexpr double HostDeriveMs = 0.2;
+    static constexpr double ObservationWeight = 0.2;  // EWMA weight of a new sample
+
+    Estimate defaultEstimate(quint8 ins, const QString& readerType) const;
+
+    mutable QMutex m_mutex;
+    QString m_readerType;
+    QHash<QString, QHash<quint8, Estimate>> m_observed;  // readerType -> INS -> estimate
+};
+
+/**
+ * @brief Times one card command for the cost model and the flight recorder
+ *
+ * Only a command marked succeeded() is observed by the model: a refused
+ * command returns early and would pull the estimate down. The flight
+ * recorder gets every command. With a null model it only records.
+ */
+class ApduTimer {
+public:
+    ApduTimer(ApduCostModel* model, quint8 ins, int derivedLevels = 0);
+    ~ApduTimer();
+
+    void succeeded(bool ok = true) { m_succeeded = ok; }
+
+private:
+    ApduCostModel* m_model;
+    quint8 m_ins;
+    int m_derivedLevels;
+    bool m_succeeded;
+    QElapsedTimer m_timer;
+};
+
+} // namespace StatusKeycard
+
+#endif // APDU_COST_MODEL_H
@@ -0,0 +1,309 @@
+#include "execution_planner.h"
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <algorithm>
+
+namespace StatusKeycard {
+
+namespace {
+
+// Same ordering as SessionManager::exportKeys: numeric, hardened after normal
+QVector<quint64> derivationSortKey(const QString& path)
+{
+    QVector<quint64> key;
+    const QStringList parts = path.split('/');
+    for (int i = 1; i < parts.size(); ++i) {
+        QString part = parts[i];
+        quint64 hardened = 0;
+        if (part.endsWith('\'')) {
+            part.chop(1);
+            hardened = 0x80000000ULL;
+        }
+        key.append(hardened + part.toULongLong());
+    }
+    return key;
+}
+
+bool derivationLess(const QString& a, const QString& b)
+{
+    const QVector<quint64> keyA = derivationSortKey(a);
+    const QVector<quint64> keyB = derivationSortKey(b);
+    if (keyA.isEmpty() != keyB.isEmpty()) {
+        return keyB.isEmpty();  // Master last (exported with makeCurrent)
+    }
+    return std::lexicographical_compare(keyA.begin(), keyA.end(), keyB.begin(), keyB.end());
+}
+
+QString parentPath(const QString& path)
+{
+    int slash = path.lastIndexOf('/');
+    return slash > 0 ? path.left(slash) : QString();
+}
+
+bool isValidPath(const QString& path)
+{
+    return path == "m" || path.startsWith("m/");
+}
+
+} // namespace
+
+// ============================================================================
+// Request / result JSON
+// ============================================================================
+
+bool PlanRequest::fromJson(const QJsonObject& json, PlanRequest& request, QString& error)
+{
+    for (const QJsonValue& value : json["exports"].toArray()) {
+        QJsonObject obj = value.toObject();
+        Export item;
+        item.path = obj["path"].toString();
+        item.exportPrivate = obj["private"].toBool();
+        item.exportChainCode = obj["chainCode"].toBool();
+        if (!isValidPath(item.path)) {
+            error = QString("invalid path '%1'").arg(item.path);
+            return false;
+        }
+        request.exports.append(item);
+    }
+
+    for (const QJsonValue& value : json["signs"].toArray()) {
+        QJsonObject obj = value.toObject();
+        SignBatch item;
+        item.path = obj["path"].toString();
+        item.count = obj["count"].toInt(1);
+        if (!isValidPath(item.path) || item.count < 1) {
+            error = QString("invalid sign entry for path '%1'").arg(item.path);
+            return false;
+        }
+        request.signs.append(item);
+    }
+
+    request.getMetadata = json["getMetadata"].toBool();
+    request.storeMetadata = json["storeMetadata"].toBool();
+    return true;
+}
+
+QJsonObject PlanStep::toJson() const
+{
+    QJsonObject json;
+    json["command"] = ApduCostModel::insName(ins);
+    json["ins"] = QString("%1").arg(ins, 2, 16, QChar('0'));
+    json["count"] = count;
+    if (!detail.isEmpty()) {
+        json["detail"] = detail;
+    }
+    json["estimatedMs"] = estimatedMs;
+    return json;
+}
+
+int ExecutionPlan::apduCount() const
+{
+    int total = 0;
+    for (const PlanStep& step : steps) {
+        total += step.count;
+    }
+    return total;
+}
+
+double ExecutionPlan::estimatedMs() const
+{
+    double total = 0;
+    for (const PlanStep& step : steps) {
+        total += step.estimatedMs;
+    }
+    return total;
+}
+
+QJsonObject ExecutionPlan::toJson() const
+{
+    QJsonArray stepsJson;
+    for (const PlanStep& step : steps) {
+        stepsJson.append(step.toJson());
+    }
+
+    QJsonObject json;
+    json["readerType"] = readerType;
+    json["steps"] = stepsJson;
+    json["apduCount"] = apduCount();
+    json["estimatedMs"] = estimatedMs();
+    json["decisions"] = decisions;
+    return json;
+}
+
+// ============================================================================
+// Planning
+// ============================================================================
+
+int ExecutionPlanner::pathDepth(const QString& path)
+{
+    return path.count('/');
+}
+
+void ExecutionPlanner::addStep(ExecutionPlan& plan, quint8 ins, int count, const QString& detail,
+                               int derivedLevels) const
+{
+    PlanStep step;
+    step.ins = ins;
+    step.count = count;
+    step.detail = detail;
+    step.estimatedMs = count * m_model.estimate(ins, derivedLevels, plan.readerType);
+    plan.steps.append(step);
+}
+
+ExecutionPlan ExecutionPlanner::plan(const PlanRequest& request, const PlanSession& session,
+                                     const QString& readerType) const
+{
+    ExecutionPlan plan;
+    plan.readerType = readerType.isEmpty() ? m_model.readerType() : readerType;
+
+    const bool anyCardWork = !request.exports.isEmpty() || !request.signs.isEmpty()
+                             || request.getMetadata || request.storeMetadata;
+    if (!anyCardWork) {
+        return plan;
+    }
+    const bool needsPIN = !request.exports.isEmpty() || !request.signs.isEmpty() || request.storeMetadata;
+
+    // Session preamble: only what the current session is missing
+    if (!session.selected) {
+        addStep(plan, ApduCostModel::Select, 1, "select applet");
+    }
+    if (!session.paired) {
+        addStep(plan, ApduCostModel::Pair, 2, "pairing (two-step)");
+    }
+    if (!session.secureChannel) {
+        addStep(plan, ApduCostModel::OpenSecureChannel, 1, "secure channel");
+        addStep(plan, ApduCostModel::MutuallyAuthenticate, 1, "secure channel");
+    }
+    if (needsPIN && !session.authorized) {
+        addStep(plan, ApduCostModel::GetStatus, 1, "PIN retries");
+        addStep(plan, ApduCostModel::VerifyPIN, 1, "authorize");
+    }
+
+    if (request.getMetadata) {
+        addStep(plan, ApduCostModel::GetData, 1, "read metadata");
+    }
+
+    planExports(plan, request, session);
+    planSigns(plan, request);
+
+    if (request.storeMetadata) {
+        addStep(plan, ApduCostModel::StoreData, 1, "write metadata");
+    }
+
+    return plan;
+}
+
+void ExecutionPlanner::planExports(ExecutionPlan& plan, const PlanRequest& request,
+                                   const PlanSession& session) const
+{
+    // De-duplicate identical (path, options) exports
+    QVector<PlanRequest::Export> exports;
+    QSet<QString> seen;
+    for (const PlanRequest::Export& item : request.exports) {
+        const QString key = QString("%1|%2|%3").arg(item.path).arg(item.exportPrivate).arg(item.exportChainCode);
+        if (!seen.contains(key)) {
+            seen.insert(key);
+            exports.append(item);
+        }
+    }
+    if (exports.size() < request.exports.size()) {
+        QJsonObject decision;
+        decision["decision"] = "dedupe-exports";
+        decision["requested"] = request.exports.size();
+        decision["planned"] = exports.size();
+        plan.decisions.append(decision);
+    }
+
+    std::stable_sort(exports.begin(), exports.end(),
+                     [](const PlanRequest::Export& a, const PlanRequest::Export& b) {
+                         return derivationLess(a.path, b.path);
+                     });
+
+    // Group by parent, keeping derivation order between groups
+    QVector<QString> parents;
+    QHash<QString, QVector<PlanRequest::Export>> groups;
+    for (const PlanRequest::Export& item : exports) {
+        const QString parent = parentPath(item.path);
+        if (!groups.contains(parent)) {
+            parents.append(parent);
+        }
+        groups[parent].append(item);
+    }
+
+    for (const QString& parent : parents) {
+        const QVector<PlanRequest::Export>& group = groups[parent];
+
+        double cardMs = 0;
+        bool hostEligible = session.supportsExtended && group.size() > 1 && !parent.isEmpty();
+        for (const PlanRequest::Export& item : group) {
+            cardMs += m_model.estimate(ApduCostModel::ExportKey, pathDepth(item.path), plan.readerType);
+            const QString last = item.path.mid(item.path.lastIndexOf('/') + 1);
+            hostEligible = hostEligible && !item.exportPrivate && !last.endsWith('\'');
+        }
+
+        // The session exports every key on the card; host-side derivation of
+        // public siblings is reported as an alternative only
+        QJsonObject decision;
+        decision["decision"] = "export-strategy";
+        decision["parent"] = parent.isEmpty() ? QString("-") : parent;
+        decision["keys"] = group.size();
+        decision["chosen"] = "card";
+        decision["estimatedMs"] = cardMs;
+        if (hostEligible) {
+            QJsonObject hostDerive;
+            hostDerive["strategy"] = "host-derive";
+            hostDerive["estimatedMs"] = m_model.estimate(ApduCostModel::ExportKey, pathDepth(parent), plan.readerType)
+                                        + group.size() * m_model.hostDeriveMs();
+            decision["alternatives"] = QJsonArray{hostDerive};
+        }
+        plan.decisions.append(decision);
+
+        for (const PlanRequest::Export& item : group) {
+            QString detail = item.path;
+            if (item.exportPrivate) {
+                detail += " (private)";
+            } else if (item.exportChainCode) {
+                detail += " (extended public)";
+            }
+            addStep(plan, ApduCostModel::ExportKey, 1, detail, pathDepth(item.path));
+        }
+    }
+}
+
+void ExecutionPlanner::planSigns(ExecutionPlan& plan, const PlanRequest& request) const
+{
+    // SignFlow signs each hash with its path, so the card derives the key
+    // every time; requests for the same key are still listed together
+    QVector<QString> paths;
+    QHash<QString, int> counts;
+    for (const PlanRequest::SignBatch& item : request.signs) {
+        if (!counts.contains(item.path)) {
+            paths.append(item.path);
+        }
+        counts[item.path] += item.count;
+    }
+
+    for (const QString& path : paths) {
+        const int count = counts.value(path);
+        const int depth = pathDepth(path);
+        addStep(plan, ApduCostModel::Sign, count, QString("%1 (derive per hash)").arg(path), depth);
+        if (count > 1) {
+            QJsonObject deriveOnce;
+            deriveOnce["strategy"] = "derive-once";
+            deriveOnce["estimatedMs"] = m_model.estimate(ApduCostModel::Sign, depth, plan.readerType)
+                                        + (count - 1) * m_model.estimate(ApduCostModel::Sign, 0, plan.readerType);
+
+            QJsonObject decision;
+            decision["decision"] = "sign-strategy";
+            decision["path"] = path;
+            decision["hashes"] = count;
+            decision["chosen"] = "derive-each";
+            decision["estimatedMs"] = count * m_model.estimate(ApduCostModel::Sign, depth, plan.readerType);
+            decision["alternatives"] = QJsonArray{deriveOnce};
+            plan.decisions.append(decision);
+        }
+    }
+}
+
+} // namespace StatusKeycard
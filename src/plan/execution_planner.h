@@ -0,0 +1,111 @@
+#ifndef EXECUTION_PLANNER_H
+#define EXECUTION_PLANNER_H
+
+#include "apdu_cost_model.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Operations to plan (keycard.ExplainPlan params)
+ */
+struct PlanRequest {
+    struct Export {
+        QString path;
+        bool exportPrivate = false;
+        bool exportChainCode = false;
+    };
+
+    struct SignBatch {
+        QString path;
+        int count = 1;  // Hashes signed with this key
+    };
+
+    QVector<Export> exports;
+    QVector<SignBatch> signs;
+    bool getMetadata = false;
+    bool storeMetadata = false;
+
+    /**
+     * @brief Parse {"exports": [...], "signs": [...], "getMetadata", "storeMetadata"}
+     * @return false with error set on malformed input
+     */
+    static bool fromJson(const QJsonObject& json, PlanRequest& request, QString& error);
+};
+
+/**
+ * @brief Card session state the plan starts from
+ */
+struct PlanSession {
+    bool selected = false;
+    bool paired = false;
+    bool secureChannel = false;
+    bool authorized = false;
+    bool supportsExtended = true;  // EXPORT KEY with chain code (applet 3.1+)
+};
+
+/**
+ * @brief One line of a plan: an APDU repeated count times
+ */
+struct PlanStep {
+    quint8 ins = 0;
+    int count = 1;
+    QString detail;
+    double estimatedMs = 0;
+
+    QJsonObject toJson() const;
+};
+
+struct ExecutionPlan {
+    QString readerType;
+    QVector<PlanStep> steps;
+    QJsonArray decisions;  // Strategy chosen per group, alternatives with their cost
+
+    int apduCount() const;
+    double estimatedMs() const;
+    QJsonObject toJson() const;
+};
+
+/**
+ * @brief Turns a set of operations into an explicit APDU plan
+ *
+ * Pure function of the request, the session state and the cost model; it
+ * never talks to the card. The planner:
+ * - adds only the session preamble (SELECT, PAIR, secure channel, PIN) the
+ *   current session lacks, and PIN verification only if an operation needs it
+ * - de-duplicates identical exports and orders them by derivation path
+ * - models what the session and SignFlow execute: one card export per key
+ *   and one SIGN with path derivation per hash
+ *
+ * "chosen" in a decision is always the strategy that runs. Strategies that
+ * are not implemented are listed as "alternatives" with their estimated
+ * cost only, even when cheaper: host-side derivation of public siblings
+ * from one extended export, and deriving a signing key once for several
+ * hashes.
+ */
+class ExecutionPlanner {
+public:
+    explicit ExecutionPlanner(const ApduCostModel& model) : m_model(model) {}
+
+    ExecutionPlan plan(const PlanRequest& request, const PlanSession& session,
+                       const QString& readerType = QString()) const;
+
+    /**
+     * @brief Number of levels below m in a derivation path
+     */
+    static int pathDepth(const QString& path);
+
+private:
+    void addStep(ExecutionPlan& plan, quint8 ins, int count, const QString& detail, int derivedLevels = 0) const;
+    void planExports(ExecutionPlan& plan, const PlanRequest& request, const PlanSession& session) const;
+    void planSigns(ExecutionPlan& plan, const PlanRequest& request) const;
+
+    const ApduCostModel& m_model;
+};
+
+} // namespace StatusKeycard
+
+#endif // EXECUTION_PLANNER_H
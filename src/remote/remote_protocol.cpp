@@ -0,0 +1,170 @@
+#include "remote_protocol.h"
+#include <QMessageAuthenticationCode>
+#include <QtEndian>
+
+namespace StatusKeycard {
+
+namespace RemoteProtocol {
+
+namespace {
+
+bool knownType(quint8 type)
+{
+    switch (static_cast<FrameType>(type)) {
+    case FrameType::Hello:
+    case FrameType::Response:
+    case FrameType::CardInserted:
+    case FrameType::CardRemoved:
+    case FrameType::ReaderAvailability:
+    case FrameType::Pong:
+    case FrameType::Challenge:
+    case FrameType::Transmit:
+    case FrameType::StartDetection:
+    case FrameType::StopDetection:
+    case FrameType::ForceScan:
+    case FrameType::Disconnect:
+    case FrameType::Ping:
+    case FrameType::Authenticate:
+        return true;
+    }
+    return false;
+}
+
+void appendU32(QByteArray& out, quint32 value)
+{
+    char bytes[4];
+    qToBigEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+} // namespace
+
+QByteArray encodeFrame(FrameType type, quint32 id, const QByteArray& payload)
+{
+    QByteArray frame;
+    frame.reserve(HeaderSize + payload.size());
+    appendU32(frame, static_cast<quint32>(1 + 4 + payload.size()));
+    frame.append(static_cast<char>(type));
+    appendU32(frame, id);
+    frame.append(payload);
+    return frame;
+}
+
+void FrameReader::append(const QByteArray& data)
+{
+    // Drop consumed bytes before growing the buffer
+    if (m_offset > 0) {
+        m_buffer.remove(0, m_offset);
+        m_offset = 0;
+    }
+    m_buffer.append(data);
+}
+
+FrameReader::Result FrameReader::next(Frame& frame)
+{
+    const qsizetype available = m_buffer.size() - m_offset;
+    if (available < 4) {
+        return Result::NeedMore;
+    }
+    const char* data = m_buffer.constData() + m_offset;
+    const quint32 length = qFromBigEndian<quint32>(data);
+    if (length < HeaderSize - 4 || length > static_cast<quint32>(MaxFrameSize)) {
+        m_error = QString("invalid frame length %1").arg(length);
+        return Result::Error;
+    }
+    if (available < 4 + static_cast<qsizetype>(length)) {
+        return Result::NeedMore;
+    }
+
+    const quint8 type = static_cast<quint8>(data[4]);
+    if (!knownType(type)) {
+        m_error = QString("unknown frame type %1").arg(type);
+        return Result::Error;
+    }
+    frame.type = static_cast<FrameType>(type);
+    frame.id = qFromBigEndian<quint32>(data + 5);
+    frame.payload = QByteArray(data + HeaderSize, length - (HeaderSize - 4));
+    m_offset += 4 + length;
+    return Result::Frame;
+}
+
+void FrameReader::clear()
+{
+    m_buffer.clear();
+    m_offset = 0;
+    m_error.clear();
+}
+
+QByteArray authResponse(const QByteArray& token, const QByteArray& nonce)
+{
+    return QMessageAuthenticationCode::hash(nonce, token, QCryptographicHash::Sha256);
+}
+
+bool equalConstantTime(const QByteArray& a, const QByteArray& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    char diff = 0;
+    for (qsizetype i = 0; i < a.size(); ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+quint16 statusWord(const QByteArray& response)
+{
+    if (response.size() < 2) {
+        return 0;
+    }
+    return static_cast<quint16>((static_cast<quint8>(response[response.size() - 2]) << 8)
+                                | static_cast<quint8>(response[response.size() - 1]));
+}
+
+bool parsePort(const QString& text, quint16& port)
+{
+    bool ok = false;
+    uint value = text.toUInt(&ok);
+    if (!ok || value == 0 || value > 65535) {
+        return false;
+    }
+    port = static_cast<quint16>(value);
+    return true;
+}
+
+bool parseAddress(const QString& spec, QString& host, quint16& port)
+{
+    QString portText;
+    if (spec.startsWith('[')) {
+        // Bracketed IPv6 literal, optionally followed by :port
+        int close = spec.indexOf(']');
+        if (close < 0) {
+            return false;
+        }
+        host = spec.mid(1, close - 1);
+        QString rest = spec.mid(close + 1);
+        if (!rest.isEmpty()) {
+            if (!rest.startsWith(':')) {
+                return false;
+            }
+            portText = rest.mid(1);
+        }
+    } else if (spec.count(':') == 1) {
+        int colon = spec.indexOf(':');
+        host = spec.left(colon);
+        portText = spec.mid(colon + 1);
+    } else {
+        // Host name, IPv4 address or bare IPv6 literal ("::1")
+        host = spec;
+    }
+
+    if (host.isEmpty()) {
+        return false;
+    }
+    port = DefaultPort;
+    return portText.isNull() || parsePort(portText, port);
+}
+
+} // namespace RemoteProtocol
+
+} // namespace StatusKeycard
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Wire format between RemoteReaderBackend (host) and RemoteReaderAgent
+ *
+ * Every frame is
+ *
+ *   [u32 length][u8 type][u32 id][payload]
+ *
+ * big-endian, where length counts type, id and payload. Requests carry an id
+ * chosen by the host, and the agent echoes it in the matching response, so
+ * several threads can have requests in flight on one connection. The agent
+ * runs requests in arrival order (a reader has one card), and events it
+ * sends on its own use id 0.
+ *
+ * An agent with a pre-shared token opens with Challenge instead of Hello.
+ * The host answers with Authenticate, HMAC-SHA256 keyed with the token over
+ * the challenge nonce, and only then gets Hello; any other frame, a wrong
+ * answer or none within AuthTimeoutMs drops the connection. The token never
+ * crosses the link, and a fresh nonce per connection stops replays. This
+ * authenticates the host only: the link stays unencrypted.
+ *
+ * Payloads:
+ *   Hello          version (u8), reader name (UTF-8)
+ *   Challenge      nonce (NonceSize bytes)
+ *   Authenticate   HMAC-SHA256(token, nonce)
+ *   Transmit       APDU
+ *   Response       card time in microseconds (u32), response APDU
+ *   CardInserted   card UID (UTF-8)
+ *   ReaderAvailability  available (u8)
+ *   everything else empty
+ */
+namespace RemoteProtocol {
+
+constexpr quint8 Version = 2;
+constexpr quint16 DefaultPort = 19790;
+constexpr int HeaderSize = 9;
+constexpr int MaxFrameSize = 1024 * 1024;
+constexpr int NonceSize = 32;
+constexpr int AuthTimeoutMs = 5000;
+
+enum class FrameType : quint8 {
+    // Agent to host
+    Hello = 1,
+    Response = 2,
+    CardInserted = 4,
+    CardRemoved = 5,
+    ReaderAvailability = 6,
+    Pong = 7,
+    Challenge = 8,
+
+    // Host to agent
+    Transmit = 16,
+    StartDetection = 18,
+    StopDetection = 19,
+    ForceScan = 20,
+    Disconnect = 21,
+    Ping = 22,
+    Authenticate = 23
+};
+
+struct Frame {
+    FrameType type = FrameType::Hello;
+    quint32 id = 0;
+    QByteArray payload;
+};
+
+QByteArray encodeFrame(FrameType type, quint32 id, const QByteArray& payload = QByteArray());
+
+/**
+ * @brief Incremental frame decoder for a byte stream
+ *
+ * Feed whatever the socket returned; next() yields complete frames. A frame
+ * longer than MaxFrameSize or of an unknown type is a protocol error and
+ * the connection should be dropped.
+ */
+class FrameReader {
+public:
+    enum class Result {
+        Frame,
+        NeedMore,
+        Error
+    };
+
+    void append(const QByteArray& data);
+    Result next(Frame& frame);
+    void clear();
+
+    QString errorString() const { return m_error; }
+
+private:
+    QByteArray m_buffer;
+    qsizetype m_offset = 0;
+    QString m_error;
+};
+
+// Authenticate payload for a Challenge nonce
+QByteArray authResponse(const QByteArray& token, const QByteArray& nonce);
+
+// Constant-time comparison, for authentication answers
+bool equalConstantTime(const QByteArray& a, const QByteArray& b);
+
+// Status word of a response APDU (0 if shorter than two bytes)
+quint16 statusWord(const QByteArray& response);
+
+// Decimal TCP port in 1..65535
+bool parsePort(const QString& text, quint16& port);
+
+/**
+ * @brief Split an agent address into host and port
+ *
+ * Accepts "host", "host:port", "[v6]" and "[v6]:port"; an unbracketed IPv6
+ * literal such as "::1" is all host. Without a port, DefaultPort is used.
+ * Fails on an empty host or a port that is not a number in 1..65535.
+ */
+bool parseAddress(const QString& spec, QString& host, quint16& port);
+
+} // namespace RemoteProtocol
+
+} // namespace StatusKeycard
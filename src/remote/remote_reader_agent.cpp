@@ -0,0 +1,275 @@
+#include "remote_reader_agent.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtEndian>
+
+namespace StatusKeycard {
+
+using RemoteProtocol::Frame;
+using RemoteProtocol::FrameReader;
+using RemoteProtocol::FrameType;
+
+namespace {
+
+QByteArray withCardTime(qint64 cardUs, const QByteArray& body)
+{
+    QByteArray payload;
+    payload.reserve(4 + body.size());
+    char bytes[4];
+    qToBigEndian(static_cast<quint32>(qBound<qint64>(0, cardUs, 0xFFFFFFFF)), bytes);
+    payload.append(bytes, 4);
+    payload.append(body);
+    return payload;
+}
+
+} // namespace
+
+RemoteReaderAgent::RemoteReaderAgent(Keycard::KeycardChannelBackend* backend, QObject* parent)
+    : QObject(parent)
+    , m_backend(backend)
+    , m_server(new QTcpServer(this))
+    , m_authenticated(false)
+    , m_readerAvailable(-1)
+    , m_clients(0)
+    , m_rejected(0)
+    , m_authFailures(0)
+    , m_requests(0)
+    , m_cardTimeUs(0)
+{
+    connect(m_server, &QTcpServer::newConnection, this, &RemoteReaderAgent::onNewConnection);
+
+    connect(m_backend, &Keycard::KeycardChannelBackend::targetDetected, this, [this](const QString& uid) {
+        m_cardUID = uid;
+        send(FrameType::CardInserted, 0, uid.toUtf8());
+    });
+    connect(m_backend, &Keycard::KeycardChannelBackend::cardRemoved, this, [this]() {
+        m_cardUID.clear();
+        send(FrameType::CardRemoved, 0);
+    });
+    connect(m_backend, &Keycard::KeycardChannelBackend::readerAvailabilityChanged, this, [this](bool available) {
+        m_readerAvailable = available ? 1 : 0;
+        if (!available) {
+            m_cardUID.clear();
+        }
+        send(FrameType::ReaderAvailability, 0, QByteArray(1, available ? 1 : 0));
+    });
+}
+
+RemoteReaderAgent::~RemoteReaderAgent()
+{
+    close();
+}
+
+void RemoteReaderAgent::setAuthToken(const QByteArray& token)
+{
+    m_authToken = token;
+}
+
+bool RemoteReaderAgent::listen(const QHostAddress& address, quint16 port)
+{
+    // Anyone who can reach the port could drive the card
+    if (m_authToken.isEmpty() && !address.isLoopback()) {
+        qWarning() << "RemoteReaderAgent: Refusing to listen on" << address.toString()
+                   << "without an auth token";
+        return false;
+    }
+    if (!m_server->listen(address, port)) {
+        qWarning() << "RemoteReaderAgent: Cannot listen on" << address.toString() << port
+                   << m_server->errorString();
+        return false;
+    }
+    qDebug() << "RemoteReaderAgent: Serving" << m_backend->backendName()
+             << "on" << address.toString() << m_server->serverPort()
+             << (m_authToken.isEmpty() ? "(no authentication)" : "(token required)");
+    return true;
+}
+
+void RemoteReaderAgent::close()
+{
+    m_server->close();
+    if (m_client) {
+        m_client->abort();
+    }
+}
+
+quint16 RemoteReaderAgent::port() const
+{
+    return m_server->serverPort();
+}
+
+QJsonObject RemoteReaderAgent::stats() const
+{
+    QJsonObject obj;
+    obj["reader"] = m_backend->backendName();
+    obj["clientConnected"] = hasClient();
+    obj["clients"] = static_cast<qint64>(m_clients);
+    obj["rejected"] = static_cast<qint64>(m_rejected);
+    obj["authFailures"] = static_cast<qint64>(m_authFailures);
+    obj["requests"] = static_cast<qint64>(m_requests);
+    obj["cardTimeUs"] = m_cardTimeUs;
+    return obj;
+}
+
+void RemoteReaderAgent::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        if (m_client) {
+            qWarning() << "RemoteReaderAgent: Refusing" << socket->peerAddress().toString()
+                       << "- reader already in use";
+            m_rejected++;
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        m_client = socket;
+        m_clients++;
+        m_reader.clear();
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(socket, &QTcpSocket::readyRead, this, &RemoteReaderAgent::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &RemoteReaderAgent::onClientDisconnected);
+
+        qDebug() << "RemoteReaderAgent: Host connected:" << socket->peerAddress().toString();
+
+        if (m_authToken.isEmpty()) {
+            m_authenticated = true;
+            greetClient();
+            continue;
+        }
+
+        // Nothing about the reader is sent before the host has answered
+        m_authenticated = false;
+        m_nonce = QByteArray(RemoteProtocol::NonceSize, 0);
+        QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(m_nonce.data()),
+                                              RemoteProtocol::NonceSize / 4);
+        send(FrameType::Challenge, 0, m_nonce);
+        QTimer::singleShot(RemoteProtocol::AuthTimeoutMs, socket, [this, socket]() {
+            if (socket == m_client && !m_authenticated) {
+                qWarning() << "RemoteReaderAgent: Host did not authenticate in time";
+                m_authFailures++;
+                socket->abort();
+            }
+        });
+    }
+}
+
+void RemoteReaderAgent::greetClient()
+{
+    QByteArray hello(1, static_cast<char>(RemoteProtocol::Version));
+    hello.append(m_backend->backendName().toUtf8());
+    send(FrameType::Hello, 0, hello);
+    if (m_readerAvailable >= 0) {
+        send(FrameType::ReaderAvailability, 0, QByteArray(1, static_cast<char>(m_readerAvailable)));
+    }
+    if (!m_cardUID.isEmpty()) {
+        send(FrameType::CardInserted, 0, m_cardUID.toUtf8());
+    }
+    emit clientConnected(QString("%1:%2").arg(m_client->peerAddress().toString()).arg(m_client->peerPort()));
+}
+
+void RemoteReaderAgent::onReadyRead()
+{
+    if (!m_client) {
+        return;
+    }
+    m_reader.append(m_client->readAll());
+    Frame frame;
+    for (;;) {
+        FrameReader::Result result = m_reader.next(frame);
+        if (result == FrameReader::Result::NeedMore) {
+            return;
+        }
+        if (result == FrameReader::Result::Error) {
+            qWarning() << "RemoteReaderAgent: Protocol error:" << m_reader.errorString();
+            m_client->abort();
+            return;
+        }
+        handleFrame(frame);
+        // The host may have gone away while a command was running
+        if (!m_client) {
+            return;
+        }
+    }
+}
+
+void RemoteReaderAgent::onClientDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || socket != m_client) {
+        return;
+    }
+    qDebug() << "RemoteReaderAgent: Host disconnected";
+    m_client = nullptr;
+    m_reader.clear();
+    m_authenticated = false;
+    m_nonce.clear();
+    socket->deleteLater();
+
+    // Leave the reader as an idle local reader would be
+    m_backend->stopDetection();
+    m_backend->disconnect();
+    emit clientDisconnected();
+}
+
+void RemoteReaderAgent::handleFrame(const Frame& frame)
+{
+    if (!m_authenticated) {
+        if (frame.type != FrameType::Authenticate
+            || !RemoteProtocol::equalConstantTime(frame.payload, RemoteProtocol::authResponse(m_authToken, m_nonce))) {
+            qWarning() << "RemoteReaderAgent: Host failed to authenticate";
+            m_authFailures++;
+            m_client->abort();
+            return;
+        }
+        m_authenticated = true;
+        m_nonce.clear();
+        greetClient();
+        return;
+    }
+
+    switch (frame.type) {
+    case FrameType::Transmit: {
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray response = m_backend->transmit(frame.payload);
+        qint64 cardUs = timer.nsecsElapsed() / 1000;
+        m_requests++;
+        m_cardTimeUs += cardUs;
+        send(FrameType::Response, frame.id, withCardTime(cardUs, response));
+        break;
+    }
+    case FrameType::StartDetection:
+        m_backend->startDetection();
+        break;
+    case FrameType::StopDetection:
+        m_backend->stopDetection();
+        break;
+    case FrameType::ForceScan:
+        m_backend->forceScan();
+        break;
+    case FrameType::Disconnect:
+        m_backend->disconnect();
+        break;
+    case FrameType::Ping:
+        send(FrameType::Pong, frame.id);
+        break;
+    default:
+        qWarning() << "RemoteReaderAgent: Unexpected frame type" << static_cast<int>(frame.type);
+        break;
+    }
+}
+
+void RemoteReaderAgent::send(FrameType type, quint32 id, const QByteArray& payload)
+{
+    // Until the host has authenticated, it only gets the challenge
+    if (m_client && m_client->state() == QAbstractSocket::ConnectedState
+        && (m_authenticated || type == FrameType::Challenge)) {
+        m_client->write(RemoteProtocol::encodeFrame(type, id, payload));
+    }
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "remote_protocol.h"
+#include <keycard-qt/backends/keycard_channel_backend.h>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+
+class QTcpServer;
+class QTcpSocket;
+
+namespace StatusKeycard {
+
+/**
+ * @brief Reader-side end of the remote reader bridge
+ *
+ * Serves one local KeycardChannelBackend (a PC/SC or NFC reader, or the
+ * virtual card farm) to a single RemoteReaderBackend over TCP. APDUs are
+ * run on the backend in the order they arrive, and the agent's card time is
+ * reported with each answer so the host can tell network latency from card
+ * latency. Card and reader events are forwarded as they happen, and the
+ * current card is reported to a host as soon as it connects.
+ *
+ * A reader serves one session at a time: a second host is refused while
+ * one is connected. With an auth token set, a host must answer the
+ * connection's challenge before it is served (see RemoteProtocol); without
+ * one, the agent only listens on a loopback address. Lives on the thread
+ * that created it; transmit() on the backend blocks that thread for the
+ * duration of each command.
+ */
+class RemoteReaderAgent : public QObject {
+    Q_OBJECT
+
+public:
+    explicit RemoteReaderAgent(Keycard::KeycardChannelBackend* backend, QObject* parent = nullptr);
+    ~RemoteReaderAgent() override;
+
+    /**
+     * @brief Require hosts to prove they know this pre-shared token
+     *
+     * Takes effect for the next host to connect. An empty token turns
+     * authentication off.
+     */
+    void setAuthToken(const QByteArray& token);
+
+    /**
+     * @brief Start accepting a host
+     *
+     * Fails for an address other than loopback while no auth token is set.
+     *
+     * @param port 0 picks a free port (see port())
+     */
+    bool listen(const QHostAddress& address = QHostAddress::LocalHost,
+                quint16 port = RemoteProtocol::DefaultPort);
+    void close();
+    quint16 port() const;
+
+    bool hasClient() const { return !m_client.isNull(); }
+
+    /**
+     * @brief Served requests, card time, connected hosts and failed logins
+     */
+    QJsonObject stats() const;
+
+signals:
+    void clientConnected(const QString& peer);
+    void clientDisconnected();
+
+private:
+    void onNewConnection();
+    void onReadyRead();
+    void onClientDisconnected();
+    void greetClient();
+    void handleFrame(const RemoteProtocol::Frame& frame);
+    void send(RemoteProtocol::FrameType type, quint32 id, const QByteArray& payload = QByteArray());
+
+    Keycard::KeycardChannelBackend* m_backend;
+    QTcpServer* m_server;
+    QPointer<QTcpSocket> m_client;
+    RemoteProtocol::FrameReader m_reader;
+    QByteArray m_authToken;
+    QByteArray m_nonce;          // Challenge of the current host
+    bool m_authenticated;        // Current host answered it (or none was needed)
+
+    // Last known reader state, replayed to a newly connected host
+    QString m_cardUID;
+    int m_readerAvailable;  // -1 until the backend reports it
+
+    // Counters
+    quint64 m_clients;
+    quint64 m_rejected;
+    quint64 m_authFailures;
+    quint64 m_requests;
+    qint64 m_cardTimeUs;
+};
+
+} // namespace StatusKeycard
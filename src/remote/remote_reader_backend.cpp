@@ -0,0 +1,498 @@
+#include "remote_reader_backend.h"
+#include "../flight_recorder.h"
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+
+namespace StatusKeycard {
+
+using RemoteProtocol::Frame;
+using RemoteProtocol::FrameReader;
+using RemoteProtocol::FrameType;
+
+void RemoteReaderBackend::Latency::record(qint64 us)
+{
+    count++;
+    totalUs += us;
+    minUs = minUs < 0 ? us : qMin(minUs, us);
+    maxUs = qMax(maxUs, us);
+    lastUs = us;
+}
+
+QJsonObject RemoteReaderBackend::Latency::toJson() const
+{
+    QJsonObject obj;
+    obj["count"] = static_cast<qint64>(count);
+    obj["avgUs"] = count > 0 ? totalUs / static_cast<qint64>(count) : 0;
+    obj["minUs"] = qMax<qint64>(minUs, 0);
+    obj["maxUs"] = maxUs;
+    obj["lastUs"] = lastUs;
+    return obj;
+}
+
+RemoteReaderBackend::RemoteReaderBackend(const QString& host, quint16 port, QObject* parent)
+    : RemoteReaderBackend(host, port, Options(), parent)
+{
+}
+
+RemoteReaderBackend::RemoteReaderBackend(const QString& host, quint16 port, const Options& options, QObject* parent)
+    : KeycardChannelBackend(parent)
+    , m_host(host)
+    , m_port(port)
+    , m_options(options)
+    , m_thread(new QThread())
+    , m_context(new QObject())
+    , m_socket(nullptr)
+    , m_reconnectTimer(nullptr)
+    , m_pingTimer(nullptr)
+    , m_nextId(1)
+    , m_stopping(false)
+    , m_detecting(false)
+    , m_linkUp(false)
+    , m_cardPresent(false)
+    , m_channelState(Keycard::ChannelState::Idle)
+    , m_requests(0)
+    , m_failures(0)
+    , m_timeouts(0)
+    , m_connects(0)
+{
+    m_thread->setObjectName(QStringLiteral("RemoteReaderBackend"));
+    m_context->moveToThread(m_thread);
+    m_thread->start();
+
+    // The socket and timers are created and used on the I/O thread only
+    QMetaObject::invokeMethod(m_context, [this]() {
+        m_socket = new QTcpSocket(m_context);
+        QObject::connect(m_socket, &QTcpSocket::connected, m_context, [this]() {
+            m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        });
+        QObject::connect(m_socket, &QTcpSocket::readyRead, m_context, [this]() { onReadyRead(); });
+        QObject::connect(m_socket, &QTcpSocket::disconnected, m_context, [this]() { onDisconnected(); });
+        QObject::connect(m_socket, &QTcpSocket::errorOccurred, m_context, [this](QAbstractSocket::SocketError) {
+            if (m_socket->state() == QAbstractSocket::UnconnectedState) {
+                qDebug() << "RemoteReaderBackend: Cannot reach agent:" << m_socket->errorString();
+                onDisconnected();
+            }
+        });
+
+        m_reconnectTimer = new QTimer(m_context);
+        m_reconnectTimer->setSingleShot(true);
+        m_reconnectTimer->setInterval(m_options.reconnectIntervalMs);
+        QObject::connect(m_reconnectTimer, &QTimer::timeout, m_context, [this]() { connectToAgent(); });
+
+        m_pingTimer = new QTimer(m_context);
+        m_pingTimer->setInterval(m_options.pingIntervalMs);
+        QObject::connect(m_pingTimer, &QTimer::timeout, m_context, [this]() {
+            quint32 id = nextId();
+            {
+                QMutexLocker locker(&m_mutex);
+                if (!m_linkUp) {
+                    return;
+                }
+                m_probes.insert(id, FlightRecorder::nowNs());
+            }
+            m_socket->write(RemoteProtocol::encodeFrame(FrameType::Ping, id));
+        });
+
+        connectToAgent();
+    }, Qt::BlockingQueuedConnection);
+}
+
+RemoteReaderBackend::~RemoteReaderBackend()
+{
+    m_stopping = true;
+    QMetaObject::invokeMethod(m_context, [this]() {
+        m_reconnectTimer->stop();
+        m_pingTimer->stop();
+        m_socket->abort();
+    }, Qt::BlockingQueuedConnection);
+    failPending();
+
+    m_thread->quit();
+    m_thread->wait();
+    delete m_context;
+    delete m_thread;
+}
+
+// ============================================================================
+// I/O thread
+// ============================================================================
+
+void RemoteReaderBackend::connectToAgent()
+{
+    if (m_stopping) {
+        return;
+    }
+    m_reader.clear();
+    m_socket->abort();
+    m_socket->connectToHost(m_host, m_port);
+}
+
+void RemoteReaderBackend::onReadyRead()
+{
+    m_reader.append(m_socket->readAll());
+    Frame frame;
+    for (;;) {
+        FrameReader::Result result = m_reader.next(frame);
+        if (result == FrameReader::Result::NeedMore) {
+            return;
+        }
+        if (result == FrameReader::Result::Error) {
+            qWarning() << "RemoteReaderBackend: Protocol error:" << m_reader.errorString();
+            m_socket->abort();
+            onDisconnected();
+            return;
+        }
+        handleFrame(frame);
+    }
+}
+
+void RemoteReaderBackend::onDisconnected()
+{
+    bool wasUp;
+    bool hadCard;
+    {
+        QMutexLocker locker(&m_mutex);
+        wasUp = m_linkUp;
+        hadCard = m_cardPresent;
+        m_linkUp = false;
+        m_cardPresent = false;
+    }
+    failPending();
+    m_pingTimer->stop();
+    if (m_stopping) {
+        return;
+    }
+
+    if (wasUp) {
+        qWarning() << "RemoteReaderBackend: Link to" << m_host << m_port << "lost";
+        if (hadCard) {
+            emitRemoved();
+        }
+        emitReaderAvailability(false);
+    }
+    m_reconnectTimer->start();
+}
+
+void RemoteReaderBackend::handleFrame(const Frame& frame)
+{
+    switch (frame.type) {
+    case FrameType::Challenge:
+        if (m_options.authToken.isEmpty()) {
+            qWarning() << "RemoteReaderBackend: Agent requires an auth token and none is set";
+            m_socket->abort();
+            onDisconnected();
+            return;
+        }
+        m_socket->write(RemoteProtocol::encodeFrame(FrameType::Authenticate, 0,
+                                                    RemoteProtocol::authResponse(m_options.authToken, frame.payload)));
+        break;
+    case FrameType::Hello: {
+        if (frame.payload.isEmpty() || static_cast<quint8>(frame.payload[0]) != RemoteProtocol::Version) {
+            qWarning() << "RemoteReaderBackend: Unsupported agent protocol version";
+            m_socket->abort();
+            onDisconnected();
+            return;
+        }
+        QString readerName = QString::fromUtf8(frame.payload.mid(1));
+        {
+            QMutexLocker locker(&m_mutex);
+            m_linkUp = true;
+            m_readerName = readerName;
+            m_connects++;
+            m_responded.wakeAll();
+        }
+        qDebug() << "RemoteReaderBackend: Connected to" << readerName << "at" << m_host << m_port;
+        if (m_options.pingIntervalMs > 0) {
+            m_pingTimer->start();
+        }
+        if (m_detecting) {
+            m_socket->write(RemoteProtocol::encodeFrame(FrameType::StartDetection, 0));
+        }
+        break;
+    }
+    case FrameType::Response:
+    case FrameType::Pong:
+        completeRequest(frame);
+        break;
+    case FrameType::CardInserted: {
+        QMutexLocker locker(&m_mutex);
+        m_cardPresent = true;
+        locker.unlock();
+        emitInserted(QString::fromUtf8(frame.payload));
+        break;
+    }
+    case FrameType::CardRemoved: {
+        QMutexLocker locker(&m_mutex);
+        m_cardPresent = false;
+        locker.unlock();
+        emitRemoved();
+        break;
+    }
+    case FrameType::ReaderAvailability: {
+        bool available = !frame.payload.isEmpty() && frame.payload[0] != 0;
+        if (!available) {
+            QMutexLocker locker(&m_mutex);
+            m_cardPresent = false;
+        }
+        emitReaderAvailability(available);
+        break;
+    }
+    default:
+        qWarning() << "RemoteReaderBackend: Unexpected frame type" << static_cast<int>(frame.type);
+        break;
+    }
+}
+
+void RemoteReaderBackend::completeRequest(const Frame& frame)
+{
+    const qint64 nowNs = FlightRecorder::nowNs();
+    QMutexLocker locker(&m_mutex);
+
+    if (frame.type == FrameType::Pong && m_probes.contains(frame.id)) {
+        m_rtt.record((nowNs - m_probes.take(frame.id)) / 1000);
+        return;
+    }
+
+    auto it = m_pending.find(frame.id);
+    if (it == m_pending.end()) {
+        // Caller gave up (timeout) before the answer arrived
+        qDebug() << "RemoteReaderBackend: Late answer for request" << frame.id;
+        return;
+    }
+
+    Pending& pending = *it;
+    const qint64 elapsedUs = (nowNs - pending.sentNs) / 1000;
+    if (frame.type == FrameType::Pong) {
+        m_rtt.record(elapsedUs);
+    } else {
+        if (frame.payload.size() < 4) {
+            pending.failed = true;
+        } else {
+            pending.cardUs = qFromBigEndian<quint32>(frame.payload.constData());
+            pending.response = frame.payload.mid(4);
+        }
+        m_latency.record(elapsedUs);
+        m_latencyHistogram.record(elapsedUs / 1000);
+        m_cardTime.record(pending.cardUs);
+    }
+    pending.done = true;
+    m_responded.wakeAll();
+}
+
+void RemoteReaderBackend::failPending()
+{
+    QMutexLocker locker(&m_mutex);
+    for (Pending& pending : m_pending) {
+        if (!pending.done) {
+            pending.done = true;
+            pending.failed = true;
+        }
+    }
+    m_probes.clear();
+    m_responded.wakeAll();
+}
+
+// ============================================================================
+// Requests
+// ============================================================================
+
+quint32 RemoteReaderBackend::nextId()
+{
+    quint32 id = m_nextId.fetch_add(1, std::memory_order_relaxed);
+    // 0 is reserved for agent events
+    return id != 0 ? id : m_nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RemoteReaderBackend::send(const QByteArray& frames)
+{
+    QMetaObject::invokeMethod(m_context, [this, frames]() {
+        if (m_socket->state() == QAbstractSocket::ConnectedState) {
+            m_socket->write(frames);
+        }
+    }, Qt::QueuedConnection);
+}
+
+bool RemoteReaderBackend::sendAndWait(quint32 id, const QByteArray& frame, Pending& result)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_linkUp) {
+            m_failures++;
+            return false;
+        }
+        Pending pending;
+        pending.sentNs = FlightRecorder::nowNs();
+        m_pending.insert(id, pending);
+    }
+
+    send(frame);
+
+    QDeadlineTimer deadline(m_options.transmitTimeoutMs);
+    QMutexLocker locker(&m_mutex);
+    while (!m_pending.constFind(id)->done) {
+        if (!m_responded.wait(&m_mutex, deadline)) {
+            break;
+        }
+    }
+    result = m_pending.take(id);
+    if (!result.done) {
+        qWarning() << "RemoteReaderBackend: Request" << id << "timed out";
+        m_timeouts++;
+    }
+    if (!result.done || result.failed) {
+        m_failures++;
+        return false;
+    }
+    return true;
+}
+
+QByteArray RemoteReaderBackend::transmit(const QByteArray& apdu)
+{
+    const qint64 startNs = FlightRecorder::nowNs();
+    const quint32 id = nextId();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_requests++;
+    }
+
+    Pending result;
+    QByteArray response;
+    if (sendAndWait(id, RemoteProtocol::encodeFrame(FrameType::Transmit, id, apdu), result)) {
+        response = result.response;
+    }
+
+    quint8 ins = apdu.size() > 1 ? static_cast<quint8>(apdu[1]) : 0;
+    FlightRecorder::instance()->record(FlightRecorder::Event::Apdu, ins, RemoteProtocol::statusWord(response),
+                                       (FlightRecorder::nowNs() - startNs) / 1000);
+    return response;
+}
+
+qint64 RemoteReaderBackend::ping()
+{
+    const qint64 startNs = FlightRecorder::nowNs();
+    const quint32 id = nextId();
+    Pending result;
+    if (!sendAndWait(id, RemoteProtocol::encodeFrame(FrameType::Ping, id), result)) {
+        return -1;
+    }
+    return (FlightRecorder::nowNs() - startNs) / 1000;
+}
+
+bool RemoteReaderBackend::waitForConnected(int timeoutMs)
+{
+    QDeadlineTimer deadline(timeoutMs);
+    QMutexLocker locker(&m_mutex);
+    while (!m_linkUp) {
+        if (!m_responded.wait(&m_mutex, deadline)) {
+            return m_linkUp;
+        }
+    }
+    return true;
+}
+
+bool RemoteReaderBackend::isLinkUp() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_linkUp;
+}
+
+QJsonObject RemoteReaderBackend::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonObject obj;
+    obj["host"] = m_host;
+    obj["port"] = m_port;
+    obj["linkUp"] = m_linkUp;
+    obj["reader"] = m_readerName;
+    obj["cardPresent"] = m_cardPresent;
+    obj["connects"] = static_cast<qint64>(m_connects);
+    obj["requests"] = static_cast<qint64>(m_requests);
+    obj["failures"] = static_cast<qint64>(m_failures);
+    obj["timeouts"] = static_cast<qint64>(m_timeouts);
+    obj["inFlight"] = m_pending.size();
+    obj["latency"] = m_latency.toJson();
+    obj["latencyHistogram"] = m_latencyHistogram.toJson();
+    obj["cardTime"] = m_cardTime.toJson();
+    obj["rtt"] = m_rtt.toJson();
+    return obj;
+}
+
+// ============================================================================
+// KeycardChannelBackend interface
+// ============================================================================
+
+bool RemoteReaderBackend::isConnected() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_linkUp && m_cardPresent;
+}
+
+void RemoteReaderBackend::startDetection()
+{
+    m_detecting = true;
+    send(RemoteProtocol::encodeFrame(FrameType::StartDetection, 0));
+}
+
+void RemoteReaderBackend::stopDetection()
+{
+    m_detecting = false;
+    send(RemoteProtocol::encodeFrame(FrameType::StopDetection, 0));
+}
+
+void RemoteReaderBackend::disconnect()
+{
+    // Drops the card connection on the agent; the link stays up
+    send(RemoteProtocol::encodeFrame(FrameType::Disconnect, 0));
+}
+
+QString RemoteReaderBackend::backendName() const
+{
+    return QString("Remote Reader (%1:%2)").arg(m_host).arg(m_port);
+}
+
+void RemoteReaderBackend::setState(Keycard::ChannelState state)
+{
+    QMutexLocker locker(&m_mutex);
+    m_channelState = state;
+}
+
+Keycard::ChannelState RemoteReaderBackend::state() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_channelState;
+}
+
+void RemoteReaderBackend::forceScan()
+{
+    send(RemoteProtocol::encodeFrame(FrameType::ForceScan, 0));
+}
+
+void RemoteReaderBackend::emitInserted(const QString& uid)
+{
+    QMetaObject::invokeMethod(this, [this, uid]() {
+        qDebug() << "RemoteReaderBackend: Card inserted:" << uid;
+        emit targetDetected(uid);
+    }, Qt::QueuedConnection);
+}
+
+void RemoteReaderBackend::emitRemoved()
+{
+    QMetaObject::invokeMethod(this, [this]() {
+        qDebug() << "RemoteReaderBackend: Card removed";
+        emit cardRemoved();
+    }, Qt::QueuedConnection);
+}
+
+void RemoteReaderBackend::emitReaderAvailability(bool available)
+{
+    QMetaObject::invokeMethod(this, [this, available]() {
+        qDebug() << "RemoteReaderBackend: Reader available:" << available;
+        emit readerAvailabilityChanged(available);
+    }, Qt::QueuedConnection);
+}
+
+} // namespace StatusKeycard
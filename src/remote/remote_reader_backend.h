@@ -0,0 +1,151 @@
+#pragma once
+
+#include "remote_protocol.h"
+#include "../flow/flow_stats.h"
+#include <keycard-qt/backends/keycard_channel_backend.h>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+class QThread;
+class QTcpSocket;
+class QTimer;
+
+namespace StatusKeycard {
+
+/**
+ * @brief KeycardChannelBackend for a reader attached to a RemoteReaderAgent
+ *
+ * APDUs and card events are tunnelled over TCP to an agent running on the
+ * machine with the physical reader, so card sessions can run on a
+ * different host. The socket lives on a private I/O thread. transmit()
+ * blocks the calling thread until the agent answers, and several threads
+ * may have requests in flight at the same time.
+ *
+ * When the agent requires a pre-shared token, Options::authToken answers
+ * its challenge; without the right token the link never comes up.
+ * Secure-channel traffic is end-to-end encrypted between this host and the
+ * card, but the link itself is not, so an agent on another machine should
+ * still be reached over a trusted network or a tunnel.
+ *
+ * Reconnects automatically. While the link is down, transmit() fails at
+ * once and the reader is reported unavailable.
+ */
+class RemoteReaderBackend : public Keycard::KeycardChannelBackend {
+    Q_OBJECT
+
+public:
+    struct Options {
+        int transmitTimeoutMs = 30000;   // Key generation and signing take seconds
+        int reconnectIntervalMs = 2000;
+        int pingIntervalMs = 5000;       // 0 disables RTT probes
+        QByteArray authToken;            // Pre-shared with the agent, if it requires one
+    };
+
+    RemoteReaderBackend(const QString& host, quint16 port, QObject* parent = nullptr);
+    RemoteReaderBackend(const QString& host, quint16 port, const Options& options, QObject* parent = nullptr);
+    ~RemoteReaderBackend() override;
+
+    /**
+     * @brief Wait until the agent has greeted this host
+     */
+    bool waitForConnected(int timeoutMs);
+    bool isLinkUp() const;
+
+    /**
+     * @brief Measure the link round trip now
+     * @return RTT in microseconds, -1 on failure
+     */
+    qint64 ping();
+
+    /**
+     * @brief Link and latency counters (requests, failures, RTT, card time)
+     */
+    QJsonObject stats() const;
+
+    // KeycardChannelBackend interface
+    QByteArray transmit(const QByteArray& apdu) override;
+    bool isConnected() const override;
+    void startDetection() override;
+    void stopDetection() override;
+    void disconnect() override;
+    QString backendName() const override;
+    void setState(Keycard::ChannelState state) override;
+    Keycard::ChannelState state() const override;
+    void forceScan() override;
+
+private:
+    struct Pending {
+        qint64 sentNs = 0;
+        bool done = false;
+        bool failed = false;
+        quint32 cardUs = 0;
+        QByteArray response;
+    };
+
+    struct Latency {
+        quint64 count = 0;
+        qint64 totalUs = 0;
+        qint64 minUs = -1;
+        qint64 maxUs = 0;
+        qint64 lastUs = 0;
+
+        void record(qint64 us);
+        QJsonObject toJson() const;
+    };
+
+    // I/O thread
+    void connectToAgent();
+    void onReadyRead();
+    void onDisconnected();
+    void handleFrame(const RemoteProtocol::Frame& frame);
+    void completeRequest(const RemoteProtocol::Frame& frame);
+    void failPending();
+
+    // Caller threads: register the id, write the frame, wait for the answer
+    bool sendAndWait(quint32 id, const QByteArray& frame, Pending& result);
+    void send(const QByteArray& frames);
+    quint32 nextId();
+
+    // Queue a backend signal onto the backend's thread
+    void emitInserted(const QString& uid);
+    void emitRemoved();
+    void emitReaderAvailability(bool available);
+
+    const QString m_host;
+    const quint16 m_port;
+    const Options m_options;
+
+    QThread* m_thread;
+    QObject* m_context;            // Lives on m_thread; parent of the socket and timers
+    QTcpSocket* m_socket;
+    QTimer* m_reconnectTimer;
+    QTimer* m_pingTimer;
+    RemoteProtocol::FrameReader m_reader;
+    std::atomic<quint32> m_nextId;
+    std::atomic<bool> m_stopping;
+    std::atomic<bool> m_detecting;  // Replayed to the agent after a reconnect
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_responded;
+    QHash<quint32, Pending> m_pending;
+    QHash<quint32, qint64> m_probes;  // Background pings: id -> sent (ns)
+    bool m_linkUp;
+    bool m_cardPresent;
+    QString m_readerName;
+    Keycard::ChannelState m_channelState;
+
+    // Counters (m_mutex)
+    quint64 m_requests;
+    quint64 m_failures;
+    quint64 m_timeouts;
+    quint64 m_connects;
+    FlowStats::Histogram m_latencyHistogram;
+    Latency m_latency;     // Request written to answer read
+    Latency m_cardTime;    // Reported by the agent
+    Latency m_rtt;         // Ping round trips
+};
+
+} // namespace StatusKeycard
@@ -0,0 +1,273 @@
+#include "request_decoder.h"
+#include "flow/flow_params.h"
+#include "hex_codec.h"
+#include <QJsonDocument>
+#include <array>
+
+namespace StatusKeycard {
+
+namespace {
+
+constexpr int MaxDepth = 64;
+
+// Minimal JSON scanner over the raw payload. It only needs to find value
+// boundaries; anything it does not understand makes the caller fall back
+// to QJsonDocument.
+class Scanner {
+public:
+    Scanner(const char* begin, const char* end) : m_pos(begin), m_end(end) {}
+
+    const char* pos() const { return m_pos; }
+    bool atEnd() const { return m_pos >= m_end; }
+
+    void skipWhitespace()
+    {
+        while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t')) {
+            ++m_pos;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skipWhitespace();
+        if (m_pos < m_end && *m_pos == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(char c)
+    {
+        skipWhitespace();
+        return m_pos < m_end && *m_pos == c;
+    }
+
+    // String contents without quotes; escaped is set if it contains escapes
+    bool readString(const char*& begin, const char*& end, bool& escaped)
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        begin = m_pos;
+        escaped = false;
+        while (m_pos < m_end) {
+            char c = *m_pos;
+            if (c == '"') {
+                end = m_pos++;
+                return true;
+            }
+            if (c == '\\') {
+                // A backslash needs a character after it
+                if (m_end - m_pos < 2) {
+                    m_pos = m_end;
+                    return false;
+                }
+                escaped = true;
+                m_pos += 2;
+                continue;
+            }
+            ++m_pos;
+        }
+        return false;
+    }
+
+    bool skipValue(int depth = 0)
+    {
+        if (depth > MaxDepth) {
+            return false;
+        }
+        skipWhitespace();
+        if (atEnd()) {
+            return false;
+        }
+
+        const char* begin;
+        const char* end;
+        bool escaped;
+        switch (*m_pos) {
+        case '"':
+            return readString(begin, end, escaped);
+        case '{':
+            ++m_pos;
+            if (consume('}')) {
+                return true;
+            }
+            do {
+                if (!readString(begin, end, escaped) || !consume(':') || !skipValue(depth + 1)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        case '[':
+            ++m_pos;
+            if (consume(']')) {
+                return true;
+            }
+            do {
+                if (!skipValue(depth + 1)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        default: {
+            // Number or literal
+            const char* start = m_pos;
+            while (m_pos < m_end && *m_pos != ',' && *m_pos != '}' && *m_pos != ']'
+                   && *m_pos != ' ' && *m_pos != '\n' && *m_pos != '\r' && *m_pos != '\t') {
+                ++m_pos;
+            }
+            return m_pos > start;
+        }
+        }
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+};
+
+// Unescape the few sequences a path can reasonably contain
+bool unescapePath(const char* begin, const char* end, QString& path)
+{
+    QByteArray bytes;
+    bytes.reserve(static_cast<int>(end - begin));
+    for (const char* p = begin; p < end; ++p) {
+        if (*p != '\\') {
+            bytes.append(*p);
+            continue;
+        }
+        if (++p >= end || (*p != '/' && *p != '\\' && *p != '"')) {
+            return false;
+        }
+        bytes.append(*p);
+    }
+    path = QString::fromUtf8(bytes);
+    return true;
+}
+
+} // namespace
+
+bool RequestBatch::decodeHash(const char* hex, qsizetype size, char* out)
+{
+    qsizetype digits = size >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X') ? size - 2 : size;
+    if (digits != HashSize * 2) {
+        return false;
+    }
+    return HexCodec::decode(hex, size, out) == HashSize;
+}
+
+bool RequestBatch::decodeHash(QStringView hex, QByteArray& out)
+{
+    qsizetype digits = hex.startsWith(QLatin1String("0x"), Qt::CaseInsensitive) ? hex.size() - 2 : hex.size();
+    if (digits != HashSize * 2) {
+        out.clear();
+        return false;
+    }
+    return HexCodec::fromHex(hex, out);
+}
+
+RequestDecoder::Result RequestDecoder::decodeFlowParams(FlowType flowType, const QByteArray& json,
+                                                        QJsonObject& params, std::shared_ptr<RequestBatch>& batch)
+{
+    if (flowType != FlowType::Sign || json.size() < LargePayloadBytes) {
+        return Result::Fallback;
+    }
+
+    Scanner scanner(json.constData(), json.constData() + json.size());
+    if (!scanner.consume('{')) {
+        return Result::Fallback;
+    }
+
+    auto decoded = std::make_shared<RequestBatch>();
+    QByteArray rest;
+    rest.reserve(1024);
+    rest.append('{');
+
+    if (!scanner.peek('}')) {
+        do {
+            scanner.skipWhitespace();
+            const char* memberStart = scanner.pos();
+
+            const char* keyBegin;
+            const char* keyEnd;
+            bool keyEscaped;
+            if (!scanner.readString(keyBegin, keyEnd, keyEscaped) || !scanner.consume(':')) {
+                return Result::Fallback;
+            }
+            QLatin1String key(keyBegin, static_cast<int>(keyEnd - keyBegin));
+
+            bool isHashes = !keyEscaped && key == FlowParams::TX_HASH;
+            bool isPaths = !keyEscaped && key == FlowParams::BIP44_PATH;
+
+            if ((isHashes || isPaths) && scanner.consume('[')) {
+                if (isHashes) {
+                    // Rough upper bound: 64 hex chars + quotes + comma per hash
+                    decoded->hashes.reserve(static_cast<int>(json.size() / 67 + 1) * RequestBatch::HashSize);
+                    decoded->hashCount = 0;
+                } else {
+                    decoded->hasPaths = true;
+                }
+
+                if (!scanner.consume(']')) {
+                    do {
+                        const char* begin;
+                        const char* end;
+                        bool escaped;
+                        if (!scanner.readString(begin, end, escaped)) {
+                            return Result::Fallback;
+                        }
+                        if (isHashes) {
+                            // SignFlow reports the bad entry from the DOM
+                            char hash[RequestBatch::HashSize];
+                            if (escaped || !RequestBatch::decodeHash(begin, end - begin, hash)) {
+                                return Result::Fallback;
+                            }
+                            decoded->hashes.append(hash, RequestBatch::HashSize);
+                            decoded->hashCount++;
+                        } else {
+                            QString path;
+                            if (!escaped) {
+                                path = QString::fromUtf8(begin, static_cast<int>(end - begin));
+                            } else if (!unescapePath(begin, end, path)) {
+                                return Result::Fallback;
+                            }
+                            decoded->paths.append(path);
+                        }
+                    } while (scanner.consume(','));
+
+                    if (!scanner.consume(']')) {
+                        return Result::Fallback;
+                    }
+                }
+                continue;
+            }
+
+            // Anything else is copied verbatim for QJsonDocument
+            if (!scanner.skipValue()) {
+                return Result::Fallback;
+            }
+            if (rest.size() > 1) {
+                rest.append(',');
+            }
+            rest.append(memberStart, static_cast<int>(scanner.pos() - memberStart));
+        } while (scanner.consume(','));
+    }
+
+    if (!scanner.consume('}')) {
+        return Result::Fallback;
+    }
+    rest.append('}');
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(rest, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        return Result::Fallback;
+    }
+
+    params = doc.object();
+    batch = (decoded->hasHashes() || decoded->hasPaths) ? decoded : nullptr;
+    return Result::Decoded;
+}
+
+} // namespace StatusKeycard
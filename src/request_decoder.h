@@ -0,0 +1,70 @@
+#pragma once
+
+#include "flow/flow_types.h"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <memory>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Batch arrays decoded straight from a request payload
+ *
+ * Hashes are stored back to back (32 bytes each) in one buffer; paths keep
+ * their string form.
+ */
+struct RequestBatch {
+    static constexpr int HashSize = 32;
+
+    QByteArray hashes;
+    int hashCount = -1;   // -1 when the payload had no hash array
+    QStringList paths;
+    bool hasPaths = false;
+
+    bool hasHashes() const { return hashCount >= 0; }
+    QByteArray hash(int i) const { return hashes.mid(i * HashSize, HashSize); }
+
+    /**
+     * @brief Decode one tx-hash entry: 64 hex digits, optional 0x prefix
+     *
+     * The only form SignFlow accepts, whether the payload went through
+     * RequestDecoder or QJsonDocument. out must hold HashSize bytes.
+     */
+    static bool decodeHash(const char* hex, qsizetype size, char* out);
+    static bool decodeHash(QStringView hex, QByteArray& out);
+};
+
+/**
+ * @brief Single-pass decoder for large flow request payloads
+ *
+ * Scans the top-level JSON object once. Arrays under the batch keys
+ * (tx-hash, bip44-path) are decoded directly into a RequestBatch, with hex
+ * and length validation in the same pass; all other members are copied
+ * verbatim and parsed with QJsonDocument, which is cheap once the bulk is
+ * gone. Payloads below LargePayloadBytes are parsed with QJsonDocument only.
+ *
+ * The decoder never rejects a request: an entry it cannot decode (a hash
+ * that RequestBatch::decodeHash() refuses, a non-string element, escapes)
+ * makes it fall back, so SignFlow applies the same checks and reports the
+ * same error for every payload size.
+ *
+ * Only SignFlow reads the batch; for every other flow type the arrays must
+ * stay in params, so those payloads always fall back.
+ */
+class RequestDecoder {
+public:
+    static constexpr int LargePayloadBytes = 4096;
+
+    enum class Result {
+        Decoded,   // params/batch filled
+        Fallback   // Not handled here (not a sign flow, small, unusual syntax or values); use QJsonDocument
+    };
+
+    static Result decodeFlowParams(FlowType flowType, const QByteArray& json, QJsonObject& params,
+                                   std::shared_ptr<RequestBatch>& batch);
+};
+
+} // namespace StatusKeycard
@@ -1,10 +1,14 @@
 #include "rpc_service.h"
 #include "../session/session_manager.h"
 #include "../storage/file_pairing_storage.h"
+#include "../flow/flow_manager.h"
+#include "../flight_recorder.h"
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
 
 namespace StatusKeycard {
 
@@ -53,6 +57,10 @@ QString RpcService::processRequest(const QString& requestJson) {
         params = paramsValue.toObject();
     }
     
+    FlightRecorder* recorder = FlightRecorder::instance();
+    recorder->record(FlightRecorder::Event::RpcStart, 0, 0, 0, method);
+    const qint64 startNs = FlightRecorder::nowNs();
+
     // Route to handler
     QJsonObject response;
     
@@ -86,9 +94,27 @@ QString RpcService::processRequest(const QString& requestJson) {
         response = handleExportLoginKeys(id, params);
     } else if (method == "keycard.ExportRecoverKeys") {
         response = handleExportRecoverKeys(id, params);
+    } else if (method == "keycard.ExportKeys") {
+        response = handleExportKeys(id, params);
+    } else if (method == "keycard.ListPairings") {
+        response = handleListPairings(id, params);
+    } else if (method == "keycard.SetPairingSlotPolicy") {
+        response = handleSetPairingSlotPolicy(id, params);
+    } else if (method == "keycard.GetFlowStats") {
+        response = handleGetFlowStats(id, params);
+    } else if (method == "keycard.GetSessionStats") {
+        response = handleGetSessionStats(id, params);
+    } else if (method == "keycard.ExplainPlan") {
+        response = handleExplainPlan(id, params);
+    } else if (method == "keycard.DumpFlightRecorder") {
+        response = handleDumpFlightRecorder(id, params);
     } else {
         response = createErrorResponse(id, -32601, QString("Method not found: %1").arg(method));
     }
+
+    int errorCode = response["error"].toObject()["code"].toInt();
+    recorder->record(FlightRecorder::Event::RpcEnd, 0, static_cast<quint16>(errorCode),
+                     (FlightRecorder::nowNs() - startNs) / 1000, method);
     
     return QJsonDocument(response).toJson(QJsonDocument::Compact);
 }
@@ -178,6 +204,7 @@ QJsonObject RpcService::handleStart(const QString& id, const QJsonObject& params
     QString storagePath = params["storageFilePath"].toString();
     bool logEnabled = params["logEnabled"].toBool(false);
     QString logFilePath = params["logFilePath"].toString();
+    bool lazySecureChannel = params["lazySecureChannel"].toBool(false);
     
     if (storagePath.isEmpty()) {
         return createErrorResponse(id, -32602, "storageFilePath is required");
@@ -193,6 +220,14 @@ QJsonObject RpcService::handleStart(const QString& id, const QJsonObject& params
         fileStorage->setPath(storagePath);
     }
     
+    // Keep the flight recorder next to the pairings so it outlives the process
+    QString recorderPath = params["flightRecorderPath"].toString();
+    if (recorderPath.isEmpty()) {
+        recorderPath = QFileInfo(storagePath).absoluteDir().filePath("keycard-flight-recorder.bin");
+    }
+    FlightRecorder::instance()->open(recorderPath);
+
+    m_sessionManager->setLazySecureChannel(lazySecureChannel);
     bool success = m_sessionManager->start(logEnabled, logFilePath);
     if (!success) {
         return createErrorResponse(id, -32000, m_sessionManager->lastError());
@@ -457,5 +492,170 @@ QJsonObject RpcService::handleExportRecoverKeys(const QString& id, const QJsonOb
     return createSuccessResponse(id, result);
 }
 
-} // namespace StatusKeycard
+QJsonObject RpcService::handleExportKeys(const QString& id, const QJsonObject& params) {
+    QJsonArray keysArray = params["keys"].toArray();
+    if (keysArray.isEmpty()) {
+        return createErrorResponse(id, -32602, "Invalid params: keys list is required");
+    }
+
+    QVector<SessionManager::KeyExportRequest> requests;
+    requests.reserve(keysArray.size());
+    for (const QJsonValue& val : keysArray) {
+        QJsonObject obj = val.toObject();
+        SessionManager::KeyExportRequest request;
+        request.path = obj["path"].toString();
+        request.exportPrivate = obj["private"].toBool();
+        request.exportChainCode = obj["chainCode"].toBool();
+        if (!request.path.startsWith("m")) {
+            return createErrorResponse(id, -32602, QString("Invalid params: invalid path '%1'").arg(request.path));
+        }
+        requests.append(request);
+    }
+
+    QVector<SessionManager::KeyExportResult> results = m_sessionManager->exportKeys(requests);
+    if (!m_sessionManager->lastError().isEmpty()) {
+        return createErrorResponse(id, -32000, m_sessionManager->lastError());
+    }
+
+    // Results are in request order; failed items carry "error" instead of key data
+    QJsonArray resultKeys;
+    for (const SessionManager::KeyExportResult& res : results) {
+        QJsonObject obj;
+        obj["path"] = res.path;
+        if (!res.error.isEmpty()) {
+            obj["error"] = res.error;
+        } else {
+            obj["address"] = res.key.address;
+            obj["publicKey"] = res.key.publicKey;
+            if (!res.key.privateKey.isEmpty()) {
+                obj["privateKey"] = res.key.privateKey;
+            }
+            if (!res.key.chainCode.isEmpty()) {
+                obj["chainCode"] = res.key.chainCode;
+            }
+        }
+        resultKeys.append(obj);
+    }
+
+    QJsonObject result;
+    result["keys"] = resultKeys;
+
+    return createSuccessResponse(id, result);
+}
+
+QJsonObject RpcService::handleListPairings(const QString& id, const QJsonObject& params) {
+    Q_UNUSED(params);
+
+    if (!m_sessionManager || !m_sessionManager->commandSet()) {
+        return createErrorResponse(id, -32000, "CommandSet not set");
+    }
+
+    auto fileStorage = std::dynamic_pointer_cast<StatusKeycard::FilePairingStorage>(
+        m_sessionManager->commandSet()->pairingStorage());
+    if (!fileStorage) {
+        return createErrorResponse(id, -32000, "Pairing storage does not support listing");
+    }
+
+    // Served from the in-memory cache; pairing keys are never exposed
+    QJsonArray pairings;
+    for (const FilePairingStorage::PairingRecord& record : fileStorage->listPairings()) {
+        QJsonObject obj;
+        obj["instanceUID"] = record.instanceUID;
+        obj["keyUID"] = record.keyUID;
+        obj["index"] = record.pairing.index;
+        obj["lastUsed"] = static_cast<double>(record.lastUsed);
+        pairings.append(obj);
+    }
+
+    QJsonObject result;
+    result["pairings"] = pairings;
+
+    return createSuccessResponse(id, result);
+}
+
+QJsonObject RpcService::handleSetPairingSlotPolicy(const QString& id, const QJsonObject& params) {
+    PairingSlotManager::Policy policy = m_sessionManager->pairingSlotPolicy();
+    policy.autoUnpair = params["autoUnpair"].toBool(policy.autoUnpair);
+    policy.reserveSlots = params["reserveSlots"].toInt(policy.reserveSlots);
 
+    if (policy.reserveSlots < 0) {
+        return createErrorResponse(id, -32602, "reserveSlots must not be negative");
+    }
+
+    m_sessionManager->setPairingSlotPolicy(policy);
+
+    return createSuccessResponse(id, QJsonObject());
+}
+
+QJsonObject RpcService::handleGetFlowStats(const QString& id, const QJsonObject& params) {
+    FlowStats& stats = FlowManager::instance()->stats();
+
+    QJsonObject result;
+    result["flows"] = stats.toJson();
+
+    if (params["reset"].toBool()) {
+        stats.reset();
+    }
+
+    return createSuccessResponse(id, result);
+}
+
+QJsonObject RpcService::handleGetSessionStats(const QString& id, const QJsonObject& params) {
+    SessionStats& stats = m_sessionManager->stats();
+
+    QJsonObject result = stats.toJson();
+    result["state"] = m_sessionManager->currentStateString();
+    result["stateDurationMs"] = static_cast<double>(m_sessionManager->stateDurationMs());
+
+    if (params["reset"].toBool()) {
+        stats.reset();
+    }
+
+    return createSuccessResponse(id, result);
+}
+
+QJsonObject RpcService::handleExplainPlan(const QString& id, const QJsonObject& params) {
+    PlanRequest request;
+    QString error;
+    if (!PlanRequest::fromJson(params, request, error)) {
+        return createErrorResponse(id, -32602, QString("Invalid params: %1").arg(error));
+    }
+
+    // Planning only reads cached session state; the card is not touched
+    ApduCostModel& model = m_sessionManager->costModel();
+    ExecutionPlan plan = ExecutionPlanner(model).plan(request, m_sessionManager->planSession(),
+                                                      params["readerType"].toString());
+
+    QJsonObject result = plan.toJson();
+    AppletCapabilities capabilities = m_sessionManager->capabilities();
+    if (capabilities.versionMajor > 0) {
+        result["capabilities"] = capabilities.toJson();
+    }
+    if (params["includeModel"].toBool()) {
+        result["model"] = model.toJson();
+    }
+    return createSuccessResponse(id, result);
+}
+
+QJsonObject RpcService::handleDumpFlightRecorder(const QString& id, const QJsonObject& params) {
+    qint64 lastMs = static_cast<qint64>(params["seconds"].toDouble(0) * 1000);
+    QString path = params["path"].toString();
+
+    QJsonObject result;
+    if (path.isEmpty()) {
+        result["events"] = FlightRecorder::instance()->dump(lastMs);
+        result["path"] = FlightRecorder::instance()->path();
+    } else {
+        // Post-mortem: a ring file left behind by this or an earlier process
+        QJsonArray events;
+        QString error;
+        if (!FlightRecorder::decodeFile(path, lastMs, events, error)) {
+            return createErrorResponse(id, -32000, error);
+        }
+        result["events"] = events;
+        result["path"] = path;
+    }
+    return createSuccessResponse(id, result);
+}
+
+} // namespace StatusKeycard
@@ -82,6 +82,20 @@ private:
     QJsonObject handleStoreMetadata(const QString& id, const QJsonObject& params);
     QJsonObject handleExportLoginKeys(const QString& id, const QJsonObject& params);
     QJsonObject handleExportRecoverKeys(const QString& id, const QJsonObject& params);
+    QJsonObject handleExportKeys(const QString& id, const QJsonObject& params);
+    QJsonObject handleListPairings(const QString& id, const QJsonObject& params);
+    QJsonObject handleSetPairingSlotPolicy(const QString& id, const QJsonObject& params);
+    QJsonObject handleGetFlowStats(const QString& id, const QJsonObject& params);
+    QJsonObject handleGetSessionStats(const QString& id, const QJsonObject& params);
+    /**
+     * keycard.ExplainPlan is an estimator: it lists the APDUs the session
+     * would send for the request and their modelled cost, without touching
+     * the card. "chosen" in a decision is the strategy the session runs;
+     * "alternatives" are cost estimates for strategies it does not
+     * implement, not options it may pick.
+     */
+    QJsonObject handleExplainPlan(const QString& id, const QJsonObject& params);
+    QJsonObject handleDumpFlightRecorder(const QString& id, const QJsonObject& params);
 
     std::unique_ptr<SessionManager> m_sessionManager;
     std::shared_ptr<Keycard::CommandSet> m_commandSet;
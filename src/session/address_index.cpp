@@ -0,0 +1,69 @@
+#include "address_index.h"
+#include "../hex_codec.h"
+#include <QDebug>
+
+namespace StatusKeycard {
+
+AddressIndex* AddressIndex::s_instance = nullptr;
+
+AddressIndex* AddressIndex::instance()
+{
+    if (!s_instance) {
+        s_instance = new AddressIndex();
+    }
+    return s_instance;
+}
+
+QString AddressIndex::normalizeKeyUID(const QString& keyUID)
+{
+    return (keyUID.startsWith(QLatin1String("0x")) ? keyUID.mid(2) : keyUID).toLower();
+}
+
+QByteArray AddressIndex::addressBytes(const QString& address)
+{
+    QByteArray bytes = HexCodec::fromHex(address);
+    return bytes.size() == 20 ? bytes : QByteArray();
+}
+
+void AddressIndex::insert(const QString& keyUID, const QString& address, const QString& path)
+{
+    QByteArray key = addressBytes(address);
+    if (keyUID.isEmpty() || key.isEmpty() || path.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, QString>& paths = m_paths[normalizeKeyUID(keyUID)];
+    if (paths.size() >= MaxEntries && !paths.contains(key)) {
+        qWarning() << "AddressIndex: Index full, not indexing" << path;
+        return;
+    }
+    paths.insert(key, path);
+}
+
+QString AddressIndex::path(const QString& keyUID, const QString& address) const
+{
+    QByteArray key = addressBytes(address);
+    if (key.isEmpty()) {
+        return QString();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_paths.constFind(normalizeKeyUID(keyUID));
+    return it == m_paths.constEnd() ? QString() : it->value(key);
+}
+
+int AddressIndex::size(const QString& keyUID) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_paths.constFind(normalizeKeyUID(keyUID));
+    return it == m_paths.constEnd() ? 0 : static_cast<int>(it->size());
+}
+
+void AddressIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_paths.clear();
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,48 @@
+#ifndef ADDRESS_INDEX_H
+#define ADDRESS_INDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Reverse index from Ethereum address to derivation path
+ *
+ * Filled from every public key export (flows and SessionManager), so a signer
+ * that only knows the sender address can find its path without a lookup of
+ * its own. Entries are kept per keyUID: the keyUID identifies the seed, so an
+ * indexed address stays valid for as long as the card holds that seed and
+ * never needs invalidating. At most MaxEntries addresses are kept per keyUID.
+ */
+class AddressIndex {
+public:
+    static constexpr int MaxEntries = 4096;
+
+    static AddressIndex* instance();
+
+    // Address and keyUID are hex, with or without 0x, in any case
+    void insert(const QString& keyUID, const QString& address, const QString& path);
+
+    // Indexed path for address; empty if unknown
+    QString path(const QString& keyUID, const QString& address) const;
+
+    int size(const QString& keyUID) const;
+    void clear();
+
+private:
+    AddressIndex() = default;
+
+    static QString normalizeKeyUID(const QString& keyUID);
+    static QByteArray addressBytes(const QString& address);  // 20 bytes, empty if invalid
+
+    mutable QMutex m_mutex;
+    QHash<QString, QHash<QByteArray, QString>> m_paths;
+    static AddressIndex* s_instance;
+};
+
+} // namespace StatusKeycard
+
+#endif // ADDRESS_INDEX_H
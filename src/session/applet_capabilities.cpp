@@ -0,0 +1,38 @@
+#include "applet_capabilities.h"
+
+namespace StatusKeycard {
+
+AppletCapabilities AppletCapabilities::forApplet(int major, int minor)
+{
+    AppletCapabilities caps;
+    caps.versionMajor = major;
+    caps.versionMinor = minor;
+    caps.assumed = caps.atLeast(3, 0) ? AllCapabilities : AllCapabilities & ~FactoryReset;
+
+    // Nothing selected yet
+    if (major == 0) {
+        return caps;
+    }
+
+    caps.publicOnlyExport = caps.atLeast(2, 0);
+    caps.exportCurrent = caps.atLeast(2, 0);
+    caps.deriveAndMakeCurrent = caps.atLeast(2, 0);
+    caps.extendedExport = caps.atLeast(3, 1);
+    caps.combinedStatus = caps.atLeast(3, 0);
+    return caps;
+}
+
+QJsonObject AppletCapabilities::toJson() const
+{
+    QJsonObject json;
+    json["version"] = QString("%1.%2").arg(versionMajor).arg(versionMinor);
+    json["capabilities"] = static_cast<int>(assumed);
+    json["publicOnlyExport"] = publicOnlyExport;
+    json["extendedExport"] = extendedExport;
+    json["exportCurrent"] = exportCurrent;
+    json["deriveAndMakeCurrent"] = deriveAndMakeCurrent;
+    json["combinedStatus"] = combinedStatus;
+    return json;
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,59 @@
+#ifndef APPLET_CAPABILITIES_H
+#define APPLET_CAPABILITIES_H
+
+#include <QJsonObject>
+#include <QtGlobal>
+
+namespace StatusKeycard {
+
+/**
+ * @brief What the connected Keycard applet supports
+ *
+ * Built once per connection from the applet version in the SELECT response.
+ * Session operations and flows consult it to pick the cheapest command
+ * variant the card accepts instead of the sequence every applet understands.
+ *
+ * 3.0+ applets also report a capability byte in SELECT (tag 0x8D), but
+ * keycard-qt's ApplicationInfo does not expose it, so the capabilities are
+ * the ones an applet of that version has by default.
+ */
+struct AppletCapabilities {
+    // Capability bits, as in the SELECT capability byte (tag 0x8D)
+    enum Capability : quint8 {
+        SecureChannel = 0x01,
+        KeyManagement = 0x02,
+        CredentialsManagement = 0x04,
+        Ndef = 0x08,
+        FactoryReset = 0x10,
+        AllCapabilities = 0x1F
+    };
+
+    int versionMajor = 0;
+    int versionMinor = 0;
+    quint8 assumed = 0;  // Capability bits of the version's default build
+
+    bool publicOnlyExport = false;      // EXPORT KEY P2=0x01, no private key handling on the card
+    bool extendedExport = false;        // EXPORT KEY P2=0x02, public key and chain code in one command
+    bool exportCurrent = false;         // EXPORT KEY P1=0x00, current key without derivation
+    bool deriveAndMakeCurrent = false;  // EXPORT KEY P1=0x02, later exports of that path need no derivation
+    bool combinedStatus = false;        // Status fetched with the secure channel is current until VERIFY PIN
+
+    bool has(Capability capability) const { return (assumed & capability) == capability; }
+    bool atLeast(int major, int minor) const
+    {
+        return versionMajor > major || (versionMajor == major && versionMinor >= minor);
+    }
+
+    /**
+     * @brief Capabilities of an applet version
+     *
+     * 3.0+ applets have every capability, earlier ones all but factory reset.
+     */
+    static AppletCapabilities forApplet(int major, int minor);
+
+    QJsonObject toJson() const;
+};
+
+} // namespace StatusKeycard
+
+#endif // APPLET_CAPABILITIES_H
@@ -0,0 +1,125 @@
+#include "pairing_slot_manager.h"
+#include "../storage/file_pairing_storage.h"
+#include <keycard-qt/command_set.h>
+#include <keycard-qt/keycard_channel.h>
+#include <keycard-qt/backends/keycard_channel_backend.h>
+#include <QDebug>
+
+namespace StatusKeycard {
+
+namespace {
+
+// secp256k1 generator: a valid point, so the card gets past the ECDH step
+const QByteArray ProbePublicKey = QByteArray::fromHex(
+    "0479be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"
+    "483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8");
+
+} // namespace
+
+quint16 PairingSlotManager::openSecureChannelStatus(Keycard::KeycardChannelBackend* backend, int index)
+{
+    if (!backend || index < 0 || index > 0xFF) {
+        return 0;
+    }
+
+    QByteArray apdu = QByteArray::fromHex("8010");
+    apdu.append(static_cast<char>(index));
+    apdu.append('\0');
+    apdu.append(static_cast<char>(ProbePublicKey.size()));
+    apdu.append(ProbePublicKey);
+
+    // The card drops any secure channel when OPEN SECURE CHANNEL arrives, and
+    // nobody can finish this one: CommandSet opens a fresh channel next time
+    const QByteArray response = backend->transmit(apdu);
+    if (response.size() < 2) {
+        return 0;
+    }
+    return static_cast<quint16>((static_cast<quint8>(response[response.size() - 2]) << 8)
+                                | static_cast<quint8>(response[response.size() - 1]));
+}
+
+bool PairingSlotManager::recoverPairing(Keycard::CommandSet* commandSet,
+                                        const std::shared_ptr<FilePairingStorage>& storage,
+                                        const QString& instanceUID)
+{
+    if (!commandSet || !storage) {
+        return false;
+    }
+
+    QVector<FilePairingStorage::RetiredPairing> retired = storage->retiredPairings(instanceUID);
+
+    // Most recently used first: the likeliest to still be valid on the card
+    for (auto it = retired.crbegin(); it != retired.crend(); ++it) {
+        int index = it->pairing.index;
+        qDebug() << "PairingSlotManager: Trying retired pairing slot" << index << "for card:" << instanceUID;
+
+        if (!storage->restoreRetired(instanceUID, index)) {
+            continue;
+        }
+
+        if (commandSet->ensurePairing() && commandSet->ensureSecureChannel()) {
+            qDebug() << "PairingSlotManager: Reusing retired pairing slot" << index;
+            return true;
+        }
+
+        const QString error = commandSet->lastError();
+        auto channel = commandSet->channel();
+        const quint16 sw = openSecureChannelStatus(channel ? channel->backend() : nullptr, index);
+        if (sw == 0x6A86) {
+            // The card no longer knows this pairing (unpaired elsewhere or reset)
+            qDebug() << "PairingSlotManager: Retired pairing slot" << index << "not on the card:" << error;
+            storage->forgetSlot(instanceUID, index);
+            continue;
+        }
+
+        // Transport or card error: the slot may still be ours, keep it retired
+        qWarning() << "PairingSlotManager: Retired pairing slot" << index << "not usable now:" << error;
+        storage->remove(instanceUID);
+        return false;
+    }
+
+    return false;
+}
+
+int PairingSlotManager::reclaimSlots(Keycard::CommandSet* commandSet,
+                                     const std::shared_ptr<FilePairingStorage>& storage,
+                                     const QString& instanceUID,
+                                     int availableSlots)
+{
+    if (!m_policy.autoUnpair || !commandSet || !storage) {
+        return 0;
+    }
+
+    int needed = m_policy.reserveSlots - availableSlots;
+    if (needed <= 0) {
+        return 0;
+    }
+
+    QVector<FilePairingStorage::RetiredPairing> retired = storage->retiredPairings(instanceUID);
+    Keycard::PairingInfo current = storage->load(instanceUID);
+
+    int freed = 0;
+    for (const FilePairingStorage::RetiredPairing& entry : retired) {  // Least recently used first
+        if (freed >= needed) {
+            break;
+        }
+
+        int index = entry.pairing.index;
+        if (current.isValid() && current.index == index) {
+            continue;  // Never unpair the slot this session is using
+        }
+
+        if (!commandSet->unpair(static_cast<uint8_t>(index))) {
+            qWarning() << "PairingSlotManager: Failed to unpair slot" << index << ":" << commandSet->lastError();
+            continue;
+        }
+
+        qDebug() << "PairingSlotManager: Unpaired stale slot" << index << "on card:" << instanceUID;
+        storage->forgetSlot(instanceUID, index);
+        ++freed;
+    }
+
+    return freed;
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QString>
+#include <memory>
+
+namespace Keycard {
+class CommandSet;
+class KeycardChannelBackend;
+}
+
+namespace StatusKeycard {
+
+class FilePairingStorage;
+
+/**
+ * @brief Keeps pairing slots available on cards shared between hosts
+ *
+ * A card has a small fixed number of pairing slots. Every time this host
+ * loses its stored pairing and pairs again, the old slot stays allocated on
+ * the card. FilePairingStorage keeps those pairings as "retired"; this class
+ * uses them in two places:
+ * - On connect, when the card has no free slots, retired pairings are tried
+ *   (most recently used first) so the connection succeeds without a new slot.
+ * - After PIN verification (UNPAIR requires it), least recently used retired
+ *   slots are unpaired until the policy's reserve of free slots is met.
+ *
+ * Only slots this host paired itself are ever touched.
+ */
+class PairingSlotManager {
+public:
+    struct Policy {
+        bool autoUnpair = false;  // Unpair stale host slots after authorization
+        int reserveSlots = 1;     // Free slots to keep available on the card
+    };
+
+    void setPolicy(const Policy& policy) { m_policy = policy; }
+    Policy policy() const { return m_policy; }
+
+    /**
+     * @brief Reopen the secure channel with a retired pairing
+     * @return true if a secure channel is open with one of them
+     *
+     * Only pairings whose slot the card no longer holds (see
+     * openSecureChannelStatus()) are forgotten. Any other failure stops the
+     * attempt and leaves the slot retired, as the card may still hold it.
+     */
+    bool recoverPairing(Keycard::CommandSet* commandSet,
+                        const std::shared_ptr<FilePairingStorage>& storage,
+                        const QString& instanceUID);
+
+    /**
+     * @brief Status word of OPEN SECURE CHANNEL on a pairing slot
+     *
+     * CommandSet only reports failures as text, so the slot is probed with a
+     * raw APDU: 6A86 means the card has no pairing at that index, 9000 that
+     * it has one. A slot another host re-paired also answers 9000 and stays
+     * retired. The probe leaves no secure channel open.
+     *
+     * @return The status word, or 0 if the card did not answer
+     */
+    static quint16 openSecureChannelStatus(Keycard::KeycardChannelBackend* backend, int index);
+
+    /**
+     * @brief Unpair least recently used retired slots (requires verified PIN)
+     * @return Number of slots freed
+     */
+    int reclaimSlots(Keycard::CommandSet* commandSet,
+                     const std::shared_ptr<FilePairingStorage>& storage,
+                     const QString& instanceUID,
+                     int availableSlots);
+
+private:
+    Policy m_policy;
+};
+
+} // namespace StatusKeycard
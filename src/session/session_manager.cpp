@@ -1,5 +1,10 @@
 #include "session_manager.h"
 #include "signal_manager.h"
+#include "../flight_recorder.h"
+#include "../card_decoder.h"
+#include "../hex_codec.h"
+#include "address_index.h"
+#include "../storage/file_pairing_storage.h"
 #include <keycard-qt/types.h>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -12,6 +17,9 @@
 #include <QEventLoop>
 #include <QTimer>
 #include <QtConcurrent/QtConcurrent>
+#include <QHash>
+#include <QElapsedTimer>
+#include <algorithm>
 
 #ifdef KEYCARD_QT_HAS_OPENSSL
 #include <openssl/ec.h>
@@ -50,6 +58,8 @@ SessionManager::SessionManager(QObject* parent)
     , m_started(false)
     , m_stateCheckTimer(new QTimer(this))
 {
+    m_stateEntered.start();
+
     // CRITICAL: Ensure we're in the main Qt thread for NFC events
     QThread* mainThread = QCoreApplication::instance()->thread();
     QThread* currentThread = QThread::currentThread();
@@ -111,6 +121,9 @@ void SessionManager::setCommandSet(std::shared_ptr<Keycard::CommandSet> commandS
         qWarning() << "SessionManager: No channel set";
         return;
     }
+    if (m_channel->backend()) {
+        m_costModel->setReaderType(ApduCostModel::readerTypeForBackend(m_channel->backend()->backendName()));
+    }
 
     // Connect signals
     connect(m_channel.get(), &Keycard::KeycardChannel::readerAvailabilityChanged,
@@ -157,6 +170,10 @@ void SessionManager::stop()
     m_started = false;
     m_currentCardUID.clear();
 
+    if (auto storage = filePairingStorage()) {
+        storage->flush();
+    }
+
     if (m_channel) {
         m_channel->setState(Keycard::ChannelState::Idle);
     }
@@ -164,6 +181,44 @@ void SessionManager::stop()
     qDebug() << "SessionManager: Stopped";
 }
 
+void SessionManager::resetSession()
+{
+    QString cardUID;
+    {
+        // Wait for any in-flight card operation before dropping its state
+        QMutexLocker locker(&m_operationMutex);
+        m_lastError.clear();
+        m_appStatus = Keycard::ApplicationStatus();
+        m_metadata = Metadata();
+        cardUID = m_currentCardUID;
+        m_currentCardUID.clear();
+    }
+
+    if (!m_started) {
+        return;
+    }
+
+    qDebug() << "SessionManager: Warm reset" << (cardUID.isEmpty() ? "(no card)" : "- reconnecting card");
+    if (cardUID.isEmpty()) {
+        if (m_state != SessionState::WaitingForReader) {
+            setState(SessionState::WaitingForCard);
+        }
+        return;
+    }
+
+    // SELECT resets the applet's secure channel, so the reconnect also
+    // clears PIN verification on the card
+    onCardDetected(cardUID);
+}
+
+std::shared_ptr<FilePairingStorage> SessionManager::filePairingStorage() const
+{
+    if (!m_commandSet) {
+        return nullptr;
+    }
+    return std::dynamic_pointer_cast<FilePairingStorage>(m_commandSet->pairingStorage());
+}
+
 void SessionManager::setState(SessionState newState)
 {
     if (newState == m_state) {
@@ -171,7 +226,15 @@ void SessionManager::setState(SessionState newState)
     }
     
     SessionState oldState = m_state;
+    if (!isValidSessionTransition(oldState, newState)) {
+        qWarning() << "SessionManager: Unexpected state transition" << sessionStateToString(oldState)
+                   << "->" << sessionStateToString(newState);
+    }
+    m_stats.recordTransition(oldState, newState, m_stateEntered.restart());
     m_state = newState;
+
+    FlightRecorder::instance()->record(FlightRecorder::Event::SessionState, static_cast<quint32>(newState), 0, 0,
+                                       sessionStateToString(newState), static_cast<quint32>(oldState));
     
     // Emit Qt signal - c_api.cpp will forward to SignalManager
     emit stateChanged(newState, oldState);
@@ -182,6 +245,13 @@ void SessionManager::onReaderAvailabilityChanged(bool available)
     qDebug() << "SessionManager: Reader availability changed:" << (available ? "available" : "not available");
     
     if (available) {
+        // Warm the pairing cache so the connection path resolves pairings without file I/O
+        if (auto storage = filePairingStorage()) {
+            QtConcurrent::run([storage]() {
+                storage->prefetch();
+            });
+        }
+
         if (m_state == SessionState::UnknownReaderState || m_state == SessionState::WaitingForReader) {
             setState(SessionState::WaitingForCard);
             m_channel->setState(Keycard::ChannelState::WaitingForCard);
@@ -231,7 +301,11 @@ void SessionManager::onCardDetected(const QString& uid)
             return;
         }
         // Select applet (doesn't require pairing/secure channel)
-        m_appInfo = m_commandSet->select();
+        {
+            ApduTimer timer(m_costModel.get(), ApduCostModel::Select);
+            setAppInfo(m_commandSet->select());
+            timer.succeeded(!m_appInfo.instanceUID.isEmpty() || !m_appInfo.secureChannelPublicKey.isEmpty());
+        }
         // Check if select succeeded: initialized cards have instanceUID, pre-initialized cards have secureChannelPublicKey
         if (m_appInfo.instanceUID.isEmpty() && m_appInfo.secureChannelPublicKey.isEmpty()) {
             qWarning() << "SessionManager: Failed to select applet";
@@ -250,31 +324,108 @@ void SessionManager::onCardDetected(const QString& uid)
             return;
         }
 
-        if (!m_commandSet->ensurePairing()) {
+        // Lazy mode: the card is identified; pairing and the secure channel
+        // wait for the first operation that needs them
+        if (m_lazySecureChannel) {
+            m_secureChannelPending = true;
             QMetaObject::invokeMethod(this, [this]() {
-                setState(m_appInfo.availableSlots > 0 ? 
-                SessionState::PairingError :
-                SessionState::NoAvailablePairingSlots);
+                setState(SessionState::Ready);
             }, Qt::QueuedConnection);
+            operationCompleted();
             return;
         }
 
-        if (!m_commandSet->ensureSecureChannel()) {
-            QMetaObject::invokeMethod(this, [this]() {
-                setState(SessionState::ConnectionError);
-            }, Qt::QueuedConnection);
-            return;
+        m_secureChannelPending = false;
+        SessionState connected = openSecureChannel();
+        QMetaObject::invokeMethod(this, [this, connected]() {
+            setState(connected);
+        }, Qt::QueuedConnection);
+
+        if (connected == SessionState::Ready) {
+            operationCompleted();
         }
+    });
+}
 
-        m_appStatus = m_commandSet->cachedApplicationStatus();
-        m_metadata = getMetadata();
+SessionState SessionManager::openSecureChannel()
+{
+    bool paired = m_commandSet->ensurePairing();
+    bool channelOpen = false;
 
-        QMetaObject::invokeMethod(this, [this]() {
-            setState(SessionState::Ready);
-        }, Qt::QueuedConnection);
+    // Out of slots: reuse a pairing this host retired instead of needing a new slot
+    if (!paired && m_appInfo.availableSlots == 0) {
+        channelOpen = m_slotManager.recoverPairing(m_commandSet.get(), filePairingStorage(),
+                                                   HexCodec::toHex(m_appInfo.instanceUID));
+        paired = channelOpen;
+    }
 
-        operationCompleted();
-    });
+    if (!paired) {
+        return m_appInfo.availableSlots > 0 ?
+            SessionState::PairingError :
+            SessionState::NoAvailablePairingSlots;
+    }
+
+    if (!channelOpen && !m_commandSet->ensureSecureChannel()) {
+        return SessionState::ConnectionError;
+    }
+
+    if (auto storage = filePairingStorage()) {
+        storage->recordConnection(HexCodec::toHex(m_appInfo.instanceUID), HexCodec::toHex(m_appInfo.keyUID));
+    }
+
+    m_appStatus = m_commandSet->cachedApplicationStatus();
+    m_metadata = getMetadata();
+    return SessionState::Ready;
+}
+
+bool SessionManager::ensureSecureChannel()
+{
+    if (!m_secureChannelPending.exchange(false)) {
+        return true;
+    }
+
+    qDebug() << "SessionManager: Opening deferred secure channel";
+    SessionState connected = openSecureChannel();
+    if (connected != SessionState::Ready) {
+        setError("Failed to open secure channel (" + sessionStateToString(connected) + ")");
+        setState(connected);
+        return false;
+    }
+    return true;
+}
+
+void SessionManager::setAppInfo(const Keycard::ApplicationInfo& appInfo)
+{
+    m_appInfo = appInfo;
+    m_capabilities = AppletCapabilities::forApplet(appInfo.appVersion, appInfo.appVersionMinor);
+    m_currentKeyPath.clear();
+}
+
+void SessionManager::beginKeyExport()
+{
+    // Flows share the card and may change its current key between our
+    // operations, so only a key made current within this one is trusted
+    m_currentKeyPath.clear();
+}
+
+QByteArray SessionManager::exportKeyData(const QString& path, bool makeCurrent, bool exportPrivate,
+                                         bool exportChainCode)
+{
+    // The key made current earlier in this operation is exported without derivation
+    bool derive = !(m_capabilities.exportCurrent && path == m_currentKeyPath);
+    makeCurrent = derive && makeCurrent && m_capabilities.deriveAndMakeCurrent;
+
+    ApduTimer timer(m_costModel.get(), ApduCostModel::ExportKey, derive ? ExecutionPlanner::pathDepth(path) : 0);
+    QByteArray data = exportChainCode ?
+        m_commandSet->exportKeyExtended(derive, makeCurrent, path) :
+        m_commandSet->exportKey(derive, makeCurrent, path,
+                                exportPrivate ? Keycard::APDU::P2ExportKeyPrivateAndPublic
+                                              : Keycard::APDU::P2ExportKeyPublicOnly);
+    timer.succeeded(!data.isEmpty());
+    if (makeCurrent && !data.isEmpty()) {
+        m_currentKeyPath = path;
+    }
+    return data;
 }
 
 void SessionManager::onCardRemoved()
@@ -287,6 +438,7 @@ void SessionManager::onCardRemoved()
     return;
 #else
     m_currentCardUID.clear();
+    m_secureChannelPending = false;
     
     if (m_started) {
         setState(SessionState::WaitingForCard);
@@ -321,10 +473,10 @@ SessionManager::Status SessionManager::getStatus() const
         status.keycardInfo = new ApplicationInfoV2();
         status.keycardInfo->installed = true; // If we have it, it's installed
         status.keycardInfo->initialized = m_appInfo.initialized;
-        status.keycardInfo->instanceUID = m_appInfo.instanceUID.toHex();
+        status.keycardInfo->instanceUID = HexCodec::toHex(m_appInfo.instanceUID);
         status.keycardInfo->version = QString("%1.%2").arg(m_appInfo.appVersion).arg(m_appInfo.appVersionMinor);
         status.keycardInfo->availableSlots = m_appInfo.availableSlots;
-        status.keycardInfo->keyUID = m_appInfo.keyUID.toHex();
+        status.keycardInfo->keyUID = HexCodec::toHex(m_appInfo.keyUID);
     }
 
     if ((m_state == SessionState::Ready || m_state == SessionState::Authorized) && m_appStatus.pinRetryCount >= 0) {
@@ -345,6 +497,12 @@ SessionManager::Status SessionManager::getStatus() const
     return status;
 }
 
+SessionManager::Status SessionManager::lockedStatus() const
+{
+    QMutexLocker locker(&m_operationMutex);
+    return getStatus();
+}
+
 // Card Operations
 
 bool SessionManager::initialize(const QString& pin, const QString& puk, const QString& pairingPassword)
@@ -367,7 +525,8 @@ bool SessionManager::initialize(const QString& pin, const QString& puk, const QS
 
     m_currentCardUID.clear();
     m_appStatus = m_commandSet->cachedApplicationStatus();
-    m_appInfo = m_commandSet->select(false);
+    setAppInfo(m_commandSet->select(false));
+    m_secureChannelPending = m_lazySecureChannel;
     setState(SessionState::Ready);
     return true;
 }
@@ -389,7 +548,16 @@ bool SessionManager::authorize(const QString& pin)
         return false;
     }
 
-    bool result = m_commandSet->verifyPIN(pin);
+    if (!ensureSecureChannel()) {
+        return false;
+    }
+
+    bool result;
+    {
+        ApduTimer timer(m_costModel.get(), ApduCostModel::VerifyPIN);
+        result = m_commandSet->verifyPIN(pin);
+        timer.succeeded(result);
+    }
     m_appStatus = m_commandSet->cachedApplicationStatus();
     
     if (!result) {
@@ -412,6 +580,13 @@ bool SessionManager::authorize(const QString& pin)
         qWarning() << "SessionManager: Failed to update application status after PIN verification";
         qWarning() << "SessionManager: This may cause subsequent operations to fail";
     }
+
+    // UNPAIR needs a verified PIN, so stale host slots are reclaimed here
+    int freed = m_slotManager.reclaimSlots(m_commandSet.get(), filePairingStorage(),
+                                           HexCodec::toHex(m_appInfo.instanceUID), m_appInfo.availableSlots);
+    if (freed > 0) {
+        m_appInfo.availableSlots += freed;
+    }
     
     setState(SessionState::Authorized);
     operationCompleted();
@@ -470,6 +645,10 @@ bool SessionManager::unblockPIN(const QString& puk, const QString& newPIN)
         setError("Card not ready");
         return false;
     }
+
+    if (!ensureSecureChannel()) {
+        return false;
+    }
     
     bool result = m_commandSet->unblockPIN(puk, newPIN);
     if (!result) {
@@ -563,7 +742,7 @@ QString SessionManager::loadMnemonic(const QString& mnemonic, const QString& pas
     
     operationCompleted();
     
-    return QString("0x") + keyUID.toHex();
+    return HexCodec::toHex(keyUID, true);
 }
 
 bool SessionManager::factoryReset()
@@ -583,9 +762,10 @@ bool SessionManager::factoryReset()
     
     qDebug() << "SessionManager: Factory reset complete";
 
-    m_appInfo = m_commandSet->select(true);
+    setAppInfo(m_commandSet->select(true));
 
     m_currentCardUID.clear();
+    m_secureChannelPending = false;
     m_appStatus = m_commandSet->cachedApplicationStatus();
     setState(SessionState::EmptyKeycard);
     operationCompleted();
@@ -599,79 +779,6 @@ bool SessionManager::factoryReset()
 
 // Key Export
 
-// BER-TLV parser for exported keys (matching keycard-go implementation)
-static quint32 parseTlvLength(const QByteArray& data, int& offset) {
-    if (offset >= data.size()) {
-        return 0;
-    }
-    
-    quint8 firstByte = static_cast<quint8>(data[offset]);
-    offset++;
-    
-    // Short form: length < 128 (0x80)
-    if (firstByte < 0x80) {
-        return firstByte;
-    }
-    
-    // Long form: first byte = 0x80 + number of length bytes
-    if (firstByte == 0x80) {
-        qWarning() << "Unsupported indefinite length (0x80)";
-        return 0;
-    }
-    
-    int lengthBytes = firstByte - 0x80;
-    if (lengthBytes > 4 || offset + lengthBytes > data.size()) {
-        qWarning() << "Invalid length encoding";
-        return 0;
-    }
-    
-    // Read length bytes (big-endian)
-    quint32 length = 0;
-    for (int i = 0; i < lengthBytes; i++) {
-        length = (length << 8) | static_cast<quint8>(data[offset]);
-        offset++;
-    }
-    
-    return length;
-}
-
-static QByteArray findTlvTag(const QByteArray& data, uint8_t targetTag) {
-    int offset = 0;
-    
-    while (offset < data.size()) {
-        // Parse tag (we only support single-byte tags for now)
-        if (offset >= data.size()) {
-            break;
-        }
-        
-        uint8_t tag = static_cast<uint8_t>(data[offset]);
-        offset++;
-        
-        // Parse length (supports multi-byte lengths)
-        quint32 length = parseTlvLength(data, offset);
-        if (length == 0 && offset >= data.size()) {
-            break;
-        }
-        
-        // Check if we have enough data
-        if (offset + length > data.size()) {
-            qWarning() << "TLV length exceeds data size. Tag:" << QString("0x%1").arg(tag, 2, 16, QChar('0'))
-                      << "Length:" << length << "Remaining:" << (data.size() - offset);
-            break;
-        }
-        
-        // Found the target tag
-        if (tag == targetTag) {
-            return data.mid(offset, length);
-        }
-        
-        // Skip to next tag
-        offset += length;
-    }
-    
-    return QByteArray();
-}
-
 // Compute Ethereum address from public key using Qt's QCryptographicHash
 static QString publicKeyToAddress(const QByteArray& pubKey) {
     if (pubKey.size() != 65 || pubKey[0] != 0x04) {
@@ -684,7 +791,7 @@ static QString publicKeyToAddress(const QByteArray& pubKey) {
     QByteArray hash = QCryptographicHash::hash(pubKeyData, QCryptographicHash::Keccak_256);
     QByteArray address = hash.right(20);
     
-    return QString("0x") + address.toHex();
+    return HexCodec::toHex(address, true);
 }
 
 // Derive public key from private key using OpenSSL secp256k1
@@ -749,25 +856,30 @@ static SessionManager::KeyPair parseExportedKey(const QByteArray& data) {
         return keyPair;
     }
     
-    qDebug() << "parseExportedKey: Received" << data.size() << "bytes:";
-    qDebug() << "parseExportedKey: Hex dump:" << data.toHex();
+    qDebug() << "parseExportedKey: Received" << data.size() << "bytes";
     
     // Find template tag 0xA1
-    QByteArray template_ = findTlvTag(data, 0xA1);
+    QByteArray template_;
+    const quint8 templateTag = 0xA1;
+    DecodeError error = CardDecoder::findTlvTags(data, &templateTag, &template_, 1);
     if (template_.isEmpty()) {
-        qWarning() << "Failed to find template tag 0xA1 in exported key";
+        qWarning() << "Failed to find template tag 0xA1 in exported key:" << decodeErrorString(error);
         qWarning() << "Raw data size:" << data.size() << "bytes";
-        qWarning() << "First 32 bytes:" << data.left(32).toHex();
         return keyPair;
     }
     
-    // Find public key (0x80)
-    QByteArray pubKey = findTlvTag(template_, 0x80);
-    
-    // Find private key (0x81) if available
-    QByteArray privKey = findTlvTag(template_, 0x81);
+    // Public key (0x80), private key (0x81) and chain code (0x82) in one pass
+    const quint8 keyTags[] = { 0x80, 0x81, 0x82 };
+    QByteArray keyValues[3];
+    error = CardDecoder::findTlvTags(template_, keyTags, keyValues, 3, 1);
+    if (error != DecodeError::None) {
+        qWarning() << "parseExportedKey: Invalid key template:" << decodeErrorString(error);
+        return keyPair;
+    }
+    QByteArray pubKey = keyValues[0];
+    QByteArray privKey = keyValues[1];
     if (!privKey.isEmpty()) {
-        keyPair.privateKey = privKey.toHex();
+        keyPair.privateKey = HexCodec::toHex(privKey);
     }
     
     // If public key is missing but private key is present, derive it
@@ -783,19 +895,26 @@ static SessionManager::KeyPair parseExportedKey(const QByteArray& data) {
     
     // Set public key and address
     if (!pubKey.isEmpty()) {
-        keyPair.publicKey = pubKey.toHex();
+        keyPair.publicKey = HexCodec::toHex(pubKey);
         keyPair.address = publicKeyToAddress(pubKey);
     }
     
-    // Find chain code (0x82) if available
-    QByteArray chainCode = findTlvTag(template_, 0x82);
+    // Chain code (0x82) if available
+    const QByteArray& chainCode = keyValues[2];
     if (!chainCode.isEmpty()) {
-        keyPair.chainCode = chainCode.toHex();
+        keyPair.chainCode = HexCodec::toHex(chainCode);
     }
     
     return keyPair;
 }
 
+SessionManager::KeyPair SessionManager::indexedKeyPair(const QString& path, const QByteArray& data)
+{
+    KeyPair keyPair = parseExportedKey(data);
+    AddressIndex::instance()->insert(HexCodec::toHex(m_appInfo.keyUID), keyPair.address, path);
+    return keyPair;
+}
+
 SessionManager::LoginKeys SessionManager::exportLoginKeys()
 {
     // Serialize card operations to prevent concurrent APDU corruption
@@ -803,6 +922,7 @@ SessionManager::LoginKeys SessionManager::exportLoginKeys()
     
     // Clear any previous error
     m_lastError.clear();
+    beginKeyExport();
     
     LoginKeys keys;
     
@@ -817,26 +937,26 @@ SessionManager::LoginKeys SessionManager::exportLoginKeys()
     }
 
     qDebug() << "SessionManager: Exporting whisper key from path:" << PATH_WHISPER;
-    QByteArray whisperData = m_commandSet->exportKey(true, true, PATH_WHISPER, Keycard::APDU::P2ExportKeyPrivateAndPublic);
+    QByteArray whisperData = exportKeyData(PATH_WHISPER, true, true, false);
     if (whisperData.isEmpty()) {
         setError(QString("Failed to export whisper key: %1").arg(m_commandSet->lastError()));
         operationCompleted();
         return keys;
     }
     qDebug() << "SessionManager: Whisper key data size:" << whisperData.size();
-    keys.whisperPrivateKey = parseExportedKey(whisperData);
+    keys.whisperPrivateKey = indexedKeyPair(PATH_WHISPER, whisperData);
 
     // Export encryption private key
     // Now we can use makeCurrent=false since the whisper export already set the card state
     qDebug() << "SessionManager: Exporting encryption key from path:" << PATH_ENCRYPTION;
-    QByteArray encryptionData = m_commandSet->exportKey(true, false, PATH_ENCRYPTION, Keycard::APDU::P2ExportKeyPrivateAndPublic);
+    QByteArray encryptionData = exportKeyData(PATH_ENCRYPTION, false, true, false);
     if (encryptionData.isEmpty()) {
         setError(QString("Failed to export encryption key: %1").arg(m_commandSet->lastError()));
         operationCompleted();
         return keys;
     }
     qDebug() << "SessionManager: Encryption key data size:" << encryptionData.size();
-    keys.encryptionPrivateKey = parseExportedKey(encryptionData);
+    keys.encryptionPrivateKey = indexedKeyPair(PATH_ENCRYPTION, encryptionData);
     
     qDebug() << "SessionManager: Login keys exported successfully";
     
@@ -851,6 +971,7 @@ SessionManager::RecoverKeys SessionManager::exportRecoverKeys()
     
     // Clear any previous error
     m_lastError.clear();
+    beginKeyExport();
     
     RecoverKeys keys;
     
@@ -873,53 +994,192 @@ SessionManager::RecoverKeys SessionManager::exportRecoverKeys()
     }
     
     // Export EIP1581 key (public only)
-    QByteArray eip1581Data = m_commandSet->exportKey(true, false, PATH_EIP1581);
+    QByteArray eip1581Data = exportKeyData(PATH_EIP1581, false, false, false);
     if (eip1581Data.isEmpty()) {
         setError(QString("Failed to export EIP1581 key: %1").arg(m_commandSet->lastError()));
         operationCompleted();
         return keys;
     }
-    keys.eip1581 = parseExportedKey(eip1581Data);
+    keys.eip1581 = indexedKeyPair(PATH_EIP1581, eip1581Data);
     
     // Export wallet root key (extended public if supported, otherwise public only)
-    // Check if card supports extended keys (version >= 3.1)
-    bool supportsExtended = m_appInfo.appVersion >= 3 && m_appInfo.appVersionMinor >= 1;
-    QByteArray walletRootData = supportsExtended ?
-        m_commandSet->exportKeyExtended(true, false, PATH_WALLET_ROOT) :
-        m_commandSet->exportKey(true, false, PATH_WALLET_ROOT);
+    QByteArray walletRootData = exportKeyData(PATH_WALLET_ROOT, false, false, m_capabilities.extendedExport);
     
     if (walletRootData.isEmpty()) {
         setError(QString("Failed to export wallet root key: %1").arg(m_commandSet->lastError()));
         operationCompleted();
         return keys;
     }
-    keys.walletRootKey = parseExportedKey(walletRootData);
+    keys.walletRootKey = indexedKeyPair(PATH_WALLET_ROOT, walletRootData);
     
     // Export wallet key (public only)
-    QByteArray walletData = m_commandSet->exportKey(true, false, PATH_WALLET);
+    QByteArray walletData = exportKeyData(PATH_WALLET, false, false, false);
     if (walletData.isEmpty()) {
         setError(QString("Failed to export wallet key: %1").arg(m_commandSet->lastError()));
         operationCompleted();
         return keys;
     }
-    keys.walletKey = parseExportedKey(walletData);
+    keys.walletKey = indexedKeyPair(PATH_WALLET, walletData);
     
     // Export master key (public only, makeCurrent=true for compatibility)
-    QByteArray masterData = m_commandSet->exportKey(true, true, PATH_MASTER);
+    QByteArray masterData = exportKeyData(PATH_MASTER, true, false, false);
     if (masterData.isEmpty()) {
         setError(QString("Failed to export master key: %1").arg(m_commandSet->lastError()));
         operationCompleted();
         return keys;
     }
-    keys.masterKey = parseExportedKey(masterData);
+    keys.masterKey = indexedKeyPair(PATH_MASTER, masterData);
     
     qDebug() << "SessionManager: Recover keys exported successfully";
-    
+
     operationCompleted();
-    
+
     return keys;
 }
 
+// Derivation order key: one entry per path component, hardened components
+// sort after non-hardened ones with the same index (matching BIP32 numbering)
+static QVector<quint64> derivationSortKey(const QString& path) {
+    QVector<quint64> key;
+    const QStringList parts = path.split('/');
+    for (int i = 1; i < parts.size(); ++i) {
+        QString part = parts[i];
+        quint64 hardened = 0;
+        if (part.endsWith('\'')) {
+            part.chop(1);
+            hardened = 0x80000000ULL;
+        }
+        key.append(hardened + part.toULongLong());
+    }
+    return key;
+}
+
+QVector<SessionManager::KeyExportResult> SessionManager::exportKeys(const QVector<KeyExportRequest>& requests)
+{
+    // Serialize card operations to prevent concurrent APDU corruption
+    QMutexLocker locker(&m_operationMutex);
+
+    // Clear any previous error
+    m_lastError.clear();
+    beginKeyExport();
+
+    QVector<KeyExportResult> results(requests.size());
+    for (int i = 0; i < requests.size(); ++i) {
+        results[i].path = requests[i].path;
+    }
+
+    if (m_state != SessionState::Authorized) {
+        setError("Not authorized");
+        return results;
+    }
+
+    if (!m_commandSet) {
+        setError("No command set available");
+        return results;
+    }
+
+    // Validate and de-duplicate: identical (path, options) requests share one export
+    struct Job {
+        KeyExportRequest request;
+        QVector<quint64> sortKey;
+        QVector<int> targets;  // Indexes into results
+    };
+    QVector<Job> jobs;
+    QHash<QString, int> jobIndex;
+
+    for (int i = 0; i < requests.size(); ++i) {
+        const KeyExportRequest& req = requests[i];
+
+        if (req.path != PATH_MASTER && !req.path.startsWith(PATH_MASTER + "/")) {
+            results[i].error = "invalid-path";
+            continue;
+        }
+        if (req.exportPrivate && req.exportChainCode) {
+            results[i].error = "unsupported-export-combination";
+            continue;
+        }
+        if (req.exportPrivate && !req.path.startsWith(PATH_EIP1581)) {
+            // The applet only releases private keys below the EIP-1581 root
+            results[i].error = "private-export-not-allowed";
+            continue;
+        }
+        if (req.exportChainCode && !m_capabilities.extendedExport) {
+            results[i].error = "extended-export-not-supported";
+            continue;
+        }
+        if (!req.exportPrivate && !req.exportChainCode && !m_capabilities.publicOnlyExport) {
+            results[i].error = "public-export-not-supported";
+            continue;
+        }
+
+        QString dedupKey = QString("%1|%2|%3").arg(req.path).arg(req.exportPrivate).arg(req.exportChainCode);
+        auto it = jobIndex.find(dedupKey);
+        if (it != jobIndex.end()) {
+            jobs[it.value()].targets.append(i);
+            continue;
+        }
+
+        jobIndex.insert(dedupKey, jobs.size());
+        jobs.append({req, derivationSortKey(req.path), {i}});
+    }
+
+    // Derivation order: siblings adjacent so the card walks each subtree once;
+    // master last since it is exported with makeCurrent (same as exportRecoverKeys)
+    std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+        if (a.sortKey.isEmpty() != b.sortKey.isEmpty()) {
+            return b.sortKey.isEmpty();
+        }
+        return std::lexicographical_compare(a.sortKey.begin(), a.sortKey.end(),
+                                            b.sortKey.begin(), b.sortKey.end());
+    });
+
+    qDebug() << "SessionManager: Exporting" << jobs.size() << "keys for" << requests.size() << "requests";
+
+    for (const Job& job : jobs) {
+        const KeyExportRequest& req = job.request;
+        bool makeCurrent = (req.path == PATH_MASTER);
+
+        QByteArray data = exportKeyData(req.path, makeCurrent, req.exportPrivate, req.exportChainCode);
+
+        KeyPair keyPair;
+        QString error;
+        if (data.isEmpty()) {
+            qWarning() << "SessionManager: Failed to export key" << req.path << ":" << m_commandSet->lastError();
+            error = "export-failed";
+        } else {
+            keyPair = indexedKeyPair(req.path, data);
+            if (keyPair.publicKey.isEmpty()) {
+                error = "parse-failed";
+            } else if (req.exportPrivate && keyPair.privateKey.isEmpty()) {
+                error = "private-key-missing";
+            }
+        }
+
+        for (int target : job.targets) {
+            results[target].key = keyPair;
+            results[target].error = error;
+        }
+    }
+
+    operationCompleted();
+
+    return results;
+}
+
+PlanSession SessionManager::planSession() const
+{
+    PlanSession session;
+    const bool connected = m_state == SessionState::Ready || m_state == SessionState::Authorized;
+    session.selected = connected;
+    session.paired = connected && !m_secureChannelPending;
+    session.secureChannel = session.paired;
+    session.authorized = m_state == SessionState::Authorized;
+    if (connected) {
+        session.supportsExtended = m_capabilities.extendedExport;
+    }
+    return session;
+}
+
 // Metadata Operations Implementation
 // These are defined here (after helper functions) to avoid forward declaration issues
 
@@ -935,9 +1195,20 @@ SessionManager::Metadata SessionManager::getMetadata()
         return metadata;
     }
     
+    if (!ensureSecureChannel()) {
+        return metadata;
+    }
+
     // Get metadata from card (matching status-keycard-go GetMetadata)
     qDebug() << "SessionManager: Getting metadata from card";
-    QByteArray metadataData = m_commandSet->getData(Keycard::APDU::P1StoreDataPublic);  // 0x00
+    QByteArray metadataData;
+    {
+        ApduTimer timer(m_costModel.get(), ApduCostModel::GetData);
+        metadataData = m_commandSet->getData(Keycard::APDU::P1StoreDataPublic);  // 0x00
+        // A bare status word other than 9000 is the card refusing
+        timer.succeeded(!metadataData.isEmpty()
+                        && (metadataData.size() != 2 || metadataData == QByteArray::fromHex("9000")));
+    }
     
     // Check if data looks like a status word (error response)
     if (metadataData.size() == 2) {
@@ -957,79 +1228,30 @@ SessionManager::Metadata SessionManager::getMetadata()
         return metadata;
     }
     
-    // Parse metadata using Go's custom binary format (matching types/metadata.go ParseMetadata())
-    // Format: [version+namelen][name][start/count pairs in LEB128]
-    //   Byte 0: version (3 bits) + name length (5 bits)
-    //   Bytes 1..namelen: card name
-    //   Remaining: series of start/count LEB128 pairs for wallet paths
-    
-    int offset = 0;
-    if (offset >= metadataData.size()) {
-        qDebug() << "SessionManager: Metadata too short";
+    // Parse metadata using Go's custom binary format (matching types/metadata.go ParseMetadata()),
+    // bounded so a corrupted blob cannot expand into an unbounded wallet list
+    DecodedMetadata decoded;
+    DecodeError error = CardDecoder::decodeMetadata(metadataData, decoded);
+    if (error == DecodeError::UnsupportedVersion) {
+        qWarning() << "SessionManager: Invalid metadata version:" << (static_cast<quint8>(metadataData[0]) >> 5);
         operationCompleted();
         return metadata;
     }
-    
-    // Parse header byte
-    uint8_t header = static_cast<uint8_t>(metadataData[offset++]);
-    uint8_t version = header >> 5;
-    uint8_t namelen = header & 0x1F;
-    
-    qDebug() << "SessionManager: Metadata version:" << version << "namelen:" << namelen;
-    
-    if (version != 1) {
-        qWarning() << "SessionManager: Invalid metadata version:" << version;
+    if (error != DecodeError::None) {
+        qWarning() << "SessionManager: Rejected metadata:" << decodeErrorString(error);
+        setError(QString("Invalid metadata: %1").arg(decodeErrorString(error)));
         operationCompleted();
         return metadata;
     }
-    
-    // Parse card name
-    if (namelen > 0) {
-        if (offset + namelen > metadataData.size()) {
-            qWarning() << "SessionManager: Metadata too short for name";
-            operationCompleted();
-            return metadata;
-        }
-        QByteArray nameData = metadataData.mid(offset, namelen);
-        metadata.name = QString::fromUtf8(nameData);
-        offset += namelen;
-        qDebug() << "SessionManager: Card name:" << metadata.name;
-    }
-    
-    // Parse wallet paths (LEB128 encoded start/count pairs)
-    while (offset < metadataData.size()) {
-        // Parse start index (LEB128)
-        uint32_t start = 0;
-        int shift = 0;
-        while (offset < metadataData.size()) {
-            uint8_t byte = static_cast<uint8_t>(metadataData[offset++]);
-            start |= (byte & 0x7F) << shift;
-            if ((byte & 0x80) == 0) break;
-            shift += 7;
-        }
-        
-        if (offset >= metadataData.size()) break;
-        
-        // Parse count (LEB128)
-        uint32_t count = 0;
-        shift = 0;
-        while (offset < metadataData.size()) {
-            uint8_t byte = static_cast<uint8_t>(metadataData[offset++]);
-            count |= (byte & 0x7F) << shift;
-            if ((byte & 0x80) == 0) break;
-            shift += 7;
-        }
-        
-        // Add all paths in range [start, start+count]
-        // Expand to full paths like Go's ToMetadata() does
-        for (uint32_t i = start; i <= start + count; ++i) {
-            QString walletPath = PATH_WALLET_ROOT + QString("/%1").arg(i);
-            Wallet wallet;
-            wallet.path = walletPath;
-            // Note: address and publicKey are left empty (not resolved)
-            // Use exportKey() separately if you need those
-            metadata.wallets.append(wallet);
-        }
+
+    metadata.name = decoded.name;
+    metadata.wallets.reserve(decoded.walletCount);
+    // Expand to full paths like Go's ToMetadata() does; address and publicKey
+    // are left empty (use exportKey() separately if you need those)
+    for (quint32 index : decoded.walletIndexes()) {
+        Wallet wallet;
+        wallet.path = PATH_WALLET_ROOT + QString("/%1").arg(index);
+        metadata.wallets.append(wallet);
     }
     
     qDebug() << "SessionManager: Metadata retrieved - name:" << metadata.name
@@ -1133,7 +1355,12 @@ bool SessionManager::storeMetadata(const QString& name, const QStringList& paths
     
     // Store metadata on card (public data type)
     // Use P1StoreDataPublic (0x00) as defined in status-keycard-go
-    bool success = m_commandSet->storeData(0x00, metadata);  // 0x00 = P1StoreDataPublic
+    bool success;
+    {
+        ApduTimer timer(m_costModel.get(), ApduCostModel::StoreData);
+        success = m_commandSet->storeData(0x00, metadata);  // 0x00 = P1StoreDataPublic
+        timer.succeeded(success);
+    }
     
     if (!success) {
         setError(QString("Failed to store metadata: %1").arg(m_commandSet->lastError()));
@@ -1,15 +1,23 @@
 #pragma once
 
 #include "session_state.h"
+#include "pairing_slot_manager.h"
+#include "applet_capabilities.h"
+#include "session_stats.h"
+#include "../plan/execution_planner.h"
 #include <keycard-qt/keycard_channel.h>
 #include <keycard-qt/command_set.h>
 #include <QObject>
 #include <QTimer>
 #include <QMutex>
+#include <QElapsedTimer>
+#include <atomic>
 #include <memory>
 
 namespace StatusKeycard {
 
+class FilePairingStorage;
+
 /**
  * @brief Manages keycard session lifecycle
  * 
@@ -41,6 +49,16 @@ public:
     void stop();
     bool isStarted() const { return m_started; }
 
+    /**
+     * @brief Warm reset: drop logical session and auth state only
+     *
+     * Clears authorization, cached status/metadata and the last error while
+     * keeping the channel, reader detection and pairing cache. A connected
+     * card is re-selected (which drops its PIN verification) and reconnected
+     * with the cached pairing instead of waiting for a new detection.
+     */
+    void resetSession();
+
     // Current state
     SessionState currentState() const { return m_state; }
     QString currentStateString() const;
@@ -86,7 +104,70 @@ public:
         KeyPair masterKey;
     };
     RecoverKeys exportRecoverKeys();
-    
+
+    // Batched key export (keycard.ExportKeys)
+    struct KeyExportRequest {
+        QString path;
+        bool exportPrivate = false;    // Only allowed for EIP-1581 paths
+        bool exportChainCode = false;  // Requires extended export support (3.1+)
+    };
+
+    struct KeyExportResult {
+        QString path;
+        KeyPair key;
+        QString error;  // Empty on success
+    };
+
+    /**
+     * @brief Export an arbitrary set of keys in one locked batch
+     *
+     * Requests are de-duplicated and executed in derivation order (siblings
+     * adjacent, master last) so the card walks each subtree once. Results are
+     * returned in request order; per-item failures are reported in
+     * KeyExportResult::error, while lastError() is only set when the batch
+     * could not run at all (not authorized, no command set).
+     */
+    QVector<KeyExportResult> exportKeys(const QVector<KeyExportRequest>& requests);
+
+    /**
+     * @brief Defer pairing and OPEN SECURE CHANNEL until an operation needs it
+     *
+     * Card detection then only SELECTs the applet and reports Ready; the
+     * secure channel is opened by the first authorize/unblock/metadata call.
+     * Until then getStatus() has no keycardStatus (PIN/PUK retries).
+     */
+    void setLazySecureChannel(bool lazy) { m_lazySecureChannel = lazy; }
+    bool lazySecureChannel() const { return m_lazySecureChannel; }
+
+    /**
+     * @brief APDU latency model, calibrated from this session's card commands
+     *
+     * Shared so that flows on the same card (FlowManager::setCostModel) feed
+     * the same model.
+     */
+    ApduCostModel& costModel() { return *m_costModel; }
+    std::shared_ptr<ApduCostModel> sharedCostModel() const { return m_costModel; }
+
+    /**
+     * @brief Session state an execution plan would start from
+     */
+    PlanSession planSession() const;
+
+    /**
+     * @brief Capabilities of the connected applet (empty when no card is selected)
+     */
+    AppletCapabilities capabilities() const { return m_capabilities; }
+
+    /**
+     * @brief Dwell times per state and transition counters
+     */
+    SessionStats& stats() { return m_stats; }
+    qint64 stateDurationMs() const { return m_stateEntered.elapsed(); }  // Time in the current state
+
+    // Pairing slot policy (automatic reuse/unpair of stale host slots)
+    void setPairingSlotPolicy(const PairingSlotManager::Policy& policy) { m_slotManager.setPolicy(policy); }
+    PairingSlotManager::Policy pairingSlotPolicy() const { return m_slotManager.policy(); }
+
     // Channel access (for Android JNI bridge)
     Keycard::KeycardChannel* getChannel() { return m_channel.get(); }
     
@@ -132,6 +213,8 @@ public:
         }
     };
     Status getStatus() const;
+    // getStatus() for callers outside session operations; waits for the one in flight
+    Status lockedStatus() const;
     
     // Error handling
     QString lastError() const { return m_lastError; }
@@ -152,6 +235,13 @@ private:
     void setError(const QString& error);
     void startCardOperation();
     void operationCompleted();
+    std::shared_ptr<FilePairingStorage> filePairingStorage() const;  // Null for other storage types
+    SessionState openSecureChannel();  // Pair + open channel (operation mutex held); Ready on success
+    bool ensureSecureChannel();        // Opens a deferred channel; false (and error state) on failure
+    void setAppInfo(const Keycard::ApplicationInfo& appInfo);  // After every SELECT; rebuilds capabilities
+    void beginKeyExport();  // Start of each export operation; forgets the current key
+    QByteArray exportKeyData(const QString& path, bool makeCurrent, bool exportPrivate, bool exportChainCode);
+    KeyPair indexedKeyPair(const QString& path, const QByteArray& data);  // Parse, then record in AddressIndex
 
     // State
     SessionState m_state;
@@ -163,12 +253,22 @@ private:
     std::shared_ptr<Keycard::CommandSet> m_commandSet;
     Keycard::ApplicationInfo m_appInfo;
     Keycard::ApplicationStatus m_appStatus;  // Cached status to avoid redundant GET_STATUS calls
+    AppletCapabilities m_capabilities;
+    QString m_currentKeyPath;  // Path made current by EXPORT KEY during the running operation
     Metadata m_metadata;
     
     // Monitoring
     QTimer* m_stateCheckTimer;
     QString m_currentCardUID;
     bool m_authorized;
+    PairingSlotManager m_slotManager;
+    bool m_lazySecureChannel = false;
+    // Lazy mode: card selected, channel not opened yet. Atomic: planSession()
+    // reads it on the RPC thread without the operation lock
+    std::atomic<bool> m_secureChannelPending{false};
+    std::shared_ptr<ApduCostModel> m_costModel = std::make_shared<ApduCostModel>();
+    SessionStats m_stats;
+    QElapsedTimer m_stateEntered;
     
     // Thread safety - protects all card operations
     // MUST be recursive to allow exportRecoverKeys() to call exportLoginKeys()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QString>
+#include <QtGlobal>
 
 namespace StatusKeycard {
 
@@ -53,5 +54,66 @@ inline QString sessionStateToString(SessionState state) {
     return "unknown-reader-state";
 }
 
+constexpr int SessionStateCount = static_cast<int>(SessionState::NoAvailablePairingSlots) + 1;
+
+namespace SessionTransitions {
+
+constexpr quint32 bit(SessionState state) { return quint32(1) << static_cast<int>(state); }
+
+// Reachable from every state: the reader and the card can go away, be
+// (re)detected or the session be stopped at any time
+constexpr quint32 Always =
+    bit(SessionState::UnknownReaderState) | bit(SessionState::WaitingForReader) |
+    bit(SessionState::ReaderConnectionError) | bit(SessionState::WaitingForCard) |
+    bit(SessionState::ConnectingCard) | bit(SessionState::InternalError);
+
+// Card states reached from a connected card by an operation
+constexpr quint32 ChannelFailed =
+    bit(SessionState::ConnectionError) | bit(SessionState::PairingError) |
+    bit(SessionState::NoAvailablePairingSlots);
+constexpr quint32 Reset = bit(SessionState::FactoryResetting) | bit(SessionState::EmptyKeycard);
+constexpr quint32 Blocked = bit(SessionState::BlockedPIN) | bit(SessionState::BlockedPUK);
+
+// Additional targets per source state, in SessionState order
+constexpr quint32 Table[SessionStateCount] = {
+    /* UnknownReaderState */      0,
+    /* NoReadersFound */          0,
+    /* WaitingForReader */        0,
+    /* ReaderConnectionError */   0,
+    /* WaitingForCard */          0,
+    /* ConnectingCard */          ChannelFailed | Blocked | bit(SessionState::EmptyKeycard) |
+                                  bit(SessionState::NotKeycard) | bit(SessionState::Ready),
+    /* EmptyKeycard */            bit(SessionState::Ready),
+    /* NotKeycard */              0,
+    /* ConnectionError */         0,
+    /* PairingError */            0,
+    /* BlockedPIN */              Reset | bit(SessionState::BlockedPUK) | bit(SessionState::Ready) |
+                                  bit(SessionState::Authorized),
+    /* BlockedPUK */              Reset,
+    /* Ready */                   ChannelFailed | Reset | Blocked | bit(SessionState::Authorized),
+    /* Authorized */              ChannelFailed | Reset | Blocked | bit(SessionState::Ready),
+    /* FactoryResetting */        bit(SessionState::EmptyKeycard) | bit(SessionState::ConnectionError),
+    /* InternalError */           0,
+    /* NoAvailablePairingSlots */ 0,
+};
+
+} // namespace SessionTransitions
+
+/**
+ * @brief Whether the session may move from one state to another
+ *
+ * Staying in the same state is always valid.
+ */
+constexpr bool isValidSessionTransition(SessionState from, SessionState to)
+{
+    return from == to ||
+        ((SessionTransitions::Table[static_cast<int>(from)] | SessionTransitions::Always) &
+         SessionTransitions::bit(to)) != 0;
+}
+
+static_assert(SessionStateCount <= 32, "session transitions are 32-bit masks");
+static_assert(isValidSessionTransition(SessionState::ConnectingCard, SessionState::Ready), "");
+static_assert(!isValidSessionTransition(SessionState::WaitingForCard, SessionState::Authorized), "");
+
 } // namespace StatusKeycard
 
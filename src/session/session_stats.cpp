@@ -0,0 +1,76 @@
+#include "session_stats.h"
+#include <QMutexLocker>
+
+namespace StatusKeycard {
+
+namespace {
+
+int transitionKey(SessionState from, SessionState to)
+{
+    return static_cast<int>(from) * SessionStateCount + static_cast<int>(to);
+}
+
+} // namespace
+
+void SessionStats::recordTransition(SessionState from, SessionState to, qint64 dwellMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_dwell[static_cast<int>(from)].record(dwellMs);
+    ++m_transitions[transitionKey(from, to)];
+    if (!isValidSessionTransition(from, to)) {
+        ++m_invalid;
+    }
+}
+
+FlowStats::Histogram SessionStats::dwell(SessionState state) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dwell[static_cast<int>(state)];
+}
+
+quint64 SessionStats::transitions(SessionState from, SessionState to) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_transitions.value(transitionKey(from, to));
+}
+
+quint64 SessionStats::invalidTransitions() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_invalid;
+}
+
+QJsonObject SessionStats::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QJsonObject dwell;
+    for (int i = 0; i < SessionStateCount; ++i) {
+        if (m_dwell[i].count > 0) {
+            dwell[sessionStateToString(static_cast<SessionState>(i))] = m_dwell[i].toJson();
+        }
+    }
+
+    QJsonObject transitions;
+    for (auto it = m_transitions.constBegin(); it != m_transitions.constEnd(); ++it) {
+        auto from = static_cast<SessionState>(it.key() / SessionStateCount);
+        auto to = static_cast<SessionState>(it.key() % SessionStateCount);
+        transitions[sessionStateToString(from) + "->" + sessionStateToString(to)] = static_cast<double>(it.value());
+    }
+
+    QJsonObject json;
+    json["dwell"] = dwell;
+    json["transitions"] = transitions;
+    json["invalidTransitions"] = static_cast<double>(m_invalid);
+    return json;
+}
+
+void SessionStats::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_dwell = {};
+    m_transitions.clear();
+    m_invalid = 0;
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,43 @@
+#ifndef SESSION_STATS_H
+#define SESSION_STATS_H
+
+#include "session_state.h"
+#include "../flow/flow_stats.h"
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <array>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Session state dwell times and transition counters
+ *
+ * Each state change records how long the session stayed in the state it
+ * leaves (same power-of-two millisecond histograms as FlowStats), and counts
+ * the transition. Transitions missing from the SessionState transition table
+ * are counted separately.
+ *
+ * Thread-safe.
+ */
+class SessionStats {
+public:
+    void recordTransition(SessionState from, SessionState to, qint64 dwellMs);
+
+    FlowStats::Histogram dwell(SessionState state) const;
+    quint64 transitions(SessionState from, SessionState to) const;
+    quint64 invalidTransitions() const;
+
+    QJsonObject toJson() const;
+    void reset();
+
+private:
+    mutable QMutex m_mutex;
+    std::array<FlowStats::Histogram, SessionStateCount> m_dwell;
+    QHash<int, quint64> m_transitions;  // from * SessionStateCount + to
+    quint64 m_invalid = 0;
+};
+
+} // namespace StatusKeycard
+
+#endif // SESSION_STATS_H
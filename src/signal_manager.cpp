@@ -1,4 +1,6 @@
 #include "signal_manager.h"
+#include "signal_queue.h"
+#include "flight_recorder.h"
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -6,35 +8,26 @@
 
 namespace StatusKeycard {
 
-SignalManager* SignalManager::s_instance = nullptr;
-
-SignalManager::SignalManager()
-    : QObject(nullptr)
-    , m_callback(nullptr)
-{
-}
-
-SignalManager::~SignalManager()
-{
-}
+namespace {
 
-SignalManager* SignalManager::instance()
+// Top-level signal type, without parsing the payload. Keys are serialized in
+// sorted order, so the top-level "type" is the last one.
+QString signalType(const QString& jsonSignal)
 {
-    if (!s_instance) {
-        s_instance = new SignalManager();
+    static const QLatin1String typeKey("\"type\":\"");
+    qsizetype start = jsonSignal.lastIndexOf(typeKey);
+    if (start < 0) {
+        return QString();
     }
-    return s_instance;
+    start += typeKey.size();
+    qsizetype end = jsonSignal.indexOf(QLatin1Char('"'), start);
+    return jsonSignal.mid(start, end < 0 ? -1 : end - start);
 }
 
-void SignalManager::setCallback(SignalCallback callback)
+// Event of a full status-changed signal
+QJsonObject statusEvent(const SessionManager::Status& status)
 {
-    m_callback = callback;
-    qDebug() << "SignalManager: Callback" << (callback ? "set" : "cleared");
-}
-
-void SignalManager::emitStatusChanged(const SessionManager::Status& status)
-{
-    // Build the event object with the exact structure from status-keycard-go
+    // The exact structure from status-keycard-go
     QJsonObject event;
     event["state"] = status.state;
     
@@ -83,15 +76,92 @@ void SignalManager::emitStatusChanged(const SessionManager::Status& status)
         event["metadata"] = QJsonValue::Null;
     }
     
-    // Wrap in signal envelope
-    QJsonObject signal;
-    signal["type"] = "status-changed";
-    signal["event"] = event;
-    
-    QJsonDocument doc(signal);
-    QString jsonString = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    
-    sendSignal(jsonString);
+    return event;
+}
+
+} // namespace
+
+SignalManager* SignalManager::s_instance = nullptr;
+
+SignalManager::SignalManager()
+    : QObject(nullptr)
+    , m_defaultDelivery(std::make_shared<Delivery>())
+    , m_flowDelivery(m_defaultDelivery)
+{
+}
+
+SignalManager::~SignalManager()
+{
+}
+
+SignalManager* SignalManager::instance()
+{
+    if (!s_instance) {
+        s_instance = new SignalManager();
+    }
+    return s_instance;
+}
+
+void SignalManager::setCallback(SignalCallback callback)
+{
+    setCallback(*m_defaultDelivery, callback);
+}
+
+void SignalManager::setCallback(Delivery& delivery, SignalCallback callback)
+{
+    QMutexLocker locker(&delivery.mutex);
+    delivery.callback = callback;
+    qDebug() << "SignalManager: Callback" << (callback ? "set" : "cleared");
+}
+
+void SignalManager::emitStatusChanged(const SessionManager::Status& status)
+{
+    sendStatus(*m_defaultDelivery, m_statusDiffs, status, false);
+}
+
+void SignalManager::emitStatusSnapshot(const SessionManager::Status& status)
+{
+    sendStatus(*m_defaultDelivery, m_statusDiffs, status, true);
+}
+
+void SignalManager::emitStatusChanged(StatusDiffs& diffs, const SessionManager::Status& status)
+{
+    sendStatus(*m_defaultDelivery, diffs, status, false);
+}
+
+void SignalManager::emitStatusSnapshot(StatusDiffs& diffs, const SessionManager::Status& status)
+{
+    sendStatus(*m_defaultDelivery, diffs, status, true);
+}
+
+void SignalManager::emitStatusChanged(Delivery& delivery, StatusDiffs& diffs, const SessionManager::Status& status)
+{
+    sendStatus(delivery, diffs, status, false);
+}
+
+void SignalManager::emitStatusSnapshot(Delivery& delivery, StatusDiffs& diffs, const SessionManager::Status& status)
+{
+    sendStatus(delivery, diffs, status, true);
+}
+
+void SignalManager::setStatusDiffs(bool enabled)
+{
+    setStatusDiffs(m_statusDiffs, enabled);
+}
+
+bool SignalManager::statusDiffs() const
+{
+    QMutexLocker locker(&m_statusDiffs.mutex);
+    return m_statusDiffs.enabled;
+}
+
+void SignalManager::setStatusDiffs(StatusDiffs& diffs, bool enabled)
+{
+    QMutexLocker locker(&diffs.mutex);
+    diffs.enabled = enabled;
+    // Consumers start from a snapshot
+    diffs.last = QJsonObject();
+    qDebug() << "SignalManager: Status diffs" << (enabled ? "enabled" : "disabled");
 }
 
 void SignalManager::emitError(const QString& error)
@@ -103,18 +173,30 @@ void SignalManager::emitError(const QString& error)
     signal["type"] = "error";
     signal["event"] = event;
     
-    QJsonDocument doc(signal);
-    QString jsonString = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    
-    sendSignal(jsonString);
+    sendSignal(*flowDelivery(), QJsonDocument(signal).toJson(QJsonDocument::Compact), QStringLiteral("error"));
 }
 
 void SignalManager::emitSignal(const QString& jsonSignal)
 {
-    sendSignal(jsonSignal);
+    sendSignal(*flowDelivery(), jsonSignal.toUtf8(), signalType(jsonSignal));
+}
+
+void SignalManager::emitSerialized(QByteArray signal, const QString& type)
+{
+    sendSignal(*flowDelivery(), std::move(signal), type);
+}
+
+void SignalManager::emitSerialized(Delivery& delivery, QByteArray signal, const QString& type)
+{
+    sendSignal(delivery, std::move(signal), type);
 }
 
 void SignalManager::emitChannelStateChanged(const QString& state)
+{
+    emitChannelStateChanged(*m_defaultDelivery, state);
+}
+
+void SignalManager::emitChannelStateChanged(Delivery& delivery, const QString& state)
 {
     QJsonObject event;
     event["state"] = state;
@@ -123,22 +205,165 @@ void SignalManager::emitChannelStateChanged(const QString& state)
     signal["type"] = "channel-state-changed";
     signal["event"] = event;
     
-    QJsonDocument doc(signal);
-    QString jsonString = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    
-    sendSignal(jsonString);
+    sendSignal(delivery, QJsonDocument(signal).toJson(QJsonDocument::Compact),
+               QStringLiteral("channel-state-changed"));
+}
+
+int SignalManager::enableQueue(int capacity)
+{
+    return enableQueue(*m_defaultDelivery, capacity);
+}
+
+void SignalManager::disableQueue()
+{
+    disableQueue(*m_defaultDelivery);
 }
 
-void SignalManager::sendSignal(const QString& jsonSignal)
+std::shared_ptr<SignalQueue> SignalManager::queue() const
 {
-    if (!m_callback) {
-        qDebug() << "SignalManager: No callback set, signal dropped:" << jsonSignal;
+    return queue(*m_defaultDelivery);
+}
+
+int SignalManager::enableQueue(Delivery& delivery, int capacity)
+{
+    QMutexLocker locker(&delivery.mutex);
+    if (!delivery.queue) {
+        delivery.queue = std::make_shared<SignalQueue>(capacity);
+        ++delivery.queueGeneration;
+        qDebug() << "SignalManager: Signal queue enabled, capacity" << capacity;
+    } else if (delivery.queue->capacity() != capacity) {
+        // Same queue and fd; signals that no longer fit count as dropped
+        delivery.queue->setCapacity(capacity);
+        qDebug() << "SignalManager: Signal queue resized, capacity" << capacity;
+    }
+    return delivery.queue->fd();
+}
+
+void SignalManager::disableQueue(Delivery& delivery)
+{
+    // Buffered status diffs are discarded with the queue; the new generation
+    // makes the context's status stream start over from a snapshot. The fd
+    // closes once the last drain holding the queue returns.
+    QMutexLocker locker(&delivery.mutex);
+    delivery.queue.reset();
+    ++delivery.queueGeneration;
+    qDebug() << "SignalManager: Signal queue disabled";
+}
+
+std::shared_ptr<SignalQueue> SignalManager::queue(const Delivery& delivery)
+{
+    QMutexLocker locker(&delivery.mutex);
+    return delivery.queue;
+}
+
+void SignalManager::routeFlowSignals(std::shared_ptr<Delivery> delivery)
+{
+    QMutexLocker locker(&m_flowDeliveryMutex);
+    m_flowDelivery = delivery ? std::move(delivery) : m_defaultDelivery;
+}
+
+void SignalManager::resetFlowSignals(const Delivery* delivery)
+{
+    QMutexLocker locker(&m_flowDeliveryMutex);
+    if (m_flowDelivery.get() == delivery) {
+        m_flowDelivery = m_defaultDelivery;
+    }
+}
+
+std::shared_ptr<SignalManager::Delivery> SignalManager::flowDelivery() const
+{
+    QMutexLocker locker(&m_flowDeliveryMutex);
+    return m_flowDelivery;
+}
+
+void SignalManager::sendStatus(Delivery& delivery, StatusDiffs& diffs, const SessionManager::Status& status,
+                               bool snapshot)
+{
+    QJsonObject event = statusEvent(status);
+
+    std::shared_ptr<SignalQueue> signalQueue;
+    quint64 generation;
+    {
+        QMutexLocker locker(&delivery.mutex);
+        signalQueue = delivery.queue;
+        generation = delivery.queueGeneration;
+    }
+
+    // Built under the lock, sent after releasing it, so the callback can
+    // request a snapshot. Two racing updates may arrive out of order; the
+    // consumer then sees a baseVersion gap and asks for a snapshot.
+    QJsonObject signal;
+    {
+        QMutexLocker locker(&diffs.mutex);
+        if (!diffs.enabled) {
+            signal["type"] = "status-changed";
+            signal["event"] = event;
+        } else {
+            // A dropped signal may have been one of our diffs
+            quint64 dropped = signalQueue ? signalQueue->dropped() : 0;
+            bool gap = generation != diffs.queueGeneration || dropped != diffs.queueDropped;
+            diffs.queueGeneration = generation;
+            diffs.queueDropped = dropped;
+
+            if (snapshot || gap || diffs.last.isEmpty()) {
+                QJsonObject full = event;
+                full["version"] = static_cast<qint64>(++diffs.version);
+                signal["type"] = "status-changed";
+                signal["event"] = full;
+            } else {
+                QJsonObject changed;
+                for (auto it = event.constBegin(); it != event.constEnd(); ++it) {
+                    if (diffs.last.value(it.key()) != it.value()) {
+                        changed[it.key()] = it.value();
+                    }
+                }
+                if (changed.isEmpty()) {
+                    return;
+                }
+                QJsonObject diff;
+                diff["baseVersion"] = static_cast<qint64>(diffs.version);
+                diff["version"] = static_cast<qint64>(++diffs.version);
+                diff["changed"] = changed;
+                signal["type"] = "status-diff";
+                signal["event"] = diff;
+            }
+            diffs.last = event;
+        }
+    }
+
+    QString type = signal["type"].toString();
+    sendSignal(delivery, QJsonDocument(signal).toJson(QJsonDocument::Compact), type);
+}
+
+void SignalManager::sendSignal(Delivery& delivery, QByteArray signal, const QString& type)
+{
+    FlightRecorder::instance()->record(FlightRecorder::Event::Signal, 0, 0, 0, type);
+
+    // Serialized once; subscribers share the buffer, the queue takes it over
+    m_subscribers.publish(signal, type);
+
+    std::shared_ptr<SignalQueue> signalQueue;
+    SignalCallback callback;
+    {
+        QMutexLocker locker(&delivery.mutex);
+        signalQueue = delivery.queue;
+        callback = delivery.callback;
+    }
+
+    if (signalQueue) {
+        signalQueue->push(std::move(signal));
+        return;
+    }
+
+    if (!callback) {
+        if (m_subscribers.isEmpty()) {
+            qDebug() << "SignalManager: No callback set, signal dropped:" << type;
+        }
         return;
     }
     
-    // Convert QString to char* for C callback
-    QByteArray signalBytes = jsonSignal.toUtf8();
-    m_callback(signalBytes.constData());
+    // Called with no lock held, so the callback may emit or request a snapshot
+    callback(signal.constData());
 }
 
 } // namespace StatusKeycard
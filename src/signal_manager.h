@@ -3,35 +3,129 @@
 #include "../include/status-keycard-qt/status_keycard.h"
 #include "session/session_state.h"
 #include "session/session_manager.h"
+#include "signal_subscribers.h"
 #include <QObject>
 #include <QString>
+#include <QMutex>
+#include <QJsonObject>
+#include <memory>
 
 namespace StatusKeycard {
 
+class SignalQueue;
+
 /**
  * @brief Manages signal callbacks to Nim/C code
  * 
- * Bridges Qt signals to C callback mechanism.
+ * Bridges Qt signals to C callback mechanism. With the signal queue enabled,
+ * signals are buffered for KeycardDrainSignals() instead of being pushed
+ * through the callback. Each signal is serialized once and the same buffer
+ * is also handed to every registered subscriber.
+ *
+ * Callbacks and signal queues are per C API context (Delivery). Signals a
+ * context emits (status, channel state) go to its own callback or queue;
+ * signals not tied to a context (flow results, errors) go to the context
+ * that initialized the flow API, see routeFlowSignals(). The overloads
+ * without a Delivery use the default one, which belongs to the global
+ * context.
+ *
+ * With status diffs enabled, status updates are versioned: a full
+ * "status-changed" snapshot carries "version", and later updates are sent as
+ * "status-diff" signals holding only the top-level fields that changed and
+ * the "baseVersion" they apply to. A snapshot is sent again when diffs are
+ * enabled, when the signal queue dropped signals since the last update, and
+ * on request (emitStatusSnapshot()), e.g. after a consumer saw a version gap.
+ * The diff state (StatusDiffs) belongs to whoever owns the status stream,
+ * one per C API context; the overloads without it use a default stream.
  */
 class SignalManager : public QObject {
     Q_OBJECT
 
 public:
+    /**
+     * @brief Version and last sent status of one status stream
+     */
+    struct StatusDiffs {
+        mutable QMutex mutex;
+        bool enabled = false;
+        quint64 version = 0;
+        QJsonObject last;            // Empty until the next snapshot
+        quint64 queueGeneration = 0; // Signal queue the last status went to
+        quint64 queueDropped = 0;    // Its drops at the last status signal
+    };
+
+    /**
+     * @brief Callback and signal queue of one context
+     */
+    struct Delivery {
+        mutable QMutex mutex;
+        SignalCallback callback = nullptr;
+        std::shared_ptr<SignalQueue> queue;
+        quint64 queueGeneration = 0;  // Bumped when the queue is replaced
+    };
+
     static SignalManager* instance();
     
     void setCallback(SignalCallback callback);
+    static void setCallback(Delivery& delivery, SignalCallback callback);
     void emitStatusChanged(const SessionManager::Status& status);
+    void emitStatusSnapshot(const SessionManager::Status& status);
+    void emitStatusChanged(StatusDiffs& diffs, const SessionManager::Status& status);
+    void emitStatusSnapshot(StatusDiffs& diffs, const SessionManager::Status& status);
+    void emitStatusChanged(Delivery& delivery, StatusDiffs& diffs, const SessionManager::Status& status);
+    void emitStatusSnapshot(Delivery& delivery, StatusDiffs& diffs, const SessionManager::Status& status);
     void emitError(const QString& error);
     void emitSignal(const QString& jsonSignal);
+    // Already serialized UTF-8 JSON; the buffer is moved, not copied, to the
+    // queue or callback and shared with subscribers
+    void emitSerialized(QByteArray signal, const QString& type);
+    void emitSerialized(Delivery& delivery, QByteArray signal, const QString& type);
     void emitChannelStateChanged(const QString& state);
+    void emitChannelStateChanged(Delivery& delivery, const QString& state);
+
+    // Versioned status diffs; off by default (full status-changed, no version)
+    void setStatusDiffs(bool enabled);
+    bool statusDiffs() const;
+    static void setStatusDiffs(StatusDiffs& diffs, bool enabled);
+
+    // Pull-based delivery. Enabling an enabled queue resizes it, keeping its
+    // fd; disabling closes the fd, so the host must stop polling it first.
+    int enableQueue(int capacity);  // Returns the readiness fd (-1 if unsupported)
+    void disableQueue();
+    std::shared_ptr<SignalQueue> queue() const;
+    static int enableQueue(Delivery& delivery, int capacity);
+    static void disableQueue(Delivery& delivery);
+    static std::shared_ptr<SignalQueue> queue(const Delivery& delivery);
+
+    std::shared_ptr<Delivery> defaultDelivery() const { return m_defaultDelivery; }
+
+    /**
+     * @brief Send signals not tied to a context to this delivery
+     *
+     * nullptr returns them to the default delivery. resetFlowSignals() only
+     * does so while the given delivery is the current target, for contexts
+     * going away.
+     */
+    void routeFlowSignals(std::shared_ptr<Delivery> delivery);
+    void resetFlowSignals(const Delivery* delivery);
+
+    // Additional consumers (loggers, metrics), independent of the callback
+    SignalSubscribers* subscribers() { return &m_subscribers; }
 
 private:
     SignalManager();
     ~SignalManager();
     
-    void sendSignal(const QString& jsonSignal);
+    std::shared_ptr<Delivery> flowDelivery() const;
+    void sendSignal(Delivery& delivery, QByteArray signal, const QString& type);
+    void sendStatus(Delivery& delivery, StatusDiffs& diffs, const SessionManager::Status& status, bool snapshot);
     
-    SignalCallback m_callback;
+    SignalSubscribers m_subscribers;
+
+    const std::shared_ptr<Delivery> m_defaultDelivery;
+    std::shared_ptr<Delivery> m_flowDelivery;  // Guarded by m_flowDeliveryMutex
+    mutable QMutex m_flowDeliveryMutex;
+    StatusDiffs m_statusDiffs;  // Default status stream
     static SignalManager* s_instance;
 };
 
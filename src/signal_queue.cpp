@@ -0,0 +1,180 @@
+#include "signal_queue.h"
+#include <QDebug>
+#include <QtGlobal>
+#include <cstring>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define SIGNAL_QUEUE_EVENTFD
+#elif defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#define SIGNAL_QUEUE_PIPE
+#endif
+
+namespace StatusKeycard {
+
+SignalQueue::SignalQueue(int capacity)
+    : m_ring(qMax(1, capacity))
+    , m_head(0)
+    , m_count(0)
+    , m_dropped(0)
+    , m_ready(false)
+    , m_readFd(-1)
+    , m_writeFd(-1)
+{
+#if defined(SIGNAL_QUEUE_EVENTFD)
+    m_readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_writeFd = m_readFd;
+#elif defined(SIGNAL_QUEUE_PIPE)
+    int fds[2];
+    if (pipe(fds) == 0) {
+        for (int fd : fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        m_readFd = fds[0];
+        m_writeFd = fds[1];
+    }
+#endif
+    if (m_readFd < 0) {
+        qWarning() << "SignalQueue: No readiness descriptor available, poll by draining";
+    }
+}
+
+SignalQueue::~SignalQueue()
+{
+#if defined(SIGNAL_QUEUE_EVENTFD) || defined(SIGNAL_QUEUE_PIPE)
+    if (m_readFd >= 0) {
+        close(m_readFd);
+    }
+    if (m_writeFd >= 0 && m_writeFd != m_readFd) {
+        close(m_writeFd);
+    }
+#endif
+}
+
+void SignalQueue::push(QByteArray signal)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_count == m_ring.size()) {
+        // Full: overwrite the oldest signal
+        m_head = (m_head + 1) % m_ring.size();
+        m_count--;
+        m_dropped++;
+    }
+
+    m_ring[(m_head + m_count) % m_ring.size()] = std::move(signal);
+    m_count++;
+    setReady(true);
+}
+
+void SignalQueue::setCapacity(int capacity)
+{
+    QMutexLocker locker(&m_mutex);
+    capacity = qMax(1, capacity);
+    if (capacity == m_ring.size()) {
+        return;
+    }
+
+    int keep = qMin(m_count, capacity);
+    int skip = m_count - keep;
+    QVector<QByteArray> ring(capacity);
+    for (int i = 0; i < keep; i++) {
+        ring[i] = std::move(m_ring[(m_head + skip + i) % m_ring.size()]);
+    }
+    m_ring = std::move(ring);
+    m_head = 0;
+    m_count = keep;
+    m_dropped += skip;
+}
+
+int SignalQueue::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_ring.size();
+}
+
+int SignalQueue::drain(char* buf, int capacity)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_count == 0) {
+        if (buf && capacity > 0) {
+            buf[0] = '\0';
+        }
+        return 0;
+    }
+
+    int written = 0;
+    int offset = 0;
+    while (m_count > 0) {
+        QByteArray& signal = m_ring[m_head];
+        // Separator before every signal but the first, NUL after the last
+        int needed = signal.size() + (written > 0 ? 1 : 0) + 1;
+        if (!buf || offset + needed > capacity) {
+            if (written == 0) {
+                return -(signal.size() + 1);
+            }
+            break;
+        }
+        if (written > 0) {
+            buf[offset++] = '\n';
+        }
+        memcpy(buf + offset, signal.constData(), signal.size());
+        offset += signal.size();
+
+        signal.clear();
+        m_head = (m_head + 1) % m_ring.size();
+        m_count--;
+        written++;
+    }
+    buf[offset] = '\0';
+
+    if (m_count == 0) {
+        setReady(false);
+    }
+    return written;
+}
+
+int SignalQueue::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_count;
+}
+
+quint64 SignalQueue::dropped() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dropped;
+}
+
+void SignalQueue::setReady(bool ready)
+{
+    // One wakeup per empty -> non-empty transition, however bursty the stream
+    if (ready == m_ready || m_readFd < 0) {
+        m_ready = ready;
+        return;
+    }
+    m_ready = ready;
+
+#if defined(SIGNAL_QUEUE_EVENTFD)
+    if (ready) {
+        eventfd_write(m_writeFd, 1);
+    } else {
+        eventfd_t value;
+        eventfd_read(m_readFd, &value);
+    }
+#elif defined(SIGNAL_QUEUE_PIPE)
+    char byte = 0;
+    if (ready) {
+        (void)write(m_writeFd, &byte, 1);
+    } else {
+        (void)read(m_readFd, &byte, 1);
+    }
+#endif
+}
+
+} // namespace StatusKeycard
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QVector>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Bounded queue of serialized signals for pull-based delivery
+ *
+ * Signals are buffered in a ring and handed out in batches by drain().
+ * Readiness is exposed through a file descriptor (eventfd on Linux, a pipe
+ * on other POSIX systems) that is readable while the queue is non-empty, so
+ * hosts can poll it from their own event loop. When full, the oldest signal
+ * is dropped and counted. The descriptor is closed with the queue.
+ */
+class SignalQueue {
+public:
+    explicit SignalQueue(int capacity);
+    ~SignalQueue();
+    SignalQueue(const SignalQueue&) = delete;
+    SignalQueue& operator=(const SignalQueue&) = delete;
+
+    void push(QByteArray signal);
+
+    /**
+     * @brief Change the capacity, keeping the newest pending signals
+     *
+     * Signals that no longer fit are dropped and counted.
+     */
+    void setCapacity(int capacity);
+    int capacity() const;
+
+    /**
+     * @brief Copy pending signals into buf as newline-separated JSON
+     *
+     * Writes as many whole signals as fit, NUL-terminated, and removes them
+     * from the queue.
+     *
+     * @return Number of signals written; 0 if empty; -N if the next signal
+     *         needs a buffer of N bytes
+     */
+    int drain(char* buf, int capacity);
+
+    /**
+     * @brief Readiness descriptor (-1 where unsupported)
+     */
+    int fd() const { return m_readFd; }
+
+    int size() const;
+    quint64 dropped() const;
+
+private:
+    void setReady(bool ready);  // m_mutex held
+
+    mutable QMutex m_mutex;
+    QVector<QByteArray> m_ring;
+    int m_head;   // Oldest signal
+    int m_count;
+    quint64 m_dropped;
+    bool m_ready;
+    int m_readFd;
+    int m_writeFd;  // Same as m_readFd for eventfd
+};
+
+} // namespace StatusKeycard
@@ -0,0 +1,184 @@
+#include "signal_subscribers.h"
+#include <QDebug>
+#include <QQueue>
+#include <QWaitCondition>
+#include <atomic>
+#include <thread>
+
+namespace StatusKeycard {
+
+struct SignalSubscribers::Subscriber {
+    int id = 0;
+    Callback callback;
+    QStringList types;
+    int capacity = 0;
+
+    QMutex mutex;
+    QWaitCondition ready;
+    QQueue<QByteArray> pending;
+    int maxPending = 0;
+    quint64 dropped = 0;
+    bool stopped = false;
+    std::atomic<quint64> delivered{0};
+    std::thread thread;
+
+    bool matches(const QString& type) const
+    {
+        if (types.isEmpty()) {
+            return true;
+        }
+        for (const QString& filter : types) {
+            if (filter.endsWith(QLatin1Char('*'))) {
+                if (type.startsWith(QStringView(filter).chopped(1))) {
+                    return true;
+                }
+            } else if (filter == type) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+SignalSubscribers::SignalSubscribers()
+    : m_nextId(1)
+{
+}
+
+SignalSubscribers::~SignalSubscribers()
+{
+    QVector<std::shared_ptr<Subscriber>> subscribers;
+    {
+        QMutexLocker locker(&m_mutex);
+        subscribers.swap(m_subscribers);
+    }
+    for (const auto& subscriber : subscribers) {
+        stop(subscriber);
+    }
+}
+
+int SignalSubscribers::subscribe(Callback callback, const QStringList& types, int capacity)
+{
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->callback = std::move(callback);
+    subscriber->types = types;
+    subscriber->capacity = qMax(1, capacity);
+
+    QMutexLocker locker(&m_mutex);
+    subscriber->id = m_nextId++;
+    subscriber->thread = std::thread(&SignalSubscribers::run, subscriber);
+    m_subscribers.append(subscriber);
+    qDebug() << "SignalSubscribers: Subscriber" << subscriber->id << "added, types" << types;
+    return subscriber->id;
+}
+
+bool SignalSubscribers::unsubscribe(int id)
+{
+    std::shared_ptr<Subscriber> subscriber;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < m_subscribers.size(); ++i) {
+            if (m_subscribers[i]->id == id) {
+                subscriber = m_subscribers.takeAt(i);
+                break;
+            }
+        }
+    }
+    if (!subscriber) {
+        return false;
+    }
+    stop(subscriber);
+    qDebug() << "SignalSubscribers: Subscriber" << id << "removed";
+    return true;
+}
+
+void SignalSubscribers::publish(const QByteArray& signal, const QString& type)
+{
+    QVector<std::shared_ptr<Subscriber>> subscribers;
+    {
+        QMutexLocker locker(&m_mutex);
+        subscribers = m_subscribers;
+    }
+
+    for (const auto& subscriber : subscribers) {
+        if (!subscriber->matches(type)) {
+            continue;
+        }
+        QMutexLocker locker(&subscriber->mutex);
+        if (subscriber->pending.size() >= subscriber->capacity) {
+            subscriber->pending.dequeue();
+            ++subscriber->dropped;
+        }
+        subscriber->pending.enqueue(signal);
+        subscriber->maxPending = qMax(subscriber->maxPending, static_cast<int>(subscriber->pending.size()));
+        subscriber->ready.wakeOne();
+    }
+}
+
+bool SignalSubscribers::isEmpty() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_subscribers.isEmpty();
+}
+
+QVector<SignalSubscribers::Stats> SignalSubscribers::stats() const
+{
+    QVector<std::shared_ptr<Subscriber>> subscribers;
+    {
+        QMutexLocker locker(&m_mutex);
+        subscribers = m_subscribers;
+    }
+
+    QVector<Stats> result;
+    result.reserve(subscribers.size());
+    for (const auto& subscriber : subscribers) {
+        Stats stats;
+        stats.id = subscriber->id;
+        stats.types = subscriber->types;
+        stats.capacity = subscriber->capacity;
+        stats.delivered = subscriber->delivered.load(std::memory_order_relaxed);
+        QMutexLocker locker(&subscriber->mutex);
+        stats.pending = static_cast<int>(subscriber->pending.size());
+        stats.maxPending = subscriber->maxPending;
+        stats.dropped = subscriber->dropped;
+        result.append(stats);
+    }
+    return result;
+}
+
+void SignalSubscribers::run(std::shared_ptr<Subscriber> subscriber)
+{
+    for (;;) {
+        QByteArray signal;
+        {
+            QMutexLocker locker(&subscriber->mutex);
+            while (subscriber->pending.isEmpty() && !subscriber->stopped) {
+                subscriber->ready.wait(&subscriber->mutex);
+            }
+            if (subscriber->stopped) {
+                return;
+            }
+            signal = subscriber->pending.dequeue();
+        }
+        subscriber->callback(signal);
+        subscriber->delivered.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SignalSubscribers::stop(const std::shared_ptr<Subscriber>& subscriber)
+{
+    {
+        QMutexLocker locker(&subscriber->mutex);
+        subscriber->stopped = true;
+        subscriber->pending.clear();
+        subscriber->ready.wakeAll();
+    }
+    // Removed from its own callback: the thread exits once the callback returns
+    if (subscriber->thread.get_id() == std::this_thread::get_id()) {
+        subscriber->thread.detach();
+    } else if (subscriber->thread.joinable()) {
+        subscriber->thread.join();
+    }
+}
+
+} // namespace StatusKeycard
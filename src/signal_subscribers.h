@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+namespace StatusKeycard {
+
+/**
+ * @brief Registry of independent signal subscribers
+ *
+ * Each subscriber has its own type filter, bounded queue and delivery
+ * thread, so a slow consumer only fills its own queue (oldest signals are
+ * dropped and counted) and never delays the others or the emitter.
+ *
+ * Signals are published already serialized: every subscriber receives the
+ * same implicitly shared QByteArray, so fan-out costs one reference count
+ * per subscriber rather than a copy or a re-serialization.
+ */
+class SignalSubscribers {
+public:
+    // Runs on the subscriber's delivery thread; signal is valid for the call
+    using Callback = std::function<void(const QByteArray& signal)>;
+
+    struct Stats {
+        int id = 0;
+        QStringList types;
+        int capacity = 0;
+        int pending = 0;        // Queued, not yet delivered
+        int maxPending = 0;     // High-water mark of pending
+        quint64 delivered = 0;
+        quint64 dropped = 0;    // Overwritten while the queue was full
+    };
+
+    SignalSubscribers();
+    ~SignalSubscribers();
+    SignalSubscribers(const SignalSubscribers&) = delete;
+    SignalSubscribers& operator=(const SignalSubscribers&) = delete;
+
+    /**
+     * @brief Add a subscriber
+     *
+     * @param types Signal types to deliver (empty for all); an entry ending
+     *              in '*' matches by prefix, e.g. "keycard.flow-*"
+     * @param capacity Maximum number of queued signals
+     * @return Subscriber id (> 0)
+     */
+    int subscribe(Callback callback, const QStringList& types = {}, int capacity = 256);
+
+    /**
+     * @brief Remove a subscriber and drop its pending signals
+     *
+     * Waits for a callback in progress, so the callback is never invoked
+     * after this returns (unless called from that callback itself).
+     */
+    bool unsubscribe(int id);
+
+    void publish(const QByteArray& signal, const QString& type);
+
+    bool isEmpty() const;
+    QVector<Stats> stats() const;
+
+private:
+    struct Subscriber;
+    static void run(std::shared_ptr<Subscriber> subscriber);
+    static void stop(const std::shared_ptr<Subscriber>& subscriber);
+
+    mutable QMutex m_mutex;
+    QVector<std::shared_ptr<Subscriber>> m_subscribers;
+    int m_nextId;
+};
+
+} // namespace StatusKeycard
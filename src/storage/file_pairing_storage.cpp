@@ -1,9 +1,14 @@
 #include "file_pairing_storage.h"
+#include "../hex_codec.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QMutexLocker>
 #include <QDebug>
+#include <algorithm>
 
 namespace StatusKeycard {
 
@@ -13,7 +18,19 @@ FilePairingStorage::FilePairingStorage()
 
 void FilePairingStorage::setPath(const QString& filePath)
 {
+    QMutexLocker locker(&m_mutex);
+
+    if (filePath == m_filePath) {
+        return;
+    }
+
+    // Different file: drop the cache, it is re-read on next access
     m_filePath = filePath;
+    m_loaded = false;
+    m_dirty = false;
+    m_records.clear();
+    m_keyUIDIndex.clear();
+    m_retired.clear();
 }
 
 QJsonObject FilePairingStorage::loadAllPairings()
@@ -83,65 +100,173 @@ bool FilePairingStorage::saveAllPairings(const QJsonObject& pairings)
     return true;
 }
 
-Keycard::PairingInfo FilePairingStorage::load(const QString& cardInstanceUID)
+bool FilePairingStorage::ensureLoaded()
 {
-    qDebug() << "FilePairingStorage: Loading pairing for card:" << cardInstanceUID;
-    
+    if (m_loaded) {
+        return true;
+    }
+
     QJsonObject allPairings = loadAllPairings();
-    
-    if (!allPairings.contains(cardInstanceUID)) {
-        qDebug() << "FilePairingStorage: No pairing found for card:" << cardInstanceUID;
-        return Keycard::PairingInfo();
+
+    m_records.clear();
+    m_keyUIDIndex.clear();
+    m_retired.clear();
+
+    for (auto it = allPairings.constBegin(); it != allPairings.constEnd(); ++it) {
+        if (!it.value().isObject()) {
+            qWarning() << "FilePairingStorage: Skipping invalid pairing data for card:" << it.key();
+            continue;
+        }
+
+        QJsonObject pairingObj = it.value().toObject();
+
+        QVector<RetiredPairing> retired;
+        for (const QJsonValue& val : pairingObj["retired"].toArray()) {
+            QJsonObject retiredObj = val.toObject();
+            RetiredPairing entry;
+            entry.pairing.key = HexCodec::fromHex(retiredObj["key"].toString());
+            entry.pairing.index = retiredObj["index"].toInt();
+            entry.lastUsed = static_cast<qint64>(retiredObj["lastUsed"].toDouble());
+            if (entry.pairing.isValid()) {
+                retired.append(entry);
+            }
+        }
+        if (!retired.isEmpty()) {
+            m_retired.insert(it.key(), retired);
+        }
+
+        // Cards with only retired pairings have no "key"
+        if (!pairingObj.contains("key")) {
+            continue;
+        }
+
+        PairingRecord record;
+        record.instanceUID = it.key();
+        record.pairing.key = HexCodec::fromHex(pairingObj["key"].toString());
+        record.pairing.index = pairingObj["index"].toInt();
+        record.keyUID = pairingObj["keyUID"].toString();
+        record.lastUsed = static_cast<qint64>(pairingObj["lastUsed"].toDouble());
+
+        if (!record.pairing.isValid()) {
+            qWarning() << "FilePairingStorage: Skipping invalid pairing data for card:" << it.key();
+            continue;
+        }
+
+        m_records.insert(record.instanceUID, record);
+        if (!record.keyUID.isEmpty()) {
+            m_keyUIDIndex.insert(record.keyUID, record.instanceUID);
+        }
     }
-    
-    QJsonValue pairingValue = allPairings[cardInstanceUID];
-    if (!pairingValue.isObject()) {
-        qWarning() << "FilePairingStorage: Invalid pairing data for card:" << cardInstanceUID;
-        return Keycard::PairingInfo();
+
+    m_loaded = true;
+    m_dirty = false;
+
+    qDebug() << "FilePairingStorage: Cached" << m_records.size() << "pairings from" << m_filePath;
+    return true;
+}
+
+bool FilePairingStorage::writeCache()
+{
+    QJsonObject allPairings;
+    for (const PairingRecord& record : m_records) {
+        QJsonObject pairingObj;
+        pairingObj["key"] = HexCodec::toHex(record.pairing.key);
+        pairingObj["index"] = record.pairing.index;
+        if (!record.keyUID.isEmpty()) {
+            pairingObj["keyUID"] = record.keyUID;
+        }
+        if (record.lastUsed > 0) {
+            pairingObj["lastUsed"] = static_cast<double>(record.lastUsed);
+        }
+        allPairings[record.instanceUID] = pairingObj;
     }
-    
-    QJsonObject pairingObj = pairingValue.toObject();
-    
-    // Parse pairing info
-    Keycard::PairingInfo pairing;
-    pairing.key = QByteArray::fromHex(pairingObj["key"].toString().toUtf8());
-    pairing.index = pairingObj["index"].toInt();
-    
-    if (!pairing.isValid()) {
-        qWarning() << "FilePairingStorage: Loaded invalid pairing data for card:" << cardInstanceUID;
+
+    for (auto it = m_retired.constBegin(); it != m_retired.constEnd(); ++it) {
+        QJsonArray retiredArray;
+        for (const RetiredPairing& entry : it.value()) {
+            QJsonObject retiredObj;
+            retiredObj["key"] = HexCodec::toHex(entry.pairing.key);
+            retiredObj["index"] = entry.pairing.index;
+            retiredObj["lastUsed"] = static_cast<double>(entry.lastUsed);
+            retiredArray.append(retiredObj);
+        }
+        QJsonObject pairingObj = allPairings[it.key()].toObject();
+        pairingObj["retired"] = retiredArray;
+        allPairings[it.key()] = pairingObj;
+    }
+
+    if (!saveAllPairings(allPairings)) {
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+bool FilePairingStorage::prefetch()
+{
+    QMutexLocker locker(&m_mutex);
+    return ensureLoaded();
+}
+
+Keycard::PairingInfo FilePairingStorage::load(const QString& cardInstanceUID)
+{
+    qDebug() << "FilePairingStorage: Loading pairing for card:" << cardInstanceUID;
+
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    auto it = m_records.constFind(cardInstanceUID);
+    if (it == m_records.constEnd()) {
+        qDebug() << "FilePairingStorage: No pairing found for card:" << cardInstanceUID;
         return Keycard::PairingInfo();
     }
-    
-    qDebug() << "FilePairingStorage: Successfully loaded pairing, index:" << pairing.index;
-    return pairing;
+
+    qDebug() << "FilePairingStorage: Successfully loaded pairing, index:" << it->pairing.index;
+    return it->pairing;
 }
 
 bool FilePairingStorage::save(const QString& cardInstanceUID, const Keycard::PairingInfo& pairing)
 {
     qDebug() << "FilePairingStorage: Saving pairing for card:" << cardInstanceUID << "index:" << pairing.index;
-    
+
     if (!pairing.isValid()) {
         qWarning() << "FilePairingStorage: Cannot save invalid pairing";
         return false;
     }
-    
-    // Load all existing pairings
-    QJsonObject allPairings = loadAllPairings();
-    
-    // Create pairing object
-    QJsonObject pairingObj;
-    pairingObj["key"] = QString(pairing.key.toHex());
-    pairingObj["index"] = pairing.index;
-    
-    // Add/update this card's pairing
-    allPairings[cardInstanceUID] = pairingObj;
-    
+
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    // A replaced pairing may still hold its slot on the card
+    auto existing = m_records.constFind(cardInstanceUID);
+    if (existing != m_records.constEnd() && existing->pairing.index != pairing.index) {
+        retire(cardInstanceUID, existing->pairing, existing->lastUsed);
+    }
+
+    // The slot is current again, it is no longer retired
+    auto retired = m_retired.find(cardInstanceUID);
+    if (retired != m_retired.end()) {
+        retired->erase(std::remove_if(retired->begin(), retired->end(), [&](const RetiredPairing& entry) {
+            return entry.pairing.index == pairing.index;
+        }), retired->end());
+        if (retired->isEmpty()) {
+            m_retired.erase(retired);
+        }
+    }
+
+    // Add/update this card's pairing, keeping its secondary fields
+    PairingRecord& record = m_records[cardInstanceUID];
+    record.instanceUID = cardInstanceUID;
+    record.pairing = pairing;
+    record.lastUsed = QDateTime::currentMSecsSinceEpoch();
+
     // Save all pairings back
-    if (!saveAllPairings(allPairings)) {
+    if (!writeCache()) {
         qWarning() << "FilePairingStorage: Failed to save pairings";
         return false;
     }
-    
+
     qDebug() << "FilePairingStorage: Successfully saved pairing for card:" << cardInstanceUID;
     return true;
 }
@@ -149,26 +274,201 @@ bool FilePairingStorage::save(const QString& cardInstanceUID, const Keycard::Pai
 bool FilePairingStorage::remove(const QString& cardInstanceUID)
 {
     qDebug() << "FilePairingStorage: Removing pairing for card:" << cardInstanceUID;
-    
-    // Load all existing pairings
-    QJsonObject allPairings = loadAllPairings();
-    
-    if (!allPairings.contains(cardInstanceUID)) {
+
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    auto it = m_records.find(cardInstanceUID);
+    if (it == m_records.end()) {
         qDebug() << "FilePairingStorage: No pairing found to remove for card:" << cardInstanceUID;
         return true;  // Already gone
     }
-    
-    // Remove this card's pairing
-    allPairings.remove(cardInstanceUID);
-    
+
+    // Remove this card's pairing; its slot is tracked until unpaired or reused
+    m_keyUIDIndex.remove(it->keyUID, cardInstanceUID);
+    retire(cardInstanceUID, it->pairing, it->lastUsed);
+    m_records.erase(it);
+
     // Save updated pairings back
-    if (!saveAllPairings(allPairings)) {
+    if (!writeCache()) {
         qWarning() << "FilePairingStorage: Failed to save pairings after removal";
         return false;
     }
-    
+
     qDebug() << "FilePairingStorage: Successfully removed pairing for card:" << cardInstanceUID;
     return true;
 }
 
+bool FilePairingStorage::recordConnection(const QString& cardInstanceUID, const QString& keyUID)
+{
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    auto it = m_records.find(cardInstanceUID);
+    if (it == m_records.end()) {
+        return false;
+    }
+
+    it->lastUsed = QDateTime::currentMSecsSinceEpoch();
+    m_dirty = true;
+
+    if (it->keyUID == keyUID) {
+        return true;
+    }
+
+    // keyUID changes on key load/factory reset; drop only this card's entry
+    m_keyUIDIndex.remove(it->keyUID, cardInstanceUID);
+    it->keyUID = keyUID;
+    if (!keyUID.isEmpty()) {
+        m_keyUIDIndex.insert(keyUID, cardInstanceUID);
+    }
+
+    return writeCache();
+}
+
+FilePairingStorage::PairingRecord FilePairingStorage::findByKeyUID(const QString& keyUID)
+{
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    // A keycard and its backups share the keyUID; prefer the one used last
+    PairingRecord found;
+    for (auto it = m_keyUIDIndex.constFind(keyUID); it != m_keyUIDIndex.constEnd() && it.key() == keyUID; ++it) {
+        auto record = m_records.constFind(it.value());
+        if (record != m_records.constEnd() && (found.instanceUID.isEmpty() || record->lastUsed > found.lastUsed)) {
+            found = *record;
+        }
+    }
+    return found;
+}
+
+QVector<FilePairingStorage::PairingRecord> FilePairingStorage::listPairings()
+{
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    QVector<PairingRecord> records;
+    records.reserve(m_records.size());
+    for (const PairingRecord& record : m_records) {
+        records.append(record);
+    }
+
+    std::sort(records.begin(), records.end(), [](const PairingRecord& a, const PairingRecord& b) {
+        if (a.lastUsed != b.lastUsed) {
+            return a.lastUsed > b.lastUsed;
+        }
+        return a.instanceUID < b.instanceUID;
+    });
+
+    return records;
+}
+
+bool FilePairingStorage::flush()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_loaded || !m_dirty) {
+        return true;
+    }
+
+    return writeCache();
+}
+
+void FilePairingStorage::retire(const QString& cardInstanceUID, const Keycard::PairingInfo& pairing, qint64 lastUsed)
+{
+    QVector<RetiredPairing>& retired = m_retired[cardInstanceUID];
+
+    retired.erase(std::remove_if(retired.begin(), retired.end(), [&](const RetiredPairing& entry) {
+        return entry.pairing.index == pairing.index;
+    }), retired.end());
+    retired.append({pairing, lastUsed});
+
+    // Keep the most recently used entries
+    std::sort(retired.begin(), retired.end(), [](const RetiredPairing& a, const RetiredPairing& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+    while (retired.size() > MaxRetiredPairings) {
+        retired.removeFirst();
+    }
+}
+
+QVector<FilePairingStorage::RetiredPairing> FilePairingStorage::retiredPairings(const QString& cardInstanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    return m_retired.value(cardInstanceUID);
+}
+
+bool FilePairingStorage::restoreRetired(const QString& cardInstanceUID, int index)
+{
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    auto retired = m_retired.find(cardInstanceUID);
+    if (retired == m_retired.end()) {
+        return false;
+    }
+
+    auto entry = std::find_if(retired->begin(), retired->end(), [index](const RetiredPairing& e) {
+        return e.pairing.index == index;
+    });
+    if (entry == retired->end()) {
+        return false;
+    }
+
+    RetiredPairing restored = *entry;
+    retired->erase(entry);
+    if (retired->isEmpty()) {
+        m_retired.erase(retired);
+    }
+
+    auto current = m_records.constFind(cardInstanceUID);
+    if (current != m_records.constEnd()) {
+        retire(cardInstanceUID, current->pairing, current->lastUsed);
+    }
+
+    PairingRecord& record = m_records[cardInstanceUID];
+    record.instanceUID = cardInstanceUID;
+    record.pairing = restored.pairing;
+    record.lastUsed = restored.lastUsed;
+
+    qDebug() << "FilePairingStorage: Restored retired pairing for card:" << cardInstanceUID << "index:" << index;
+    return writeCache();
+}
+
+bool FilePairingStorage::forgetSlot(const QString& cardInstanceUID, int index)
+{
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+
+    bool changed = false;
+
+    auto current = m_records.find(cardInstanceUID);
+    if (current != m_records.end() && current->pairing.index == index) {
+        m_keyUIDIndex.remove(current->keyUID, cardInstanceUID);
+        m_records.erase(current);
+        changed = true;
+    }
+
+    auto retired = m_retired.find(cardInstanceUID);
+    if (retired != m_retired.end()) {
+        int before = retired->size();
+        retired->erase(std::remove_if(retired->begin(), retired->end(), [index](const RetiredPairing& entry) {
+            return entry.pairing.index == index;
+        }), retired->end());
+        changed = changed || retired->size() != before;
+        if (retired->isEmpty()) {
+            m_retired.erase(retired);
+        }
+    }
+
+    if (!changed) {
+        return true;
+    }
+
+    qDebug() << "FilePairingStorage: Forgot slot" << index << "for card:" << cardInstanceUID;
+    return writeCache();
+}
+
 } // namespace StatusKeycard
@@ -4,6 +4,9 @@
 #include <QString>
 #include <QJsonObject>
 #include <QStandardPaths>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
 
 namespace StatusKeycard {
 
@@ -11,7 +14,16 @@ namespace StatusKeycard {
  * @brief File-based pairing storage implementation
  * 
  * Stores all pairing information in a single JSON file.
- * Format: {"cardUID": {"key": "hex...", "index": 0}, ...}
+ * Format: {"cardUID": {"key": "hex...", "index": 0, "keyUID": "hex...", "lastUsed": 0,
+ *                      "retired": [{"key": "hex...", "index": 1, "lastUsed": 0}]}, ...}
+ *
+ * The file is read once (prefetch() or the first load()) into an in-memory
+ * cache, so pairing lookups on card connection are hash lookups with no I/O.
+ * keyUID and lastUsed are optional secondary fields kept for inventory queries.
+ *
+ * Pairings that are replaced or removed are kept as "retired": the card slot
+ * they occupy may still be allocated, so PairingSlotManager can reuse or
+ * unpair them instead of leaking slots.
  */
 class FilePairingStorage : public Keycard::IPairingStorage {
 public:
@@ -24,13 +36,69 @@ public:
     bool remove(const QString& cardInstanceUID) override;
     void setPath(const QString& filePath);
 
-    
+    struct PairingRecord {
+        QString instanceUID;
+        QString keyUID;         // Empty until the card has been connected with a key loaded
+        Keycard::PairingInfo pairing;
+        qint64 lastUsed = 0;    // Milliseconds since epoch, 0 if never recorded
+    };
+
+    struct RetiredPairing {
+        Keycard::PairingInfo pairing;
+        qint64 lastUsed = 0;
+    };
+
+    // At most one entry per card slot is kept
+    static constexpr int MaxRetiredPairings = 5;
+
+    /**
+     * @brief Read all pairings into the in-memory cache
+     * @return true if the cache is populated (an empty or missing file counts)
+     */
+    bool prefetch();
+
+    /**
+     * @brief Record a successful connection: updates keyUID and lastUsed
+     *
+     * The file is only rewritten when the keyUID changed; lastUsed alone is
+     * persisted lazily by the next write or flush().
+     */
+    bool recordConnection(const QString& cardInstanceUID, const QString& keyUID);
+
+    // Secondary index lookups (served from the cache); a keyUID shared with
+    // backup cards resolves to the most recently used one
+    PairingRecord findByKeyUID(const QString& keyUID);
+    QVector<PairingRecord> listPairings();  // Most recently used first
+
+    // Persist pending lastUsed updates
+    bool flush();
+
+    // Retired pairings of a card, least recently used first
+    QVector<RetiredPairing> retiredPairings(const QString& cardInstanceUID);
+
+    // Make a retired pairing current again (the current one, if any, is retired)
+    bool restoreRetired(const QString& cardInstanceUID, int index);
+
+    // Forget a slot entirely (unpaired, or no longer ours); current or retired
+    bool forgetSlot(const QString& cardInstanceUID, int index);
+
 private:
     QString m_filePath {QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/pairings.json"};
-    
-    // Helper methods
+
+    // In-memory cache (guarded by m_mutex; load() runs on the connection thread)
+    QMutex m_mutex;
+    bool m_loaded = false;
+    bool m_dirty = false;
+    QHash<QString, PairingRecord> m_records;    // instanceUID -> record
+    QMultiHash<QString, QString> m_keyUIDIndex; // keyUID -> instanceUIDs (backup cards share a keyUID)
+    QHash<QString, QVector<RetiredPairing>> m_retired;  // instanceUID -> retired pairings
+
+    // Helper methods (callers hold m_mutex)
     QJsonObject loadAllPairings();
     bool saveAllPairings(const QJsonObject& pairings);
+    bool ensureLoaded();
+    bool writeCache();
+    void retire(const QString& cardInstanceUID, const Keycard::PairingInfo& pairing, qint64 lastUsed);
 };
 
 } // namespace StatusKeycard
@@ -0,0 +1,64 @@
+#include <QtTest/QtTest>
+#include "session/address_index.h"
+
+using namespace StatusKeycard;
+
+class TestAddressIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void testLookupIgnoresCaseAndPrefix();
+    void testSeparatedByKeyUID();
+    void testRejectsInvalidAndBounded();
+};
+
+void TestAddressIndex::init()
+{
+    AddressIndex::instance()->clear();
+}
+
+void TestAddressIndex::testLookupIgnoresCaseAndPrefix()
+{
+    AddressIndex* index = AddressIndex::instance();
+    index->insert("0xABCDEF", "0x52908400098527886E0F7030069857D2E4169EE7", "m/44'/60'/0'/0/3");
+
+    QCOMPARE(index->path("abcdef", "0x52908400098527886e0f7030069857d2e4169ee7"), QString("m/44'/60'/0'/0/3"));
+    QCOMPARE(index->path("0xabcdef", "52908400098527886E0F7030069857D2E4169EE7"), QString("m/44'/60'/0'/0/3"));
+    QVERIFY(index->path("abcdef", "0x0000000000000000000000000000000000000001").isEmpty());
+
+    // Re-indexing the same address keeps one entry
+    index->insert("abcdef", "0x52908400098527886e0f7030069857d2e4169ee7", "m/44'/60'/0'/0/3");
+    QCOMPARE(index->size("abcdef"), 1);
+}
+
+void TestAddressIndex::testSeparatedByKeyUID()
+{
+    AddressIndex* index = AddressIndex::instance();
+    const QString address = "0x8617e340b3d01fa5f11f306f4090fd50e238070d";
+    index->insert("aa", address, "m/44'/60'/0'/0/0");
+
+    QCOMPARE(index->path("aa", address), QString("m/44'/60'/0'/0/0"));
+    QVERIFY(index->path("bb", address).isEmpty());
+    QVERIFY(index->path(QString(), address).isEmpty());
+}
+
+void TestAddressIndex::testRejectsInvalidAndBounded()
+{
+    AddressIndex* index = AddressIndex::instance();
+    index->insert("aa", "0x1234", "m/44'/60'/0'/0/0");
+    index->insert("aa", "0x8617e340b3d01fa5f11f306f4090fd50e238070d", QString());
+    index->insert(QString(), "0x8617e340b3d01fa5f11f306f4090fd50e238070d", "m/44'/60'/0'/0/0");
+    QCOMPARE(index->size("aa"), 0);
+
+    for (int i = 0; i < AddressIndex::MaxEntries + 10; ++i) {
+        QString address = QString("0x%1").arg(i, 40, 16, QChar('0'));
+        index->insert("aa", address, QString("m/44'/60'/0'/0/%1").arg(i));
+    }
+    QCOMPARE(index->size("aa"), AddressIndex::MaxEntries);
+    QCOMPARE(index->path("aa", QString("0x%1").arg(0, 40, 16, QChar('0'))), QString("m/44'/60'/0'/0/0"));
+}
+
+QTEST_MAIN(TestAddressIndex)
+#include "test_address_index.moc"
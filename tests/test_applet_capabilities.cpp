@@ -0,0 +1,57 @@
+#include <QtTest/QtTest>
+#include "session/applet_capabilities.h"
+
+using namespace StatusKeycard;
+
+class TestAppletCapabilities : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testVersionTable();
+    void testAssumedFlags();
+};
+
+void TestAppletCapabilities::testVersionTable()
+{
+    // Nothing selected yet
+    AppletCapabilities none = AppletCapabilities::forApplet(0, 0);
+    QVERIFY(!none.publicOnlyExport);
+    QVERIFY(!none.extendedExport);
+
+    AppletCapabilities v2 = AppletCapabilities::forApplet(2, 2);
+    QVERIFY(v2.publicOnlyExport);
+    QVERIFY(v2.exportCurrent);
+    QVERIFY(v2.deriveAndMakeCurrent);
+    QVERIFY(!v2.extendedExport);
+    QVERIFY(!v2.combinedStatus);
+    QVERIFY(!v2.has(AppletCapabilities::FactoryReset));
+
+    AppletCapabilities v30 = AppletCapabilities::forApplet(3, 0);
+    QVERIFY(!v30.extendedExport);
+    QVERIFY(v30.combinedStatus);
+
+    QVERIFY(AppletCapabilities::forApplet(3, 1).extendedExport);
+
+    // Minor version resets with a new major
+    AppletCapabilities v4 = AppletCapabilities::forApplet(4, 0);
+    QVERIFY(v4.extendedExport);
+    QVERIFY(v4.combinedStatus);
+    QCOMPARE(v4.toJson()["version"].toString(), QString("4.0"));
+}
+
+void TestAppletCapabilities::testAssumedFlags()
+{
+    // The capability byte is not available from SELECT; the version decides
+    AppletCapabilities v31 = AppletCapabilities::forApplet(3, 1);
+    QVERIFY(v31.has(AppletCapabilities::KeyManagement));
+    QVERIFY(v31.has(AppletCapabilities::FactoryReset));
+    QCOMPARE(v31.toJson()["capabilities"].toInt(), int(AppletCapabilities::AllCapabilities));
+
+    AppletCapabilities v2 = AppletCapabilities::forApplet(2, 2);
+    QVERIFY(v2.has(AppletCapabilities::SecureChannel));
+    QCOMPARE(v2.toJson()["capabilities"].toInt(), 0x0F);
+}
+
+QTEST_MAIN(TestAppletCapabilities)
+#include "test_applet_capabilities.moc"
@@ -0,0 +1,366 @@
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include "card_decoder.h"
+
+using namespace StatusKeycard;
+
+Q_DECLARE_METATYPE(StatusKeycard::DecodeError)
+
+/**
+ * @brief Tests for bounded decoding of card responses
+ *
+ * Hostile inputs must fail with their own error code without allocating
+ * for the claimed size; random and mutated inputs must never exceed the
+ * limits or take more than linear time.
+ */
+class TestCardDecoder : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QByteArray leb128(quint64 value)
+    {
+        QByteArray out;
+        do {
+            quint8 byte = value & 0x7F;
+            value >>= 7;
+            if (value) {
+                byte |= 0x80;
+            }
+            out.append(char(byte));
+        } while (value);
+        return out;
+    }
+
+    static QByteArray metadata(const QByteArray& name, const QVector<QPair<quint64, quint64>>& ranges)
+    {
+        QByteArray out;
+        out.append(char(0x20 | name.size()));
+        out.append(name);
+        for (const auto& range : ranges) {
+            out.append(leb128(range.first));
+            out.append(leb128(range.second));
+        }
+        return out;
+    }
+
+    static QByteArray tlv(quint8 tag, const QByteArray& value)
+    {
+        QByteArray out;
+        out.append(char(tag));
+        if (value.size() < 0x80) {
+            out.append(char(value.size()));
+        } else if (value.size() <= 0xFF) {
+            out.append(char(0x81));
+            out.append(char(value.size()));
+        } else {
+            out.append(char(0x82));
+            out.append(char(value.size() >> 8));
+            out.append(char(value.size() & 0xFF));
+        }
+        out.append(value);
+        return out;
+    }
+
+    static QByteArray derInteger(const QByteArray& value)
+    {
+        QByteArray body = value;
+        if (static_cast<quint8>(body[0]) & 0x80) {
+            body.prepend('\0');
+        }
+        return tlv(0x02, body);
+    }
+
+private slots:
+    // Metadata
+    void testMetadataRoundTrip();
+    void testMetadataHostileCorpus_data();
+    void testMetadataHostileCorpus();
+    void testMetadataUnsupportedVersion();
+
+    // TLV
+    void testTlvSinglePass();
+    void testTlvLimits();
+
+    // DER
+    void testDerSignature();
+    void testDerHostileCorpus_data();
+    void testDerHostileCorpus();
+
+    // Fuzz
+    void testFuzzMetadata();
+    void testFuzzTlvAndDer();
+
+    // Benchmarks (worst case within the limits)
+    void benchmarkMetadataMaxRanges();
+    void benchmarkTlvMaxElements();
+};
+
+void TestCardDecoder::testMetadataRoundTrip()
+{
+    QByteArray data = metadata("card", {{0, 2}, {10, 0}, {300, 1}});
+
+    DecodedMetadata decoded;
+    QCOMPARE(CardDecoder::decodeMetadata(data, decoded), DecodeError::None);
+    QCOMPARE(decoded.name, QString("card"));
+    QCOMPARE(decoded.ranges.size(), 3);
+    QCOMPARE(decoded.walletCount, 6);
+    QCOMPARE(decoded.walletIndexes(), QVector<quint32>({0, 1, 2, 10, 300, 301}));
+
+    // Name only
+    QCOMPARE(CardDecoder::decodeMetadata(metadata("x", {}), decoded), DecodeError::None);
+    QCOMPARE(decoded.walletCount, 0);
+}
+
+void TestCardDecoder::testMetadataHostileCorpus_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<DecodeError>("expected");
+
+    QTest::newRow("empty") << QByteArray() << DecodeError::Truncated;
+    QTest::newRow("name past end") << QByteArray("\x25" "ab", 3) << DecodeError::Truncated;
+    QTest::newRow("count missing") << metadata("", {}).append(leb128(5)) << DecodeError::Truncated;
+    QTest::newRow("unterminated varint") << metadata("", {}).append("\x80\x80", 2) << DecodeError::Truncated;
+    QTest::newRow("huge count") << metadata("", {{0, 0x7FFFFFFE}}) << DecodeError::TooManyWallets;
+    QTest::newRow("varint over 32 bits") << metadata("", {{quint64(1) << 32, 0}}) << DecodeError::Leb128Overflow;
+    QTest::newRow("varint 6 bytes") << metadata("", {}).append(QByteArray(5, char(0x80))).append('\0')
+                                    << DecodeError::Leb128Overflow;
+    QTest::newRow("index past non-hardened") << metadata("", {{0x7FFFFFFF, 1}}) << DecodeError::IndexOverflow;
+
+    QVector<QPair<quint64, quint64>> manyRanges;
+    for (int i = 0; i < DecodeLimits::defaults().maxRanges + 1; ++i) {
+        manyRanges.append({quint64(i) * 2, 0});
+    }
+    QTest::newRow("too many ranges") << metadata("", manyRanges) << DecodeError::TooManyRanges;
+
+    // Many ranges, each under the wallet limit, adding up past it
+    QTest::newRow("ranges add up") << metadata("", {{0, 600}, {1000, 600}}) << DecodeError::TooManyWallets;
+}
+
+void TestCardDecoder::testMetadataHostileCorpus()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(DecodeError, expected);
+
+    DecodedMetadata decoded;
+    QCOMPARE(CardDecoder::decodeMetadata(data, decoded), expected);
+    QVERIFY(decoded.walletCount <= DecodeLimits::defaults().maxWallets);
+    QVERIFY(QString(decodeErrorString(expected)).size() > 0);
+}
+
+void TestCardDecoder::testMetadataUnsupportedVersion()
+{
+    QByteArray data = metadata("card", {{0, 1}});
+    data[0] = char((data[0] & 0x1F) | 0x40);
+
+    DecodedMetadata decoded;
+    QCOMPARE(CardDecoder::decodeMetadata(data, decoded), DecodeError::UnsupportedVersion);
+    QCOMPARE(decoded.walletCount, 0);
+    QVERIFY(decoded.ranges.isEmpty());
+}
+
+void TestCardDecoder::testTlvSinglePass()
+{
+    // Keypair template as returned by EXPORT KEY
+    QByteArray publicKey(65, 0x04);
+    QByteArray chainCode(32, 0x11);
+    QByteArray inner = tlv(0x80, publicKey) + tlv(0x99, QByteArray(3, 'x')) + tlv(0x82, chainCode)
+                       + tlv(0x80, QByteArray(65, 0x05));
+    QByteArray response = tlv(0xA1, inner);
+
+    QByteArray keyTemplate = CardDecoder::findTlvTag(response, 0xA1);
+    QCOMPARE(keyTemplate, inner);
+
+    const quint8 tags[] = { 0x80, 0x81, 0x82 };
+    QByteArray values[3];
+    QCOMPARE(CardDecoder::findTlvTags(keyTemplate, tags, values, 3, 1), DecodeError::None);
+    QCOMPARE(values[0], publicKey);      // First occurrence wins
+    QVERIFY(values[1].isEmpty());
+    QCOMPARE(values[2], chainCode);
+
+    // Two-byte lengths
+    QByteArray large(300, 'L');
+    QCOMPARE(CardDecoder::findTlvTag(tlv(0x90, large), 0x90), large);
+}
+
+void TestCardDecoder::testTlvLimits()
+{
+    const DecodeLimits& limits = DecodeLimits::defaults();
+    const quint8 tag = 0x80;
+    QByteArray value;
+
+    // Declared length past the end
+    QCOMPARE(CardDecoder::findTlvTags(QByteArray("\x80\x10" "abc", 5), &tag, &value, 1),
+             DecodeError::TlvInvalidLength);
+    // Indefinite and over-long length forms
+    QCOMPARE(CardDecoder::findTlvTags(QByteArray("\x80\x80", 2), &tag, &value, 1),
+             DecodeError::TlvInvalidLength);
+    QCOMPARE(CardDecoder::findTlvTags(QByteArray("\x80\x84\x7F\xFF\xFF\xFF", 6), &tag, &value, 1),
+             DecodeError::TlvInvalidLength);
+    // Tag without a length
+    QCOMPARE(CardDecoder::findTlvTags(QByteArray("\x90", 1), &tag, &value, 1),
+             DecodeError::TlvInvalidLength);
+
+    QCOMPARE(CardDecoder::findTlvTags(tlv(0x80, QByteArray(limits.maxTlvLength + 1, 'x')), &tag, &value, 1),
+             DecodeError::TlvTooLong);
+    QCOMPARE(CardDecoder::findTlvTags(tlv(0x80, "x"), &tag, &value, 1, limits.maxTlvDepth + 1),
+             DecodeError::TlvTooDeep);
+
+    QByteArray padding;
+    for (int i = 0; i <= limits.maxTlvElements; ++i) {
+        padding.append(tlv(0x00, QByteArray()));
+    }
+    QCOMPARE(CardDecoder::findTlvTags(padding + tlv(0x80, "x"), &tag, &value, 1),
+             DecodeError::TlvTooManyElements);
+    QVERIFY(value.isEmpty());
+
+    // Errors after the tag was found do not matter
+    QCOMPARE(CardDecoder::findTlvTags(tlv(0x80, "x") + padding, &tag, &value, 1), DecodeError::None);
+    QCOMPARE(value, QByteArray("x"));
+}
+
+void TestCardDecoder::testDerSignature()
+{
+    QByteArray r = QByteArray::fromHex("8c959e5fd1ab52eea8ca757983f31ea3c7537044c9b0b4b3e2797c55e2f7688f");
+    QByteArray s = QByteArray::fromHex("0061f126de96977783184928b5187f79a84a628d8bb376eaff9d93f6ddfe9380");
+
+    // High bit padded on r, s shortened to 31 bytes
+    QByteArray body = derInteger(r) + derInteger(s.mid(1));
+    QByteArray decodedR, decodedS;
+    QCOMPARE(CardDecoder::decodeDerSignature(body, decodedR, decodedS), DecodeError::None);
+    QCOMPARE(decodedR, r);
+    QCOMPARE(decodedS, s);
+}
+
+void TestCardDecoder::testDerHostileCorpus_data()
+{
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<DecodeError>("expected");
+
+    QByteArray r(32, 0x12);
+    QByteArray s(32, 0x34);
+    QByteArray valid = derInteger(r) + derInteger(s);
+
+    QTest::newRow("empty") << QByteArray() << DecodeError::DerMalformed;
+    QTest::newRow("oversized") << QByteArray(200, 0x02) << DecodeError::DerTooLarge;
+    QTest::newRow("trailing bytes") << valid + QByteArray(1, 0) << DecodeError::DerMalformed;
+    QTest::newRow("missing s") << derInteger(r) << DecodeError::DerMalformed;
+    QTest::newRow("wrong tag") << tlv(0x04, r) + derInteger(s) << DecodeError::DerMalformed;
+    QTest::newRow("zero length") << tlv(0x02, QByteArray()) + derInteger(s) << DecodeError::DerMalformed;
+    QTest::newRow("integer too long") << tlv(0x02, QByteArray(34, 0x01)) << DecodeError::DerMalformed;
+    QTest::newRow("33 bytes without pad") << tlv(0x02, QByteArray(33, 0x01)) + derInteger(s)
+                                          << DecodeError::DerMalformed;
+    QTest::newRow("length past end") << QByteArray("\x02\x20\x01", 3) << DecodeError::DerMalformed;
+}
+
+void TestCardDecoder::testDerHostileCorpus()
+{
+    QFETCH(QByteArray, body);
+    QFETCH(DecodeError, expected);
+
+    QByteArray r, s;
+    QCOMPARE(CardDecoder::decodeDerSignature(body, r, s), expected);
+    QVERIFY(r.isEmpty());
+    QVERIFY(s.isEmpty());
+}
+
+void TestCardDecoder::testFuzzMetadata()
+{
+    QRandomGenerator random(0x5eed);
+    QByteArray valid = metadata("wallet", {{0, 5}, {100, 20}, {4000, 3}});
+    const int maxWallets = DecodeLimits::defaults().maxWallets;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < 20000; ++i) {
+        QByteArray data;
+        if (i % 2) {
+            data.resize(random.bounded(1, 512));
+            for (char& byte : data) {
+                byte = char(random.bounded(256));
+            }
+            data[0] = char((data[0] & 0x1F) | 0x20);
+        } else {
+            data = valid;
+            for (int flips = random.bounded(1, 4); flips > 0; --flips) {
+                data[random.bounded(int(data.size()))] = char(random.bounded(256));
+            }
+        }
+
+        DecodedMetadata decoded;
+        if (CardDecoder::decodeMetadata(data, decoded) == DecodeError::None) {
+            QVERIFY(decoded.walletCount <= maxWallets);
+            QCOMPARE(decoded.walletIndexes().size(), decoded.walletCount);
+        }
+    }
+    QVERIFY2(timer.elapsed() < 10000, "metadata decoding is not linear");
+}
+
+void TestCardDecoder::testFuzzTlvAndDer()
+{
+    QRandomGenerator random(0xdec0de);
+    QByteArray valid = tlv(0xA0, tlv(0x80, QByteArray(65, 0x04))
+                                 + tlv(0x30, derInteger(QByteArray(32, 0x7F)) + derInteger(QByteArray(32, 0x22))));
+    const quint8 tags[] = { 0x80, 0x30 };
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < 20000; ++i) {
+        QByteArray data = valid;
+        for (int flips = random.bounded(1, 6); flips > 0; --flips) {
+            data[random.bounded(int(data.size()))] = char(random.bounded(256));
+        }
+        data.truncate(random.bounded(1, int(data.size()) + 1));
+
+        QByteArray scanData = CardDecoder::findTlvTag(data, 0xA0);
+        QVERIFY(scanData.size() <= data.size());
+
+        QByteArray values[2];
+        CardDecoder::findTlvTags(scanData, tags, values, 2, 1);
+        QByteArray r, s;
+        if (CardDecoder::decodeDerSignature(values[1], r, s) == DecodeError::None) {
+            QCOMPARE(r.size(), 32);
+            QCOMPARE(s.size(), 32);
+        }
+    }
+    QVERIFY2(timer.elapsed() < 10000, "TLV decoding is not linear");
+}
+
+void TestCardDecoder::benchmarkMetadataMaxRanges()
+{
+    const DecodeLimits& limits = DecodeLimits::defaults();
+    QVector<QPair<quint64, quint64>> ranges;
+    int perRange = limits.maxWallets / limits.maxRanges - 1;
+    for (int i = 0; i < limits.maxRanges; ++i) {
+        ranges.append({0x7FFF0000 + quint64(i) * (perRange + 1), perRange});
+    }
+    QByteArray data = metadata(QByteArray(31, 'n'), ranges);
+
+    DecodedMetadata decoded;
+    QCOMPARE(CardDecoder::decodeMetadata(data, decoded), DecodeError::None);
+    QBENCHMARK {
+        CardDecoder::decodeMetadata(data, decoded);
+        decoded.walletIndexes();
+    }
+}
+
+void TestCardDecoder::benchmarkTlvMaxElements()
+{
+    const DecodeLimits& limits = DecodeLimits::defaults();
+    QByteArray data;
+    for (int i = 0; i < limits.maxTlvElements - 1; ++i) {
+        data.append(tlv(0x00, QByteArray(limits.maxTlvLength / limits.maxTlvElements, 0)));
+    }
+    data.append(tlv(0x30, QByteArray(70, 0x02)));
+
+    const quint8 tags[] = { 0x80, 0x30 };
+    QByteArray values[2];
+    QCOMPARE(CardDecoder::findTlvTags(data, tags, values, 2), DecodeError::None);
+    QBENCHMARK {
+        CardDecoder::findTlvTags(data, tags, values, 2);
+    }
+}
+
+QTEST_MAIN(TestCardDecoder)
+#include "test_card_decoder.moc"
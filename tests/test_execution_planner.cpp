@@ -0,0 +1,192 @@
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonObject>
+#include "plan/apdu_cost_model.h"
+#include "plan/execution_planner.h"
+
+using namespace StatusKeycard;
+
+class TestExecutionPlanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testPreambleFollowsSession();
+    void testExportsDedupedWithHostAlternative();
+    void testSignsDerivePerHash();
+    void testObservationsCalibrateModel();
+    void testTimerObservesOnlySuccess();
+    void testReaderTypeForBackend();
+    void testInvalidRequest();
+};
+
+void TestExecutionPlanner::testPreambleFollowsSession()
+{
+    ApduCostModel model;
+    ExecutionPlanner planner(model);
+
+    PlanRequest request;
+    request.getMetadata = true;
+
+    // Fresh card: select, pair, secure channel; metadata read needs no PIN
+    ExecutionPlan cold = planner.plan(request, PlanSession(), "pcsc");
+    QCOMPARE(cold.steps.first().ins, quint8(ApduCostModel::Select));
+    QCOMPARE(cold.apduCount(), 1 + 2 + 2 + 1);
+    for (const PlanStep& step : cold.steps) {
+        QVERIFY(step.ins != ApduCostModel::VerifyPIN);
+    }
+
+    // Authorized session: only the operations themselves
+    PlanSession authorized;
+    authorized.selected = authorized.paired = authorized.secureChannel = authorized.authorized = true;
+    request.storeMetadata = true;
+    ExecutionPlan warm = planner.plan(request, authorized, "pcsc");
+    QCOMPARE(warm.apduCount(), 2);
+    QVERIFY(warm.estimatedMs() < cold.estimatedMs());
+
+    // NFC readers are slower than PC/SC for the same plan
+    QVERIFY(planner.plan(request, authorized, "nfc").estimatedMs() > warm.estimatedMs());
+}
+
+void TestExecutionPlanner::testExportsDedupedWithHostAlternative()
+{
+    ApduCostModel model;
+    ExecutionPlanner planner(model);
+
+    PlanSession session;
+    session.selected = session.paired = session.secureChannel = session.authorized = true;
+
+    PlanRequest request;
+    for (int i = 0; i < 5; ++i) {
+        PlanRequest::Export item;
+        item.path = QString("m/44'/60'/0'/0/%1").arg(i);
+        request.exports.append(item);
+    }
+    request.exports.append(request.exports.first());  // Duplicate
+
+    // Every key is exported by the card, as the session does
+    ExecutionPlan plan = planner.plan(request, session, "pcsc");
+    QCOMPARE(plan.apduCount(), 5);
+    QCOMPARE(plan.steps.first().detail, QString("m/44'/60'/0'/0/0"));
+
+    bool deduped = false;
+    QJsonObject strategy;
+    for (const QJsonValue& value : plan.decisions) {
+        deduped |= value.toObject()["decision"].toString() == "dedupe-exports";
+        if (value.toObject()["decision"].toString() == "export-strategy") {
+            strategy = value.toObject();
+        }
+    }
+    QVERIFY(deduped);
+
+    // Host derivation of the public siblings is only an alternative
+    QCOMPARE(strategy["chosen"].toString(), QString("card"));
+    QCOMPARE(strategy["estimatedMs"].toDouble(), plan.estimatedMs());
+    QJsonObject alternative = strategy["alternatives"].toArray().first().toObject();
+    QCOMPARE(alternative["strategy"].toString(), QString("host-derive"));
+    QVERIFY(alternative["estimatedMs"].toDouble() > 0);
+
+    // Not offered without extended export support, or for private keys
+    session.supportsExtended = false;
+    QVERIFY(planner.plan(request, session, "pcsc").decisions.last().toObject()["alternatives"].isUndefined());
+    session.supportsExtended = true;
+    request.exports[0].exportPrivate = true;
+    QVERIFY(planner.plan(request, session, "pcsc").decisions.last().toObject()["alternatives"].isUndefined());
+}
+
+void TestExecutionPlanner::testSignsDerivePerHash()
+{
+    ApduCostModel model;
+    ExecutionPlanner planner(model);
+
+    PlanSession session;
+    session.selected = session.paired = session.secureChannel = session.authorized = true;
+
+    PlanRequest request;
+    request.signs.append({"m/44'/60'/0'/0/0", 3});
+    request.signs.append({"m/44'/60'/0'/0/1", 1});
+    request.signs.append({"m/44'/60'/0'/0/0", 2});
+
+    // SignFlow derives the key for every hash
+    ExecutionPlan plan = planner.plan(request, session, "pcsc");
+    QCOMPARE(plan.apduCount(), 6);
+    QCOMPARE(plan.steps.size(), 2);
+    QCOMPARE(plan.steps[0].count, 5);
+    QCOMPARE(plan.steps[0].estimatedMs, 5 * model.estimate(ApduCostModel::Sign, 5, "pcsc"));
+
+    QCOMPARE(plan.decisions.size(), 1);
+    QJsonObject decision = plan.decisions.first().toObject();
+    QCOMPARE(decision["chosen"].toString(), QString("derive-each"));
+    QJsonObject alternative = decision["alternatives"].toArray().first().toObject();
+    QCOMPARE(alternative["strategy"].toString(), QString("derive-once"));
+    QCOMPARE(alternative["estimatedMs"].toDouble(),
+             model.estimate(ApduCostModel::Sign, 5, "pcsc") + 4 * model.estimate(ApduCostModel::Sign, 0, "pcsc"));
+}
+
+void TestExecutionPlanner::testObservationsCalibrateModel()
+{
+    ApduCostModel model;
+    model.setReaderType("pcsc");
+    const double before = model.estimate(ApduCostModel::VerifyPIN);
+
+    model.observe(ApduCostModel::VerifyPIN, 400);
+    QCOMPARE(model.estimate(ApduCostModel::VerifyPIN), 400.0);
+    model.observe(ApduCostModel::VerifyPIN, 300);
+    QVERIFY(model.estimate(ApduCostModel::VerifyPIN) < 400.0);
+    QVERIFY(model.estimate(ApduCostModel::VerifyPIN) > 300.0);
+
+    // Other reader types keep their own table
+    QCOMPARE(model.estimate(ApduCostModel::VerifyPIN, 0, "virtual") < before, true);
+    QCOMPARE(model.toJson()["pcsc"].toObject()["VERIFY PIN"].toObject()["observations"].toInt(), 2);
+
+    model.reset();
+    QCOMPARE(model.estimate(ApduCostModel::VerifyPIN), before);
+}
+
+void TestExecutionPlanner::testTimerObservesOnlySuccess()
+{
+    ApduCostModel model;
+    {
+        ApduTimer refused(&model, ApduCostModel::VerifyPIN);
+    }
+    {
+        ApduTimer failed(&model, ApduCostModel::VerifyPIN);
+        failed.succeeded(false);
+    }
+    QCOMPARE(model.toJson()[model.readerType()].toObject()["VERIFY PIN"].toObject()["observations"].toInt(), 0);
+
+    {
+        ApduTimer verified(&model, ApduCostModel::VerifyPIN);
+        verified.succeeded();
+    }
+    QCOMPARE(model.toJson()[model.readerType()].toObject()["VERIFY PIN"].toObject()["observations"].toInt(), 1);
+
+    ApduTimer unmodelled(nullptr, ApduCostModel::Sign);  // Records only
+    unmodelled.succeeded();
+}
+
+void TestExecutionPlanner::testReaderTypeForBackend()
+{
+    QCOMPARE(ApduCostModel::readerTypeForBackend("Virtual Card Farm"), QString("virtual"));
+    QCOMPARE(ApduCostModel::readerTypeForBackend("Android NFC"), QString("nfc"));
+    QCOMPARE(ApduCostModel::readerTypeForBackend("PC/SC"), QString("pcsc"));
+    QCOMPARE(ApduCostModel::readerTypeForBackend("Remote Reader (10.0.0.2:19790)"),
+             ApduCostModel::platformReaderType());
+}
+
+void TestExecutionPlanner::testInvalidRequest()
+{
+    PlanRequest request;
+    QString error;
+    QJsonObject json;
+    json["exports"] = QJsonArray{QJsonObject{{"path", "44'/60'"}}};
+    QVERIFY(!PlanRequest::fromJson(json, request, error));
+    QVERIFY(error.contains("44'/60'"));
+
+    QVERIFY(PlanRequest::fromJson(QJsonObject(), request, error));
+    ApduCostModel model;
+    QCOMPARE(ExecutionPlanner(model).plan(request, PlanSession()).apduCount(), 0);
+}
+
+QTEST_MAIN(TestExecutionPlanner)
+#include "test_execution_planner.moc"
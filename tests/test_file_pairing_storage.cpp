@@ -0,0 +1,254 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "storage/file_pairing_storage.h"
+
+using namespace StatusKeycard;
+
+class TestFilePairingStorage : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testSaveAndLoad();
+    void testRemove();
+    void testLegacyFileFormat();
+    void testKeyUIDIndex();
+    void testKeyUIDSharedByBackupCards();
+    void testListPairingsOrder();
+    void testSetPathDropsCache();
+    void testReplacedPairingIsRetired();
+    void testRestoreAndForgetSlot();
+
+private:
+    QTemporaryDir* m_dir;
+    QString m_path;
+
+    static Keycard::PairingInfo makePairing(int index);
+};
+
+Keycard::PairingInfo TestFilePairingStorage::makePairing(int index)
+{
+    Keycard::PairingInfo pairing;
+    pairing.key = QByteArray(32, static_cast<char>(index + 1));
+    pairing.index = index;
+    return pairing;
+}
+
+void TestFilePairingStorage::init()
+{
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+    m_path = m_dir->filePath("pairings.json");
+}
+
+void TestFilePairingStorage::cleanup()
+{
+    delete m_dir;
+    m_dir = nullptr;
+}
+
+void TestFilePairingStorage::testSaveAndLoad()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+
+    QVERIFY(storage.save("aabb", makePairing(2)));
+
+    Keycard::PairingInfo loaded = storage.load("aabb");
+    QVERIFY(loaded.isValid());
+    QCOMPARE(loaded.index, 2);
+    QCOMPARE(loaded.key, makePairing(2).key);
+
+    // A fresh instance must see the persisted pairing
+    FilePairingStorage other;
+    other.setPath(m_path);
+    QCOMPARE(other.load("aabb").index, 2);
+    QVERIFY(!other.load("ccdd").isValid());
+}
+
+void TestFilePairingStorage::testRemove()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+
+    QVERIFY(storage.save("aabb", makePairing(0)));
+    QVERIFY(storage.remove("aabb"));
+    QVERIFY(!storage.load("aabb").isValid());
+    QVERIFY(storage.remove("aabb"));  // Already gone is not an error
+}
+
+void TestFilePairingStorage::testLegacyFileFormat()
+{
+    // Files written before keyUID/lastUsed existed must still load
+    QJsonObject pairingObj;
+    pairingObj["key"] = QString(makePairing(1).key.toHex());
+    pairingObj["index"] = 1;
+    QJsonObject all;
+    all["aabb"] = pairingObj;
+
+    QFile file(m_path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(all).toJson(QJsonDocument::Compact));
+    file.close();
+
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+    QVERIFY(storage.prefetch());
+    QCOMPARE(storage.load("aabb").index, 1);
+
+    QVector<FilePairingStorage::PairingRecord> records = storage.listPairings();
+    QCOMPARE(records.size(), 1);
+    QVERIFY(records[0].keyUID.isEmpty());
+    QCOMPARE(records[0].lastUsed, qint64(0));
+}
+
+void TestFilePairingStorage::testKeyUIDIndex()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+
+    QVERIFY(storage.save("aabb", makePairing(0)));
+    QVERIFY(!storage.recordConnection("ccdd", "k1"));  // Unknown card
+    QVERIFY(storage.recordConnection("aabb", "k1"));
+
+    FilePairingStorage::PairingRecord record = storage.findByKeyUID("k1");
+    QCOMPARE(record.instanceUID, QString("aabb"));
+    QVERIFY(record.lastUsed > 0);
+
+    // keyUID changes (e.g. new key loaded) replace the old index entry
+    QVERIFY(storage.recordConnection("aabb", "k2"));
+    QVERIFY(storage.findByKeyUID("k1").instanceUID.isEmpty());
+    QCOMPARE(storage.findByKeyUID("k2").instanceUID, QString("aabb"));
+
+    // keyUID is persisted
+    FilePairingStorage other;
+    other.setPath(m_path);
+    QCOMPARE(other.findByKeyUID("k2").instanceUID, QString("aabb"));
+}
+
+void TestFilePairingStorage::testKeyUIDSharedByBackupCards()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+
+    // A keycard and its backup hold the same key
+    QVERIFY(storage.save("aa", makePairing(0)));
+    QVERIFY(storage.save("bb", makePairing(1)));
+    QVERIFY(storage.recordConnection("aa", "k1"));
+    QTest::qWait(2);
+    QVERIFY(storage.recordConnection("bb", "k1"));
+    QCOMPARE(storage.findByKeyUID("k1").instanceUID, QString("bb"));
+
+    // Removing or re-keying one card leaves the other indexed
+    QVERIFY(storage.remove("bb"));
+    QCOMPARE(storage.findByKeyUID("k1").instanceUID, QString("aa"));
+    QVERIFY(storage.save("bb", makePairing(2)));
+    QVERIFY(storage.recordConnection("bb", "k1"));
+    QVERIFY(storage.recordConnection("bb", "k2"));
+    QCOMPARE(storage.findByKeyUID("k1").instanceUID, QString("aa"));
+    QVERIFY(storage.forgetSlot("bb", 2));
+    QCOMPARE(storage.findByKeyUID("k1").instanceUID, QString("aa"));
+    QVERIFY(storage.findByKeyUID("k2").instanceUID.isEmpty());
+
+    // Both entries survive a reload
+    QVERIFY(storage.save("cc", makePairing(3)));
+    QTest::qWait(2);
+    QVERIFY(storage.recordConnection("cc", "k1"));
+    FilePairingStorage other;
+    other.setPath(m_path);
+    QCOMPARE(other.findByKeyUID("k1").instanceUID, QString("cc"));
+    QVERIFY(other.remove("cc"));
+    QCOMPARE(other.findByKeyUID("k1").instanceUID, QString("aa"));
+}
+
+void TestFilePairingStorage::testListPairingsOrder()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+
+    QVERIFY(storage.save("aa", makePairing(0)));
+    QVERIFY(storage.save("bb", makePairing(1)));
+    QVERIFY(storage.recordConnection("aa", "k1"));
+    QTest::qWait(2);
+    QVERIFY(storage.recordConnection("bb", "k2"));
+
+    QVector<FilePairingStorage::PairingRecord> records = storage.listPairings();
+    QCOMPARE(records.size(), 2);
+    QCOMPARE(records[0].instanceUID, QString("bb"));
+    QCOMPARE(records[1].instanceUID, QString("aa"));
+
+    // lastUsed-only updates are persisted by flush()
+    QVERIFY(storage.recordConnection("aa", "k1"));
+    QVERIFY(storage.flush());
+
+    FilePairingStorage other;
+    other.setPath(m_path);
+    QCOMPARE(other.listPairings().first().instanceUID, QString("aa"));
+}
+
+void TestFilePairingStorage::testSetPathDropsCache()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+    QVERIFY(storage.save("aabb", makePairing(0)));
+
+    storage.setPath(m_dir->filePath("other.json"));
+    QVERIFY(!storage.load("aabb").isValid());
+    QVERIFY(storage.listPairings().isEmpty());
+}
+
+void TestFilePairingStorage::testReplacedPairingIsRetired()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+
+    QVERIFY(storage.save("aabb", makePairing(0)));
+    QVERIFY(storage.save("aabb", makePairing(1)));  // Re-paired into another slot
+
+    QVector<FilePairingStorage::RetiredPairing> retired = storage.retiredPairings("aabb");
+    QCOMPARE(retired.size(), 1);
+    QCOMPARE(retired[0].pairing.index, 0);
+
+    // Removal retires the current pairing as well
+    QVERIFY(storage.remove("aabb"));
+    QVERIFY(!storage.load("aabb").isValid());
+    QCOMPARE(storage.retiredPairings("aabb").size(), 2);
+
+    // Retired pairings survive a reload
+    FilePairingStorage other;
+    other.setPath(m_path);
+    QCOMPARE(other.retiredPairings("aabb").size(), 2);
+    QVERIFY(other.listPairings().isEmpty());
+}
+
+void TestFilePairingStorage::testRestoreAndForgetSlot()
+{
+    FilePairingStorage storage;
+    storage.setPath(m_path);
+
+    QVERIFY(storage.save("aabb", makePairing(0)));
+    QVERIFY(storage.save("aabb", makePairing(1)));
+
+    QVERIFY(storage.restoreRetired("aabb", 0));
+    QCOMPARE(storage.load("aabb").index, 0);
+    QCOMPARE(storage.retiredPairings("aabb").size(), 1);
+    QCOMPARE(storage.retiredPairings("aabb")[0].pairing.index, 1);
+    QVERIFY(!storage.restoreRetired("aabb", 3));
+
+    QVERIFY(storage.forgetSlot("aabb", 1));
+    QVERIFY(storage.retiredPairings("aabb").isEmpty());
+    QCOMPARE(storage.load("aabb").index, 0);
+
+    QVERIFY(storage.forgetSlot("aabb", 0));
+    QVERIFY(!storage.load("aabb").isValid());
+    QVERIFY(storage.retiredPairings("aabb").isEmpty());
+}
+
+QTEST_MAIN(TestFilePairingStorage)
+#include "test_file_pairing_storage.moc"
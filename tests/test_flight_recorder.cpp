@@ -0,0 +1,133 @@
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QTemporaryDir>
+#include "flight_recorder.h"
+#include "session/session_state.h"
+
+using namespace StatusKeycard;
+
+class TestFlightRecorder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanupTestCase();
+    void testRecordsDecodeInOrder();
+    void testFileSurvivesAndWraps();
+    void testDecodeRejectsOtherFiles();
+};
+
+void TestFlightRecorder::init()
+{
+    FlightRecorder::instance()->reset();
+}
+
+void TestFlightRecorder::cleanupTestCase()
+{
+    FlightRecorder::instance()->reset();
+}
+
+void TestFlightRecorder::testRecordsDecodeInOrder()
+{
+    FlightRecorder* recorder = FlightRecorder::instance();
+    recorder->record(FlightRecorder::Event::RpcStart, 0, 0, 0, QString("keycard.GetStatus"));
+    recorder->record(FlightRecorder::Event::Apdu, 0xA4, 0x9000, 1500);
+    recorder->record(FlightRecorder::Event::SessionState, static_cast<quint32>(SessionState::Ready), 0, 0,
+                     sessionStateToString(SessionState::Ready),
+                     static_cast<quint32>(SessionState::ConnectingCard));
+    recorder->record(FlightRecorder::Event::FlowStep, 2, 0, 0,
+                     "a-step-name-that-is-much-longer-than-the-tag-field");
+    recorder->record(FlightRecorder::Event::RpcEnd, 0, static_cast<quint16>(-32602), 42,
+                     QString("keycard.GetStatus"));
+
+    QJsonArray events = recorder->dump(0);
+    QCOMPARE(events.size(), 5);
+
+    QCOMPARE(events[0].toObject()["event"].toString(), QString("rpcStart"));
+    QCOMPARE(events[0].toObject()["method"].toString(), QString("keycard.GetStatus"));
+
+    QJsonObject apdu = events[1].toObject();
+    QCOMPARE(apdu["ins"].toString(), QString("0xA4"));
+    QCOMPARE(apdu["sw"].toString(), QString("0x9000"));
+    QCOMPARE(apdu["durationUs"].toInt(), 1500);
+
+    QJsonObject state = events[2].toObject();
+    QCOMPARE(state["state"].toString(), QString("ready"));
+    QCOMPARE(state["from"].toString(), QString("connecting-card"));
+
+    // Tags are truncated, never overflow into the next field
+    QCOMPARE(events[3].toObject()["step"].toString().size(), FlightRecorder::TagSize - 1);
+
+    QCOMPARE(events[4].toObject()["error"].toInt(), -32602);
+
+    for (int i = 1; i < events.size(); ++i) {
+        QVERIFY(events[i].toObject()["seq"].toDouble() > events[i - 1].toObject()["seq"].toDouble());
+        QVERIFY(events[i].toObject()["time"].toDouble() >= events[i - 1].toObject()["time"].toDouble());
+    }
+}
+
+void TestFlightRecorder::testFileSurvivesAndWraps()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("recorder.bin");
+
+    FlightRecorder* recorder = FlightRecorder::instance();
+    const double startMs = static_cast<double>(QDateTime::currentMSecsSinceEpoch());
+    recorder->record(FlightRecorder::Event::Signal, 0, 0, 0, "status-changed");
+    QVERIFY(recorder->open(path, 16));
+    QCOMPARE(recorder->path(), path);
+
+    // Heap events move into the file
+    QCOMPARE(recorder->dump(0).size(), 1);
+
+    for (quint32 i = 0; i < 40; ++i) {
+        recorder->record(FlightRecorder::Event::Apdu, i, 0x9000, 10);
+    }
+
+    // Only the newest ring-full is kept
+    QJsonArray events;
+    QString error;
+    QVERIFY(FlightRecorder::decodeFile(path, 0, events, error));
+    QCOMPARE(events.size(), 16);
+    QCOMPARE(events.last().toObject()["ins"].toString(), QString("0x27"));
+    QCOMPARE(events.first().toObject()["ins"].toString(), QString("0x18"));
+
+    // A reopened file keeps its events and is appended to
+    recorder->reset();
+    QVERIFY(recorder->open(path, 16));
+    recorder->record(FlightRecorder::Event::Signal, 0, 0, 0, "flow-result");
+    QJsonArray reopened = recorder->dump(0);
+    QCOMPARE(reopened.size(), 16);
+    QCOMPARE(reopened.last().toObject()["type"].toString(), QString("flow-result"));
+    QCOMPARE(reopened.last().toObject()["seq"].toDouble(), 42.0);
+
+    // Records carry their own wall time; reopening does not move older ones
+    const double endMs = static_cast<double>(QDateTime::currentMSecsSinceEpoch());
+    for (const QJsonValue& event : reopened) {
+        QVERIFY(event.toObject()["time"].toDouble() >= startMs - 1);
+        QVERIFY(event.toObject()["time"].toDouble() <= endMs + 1);
+    }
+}
+
+void TestFlightRecorder::testDecodeRejectsOtherFiles()
+{
+    QTemporaryDir dir;
+    QString path = dir.filePath("not-a-recorder.json");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(256, '{'));
+    file.close();
+
+    QJsonArray events;
+    QString error;
+    QVERIFY(!FlightRecorder::decodeFile(path, 0, events, error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!FlightRecorder::decodeFile(dir.filePath("missing.bin"), 0, events, error));
+}
+
+QTEST_MAIN(TestFlightRecorder)
+#include "test_flight_recorder.moc"
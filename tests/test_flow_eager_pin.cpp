@@ -0,0 +1,213 @@
+#include <QtTest/QtTest>
+#include <QJsonObject>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+#include "flow/flow_manager.h"
+#include "flow/flow_params.h"
+#include "flow/flow_signals.h"
+#include "flow/flows/flow_base.h"
+#include "mocked/virtual_card_farm.h"
+#include "storage/file_pairing_storage.h"
+#include <keycard-qt/keycard_channel.h>
+#include <keycard-qt/command_set.h>
+#include <memory>
+
+using namespace StatusKeycard;
+
+namespace {
+
+/**
+ * Login-type flow running only the PIN steps of FlowBase, so the APDUs the
+ * virtual card sees come from selectKeycard() and verifyPIN() alone.
+ */
+class PinStepsFlow : public FlowBase
+{
+public:
+    PinStepsFlow(const QJsonObject& params, bool verify)
+        : FlowBase(FlowManager::instance(), FlowType::Login, params)
+        , m_verify(verify)
+    {
+    }
+
+    QJsonObject execute() override
+    {
+        QJsonObject result;
+        result["ok"] = selectKeycard() && (!m_verify || verifyPIN());
+        return result;
+    }
+
+private:
+    bool m_verify;
+};
+
+struct Pause {
+    QString action;
+    QJsonObject event;
+};
+
+} // namespace
+
+/**
+ * @brief Up-front PIN handling in FlowBase against the virtual card farm
+ *
+ * The farm runs the secure channel for real, so these go through CommandSet
+ * exactly as a flow on a card would; its per-INS counters show which
+ * commands were sent.
+ */
+class TestFlowEagerPin : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir* m_dir = nullptr;
+    VirtualCardFarm* m_farm = nullptr;  // Owned by the channel
+    QMutex m_pausesMutex;
+    QVector<Pause> m_pauses;
+
+    void insertCard(VirtualCardFarm::CardState state, const QJsonObject& card = QJsonObject())
+    {
+        QVERIFY(m_farm->registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted, state, card).isEmpty());
+    }
+
+    int commands(const char* ins) const
+    {
+        return m_farm->stats()["commands"].toObject()[QString::fromLatin1(ins)].toInt();
+    }
+
+    int pauseCount()
+    {
+        QMutexLocker locker(&m_pausesMutex);
+        return m_pauses.size();
+    }
+
+    Pause pause(int index)
+    {
+        QMutexLocker locker(&m_pausesMutex);
+        return m_pauses.value(index);
+    }
+
+    QFuture<QJsonObject> run(PinStepsFlow* flow)
+    {
+        connect(flow, &FlowBase::flowPaused, flow, [this](const QString& action, const QJsonObject& event) {
+            QMutexLocker locker(&m_pausesMutex);
+            m_pauses.append(Pause{action, event});
+        }, Qt::DirectConnection);
+        return QtConcurrent::run([flow]() { return flow->execute(); });
+    }
+
+private slots:
+    void init()
+    {
+        m_dir = new QTemporaryDir();
+        QVERIFY(m_dir->isValid());
+        auto storage = std::make_shared<FilePairingStorage>();
+        storage->setPath(m_dir->filePath("pairings.json"));
+
+        m_farm = new VirtualCardFarm();
+        auto channel = std::make_shared<Keycard::KeycardChannel>(m_farm);
+        auto commandSet = std::make_shared<Keycard::CommandSet>(channel, storage, [](const QString&) {
+            return QString("KeycardDefaultPairing");
+        });
+        QVERIFY(FlowManager::instance()->init(commandSet));
+        m_pauses.clear();
+    }
+
+    void cleanup()
+    {
+        delete m_dir;
+        m_dir = nullptr;
+    }
+
+    void testCorrectPinVerifiedOnceAfterSelect()
+    {
+        insertCard(VirtualCardFarm::CardState::KeycardWithMnemonicOnly);
+        QJsonObject params;
+        params[FlowParams::PIN] = "000000";
+        PinStepsFlow flow(params, true);
+
+        QJsonObject result = run(&flow).result();
+        QVERIFY(result["ok"].toBool());
+        QCOMPARE(pauseCount(), 0);
+        QCOMPARE(commands("20"), 1);  // VERIFY PIN
+        QCOMPARE(commands("a4"), 1);  // No re-SELECT in verifyPIN()
+    }
+
+    void testWrongPinNotResent()
+    {
+        insertCard(VirtualCardFarm::CardState::KeycardWithMnemonicOnly);
+        QJsonObject params;
+        params[FlowParams::PIN] = "111111";
+        PinStepsFlow flow(params, true);
+        QFuture<QJsonObject> future = run(&flow);
+
+        // The rejected PIN is not tried again; the prompt says why
+        QTRY_COMPARE(pauseCount(), 1);
+        QCOMPARE(pause(0).action, FlowSignals::ENTER_PIN);
+        QCOMPARE(pause(0).event[FlowParams::ERROR_KEY].toString(), QString("pin"));
+        QCOMPARE(pause(0).event[FlowParams::PIN_RETRIES].toInt(), 2);
+        QCOMPARE(commands("20"), 1);
+
+        QJsonObject pin;
+        pin[FlowParams::PIN] = "000000";
+        flow.resume(pin);
+        QVERIFY(future.result()["ok"].toBool());
+        QCOMPARE(pauseCount(), 1);
+        QCOMPARE(commands("20"), 2);
+    }
+
+    void testBlockedAfterEagerFailure()
+    {
+        QJsonObject card;
+        card["pinRetries"] = 1;
+        insertCard(VirtualCardFarm::CardState::KeycardWithMnemonicOnly, card);
+        QJsonObject params;
+        params[FlowParams::PIN] = "111111";
+        PinStepsFlow flow(params, true);
+        QFuture<QJsonObject> future = run(&flow);
+
+        // The eager attempt used the last retry: PUK next, not the PIN again
+        QTRY_COMPARE(pauseCount(), 1);
+        QCOMPARE(pause(0).action, FlowSignals::ENTER_PUK);
+        QCOMPARE(commands("20"), 1);
+
+        QJsonObject unblock;
+        unblock[FlowParams::PUK] = "000000000000";
+        unblock[FlowParams::NEW_PIN] = "123456";
+        flow.resume(unblock);
+        QVERIFY(future.result()["ok"].toBool());
+        QCOMPARE(pauseCount(), 1);
+        QCOMPARE(commands("22"), 1);  // UNBLOCK PIN
+        QCOMPARE(commands("20"), 2);  // With the new PIN
+    }
+
+    void testNoEagerAttemptOnUninitializedCard()
+    {
+        insertCard(VirtualCardFarm::CardState::EmptyKeycard);
+        QJsonObject params;
+        params[FlowParams::PIN] = "000000";
+        PinStepsFlow flow(params, false);
+
+        QVERIFY(run(&flow).result()["ok"].toBool());
+        QCOMPARE(commands("a4"), 1);
+        QCOMPARE(commands("20"), 0);
+    }
+
+    void testNoEagerAttemptOnKeylessCard()
+    {
+        QJsonObject card;
+        card["keyless"] = true;
+        insertCard(VirtualCardFarm::CardState::KeycardWithMnemonicOnly, card);
+        QJsonObject params;
+        params[FlowParams::PIN] = "000000";
+        PinStepsFlow flow(params, false);
+
+        QVERIFY(run(&flow).result()["ok"].toBool());
+        QCOMPARE(commands("a4"), 1);
+        QCOMPARE(commands("20"), 0);
+        QCOMPARE(commands("12"), 0);  // Nor pairing for it
+    }
+};
+
+QTEST_MAIN(TestFlowEagerPin)
+#include "test_flow_eager_pin.moc"
@@ -0,0 +1,125 @@
+#include <QtTest/QtTest>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QTemporaryDir>
+#include "flow/flow_manager.h"
+#include "flow/flow_params.h"
+#include "flow/flow_signals.h"
+#include "flow/flow_types.h"
+#include "mocked/virtual_card_farm.h"
+#include "signal_manager.h"
+#include "storage/file_pairing_storage.h"
+#include <keycard-qt/keycard_channel.h>
+#include <keycard-qt/command_set.h>
+#include <memory>
+
+using namespace StatusKeycard;
+
+/**
+ * @brief Handing the card from a finished flow to the next queued one
+ *
+ * FlowManager sets the channel Idle after a flow unless it hands the card
+ * over; the virtual card farm counts those requests.
+ */
+class TestFlowHandover : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir* m_dir = nullptr;
+    VirtualCardFarm* m_farm = nullptr;  // Owned by the channel
+
+    static QMutex s_resultsMutex;
+    static QVector<QJsonObject> s_results;
+
+    static void signalCallback(const char* signal)
+    {
+        QJsonObject json = QJsonDocument::fromJson(QByteArray(signal)).object();
+        if (json["type"].toString() == FlowSignals::FLOW_RESULT) {
+            QMutexLocker locker(&s_resultsMutex);
+            s_results.append(json["event"].toObject());
+        }
+    }
+
+    static int resultCount()
+    {
+        QMutexLocker locker(&s_resultsMutex);
+        return s_results.size();
+    }
+
+    int idleRequests() const
+    {
+        return m_farm->stats()["idleRequests"].toInt();
+    }
+
+private slots:
+    void init()
+    {
+        m_dir = new QTemporaryDir();
+        QVERIFY(m_dir->isValid());
+        auto storage = std::make_shared<FilePairingStorage>();
+        storage->setPath(m_dir->filePath("pairings.json"));
+
+        m_farm = new VirtualCardFarm();
+        auto channel = std::make_shared<Keycard::KeycardChannel>(m_farm);
+        auto commandSet = std::make_shared<Keycard::CommandSet>(channel, storage, [](const QString&) {
+            return QString("KeycardDefaultPairing");
+        });
+        QVERIFY(FlowManager::instance()->init(commandSet));
+        FlowManager::instance()->stats().reset();
+
+        {
+            QMutexLocker locker(&s_resultsMutex);
+            s_results.clear();
+        }
+        SignalManager::instance()->setCallback(signalCallback);
+    }
+
+    void cleanup()
+    {
+        SignalManager::instance()->setCallback(nullptr);
+        delete m_dir;
+        m_dir = nullptr;
+    }
+
+    void testGetAppInfoHandsCardToQueuedFlow()
+    {
+        QVERIFY(m_farm->registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                                     VirtualCardFarm::CardState::KeycardWithMnemonicOnly,
+                                     QJsonObject()).isEmpty());
+        // FlowManager only hands over a card it saw being detected
+        m_farm->startDetection();
+        QTest::qWait(50);
+
+        QJsonObject params;
+        params[FlowParams::SELECT_ONLY] = true;
+        const int type = static_cast<int>(FlowType::GetAppInfo);
+        QVERIFY(FlowManager::instance()->startFlow(type, params));
+        QVERIFY(FlowManager::instance()->startFlow(type, params));  // Queued behind the first
+        const int idleBefore = idleRequests();
+
+        QTRY_COMPARE(resultCount(), 2);
+        {
+            QMutexLocker locker(&s_resultsMutex);
+            QCOMPARE(s_results[0][FlowParams::ERROR_KEY].toString(), QString("ok"));
+            QCOMPARE(s_results[1][FlowParams::ERROR_KEY].toString(), QString("ok"));
+        }
+
+        // "ok" is success: the reader session stays up between the flows and
+        // is only set Idle after the last one
+        QTRY_COMPARE(idleRequests(), idleBefore + 1);
+        QTest::qWait(50);
+        QCOMPARE(idleRequests(), idleBefore + 1);
+
+        FlowStats::TypeStats stats = FlowManager::instance()->stats().stats(FlowType::GetAppInfo);
+        QCOMPARE(stats.completed, quint64(2));
+        QCOMPARE(stats.failed, quint64(0));
+    }
+};
+
+QMutex TestFlowHandover::s_resultsMutex;
+QVector<QJsonObject> TestFlowHandover::s_results;
+
+QTEST_MAIN(TestFlowHandover)
+#include "test_flow_handover.moc"
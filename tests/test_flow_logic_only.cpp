@@ -1,8 +1,16 @@
 #include <QtTest/QtTest>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QJsonDocument>
 #include "flow/flow_types.h"
 #include "flow/flow_params.h"
+#include "flow/flow_registry.h"
+#include "flow/flow_stats.h"
+#include "flow/flow_command_mailbox.h"
+#include "flow/flow_queue.h"
+#include "flow/flows/flow_base.h"
+#include "request_decoder.h"
+#include <QThread>
 
 using namespace StatusKeycard;
 
@@ -24,6 +32,7 @@ private slots:
         QCOMPARE(static_cast<int>(FlowType::ChangePairing), 8);
         QCOMPARE(static_cast<int>(FlowType::StoreMetadata), 12);
         QCOMPARE(static_cast<int>(FlowType::GetMetadata), 13);
+        QCOMPARE(static_cast<int>(FlowType::Composite), 14);
     }
 
     void testFlowTypeDistinct()
@@ -301,6 +310,337 @@ private slots:
         params[FlowParams::BIP44_PATH] = "m/44'/60'/0'/0/0";
         QVERIFY(params.contains(FlowParams::BIP44_PATH));
     }
+
+    void testFlowRegistryCoversAllTypes()
+    {
+        QCOMPARE(static_cast<int>(FlowRegistry::all().size()), 15);
+        for (int type = 0; type <= static_cast<int>(FlowType::Composite); type++) {
+            const FlowDescriptor* descriptor = FlowRegistry::find(type);
+            QVERIFY(descriptor != nullptr);
+            QCOMPARE(static_cast<int>(descriptor->type), type);
+        }
+        QVERIFY(FlowRegistry::find(-1) == nullptr);
+        QVERIFY(FlowRegistry::find(15) == nullptr);
+    }
+
+    void testFlowRegistryUnimplementedTypes()
+    {
+        QVERIFY(FlowRegistry::find(static_cast<int>(FlowType::UnpairThis))->create == nullptr);
+        QVERIFY(FlowRegistry::find(static_cast<int>(FlowType::UnpairOthers))->create == nullptr);
+        QVERIFY(FlowRegistry::find(static_cast<int>(FlowType::DeleteAccountAndUnpair))->create == nullptr);
+        QVERIFY(FlowRegistry::find(static_cast<int>(FlowType::Login))->create != nullptr);
+    }
+
+    void testFlowRegistryParamSchema()
+    {
+        const FlowDescriptor* sign = FlowRegistry::find(static_cast<int>(FlowType::Sign));
+        QVERIFY(FlowRegistry::acceptsParam(*sign, FlowParams::TX_HASH));
+        QVERIFY(FlowRegistry::acceptsParam(*sign, FlowParams::PIN));  // Common parameter
+        QVERIFY(!FlowRegistry::acceptsParam(*sign, FlowParams::CARD_NAME));
+    }
+
+    void testFlowRegistryComposableSteps()
+    {
+        const FlowDescriptor* login = FlowRegistry::find(static_cast<int>(FlowType::Login));
+        QVERIFY(login->composable);
+        QVERIFY(FlowRegistry::runsStep(*login, "requireKeys"));
+        QVERIFY(FlowRegistry::runsStep(*login, "verifyPIN"));
+
+        // Flows that change keys, pairing or the card itself cannot share a session
+        QVERIFY(!FlowRegistry::find(static_cast<int>(FlowType::LoadAccount))->composable);
+        QVERIFY(!FlowRegistry::find(static_cast<int>(FlowType::ChangePairing))->composable);
+        QVERIFY(!FlowRegistry::find(static_cast<int>(FlowType::GetAppInfo))->composable);
+        QVERIFY(!FlowRegistry::find(static_cast<int>(FlowType::Composite))->composable);
+
+        const FlowDescriptor* metadata = FlowRegistry::find(static_cast<int>(FlowType::GetMetadata));
+        QVERIFY(metadata->composable);
+        QVERIFY(!FlowRegistry::runsStep(*metadata, "requireKeys"));
+
+        const FlowDescriptor* composite = FlowRegistry::find(static_cast<int>(FlowType::Composite));
+        QVERIFY(FlowRegistry::acceptsParam(*composite, FlowParams::COMPOSITE_STEPS));
+    }
+
+    void testFlowStatsHistogram()
+    {
+        FlowStats stats;
+        stats.recordStarted(FlowType::Sign);
+        stats.recordExecution(FlowType::Sign, 0, FlowStats::Outcome::Completed);
+        stats.recordExecution(FlowType::Sign, 5, FlowStats::Outcome::Failed);
+        stats.recordStep(FlowType::Sign, "verifyPIN", 3);
+
+        FlowStats::TypeStats sign = stats.stats(FlowType::Sign);
+        QCOMPARE(sign.started, quint64(1));
+        QCOMPARE(sign.completed, quint64(1));
+        QCOMPARE(sign.failed, quint64(1));
+        QCOMPARE(sign.execute.count, quint64(2));
+        QCOMPARE(sign.execute.maxMs, qint64(5));
+        QCOMPARE(sign.execute.buckets[0], quint64(1));  // < 1ms
+        QCOMPARE(sign.execute.buckets[3], quint64(1));  // 4..7ms
+        QCOMPARE(sign.steps.value("verifyPIN").count, quint64(1));
+
+        // Declared steps are listed even when never recorded
+        QJsonObject json = stats.toJson();
+        QJsonObject steps = json["Sign"].toObject()["steps"].toObject();
+        QVERIFY(steps.contains("selectKeycard"));
+        QCOMPARE(steps["verifyPIN"].toObject()["count"].toInt(), 1);
+        QVERIFY(!json.contains("UnpairThis"));
+
+        stats.reset();
+        QCOMPARE(stats.stats(FlowType::Sign).started, quint64(0));
+    }
+    void testFlowCommandMailboxOrder()
+    {
+        FlowCommandMailbox mailbox;
+        QVERIFY(mailbox.takeAll().isEmpty());
+
+        // Only the first post into an empty mailbox asks for a drain
+        FlowCommand start;
+        start.token = mailbox.nextToken();
+        start.kind = FlowCommand::Kind::Start;
+        start.flowType = static_cast<int>(FlowType::Sign);
+        QVERIFY(mailbox.post(start));
+
+        FlowCommand cancel;
+        cancel.token = mailbox.nextToken();
+        cancel.kind = FlowCommand::Kind::Cancel;
+        QVERIFY(!mailbox.post(cancel));
+        QVERIFY(start.token != cancel.token);
+
+        QVector<FlowCommand> commands = mailbox.takeAll();
+        QCOMPARE(commands.size(), 2);
+        QCOMPARE(commands[0].token, start.token);
+        QCOMPARE(commands[0].flowType, static_cast<int>(FlowType::Sign));
+        QCOMPARE(commands[1].token, cancel.token);
+        QVERIFY(commands[1].kind == FlowCommand::Kind::Cancel);
+
+        QVERIFY(mailbox.post(cancel));  // Empty again after takeAll
+    }
+
+    void testFlowCommandMailboxConcurrentPosts()
+    {
+        FlowCommandMailbox mailbox;
+        const int threads = 4;
+        const int perThread = 500;
+
+        QVector<QThread*> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.append(QThread::create([&mailbox, t, perThread]() {
+                for (int i = 0; i < perThread; ++i) {
+                    FlowCommand command;
+                    command.token = mailbox.nextToken();
+                    command.flowType = t;
+                    command.params["seq"] = i;
+                    mailbox.post(command);
+                }
+            }));
+        }
+        for (QThread* worker : workers) {
+            worker->start();
+        }
+        for (QThread* worker : workers) {
+            worker->wait();
+            delete worker;
+        }
+
+        QVector<FlowCommand> commands = mailbox.takeAll();
+        QCOMPARE(commands.size(), threads * perThread);
+
+        // Tokens are unique and each producer's commands stay in order
+        QSet<quint64> tokens;
+        QVector<int> lastSeq(threads, -1);
+        for (const FlowCommand& command : commands) {
+            tokens.insert(command.token);
+            int seq = command.params["seq"].toInt();
+            QVERIFY(seq > lastSeq[command.flowType]);
+            lastSeq[command.flowType] = seq;
+        }
+        QCOMPARE(tokens.size(), threads * perThread);
+    }
+    void testFlowQueueOrderAndDeadlines()
+    {
+        FlowQueue queue(3);
+        const int sign = static_cast<int>(FlowType::Sign);
+        const int info = static_cast<int>(FlowType::GetAppInfo);
+
+        quint64 low = queue.enqueue(sign, QJsonObject(), nullptr, 0, 0);
+        quint64 high = queue.enqueue(info, QJsonObject(), nullptr, 5, 0);
+        quint64 expiring = queue.enqueue(sign, QJsonObject(), nullptr, 0, 1);
+        QVERIFY(low && high && expiring);
+        QCOMPARE(queue.enqueue(sign, QJsonObject(), nullptr, 9, 0), quint64(0));  // Full
+
+        // Higher priority first, posting order within a priority
+        QCOMPARE(queue.position(high), 0);
+        QCOMPARE(queue.position(low), 1);
+        QCOMPARE(queue.position(expiring), 2);
+        QVERIFY(queue.msUntilNextDeadline() >= 0);
+
+        QTest::qWait(5);
+        QVector<QueuedFlow> expired = queue.takeExpired();
+        QCOMPARE(expired.size(), 1);
+        QCOMPARE(expired[0].id, expiring);
+        QCOMPARE(queue.msUntilNextDeadline(), qint64(-1));
+
+        QueuedFlow next;
+        QVERIFY(queue.takeNext(next));
+        QCOMPARE(next.id, high);
+        QCOMPARE(next.flowType, info);
+        QVERIFY(queue.waitedMs(next) >= 5);
+        QVERIFY(queue.takeNext(next));
+        QCOMPARE(next.id, low);
+        QVERIFY(!queue.takeNext(next));
+
+        // Capacity 0 rejects everything (pre-queue behaviour)
+        queue.setCapacity(0);
+        QCOMPARE(queue.enqueue(sign, QJsonObject(), nullptr, 0, 0), quint64(0));
+    }
+
+    // Sign request with count hashes and paths, as a large batch arrives
+    static QJsonObject signBatchPayload(int count)
+    {
+        QJsonArray hashes;
+        QJsonArray paths;
+        for (int i = 0; i < count; ++i) {
+            QByteArray hash(32, static_cast<char>(i & 0xFF));
+            hashes.append((i % 2 ? "0x" : "") + QString::fromLatin1(hash.toHex()));
+            paths.append(QString("m/44'/60'/0'/0/%1").arg(i));
+        }
+        QJsonObject payload;
+        payload[FlowParams::TX_HASH] = hashes;
+        payload[FlowParams::BIP44_PATH] = paths;
+        payload[FlowParams::PIN] = "123456";
+        payload[FlowParams::VERIFY_SIGNATURE] = true;
+        return payload;
+    }
+
+    void testRequestDecoderBatch()
+    {
+        QJsonObject payload = signBatchPayload(1000);
+        QByteArray json = QJsonDocument(payload).toJson(QJsonDocument::Compact);
+
+        QJsonObject params;
+        std::shared_ptr<RequestBatch> batch;
+        QCOMPARE(RequestDecoder::decodeFlowParams(FlowType::Sign, json, params, batch), RequestDecoder::Result::Decoded);
+        QVERIFY(batch);
+        QCOMPARE(batch->hashCount, 1000);
+        QCOMPARE(batch->hashes.size(), 1000 * RequestBatch::HashSize);
+        QCOMPARE(batch->hash(257), QByteArray(32, static_cast<char>(1)));
+        QCOMPARE(batch->paths.size(), 1000);
+        QCOMPARE(batch->paths[999], QString("m/44'/60'/0'/0/999"));
+
+        // Batch arrays are not duplicated in the DOM; the rest is
+        QVERIFY(!params.contains(FlowParams::TX_HASH));
+        QCOMPARE(params[FlowParams::PIN].toString(), QString("123456"));
+        QVERIFY(params[FlowParams::VERIFY_SIGNATURE].toBool());
+
+        // Small payloads stay on QJsonDocument
+        QCOMPARE(RequestDecoder::decodeFlowParams(FlowType::Sign, "{\"pin\":\"123456\"}", params, batch),
+                 RequestDecoder::Result::Fallback);
+    }
+
+    void testRequestDecoderHashesMatchJsonPath()
+    {
+        // Every entry the fast path refuses goes to QJsonDocument, and
+        // SignFlow refuses the same entries there
+        const QJsonValue entries[] = {
+            QString("zz") + QString(62, QLatin1Char('0')),  // Not hex
+            QString(40, QLatin1Char('a')),                   // 20 bytes
+            QString("0x") + QString(66, QLatin1Char('a')),  // 33 bytes
+            QString(),                                       // Empty
+            42                                               // Not a string
+        };
+        for (const QJsonValue& entry : entries) {
+            QJsonObject payload = signBatchPayload(200);
+            QJsonArray hashes = payload[FlowParams::TX_HASH].toArray();
+            hashes[100] = entry;
+            payload[FlowParams::TX_HASH] = hashes;
+            QByteArray json = QJsonDocument(payload).toJson(QJsonDocument::Compact);
+
+            QJsonObject params;
+            std::shared_ptr<RequestBatch> batch;
+            QCOMPARE(RequestDecoder::decodeFlowParams(FlowType::Sign, json, params, batch),
+                     RequestDecoder::Result::Fallback);
+            QByteArray hash;
+            QVERIFY(!RequestBatch::decodeHash(entry.toString(), hash));
+        }
+
+        QByteArray hash;
+        QVERIFY(RequestBatch::decodeHash(QString("0X") + QString(64, QLatin1Char('F')), hash));
+        QCOMPARE(hash, QByteArray(32, static_cast<char>(0xFF)));
+        const QByteArray hex = "0x" + QByteArray(64, 'f');
+        char raw[RequestBatch::HashSize];
+        QVERIFY(RequestBatch::decodeHash(hex.constData(), hex.size(), raw));
+    }
+
+    void testRequestDecoderTrailingBackslash()
+    {
+        // A string cut after a backslash must not move the scanner past the end
+        QByteArray json = "{\"pin\":\"" + QByteArray(RequestDecoder::LargePayloadBytes, 'a') + "\\";
+        QJsonObject params;
+        std::shared_ptr<RequestBatch> batch;
+        QCOMPARE(RequestDecoder::decodeFlowParams(FlowType::Sign, json, params, batch),
+                 RequestDecoder::Result::Fallback);
+
+        json = "{\"tx-hash\":[\"" + QByteArray(RequestDecoder::LargePayloadBytes, 'a') + "\\";
+        QCOMPARE(RequestDecoder::decodeFlowParams(FlowType::Sign, json, params, batch),
+                 RequestDecoder::Result::Fallback);
+    }
+
+    // A 1000-hash Sign batch through the decoder and through QJsonDocument
+    // plus the per-entry hex decoding SignFlow does on that path
+    void benchmarkRequestDecoderSignBatch()
+    {
+        QByteArray json = QJsonDocument(signBatchPayload(1000)).toJson(QJsonDocument::Compact);
+        QBENCHMARK {
+            QJsonObject params;
+            std::shared_ptr<RequestBatch> batch;
+            RequestDecoder::decodeFlowParams(FlowType::Sign, json, params, batch);
+        }
+    }
+
+    void benchmarkJsonDocumentSignBatch()
+    {
+        QByteArray json = QJsonDocument(signBatchPayload(1000)).toJson(QJsonDocument::Compact);
+        QBENCHMARK {
+            QJsonObject params = QJsonDocument::fromJson(json).object();
+            QVector<QByteArray> hashes;
+            for (const QJsonValue& value : params[FlowParams::TX_HASH].toArray()) {
+                QByteArray hash;
+                RequestBatch::decodeHash(value.toString(), hash);
+                hashes.append(hash);
+            }
+        }
+    }
+
+    void testRequestDecoderLeavesOtherFlowsAlone()
+    {
+        // ExportPublic reads bip44-path from params, never from a batch
+        QJsonArray paths;
+        for (int i = 0; i < 200; ++i) {
+            paths.append(QString("m/44'/60'/0'/0/%1").arg(i));
+        }
+        QJsonObject payload;
+        payload[FlowParams::BIP44_PATH] = paths;
+        payload[FlowParams::PIN] = "123456";
+        QByteArray json = QJsonDocument(payload).toJson(QJsonDocument::Compact);
+        QVERIFY(json.size() >= RequestDecoder::LargePayloadBytes);
+
+        QJsonObject params;
+        std::shared_ptr<RequestBatch> batch;
+        QCOMPARE(RequestDecoder::decodeFlowParams(FlowType::ExportPublic, json, params, batch),
+                 RequestDecoder::Result::Fallback);
+        QVERIFY(!batch);
+        QVERIFY(params.isEmpty());
+    }
+
+    void testFlowResultIsError()
+    {
+        QVERIFY(!FlowResult::isError(QJsonObject()));
+        QVERIFY(!FlowResult::isError(QJsonObject{{FlowParams::ERROR_KEY, ""}}));
+        // GetAppInfo's success
+        QVERIFY(!FlowResult::isError(QJsonObject{{FlowParams::ERROR_KEY, "ok"}}));
+        QVERIFY(FlowResult::isError(QJsonObject{{FlowParams::ERROR_KEY, "cancelled"}}));
+        QVERIFY(FlowResult::isError(QJsonObject{{FlowParams::ERROR_KEY, "step-failed"}}));
+    }
 };
 
 QTEST_MAIN(TestFlowLogicOnly)
@@ -4,22 +4,97 @@
 #include "signal_manager.h"
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 
 using namespace StatusKeycard;
 
+#ifdef __GLIBC__
+// Heap allocations made by this thread while counting; QByteArray, QString
+// and operator new all end up in malloc
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+namespace {
+thread_local bool s_countAllocations = false;
+thread_local int s_allocations = 0;
+}
+
+extern "C" void* malloc(size_t size) noexcept
+{
+    s_allocations += s_countAllocations;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept
+{
+    s_allocations += s_countAllocations;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) noexcept
+{
+    s_allocations += s_countAllocations;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) noexcept
+{
+    __libc_free(ptr);
+}
+
+template <typename Function>
+static int countAllocations(Function function)
+{
+    s_allocations = 0;
+    s_countAllocations = true;
+    function();
+    s_countAllocations = false;
+    return s_allocations;
+}
+#endif
+
 class TestFlowSignals : public QObject
 {
     Q_OBJECT
 
 private:
     QString lastSignal;
+    static const char* s_lastSignalData;
+
+    static QJsonObject sampleResult()
+    {
+        QJsonObject result;
+        result[FlowParams::KEY_UID] = QString(64, QLatin1Char('a'));
+        result[FlowParams::INSTANCE_UID] = QString(32, QLatin1Char('b'));
+        result[FlowParams::FREE_SLOTS] = 3;
+        QJsonArray keys;
+        for (int i = 0; i < 8; ++i) {
+            QJsonObject key;
+            key["address"] = QString("0x%1").arg(i, 40, 16, QLatin1Char('0'));
+            key["publicKey"] = QString(130, QLatin1Char('c'));
+            keys.append(key);
+        }
+        result["keys"] = keys;
+        return result;
+    }
+
+    // Envelope as built before signals were serialized in place
+    static QByteArray documentEnvelope(const QString& type, const QJsonObject& event)
+    {
+        QJsonObject signal;
+        signal["type"] = type;
+        signal["event"] = event;
+        return QJsonDocument(signal).toJson(QJsonDocument::Compact);
+    }
     
 private slots:
     void initTestCase()
     {
         // Register callback to capture signals
         SignalManager::instance()->setCallback([](const char* signal) {
-            // Signals are captured by the test
+            s_lastSignalData = signal;
         });
     }
 
@@ -106,8 +181,105 @@ private slots:
         QCOMPARE(cardInfo[FlowParams::PIN_RETRIES].toInt(), 3);
         QCOMPARE(cardInfo[FlowParams::PUK_RETRIES].toInt(), 5);
     }
+
+    void testSerializeMatchesDocument_data()
+    {
+        QTest::addColumn<QString>("type");
+        QTest::addColumn<QJsonObject>("event");
+
+        QJsonObject escaped;
+        escaped[FlowParams::ERROR_KEY] = QString::fromUtf8("quote\" back\\ tab\t \xC3\xA9 \xE2\x82\xAC");
+        QJsonObject nested;
+        nested["card"] = QJsonObject{{"type", "inner"}, {"retries", 3}};
+
+        QTest::newRow("empty") << FlowSignals::CARD_INSERTED << QJsonObject();
+        QTest::newRow("pin") << FlowSignals::ENTER_PIN
+                             << QJsonObject{{FlowParams::ERROR_KEY, "enter-pin"}, {FlowParams::PIN_RETRIES, 3}};
+        QTest::newRow("escaped") << FlowSignals::FLOW_RESULT << escaped;
+        QTest::newRow("nested-type-key") << FlowSignals::FLOW_RESULT << nested;
+        QTest::newRow("result") << FlowSignals::FLOW_RESULT << sampleResult();
+    }
+
+    void testSerializeMatchesDocument()
+    {
+        QFETCH(QString, type);
+        QFETCH(QJsonObject, event);
+
+        QByteArray signal = FlowSignals::serialize(type, event);
+        QCOMPARE(signal, documentEnvelope(type, event));
+
+        QJsonObject parsed = QJsonDocument::fromJson(signal).object();
+        QCOMPARE(parsed["type"].toString(), type);
+        QCOMPARE(parsed["event"].toObject(), event);
+    }
+
+    void testSerializedSignalReachesCallbackWithoutCopy()
+    {
+        QByteArray signal = FlowSignals::serialize(FlowSignals::FLOW_RESULT, sampleResult());
+        const char* data = signal.constData();
+        s_lastSignalData = nullptr;
+
+        SignalManager::instance()->emitSerialized(std::move(signal), FlowSignals::FLOW_RESULT);
+
+        // The callback sees the buffer written by serialize(), not a copy
+        QVERIFY(s_lastSignalData == data);
+    }
+
+    void testSignalAllocations()
+    {
+#ifndef __GLIBC__
+        QSKIP("Allocation counting needs glibc");
+#else
+        QJsonObject event = sampleResult();
+        SignalManager::instance()->emitSerialized(FlowSignals::serialize(FlowSignals::FLOW_RESULT, event),
+                                                  FlowSignals::FLOW_RESULT);
+
+        // Handing a serialized signal to the callback allocates nothing
+        QByteArray signal = FlowSignals::serialize(FlowSignals::FLOW_RESULT, event);
+        QCOMPARE(countAllocations([&]() {
+            SignalManager::instance()->emitSerialized(std::move(signal), FlowSignals::FLOW_RESULT);
+        }), 0);
+
+        // Serializing in place allocates less than the document envelope and
+        // QString round trip it replaced
+        int serialized = countAllocations([&]() {
+            QByteArray bytes = FlowSignals::serialize(FlowSignals::FLOW_RESULT, event);
+            Q_UNUSED(bytes);
+        });
+        int document = countAllocations([&]() {
+            QString json = QString::fromUtf8(documentEnvelope(FlowSignals::FLOW_RESULT, event));
+            QByteArray bytes = json.toUtf8();
+            Q_UNUSED(bytes);
+        });
+        qDebug() << "Allocations per signal: serialize" << serialized << "document" << document;
+        QVERIFY(serialized < document);
+#endif
+    }
+
+    // Per flow signal: serialize the event, build the envelope, then hand it
+    // over as before (QString round trip) and as now (moved UTF-8 buffer)
+    void benchmarkDocumentEnvelope()
+    {
+        QJsonObject event = sampleResult();
+        QBENCHMARK {
+            QString json = QString::fromUtf8(documentEnvelope(FlowSignals::FLOW_RESULT, event));
+            QByteArray bytes = json.toUtf8();
+            Q_UNUSED(bytes);
+        }
+    }
+
+    void benchmarkSerialize()
+    {
+        QJsonObject event = sampleResult();
+        QBENCHMARK {
+            QByteArray bytes = FlowSignals::serialize(FlowSignals::FLOW_RESULT, event);
+            Q_UNUSED(bytes);
+        }
+    }
 };
 
+const char* TestFlowSignals::s_lastSignalData = nullptr;
+
 QTEST_MAIN(TestFlowSignals)
 #include "test_flow_signals.moc"
 
@@ -0,0 +1,178 @@
+#include <QtTest/QtTest>
+#include <QRandomGenerator>
+#include "hex_codec.h"
+#include <cctype>
+
+using namespace StatusKeycard;
+
+Q_DECLARE_METATYPE(StatusKeycard::HexCodec::Kernel)
+
+/**
+ * @brief Tests for the hex codec
+ *
+ * Every kernel available on this machine must agree with QByteArray::toHex
+ * for all lengths around the vector widths, accept either case and the
+ * optional prefix, and reject any non-hex digit wherever it appears.
+ */
+class TestHexCodec : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QByteArray randomBytes(int size, quint32 seed)
+    {
+        QRandomGenerator rng(seed);
+        QByteArray data(size, Qt::Uninitialized);
+        for (int i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(rng.bounded(256));
+        }
+        return data;
+    }
+
+    static void addKernelRows()
+    {
+        QTest::addColumn<HexCodec::Kernel>("kernel");
+        for (HexCodec::Kernel kernel : HexCodec::supportedKernels()) {
+            QTest::newRow(HexCodec::kernelName(kernel)) << kernel;
+        }
+    }
+
+private slots:
+    void testActiveKernelIsSupported()
+    {
+        QVERIFY(HexCodec::supportedKernels().contains(HexCodec::activeKernel()));
+        qDebug() << "Active hex kernel:" << HexCodec::kernelName(HexCodec::activeKernel());
+    }
+
+    void testEncodeMatchesQt_data() { addKernelRows(); }
+
+    void testEncodeMatchesQt()
+    {
+        QFETCH(HexCodec::Kernel, kernel);
+        for (int size = 0; size <= 130; ++size) {
+            QByteArray data = randomBytes(size, size);
+            QByteArray out(2 * size, Qt::Uninitialized);
+            HexCodec::encode(data.constData(), size, out.data(), kernel);
+            QCOMPARE(out, data.toHex());
+        }
+    }
+
+    void testDecodeRoundTrip_data() { addKernelRows(); }
+
+    void testDecodeRoundTrip()
+    {
+        QFETCH(HexCodec::Kernel, kernel);
+        for (int size = 0; size <= 130; ++size) {
+            QByteArray data = randomBytes(size, 1000 + size);
+            QByteArray hex = data.toHex();
+            if (size % 2) {
+                hex = hex.toUpper();
+            }
+            if (size % 3 == 0) {
+                hex.prepend(size % 2 ? "0X" : "0x");
+            }
+            QByteArray out(HexCodec::decodedSize(hex.size()), Qt::Uninitialized);
+            QCOMPARE(HexCodec::decode(hex.constData(), hex.size(), out.data(), kernel), qsizetype(size));
+            QCOMPARE(out.left(size), data);
+        }
+    }
+
+    void testDecodeRejectsInvalidDigits_data() { addKernelRows(); }
+
+    void testDecodeRejectsInvalidDigits()
+    {
+        QFETCH(HexCodec::Kernel, kernel);
+        // 48 bytes: one full AVX2 block, one SSE2 block and a scalar tail
+        const QByteArray hex = randomBytes(48, 7).toHex();
+        QByteArray out(48, Qt::Uninitialized);
+        for (int pos = 0; pos < hex.size(); ++pos) {
+            for (int c = 0; c < 256; ++c) {
+                if (isxdigit(c)) {
+                    continue;
+                }
+                QByteArray bad = hex;
+                bad[pos] = static_cast<char>(c);
+                QCOMPARE(HexCodec::decode(bad.constData(), bad.size(), out.data(), kernel), qsizetype(-1));
+            }
+        }
+    }
+
+    void testDecodeRejectsOddLength()
+    {
+        char out[4];
+        QCOMPARE(HexCodec::decode("abc", 3, out), qsizetype(-1));
+        QCOMPARE(HexCodec::decode("0xabc", 5, out), qsizetype(-1));
+        QCOMPARE(HexCodec::decode("0x", 2, out), qsizetype(0));
+    }
+
+    void testStringHelpers()
+    {
+        QByteArray data = randomBytes(600, 42);  // Spans several conversion chunks
+        QString hex = HexCodec::toHex(data);
+        QCOMPARE(hex, QString::fromLatin1(data.toHex()));
+        QCOMPARE(HexCodec::toHex(data, true), QStringLiteral("0x") + hex);
+        QCOMPARE(HexCodec::toHexBytes(data), data.toHex());
+        QCOMPARE(HexCodec::toHex(QByteArray()), QString());
+        QCOMPARE(HexCodec::toHex(QByteArray(), true), QStringLiteral("0x"));
+
+        QCOMPARE(HexCodec::fromHex(hex), data);
+        QCOMPARE(HexCodec::fromHex(QStringLiteral("0X") + hex.toUpper()), data);
+
+        QByteArray out("stale");
+        QVERIFY(HexCodec::fromHex(hex.toLatin1(), out));
+        QCOMPARE(out, data);
+
+        // Characters outside Latin-1 that truncate to a hex digit
+        QString wide = hex;
+        wide[500] = QChar(0x0130);
+        QVERIFY(!HexCodec::fromHex(wide, out));
+        QVERIFY(out.isEmpty());
+        QVERIFY(HexCodec::fromHex(QStringLiteral("0xabz0")).isEmpty());
+    }
+
+    void benchmarkEncode_data() { addKernelRows(); }
+
+    void benchmarkEncode()
+    {
+        QFETCH(HexCodec::Kernel, kernel);
+        QByteArray data = randomBytes(64 * 1024, 1);
+        QByteArray out(2 * data.size(), Qt::Uninitialized);
+        QBENCHMARK {
+            HexCodec::encode(data.constData(), data.size(), out.data(), kernel);
+        }
+    }
+
+    void benchmarkDecode_data() { addKernelRows(); }
+
+    void benchmarkDecode()
+    {
+        QFETCH(HexCodec::Kernel, kernel);
+        QByteArray hex = randomBytes(64 * 1024, 2).toHex();
+        QByteArray out(hex.size() / 2, Qt::Uninitialized);
+        QBENCHMARK {
+            HexCodec::decode(hex.constData(), hex.size(), out.data(), kernel);
+        }
+    }
+
+    // Typical export result field: "0x" + 65-byte public key
+    void benchmarkPublicKeyQt()
+    {
+        QByteArray key = randomBytes(65, 3);
+        QBENCHMARK {
+            QString hex = QString("0x") + key.toHex();
+            Q_UNUSED(hex);
+        }
+    }
+
+    void benchmarkPublicKeyCodec()
+    {
+        QByteArray key = randomBytes(65, 3);
+        QBENCHMARK {
+            QString hex = HexCodec::toHex(key, true);
+            Q_UNUSED(hex);
+        }
+    }
+};
+
+QTEST_MAIN(TestHexCodec)
+#include "test_hex_codec.moc"
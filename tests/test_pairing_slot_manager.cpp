@@ -0,0 +1,124 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include "mocked/virtual_card_farm.h"
+#include "session/pairing_slot_manager.h"
+#include "storage/file_pairing_storage.h"
+#include <keycard-qt/keycard_channel.h>
+#include <keycard-qt/command_set.h>
+#include <memory>
+
+using namespace StatusKeycard;
+
+/**
+ * @brief Retired pairing recovery against the virtual card farm
+ *
+ * The farm answers OPEN SECURE CHANNEL like the applet: 6A86 for an index
+ * it holds no pairing key for.
+ */
+class TestPairingSlotManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void testSlotStatus();
+    void testRecoverHeldSlot();
+    void testRecoverForgetsUnknownSlot();
+
+private:
+    // Pair with the card and return its instance UID as stored
+    QString pair();
+
+    QTemporaryDir* m_dir = nullptr;
+    VirtualCardFarm* m_farm = nullptr;  // Owned by the channel
+    std::shared_ptr<FilePairingStorage> m_storage;
+    std::shared_ptr<Keycard::CommandSet> m_commandSet;
+};
+
+void TestPairingSlotManager::init()
+{
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+    m_storage = std::make_shared<FilePairingStorage>();
+    m_storage->setPath(m_dir->filePath("pairings.json"));
+
+    m_farm = new VirtualCardFarm();
+    QVERIFY(m_farm->registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                                 VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    auto channel = std::make_shared<Keycard::KeycardChannel>(m_farm);
+    m_commandSet = std::make_shared<Keycard::CommandSet>(channel, m_storage, [](const QString&) {
+        return QString("KeycardDefaultPairing");
+    });
+}
+
+void TestPairingSlotManager::cleanup()
+{
+    m_commandSet.reset();
+    m_storage.reset();
+    m_farm = nullptr;
+    delete m_dir;
+    m_dir = nullptr;
+}
+
+QString TestPairingSlotManager::pair()
+{
+    m_commandSet->select();
+    if (!m_commandSet->ensurePairing()) {
+        return QString();
+    }
+    QVector<FilePairingStorage::PairingRecord> pairings = m_storage->listPairings();
+    return pairings.size() == 1 ? pairings[0].instanceUID : QString();
+}
+
+void TestPairingSlotManager::testSlotStatus()
+{
+    const QString uid = pair();
+    QVERIFY(!uid.isEmpty());
+    const int index = m_storage->load(uid).index;
+
+    QCOMPARE(PairingSlotManager::openSecureChannelStatus(m_farm, index), quint16(0x9000));
+    QCOMPARE(PairingSlotManager::openSecureChannelStatus(m_farm, index + 1), quint16(0x6A86));
+    QCOMPARE(PairingSlotManager::openSecureChannelStatus(nullptr, index), quint16(0));
+
+    // The probe leaves nothing open: CommandSet still gets its own channel
+    QVERIFY2(m_commandSet->ensureSecureChannel(), qPrintable(m_commandSet->lastError()));
+}
+
+void TestPairingSlotManager::testRecoverHeldSlot()
+{
+    const QString uid = pair();
+    QVERIFY(!uid.isEmpty());
+    const int index = m_storage->load(uid).index;
+    QVERIFY(m_storage->remove(uid));  // Lost locally, still allocated on the card
+
+    PairingSlotManager manager;
+    m_commandSet->select();
+    QVERIFY(manager.recoverPairing(m_commandSet.get(), m_storage, uid));
+    QCOMPARE(m_storage->load(uid).index, index);
+    QVERIFY(m_storage->retiredPairings(uid).isEmpty());
+}
+
+void TestPairingSlotManager::testRecoverForgetsUnknownSlot()
+{
+    const QString uid = pair();
+    QVERIFY(!uid.isEmpty());
+    QVERIFY(m_storage->remove(uid));
+    QVERIFY(m_storage->forgetSlot(uid, m_storage->retiredPairings(uid)[0].pairing.index));
+
+    // A pairing for a slot the card never allocated (unpaired elsewhere)
+    Keycard::PairingInfo stale;
+    stale.key = QByteArray(32, 0x07);
+    stale.index = 4;
+    QVERIFY(m_storage->save(uid, stale));
+    QVERIFY(m_storage->remove(uid));
+
+    PairingSlotManager manager;
+    m_commandSet->select();
+    QVERIFY(!manager.recoverPairing(m_commandSet.get(), m_storage, uid));
+    QVERIFY(m_storage->retiredPairings(uid).isEmpty());
+    QVERIFY(!m_storage->load(uid).isValid());
+}
+
+QTEST_MAIN(TestPairingSlotManager)
+#include "test_pairing_slot_manager.moc"
@@ -0,0 +1,286 @@
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+#include <QJsonObject>
+#include <QThread>
+#include "remote/remote_protocol.h"
+#include "remote/remote_reader_agent.h"
+#include "remote/remote_reader_backend.h"
+#include "mocked/virtual_card_farm.h"
+
+using namespace StatusKeycard;
+
+/**
+ * @brief Remote reader bridge over loopback
+ *
+ * The agent serves a virtual card farm from its own thread, as it would
+ * from the reader host; the backend talks to it through 127.0.0.1.
+ */
+class TestRemoteReader : public QObject
+{
+    Q_OBJECT
+
+private:
+    QThread* m_agentThread = nullptr;
+    RemoteReaderAgent* m_agent = nullptr;
+    VirtualCardFarm* m_farm = nullptr;
+    RemoteReaderBackend* m_backend = nullptr;
+    quint16 m_port = 0;
+
+    static QByteArray select() { return QByteArray::fromHex("00A4040000"); }
+
+    static RemoteReaderBackend::Options fastOptions()
+    {
+        RemoteReaderBackend::Options options;
+        options.transmitTimeoutMs = 2000;
+        options.reconnectIntervalMs = 50;
+        options.pingIntervalMs = 50;
+        return options;
+    }
+
+    bool listen()
+    {
+        bool ok = false;
+        QMetaObject::invokeMethod(m_agent, [this, &ok]() {
+            ok = m_agent->listen(QHostAddress::LocalHost, m_port);
+            m_port = m_agent->port();
+        }, Qt::BlockingQueuedConnection);
+        return ok;
+    }
+
+    void insertCard()
+    {
+        QVERIFY(m_farm->registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                                     VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    }
+
+private slots:
+    void init()
+    {
+        m_agentThread = new QThread(this);
+        m_farm = new VirtualCardFarm();
+        m_agent = new RemoteReaderAgent(m_farm);
+        m_farm->setParent(m_agent);
+        m_agent->moveToThread(m_agentThread);
+        m_agentThread->start();
+
+        m_port = 0;
+        QVERIFY(listen());
+        m_backend = new RemoteReaderBackend("127.0.0.1", m_port, fastOptions());
+        QVERIFY(m_backend->waitForConnected(2000));
+    }
+
+    void cleanup()
+    {
+        delete m_backend;
+        m_backend = nullptr;
+        QMetaObject::invokeMethod(m_agent, [this]() { delete m_agent; }, Qt::BlockingQueuedConnection);
+        m_agent = nullptr;
+        m_farm = nullptr;
+        m_agentThread->quit();
+        m_agentThread->wait();
+        delete m_agentThread;
+        m_agentThread = nullptr;
+    }
+
+    void testFrameReader()
+    {
+        QByteArray stream = RemoteProtocol::encodeFrame(RemoteProtocol::FrameType::Transmit, 7, select())
+                          + RemoteProtocol::encodeFrame(RemoteProtocol::FrameType::Ping, 8);
+
+        // Byte by byte, as a slow link would deliver it
+        RemoteProtocol::FrameReader reader;
+        QVector<RemoteProtocol::Frame> frames;
+        RemoteProtocol::Frame frame;
+        for (char byte : stream) {
+            reader.append(QByteArray(1, byte));
+            while (reader.next(frame) == RemoteProtocol::FrameReader::Result::Frame) {
+                frames.append(frame);
+            }
+        }
+        QCOMPARE(frames.size(), 2);
+        QCOMPARE(frames[0].type, RemoteProtocol::FrameType::Transmit);
+        QCOMPARE(frames[0].id, quint32(7));
+        QCOMPARE(frames[0].payload, select());
+        QCOMPARE(frames[1].type, RemoteProtocol::FrameType::Ping);
+        QVERIFY(frames[1].payload.isEmpty());
+
+        RemoteProtocol::FrameReader oversized;
+        oversized.append(QByteArray::fromHex("7FFFFFFF10"));
+        QCOMPARE(oversized.next(frame), RemoteProtocol::FrameReader::Result::Error);
+
+        RemoteProtocol::FrameReader unknown;
+        unknown.append(QByteArray::fromHex("0000000563") + QByteArray(4, 0));
+        QCOMPARE(unknown.next(frame), RemoteProtocol::FrameReader::Result::Error);
+    }
+
+    void testParseAddress()
+    {
+        QString host;
+        quint16 port = 0;
+        QVERIFY(RemoteProtocol::parseAddress("reader.local", host, port));
+        QCOMPARE(host, QString("reader.local"));
+        QCOMPARE(port, RemoteProtocol::DefaultPort);
+        QVERIFY(RemoteProtocol::parseAddress("10.0.0.2:4000", host, port));
+        QCOMPARE(host, QString("10.0.0.2"));
+        QCOMPARE(port, quint16(4000));
+
+        // IPv6 literals, bare or bracketed
+        QVERIFY(RemoteProtocol::parseAddress("::1", host, port));
+        QCOMPARE(host, QString("::1"));
+        QCOMPARE(port, RemoteProtocol::DefaultPort);
+        QVERIFY(RemoteProtocol::parseAddress("[fe80::1]:4000", host, port));
+        QCOMPARE(host, QString("fe80::1"));
+        QCOMPARE(port, quint16(4000));
+        QVERIFY(RemoteProtocol::parseAddress("[::1]", host, port));
+        QCOMPARE(host, QString("::1"));
+
+        // Bad ports are rejected rather than read as 0
+        QVERIFY(!RemoteProtocol::parseAddress("host:", host, port));
+        QVERIFY(!RemoteProtocol::parseAddress("host:0", host, port));
+        QVERIFY(!RemoteProtocol::parseAddress("host:65536", host, port));
+        QVERIFY(!RemoteProtocol::parseAddress("host:http", host, port));
+        QVERIFY(!RemoteProtocol::parseAddress("[::1]4000", host, port));
+        QVERIFY(!RemoteProtocol::parseAddress("[::1", host, port));
+        QVERIFY(!RemoteProtocol::parseAddress(":4000", host, port));
+    }
+
+    void testTransmitMatchesLocalReader()
+    {
+        insertCard();
+        QByteArray local = m_farm->transmit(select());
+        QVERIFY(local.endsWith(QByteArray::fromHex("9000")));
+        QCOMPARE(m_backend->transmit(select()), local);
+
+        QJsonObject stats = m_backend->stats();
+        QCOMPARE(stats["requests"].toInt(), 1);
+        QCOMPARE(stats["failures"].toInt(), 0);
+        QCOMPARE(stats["latency"].toObject()["count"].toInt(), 1);
+    }
+
+    void testCardEventsForwarded()
+    {
+        QSignalSpy detected(m_backend, &Keycard::KeycardChannelBackend::targetDetected);
+        QSignalSpy removed(m_backend, &Keycard::KeycardChannelBackend::cardRemoved);
+
+        insertCard();
+        m_backend->startDetection();
+        QTRY_VERIFY(detected.count() >= 1);
+        QVERIFY(!detected.last().first().toString().isEmpty());
+        QVERIFY(m_backend->isConnected());
+
+        QVERIFY(m_farm->removeCard().isEmpty());
+        QTRY_COMPARE(removed.count(), 1);
+        QVERIFY(!m_backend->isConnected());
+    }
+
+    void testRttMetrics()
+    {
+        QVERIFY(m_backend->ping() >= 0);
+        QTRY_VERIFY(m_backend->stats()["rtt"].toObject()["count"].toInt() >= 3);
+        QJsonObject rtt = m_backend->stats()["rtt"].toObject();
+        QVERIFY(rtt["maxUs"].toInt() >= rtt["minUs"].toInt());
+    }
+
+    void testLinkLossAndReconnect()
+    {
+        insertCard();
+        QSignalSpy availability(m_backend, &Keycard::KeycardChannelBackend::readerAvailabilityChanged);
+
+        QMetaObject::invokeMethod(m_agent, [this]() { m_agent->close(); }, Qt::BlockingQueuedConnection);
+        QTRY_VERIFY(!m_backend->isLinkUp());
+        QTRY_VERIFY(!availability.isEmpty());
+        QCOMPARE(availability.last().first().toBool(), false);
+
+        // Fails at once instead of waiting for the timeout
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(m_backend->transmit(select()).isEmpty());
+        QVERIFY(timer.elapsed() < 1000);
+
+        QVERIFY(listen());
+        QVERIFY(m_backend->waitForConnected(2000));
+        QVERIFY(m_backend->transmit(select()).endsWith(QByteArray::fromHex("9000")));
+        QVERIFY(m_backend->stats()["connects"].toInt() >= 2);
+    }
+
+    void testSecondHostRefused()
+    {
+        RemoteReaderBackend second("127.0.0.1", m_port, fastOptions());
+        QVERIFY(!second.waitForConnected(300));
+        QVERIFY(second.transmit(select()).isEmpty());
+
+        int rejected = 0;
+        QMetaObject::invokeMethod(m_agent, [this, &rejected]() {
+            rejected = m_agent->stats()["rejected"].toInt();
+        }, Qt::BlockingQueuedConnection);
+        QVERIFY(rejected >= 1);
+    }
+
+    void testAuthToken()
+    {
+        QMetaObject::invokeMethod(m_agent, [this]() {
+            m_agent->close();
+            m_agent->setAuthToken("reader-secret");
+        }, Qt::BlockingQueuedConnection);
+        QTRY_VERIFY(!m_backend->isLinkUp());
+        m_port = 0;
+        QVERIFY(listen());
+        insertCard();
+
+        // No token, or the wrong one: dropped before hearing about the reader
+        {
+            RemoteReaderBackend noToken("127.0.0.1", m_port, fastOptions());
+            QVERIFY(!noToken.waitForConnected(300));
+        }
+        {
+            RemoteReaderBackend::Options wrongToken = fastOptions();
+            wrongToken.authToken = "guess";
+            RemoteReaderBackend wrong("127.0.0.1", m_port, wrongToken);
+            QSignalSpy detected(&wrong, &Keycard::KeycardChannelBackend::targetDetected);
+            QVERIFY(!wrong.waitForConnected(300));
+            QVERIFY(wrong.transmit(select()).isEmpty());
+            QTest::qWait(50);
+            QCOMPARE(detected.count(), 0);
+        }
+
+        int authFailures = 0;
+        QMetaObject::invokeMethod(m_agent, [this, &authFailures]() {
+            authFailures = m_agent->stats()["authFailures"].toInt();
+        }, Qt::BlockingQueuedConnection);
+        QVERIFY(authFailures >= 1);
+
+        RemoteReaderBackend::Options rightToken = fastOptions();
+        rightToken.authToken = "reader-secret";
+        RemoteReaderBackend host("127.0.0.1", m_port, rightToken);
+        QVERIFY(host.waitForConnected(2000));
+        QVERIFY(host.transmit(select()).endsWith(QByteArray::fromHex("9000")));
+    }
+
+    void testNonLoopbackNeedsToken()
+    {
+        bool openListen = true;
+        bool tokenListen = false;
+        QMetaObject::invokeMethod(m_agent, [this, &openListen, &tokenListen]() {
+            m_agent->close();
+            openListen = m_agent->listen(QHostAddress::Any, 0);
+            m_agent->setAuthToken("reader-secret");
+            tokenListen = m_agent->listen(QHostAddress::Any, 0);
+        }, Qt::BlockingQueuedConnection);
+        QVERIFY(!openListen);
+        QVERIFY(tokenListen);
+    }
+
+    // 20 SELECTs one by one
+    void benchmarkSequential()
+    {
+        insertCard();
+        QBENCHMARK {
+            for (int i = 0; i < 20; ++i) {
+                m_backend->transmit(select());
+            }
+        }
+    }
+};
+
+QTEST_MAIN(TestRemoteReader)
+#include "test_remote_reader.moc"
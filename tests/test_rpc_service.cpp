@@ -38,6 +38,9 @@ private slots:
     void testStoreMetadataMethod();
     void testExportLoginKeysMethod();
     void testExportRecoverKeysMethod();
+    void testExportKeysMethod();
+    void testListPairingsMethod();
+    void testSetPairingSlotPolicyMethod();
     
     // Integration tests
     void testFullWorkflow();
@@ -337,6 +340,62 @@ void TestRpcService::testExportRecoverKeysMethod()
     QVERIFY(resp.contains("error"));
 }
 
+void TestRpcService::testExportKeysMethod()
+{
+    // Missing key list
+    QString response = sendRequest("keycard.ExportKeys");
+    QJsonObject resp = parseResponse(response);
+    QVERIFY(resp.contains("error"));
+    QCOMPARE(resp["error"].toObject()["code"].toInt(), -32602);
+
+    // Invalid path
+    QJsonObject badKey;
+    badKey["path"] = "44'/60'/0'/0/0";
+    QJsonObject params;
+    params["keys"] = QJsonArray{badKey};
+    response = sendRequest("keycard.ExportKeys", params);
+    resp = parseResponse(response);
+    QCOMPARE(resp["error"].toObject()["code"].toInt(), -32602);
+
+    // Valid request without an authorized session
+    QJsonObject walletKey;
+    walletKey["path"] = "m/44'/60'/0'/0/0";
+    QJsonObject eipKey;
+    eipKey["path"] = "m/43'/60'/1581'";
+    eipKey["private"] = true;
+    params["keys"] = QJsonArray{walletKey, eipKey};
+    response = sendRequest("keycard.ExportKeys", params);
+    resp = parseResponse(response);
+    QVERIFY(resp.contains("error"));
+    QCOMPARE(resp["error"].toObject()["code"].toInt(), -32000);
+}
+
+void TestRpcService::testListPairingsMethod()
+{
+    // No command set / pairing storage attached to a bare service
+    QString response = sendRequest("keycard.ListPairings");
+    QJsonObject resp = parseResponse(response);
+    QVERIFY(resp.contains("error"));
+    QCOMPARE(resp["error"].toObject()["code"].toInt(), -32000);
+}
+
+void TestRpcService::testSetPairingSlotPolicyMethod()
+{
+    QJsonObject params;
+    params["autoUnpair"] = true;
+    params["reserveSlots"] = 2;
+    QString response = sendRequest("keycard.SetPairingSlotPolicy", params);
+    QJsonObject resp = parseResponse(response);
+    QVERIFY(resp.contains("result"));
+    QVERIFY(m_service->sessionManager()->pairingSlotPolicy().autoUnpair);
+    QCOMPARE(m_service->sessionManager()->pairingSlotPolicy().reserveSlots, 2);
+
+    params["reserveSlots"] = -1;
+    response = sendRequest("keycard.SetPairingSlotPolicy", params);
+    resp = parseResponse(response);
+    QCOMPARE(resp["error"].toObject()["code"].toInt(), -32602);
+}
+
 void TestRpcService::testFullWorkflow()
 {
     // Test a typical workflow sequence
@@ -1,5 +1,6 @@
 #include <QtTest/QtTest>
 #include <QTemporaryDir>
+#include <QJsonObject>
 #include "session/session_manager.h"
 #include "session/session_state.h"
 #include "mocks/mock_keycard_backend.h"
@@ -141,6 +142,53 @@ private slots:
         }
     }
 
+    void testTransitionTable()
+    {
+        // Card and reader events are accepted from any state
+        QVERIFY(isValidSessionTransition(SessionState::Authorized, SessionState::WaitingForCard));
+        QVERIFY(isValidSessionTransition(SessionState::PairingError, SessionState::ConnectingCard));
+        QVERIFY(isValidSessionTransition(SessionState::Ready, SessionState::UnknownReaderState));
+
+        QVERIFY(isValidSessionTransition(SessionState::ConnectingCard, SessionState::EmptyKeycard));
+        QVERIFY(isValidSessionTransition(SessionState::EmptyKeycard, SessionState::Ready));
+        QVERIFY(isValidSessionTransition(SessionState::Ready, SessionState::Authorized));
+        QVERIFY(isValidSessionTransition(SessionState::Authorized, SessionState::EmptyKeycard));
+
+        // Authorization needs a connected card
+        QVERIFY(!isValidSessionTransition(SessionState::WaitingForCard, SessionState::Authorized));
+        QVERIFY(!isValidSessionTransition(SessionState::ConnectingCard, SessionState::Authorized));
+        QVERIFY(!isValidSessionTransition(SessionState::ConnectionError, SessionState::Ready));
+    }
+
+    void testStateStatsRecordDwellAndTransitions()
+    {
+        m_manager->start();
+        QTest::qWait(50);
+        m_manager->stop();
+
+        SessionStats& stats = m_manager->stats();
+        SessionState started = m_stateChanges.first().first;
+        QCOMPARE(stats.transitions(SessionState::UnknownReaderState, started), quint64(1));
+        QVERIFY(stats.dwell(SessionState::UnknownReaderState).count >= 1);
+        // The time between start and stop is spread over the states visited
+        qint64 startedMs = 0;
+        for (int i = 0; i < m_stateChanges.size() - 1; ++i) {
+            startedMs += stats.dwell(m_stateChanges[i].first).totalMs;
+        }
+        QVERIFY(startedMs >= 40);
+        QCOMPARE(stats.invalidTransitions(), quint64(0));
+        QCOMPARE(m_manager->currentState(), SessionState::UnknownReaderState);
+        QVERIFY(m_manager->stateDurationMs() < 1000);
+
+        QJsonObject json = stats.toJson();
+        QVERIFY(json["transitions"].toObject().contains(
+            "unknown-reader-state->" + sessionStateToString(started)));
+        QVERIFY(json["dwell"].toObject().contains("unknown-reader-state"));
+
+        stats.reset();
+        QCOMPARE(stats.transitions(SessionState::UnknownReaderState, started), quint64(0));
+    }
+
     void testGetStatus()
     {
         SessionManager::Status status = m_manager->getStatus();
@@ -206,6 +254,39 @@ private slots:
             QVERIFY(change.first != change.second);
         }
     }
+
+    void testResetSessionKeepsSessionStarted()
+    {
+        // Not started: only clears logical state
+        QVERIFY(!m_manager->authorize("123456"));
+        QVERIFY(!m_manager->lastError().isEmpty());
+        m_manager->resetSession();
+        QVERIFY(m_manager->lastError().isEmpty());
+        QVERIFY(!m_manager->isStarted());
+
+        // Started: warm reset keeps the session running
+        m_manager->start();
+        QTest::qWait(200);
+        m_manager->resetSession();
+        QTest::qWait(200);
+
+        QVERIFY(m_manager->isStarted());
+        QVERIFY(m_manager->currentState() != SessionState::UnknownReaderState);
+        QVERIFY(m_manager->currentState() != SessionState::Authorized);
+    }
+
+    void testLazySecureChannelReachesReadyOnSelect()
+    {
+        QVERIFY(!m_manager->lazySecureChannel());
+        m_manager->setLazySecureChannel(true);
+        QVERIFY(m_manager->start());
+
+        // Detection only SELECTs; no pairing round trip before Ready
+        QTRY_COMPARE_WITH_TIMEOUT(m_manager->currentState(), SessionState::Ready, 2000);
+        SessionManager::Status status = m_manager->getStatus();
+        QVERIFY(status.keycardInfo != nullptr);
+        QVERIFY(!status.keycardInfo->instanceUID.isEmpty());
+    }
 };
 
 QTEST_MAIN(TestSessionManager)
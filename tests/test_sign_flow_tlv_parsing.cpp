@@ -1,8 +1,10 @@
 #include <QtTest/QtTest>
 #include "flow/flows/sign_flow.h"
 #include "flow/flow_params.h"
+#include "flow/signature_verifier.h"
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QCryptographicHash>
 #include <openssl/ec.h>
 #include <openssl/ecdsa.h>
 #include <openssl/obj_mac.h>
@@ -558,6 +560,126 @@ private slots:
         QCOMPARE(s.size(), 32);
         
     }
+
+    // ========================================================================
+    // Host-side Signature Verification Tests
+    // ========================================================================
+
+    // Helper: sign and find the recovery ID the way SignFlow would
+    SignatureVerifier::Item makeVerifierItem(const QByteArray& privateKey, const QByteArray& publicKey,
+                                             const QByteArray& hash)
+    {
+        SignatureVerifier::Item item;
+        item.hash = hash;
+        item.publicKey = publicKey;
+        if (!signHash(hash, privateKey, item.r, item.s)) {
+            return item;
+        }
+        for (int recoveryId = 0; recoveryId <= 1; recoveryId++) {
+            item.recoveryId = recoveryId;
+            if (SignatureVerifier::verify(item)) {
+                return item;
+            }
+        }
+        item.recoveryId = -1;
+        return item;
+    }
+
+    void testSignatureVerifierSingle()
+    {
+        QByteArray privateKey, publicKey, otherPrivateKey, otherPublicKey;
+        QVERIFY(generateTestKeyPair(privateKey, publicKey));
+        QVERIFY(generateTestKeyPair(otherPrivateKey, otherPublicKey));
+
+        QByteArray hash = QByteArray::fromHex("f281b75fc5e5615c539102d5980f2e239db8ac4fae8fc73cb4fe3725b6842d93");
+        SignatureVerifier::Item item = makeVerifierItem(privateKey, publicKey, hash);
+        QVERIFY(item.recoveryId == 0 || item.recoveryId == 1);
+        QVERIFY(SignatureVerifier::verify(item));
+
+        // Wrong expected key
+        SignatureVerifier::Item wrongKey = item;
+        wrongKey.publicKey = otherPublicKey;
+        QVERIFY(!SignatureVerifier::verify(wrongKey));
+
+        // Wrong hash
+        SignatureVerifier::Item wrongHash = item;
+        wrongHash.hash[0] = static_cast<char>(wrongHash.hash[0] ^ 0x01);
+        QVERIFY(!SignatureVerifier::verify(wrongHash));
+
+        // Malformed input
+        SignatureVerifier::Item malformed = item;
+        malformed.s = QByteArray(32, 0);
+        QVERIFY(!SignatureVerifier::verify(malformed));
+    }
+
+    void testSignatureVerifierBatchReportsPerItem()
+    {
+        QByteArray privateKey, publicKey;
+        QVERIFY(generateTestKeyPair(privateKey, publicKey));
+
+        QVector<SignatureVerifier::Item> items;
+        for (int i = 0; i < 8; i++) {
+            QByteArray hash = QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Sha256);
+            items.append(makeVerifierItem(privateKey, publicKey, hash));
+        }
+
+        QVector<bool> results = SignatureVerifier::verifyBatch(items);
+        QCOMPARE(results.size(), 8);
+        for (bool ok : results) {
+            QVERIFY(ok);
+        }
+
+        // Corrupt two signatures: bisection must single out exactly those
+        items[2].s[31] = static_cast<char>(items[2].s[31] ^ 0x01);
+        items[6].recoveryId = 1 - items[6].recoveryId;
+
+        results = SignatureVerifier::verifyBatch(items);
+        for (int i = 0; i < results.size(); i++) {
+            QCOMPARE(results[i], i != 2 && i != 6);
+        }
+
+        QVERIFY(SignatureVerifier::verifyBatch({}).isEmpty());
+    }
+
+    void testComputeRecoveryIdsMatchesVerification()
+    {
+        QByteArray privateKey, publicKey, otherPrivateKey, otherPublicKey;
+        QVERIFY(generateTestKeyPair(privateKey, publicKey));
+        QVERIFY(generateTestKeyPair(otherPrivateKey, otherPublicKey));
+
+        QVector<SignatureVerifier::Item> expected;
+        for (int i = 0; i < 8; i++) {
+            QByteArray hash = QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Sha256);
+            expected.append(makeVerifierItem(privateKey, publicKey, hash));
+        }
+
+        // Same V as the recovery ID that verifies, with no recovery done
+        QVector<SignatureVerifier::Item> items = expected;
+        items[3].publicKey = otherPublicKey;
+        items[5].publicKey.clear();
+        SignatureVerifier::computeRecoveryIds(items);
+        for (int i = 0; i < items.size(); i++) {
+            QCOMPARE(items[i].recoveryId, i == 3 || i == 5 ? -1 : expected[i].recoveryId);
+        }
+
+        QVector<SignatureVerifier::Item> none;
+        SignatureVerifier::computeRecoveryIds(none);
+        QVERIFY(none.isEmpty());
+    }
+
+    void benchmarkComputeRecoveryIds()
+    {
+        QByteArray privateKey, publicKey;
+        QVERIFY(generateTestKeyPair(privateKey, publicKey));
+        QVector<SignatureVerifier::Item> items;
+        for (int i = 0; i < 32; i++) {
+            QByteArray hash = QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Sha256);
+            items.append(makeVerifierItem(privateKey, publicKey, hash));
+        }
+        QBENCHMARK {
+            SignatureVerifier::computeRecoveryIds(items);
+        }
+    }
 };
 
 QTEST_MAIN(TestSignFlowTLVParsing)
@@ -2,6 +2,10 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include "signal_manager.h"
+#include "signal_queue.h"
+#include "signal_subscribers.h"
+#include <QSemaphore>
+#include <atomic>
 #include "session/session_manager.h"
 
 using namespace StatusKeycard;
@@ -24,22 +28,60 @@ private slots:
     void testEmitError();
     void testSignalFormat();
     void testMultipleSignals();
+    void testSignalQueueDrain();
+    void testSignalQueueOverflow();
+    void testSignalQueueResize();
+    void testSignalQueuePerContext();
+    void testSubscribersShareOneBuffer();
+    void testSubscriberFilters();
+    void testSlowSubscriberDoesNotBlockOthers();
+    void testStatusDiffsOffByDefault();
+    void testStatusDiffs();
+    void testStatusSnapshotAfterQueueDrop();
+    void testStatusStreamsPerContext();
+    void testStatusSnapshotFromCallback();
+    void testStatusCallbackPerContext();
 
 private:
+    static void fillStatus(SessionManager::Status& status, const QString& state, int wallets);
+    QJsonObject lastSignal() const;
+
     SignalManager* m_signalManager;
     QStringList m_receivedSignals;
     
     static void signalCallback(const char* signal_json);
+    static void snapshotCallback(const char* signal_json);
+    static void otherContextCallback(const char* signal_json);
     static QStringList s_receivedSignals;
+    static QStringList s_otherContextSignals;
+    static SignalManager::StatusDiffs* s_snapshotDiffs;
 };
 
 QStringList TestSignalManager::s_receivedSignals;
+QStringList TestSignalManager::s_otherContextSignals;
+SignalManager::StatusDiffs* TestSignalManager::s_snapshotDiffs = nullptr;
 
 void TestSignalManager::signalCallback(const char* signal_json)
 {
     s_receivedSignals.append(QString::fromUtf8(signal_json));
 }
 
+void TestSignalManager::otherContextCallback(const char* signal_json)
+{
+    s_otherContextSignals.append(QString::fromUtf8(signal_json));
+}
+
+// Asks for a snapshot on the first diff, as a consumer that saw a gap would
+void TestSignalManager::snapshotCallback(const char* signal_json)
+{
+    s_receivedSignals.append(QString::fromUtf8(signal_json));
+    if (s_receivedSignals.last().contains("\"status-diff\"")) {
+        SessionManager::Status status;
+        fillStatus(status, "authorized", 1);
+        SignalManager::instance()->emitStatusSnapshot(*s_snapshotDiffs, status);
+    }
+}
+
 void TestSignalManager::initTestCase()
 {
     s_receivedSignals.clear();
@@ -59,6 +101,7 @@ void TestSignalManager::init()
 
 void TestSignalManager::cleanup()
 {
+    m_signalManager->setStatusDiffs(false);
     m_signalManager->setCallback(nullptr);
     s_receivedSignals.clear();
 }
@@ -238,6 +281,384 @@ void TestSignalManager::testMultipleSignals()
     }
 }
 
+void TestSignalManager::testSignalQueueDrain()
+{
+    m_signalManager->enableQueue(16);
+    m_signalManager->emitError("first");
+    m_signalManager->emitError("second");
+
+    // Queued signals bypass the callback
+    QVERIFY(s_receivedSignals.isEmpty());
+    auto queue = m_signalManager->queue();
+    QVERIFY(queue);
+    QCOMPARE(queue->size(), 2);
+
+    // Too small for the first signal: report the size needed
+    char tiny[4];
+    int needed = queue->drain(tiny, sizeof(tiny));
+    QVERIFY(needed < -4);
+
+    QByteArray buf(-needed * 2 + 16, 0);
+    QCOMPARE(queue->drain(buf.data(), buf.size()), 2);
+    QList<QByteArray> lines = QByteArray(buf.constData()).split('\n');
+    QCOMPARE(lines.size(), 2);
+    QCOMPARE(QJsonDocument::fromJson(lines[0]).object()["event"].toObject()["error"].toString(), QString("first"));
+    QCOMPARE(QJsonDocument::fromJson(lines[1]).object()["event"].toObject()["error"].toString(), QString("second"));
+    QCOMPARE(queue->drain(buf.data(), buf.size()), 0);
+
+    m_signalManager->disableQueue();
+    m_signalManager->emitError("callback");
+    QCOMPARE(s_receivedSignals.size(), 1);
+}
+
+void TestSignalManager::testSignalQueueOverflow()
+{
+    SignalQueue queue(3);
+    for (int i = 0; i < 5; ++i) {
+        queue.push(QByteArray::number(i));
+    }
+    QCOMPARE(queue.size(), 3);
+    QCOMPARE(queue.dropped(), quint64(2));
+
+    char buf[64];
+    QCOMPARE(queue.drain(buf, sizeof(buf)), 3);
+    QCOMPARE(QByteArray(buf), QByteArray("2\n3\n4"));
+}
+
+void TestSignalManager::testSignalQueueResize()
+{
+    int fd = m_signalManager->enableQueue(4);
+    for (int i = 0; i < 4; ++i) {
+        m_signalManager->emitError(QString::number(i));
+    }
+
+    // Enabling again resizes in place: same queue and fd, newest kept
+    auto queue = m_signalManager->queue();
+    QCOMPARE(m_signalManager->enableQueue(2), fd);
+    QVERIFY(m_signalManager->queue() == queue);
+    QCOMPARE(queue->capacity(), 2);
+    QCOMPARE(queue->size(), 2);
+    QCOMPARE(queue->dropped(), quint64(2));
+
+    char buf[256];
+    QCOMPARE(queue->drain(buf, sizeof(buf)), 2);
+    QList<QByteArray> lines = QByteArray(buf).split('\n');
+    QCOMPARE(QJsonDocument::fromJson(lines[0]).object()["event"].toObject()["error"].toString(), QString("2"));
+
+    m_signalManager->disableQueue();
+}
+
+void TestSignalManager::testSignalQueuePerContext()
+{
+    auto other = std::make_shared<SignalManager::Delivery>();
+    SignalManager::enableQueue(*other, 8);
+    SignalManager::StatusDiffs diffs;
+
+    // A context's own signals stay in its queue
+    SessionManager::Status ready;
+    fillStatus(ready, "ready", 1);
+    m_signalManager->emitStatusChanged(*other, diffs, ready);
+    m_signalManager->emitChannelStateChanged(*other, "reading");
+    QCOMPARE(SignalManager::queue(*other)->size(), 2);
+    QVERIFY(s_receivedSignals.isEmpty());
+
+    // Signals not tied to a context follow the flow owner
+    m_signalManager->emitError("default");
+    QCOMPARE(s_receivedSignals.size(), 1);
+    m_signalManager->routeFlowSignals(other);
+    m_signalManager->emitError("routed");
+    QCOMPARE(SignalManager::queue(*other)->size(), 3);
+    QCOMPARE(s_receivedSignals.size(), 1);
+
+    // A context going away hands them back
+    m_signalManager->resetFlowSignals(other.get());
+    m_signalManager->emitError("default again");
+    QCOMPARE(s_receivedSignals.size(), 2);
+    QVERIFY(!m_signalManager->queue());
+}
+
+void TestSignalManager::testSubscribersShareOneBuffer()
+{
+    QMutex mutex;
+    QVector<const char*> received;
+    auto record = [&](const QByteArray& signal) {
+        QMutexLocker locker(&mutex);
+        received.append(signal.constData());
+    };
+    SignalSubscribers* subscribers = m_signalManager->subscribers();
+    int first = subscribers->subscribe(record);
+    int second = subscribers->subscribe(record);
+
+    m_signalManager->emitError("shared");
+
+    QTRY_COMPARE(received.size(), 2);
+    QCOMPARE(received[0], received[1]);
+    // The callback still gets its copy
+    QCOMPARE(s_receivedSignals.size(), 1);
+
+    QVERIFY(subscribers->unsubscribe(first));
+    QVERIFY(subscribers->unsubscribe(second));
+    QVERIFY(!subscribers->unsubscribe(second));
+}
+
+void TestSignalManager::testSubscriberFilters()
+{
+    QMutex mutex;
+    QStringList errors;
+    QStringList flows;
+    SignalSubscribers* subscribers = m_signalManager->subscribers();
+    int errorId = subscribers->subscribe([&](const QByteArray& signal) {
+        QMutexLocker locker(&mutex);
+        errors.append(QJsonDocument::fromJson(signal).object()["type"].toString());
+    }, {"error"});
+    int flowId = subscribers->subscribe([&](const QByteArray& signal) {
+        QMutexLocker locker(&mutex);
+        flows.append(QJsonDocument::fromJson(signal).object()["type"].toString());
+    }, {"keycard.flow-*"});
+
+    m_signalManager->emitError("filtered");
+    m_signalManager->emitSignal(R"({"event":{},"type":"keycard.flow-result"})");
+    m_signalManager->emitChannelStateChanged("idle");
+
+    QTRY_COMPARE(flows.size(), 1);
+    QTRY_COMPARE(errors.size(), 1);
+    QCOMPARE(errors[0], QString("error"));
+    QCOMPARE(flows[0], QString("keycard.flow-result"));
+
+    subscribers->unsubscribe(errorId);
+    subscribers->unsubscribe(flowId);
+}
+
+void TestSignalManager::testSlowSubscriberDoesNotBlockOthers()
+{
+    QSemaphore release;
+    QSemaphore entered;
+    std::atomic<int> fastCount{0};
+    SignalSubscribers subscribers;
+    int slowId = subscribers.subscribe([&](const QByteArray&) {
+        entered.release();
+        release.acquire();
+    }, {}, 2);
+    subscribers.subscribe([&](const QByteArray&) { ++fastCount; });
+
+    subscribers.publish("first", "error");
+    QVERIFY(entered.tryAcquire(1, 5000));
+
+    // The slow subscriber is stuck in its callback; the other one keeps up
+    for (int i = 0; i < 10; ++i) {
+        subscribers.publish(QByteArray::number(i), "error");
+    }
+    QTRY_COMPARE(fastCount.load(), 11);
+
+    auto stats = subscribers.stats();
+    QCOMPARE(stats.size(), 2);
+    QCOMPARE(stats[0].id, slowId);
+    QCOMPARE(stats[0].pending, 2);
+    QCOMPARE(stats[0].dropped, quint64(8));
+    QCOMPARE(stats[1].delivered, quint64(11));
+    QCOMPARE(stats[1].dropped, quint64(0));
+
+    // Removing waits for the callback in progress
+    release.release(3);
+    QVERIFY(subscribers.unsubscribe(slowId));
+    QCOMPARE(subscribers.stats().size(), 1);
+}
+
+void TestSignalManager::fillStatus(SessionManager::Status& status, const QString& state, int wallets)
+{
+    status.state = state;
+    status.metadata = new SessionManager::Metadata();
+    status.metadata->name = "card";
+    for (int i = 0; i < wallets; ++i) {
+        status.metadata->wallets.append({QString("m/44'/60'/0'/0/%1").arg(i),
+                                         QString("0x%1").arg(i, 40, 16, QChar('0')),
+                                         QString("0x04%1").arg(i, 128, 16, QChar('0'))});
+    }
+}
+
+QJsonObject TestSignalManager::lastSignal() const
+{
+    return QJsonDocument::fromJson(s_receivedSignals.last().toUtf8()).object();
+}
+
+void TestSignalManager::testStatusDiffsOffByDefault()
+{
+    QVERIFY(!m_signalManager->statusDiffs());
+    SessionManager::Status status;
+    fillStatus(status, "ready", 2);
+    m_signalManager->emitStatusChanged(status);
+    m_signalManager->emitStatusChanged(status);
+
+    // Legacy consumers keep the full, unversioned format, repeats included
+    QCOMPARE(s_receivedSignals.size(), 2);
+    QCOMPARE(lastSignal()["type"].toString(), QString("status-changed"));
+    QVERIFY(!lastSignal()["event"].toObject().contains("version"));
+}
+
+void TestSignalManager::testStatusDiffs()
+{
+    m_signalManager->setStatusDiffs(true);
+
+    SessionManager::Status ready;
+    fillStatus(ready, "ready", 50);
+    m_signalManager->emitStatusChanged(ready);
+    QCOMPARE(lastSignal()["type"].toString(), QString("status-changed"));
+    QJsonObject snapshot = lastSignal()["event"].toObject();
+    QCOMPARE(snapshot["metadata"].toObject()["wallets"].toArray().size(), 50);
+    qint64 version = snapshot["version"].toInteger();
+    QVERIFY(version > 0);
+    int fullSize = s_receivedSignals.last().size();
+
+    // Only the state moved: the wallets are not sent again
+    SessionManager::Status authorized;
+    fillStatus(authorized, "authorized", 50);
+    m_signalManager->emitStatusChanged(authorized);
+    QCOMPARE(lastSignal()["type"].toString(), QString("status-diff"));
+    QJsonObject diff = lastSignal()["event"].toObject();
+    QCOMPARE(diff["baseVersion"].toInteger(), version);
+    QCOMPARE(diff["version"].toInteger(), version + 1);
+    QCOMPARE(diff["changed"].toObject().keys(), QStringList{"state"});
+    QCOMPARE(diff["changed"].toObject()["state"].toString(), QString("authorized"));
+    QVERIFY(s_receivedSignals.last().size() * 20 < fullSize);
+
+    // Nothing changed: nothing sent
+    m_signalManager->emitStatusChanged(authorized);
+    QCOMPARE(s_receivedSignals.size(), 2);
+
+    // A changed field is replaced as a whole, null included
+    SessionManager::Status removed;
+    removed.state = "waiting-for-card";
+    m_signalManager->emitStatusChanged(removed);
+    diff = lastSignal()["event"].toObject();
+    QCOMPARE(diff["baseVersion"].toInteger(), version + 1);
+    QJsonObject changed = diff["changed"].toObject();
+    QCOMPARE(changed.keys(), (QStringList{"metadata", "state"}));
+    QVERIFY(changed["metadata"].isNull());
+
+    // On request, e.g. after a version gap
+    m_signalManager->emitStatusSnapshot(removed);
+    QCOMPARE(s_receivedSignals.size(), 4);
+    QCOMPARE(lastSignal()["type"].toString(), QString("status-changed"));
+    QCOMPARE(lastSignal()["event"].toObject()["version"].toInteger(), version + 3);
+    QCOMPARE(lastSignal()["event"].toObject()["state"].toString(), QString("waiting-for-card"));
+
+    // Turning diffs back on starts again from a snapshot
+    m_signalManager->setStatusDiffs(true);
+    m_signalManager->emitStatusChanged(ready);
+    QCOMPARE(lastSignal()["type"].toString(), QString("status-changed"));
+}
+
+void TestSignalManager::testStatusSnapshotAfterQueueDrop()
+{
+    m_signalManager->setStatusDiffs(true);
+    m_signalManager->enableQueue(2);
+    auto queue = m_signalManager->queue();
+    QByteArray buf(64 * 1024, 0);
+
+    SessionManager::Status ready;
+    fillStatus(ready, "ready", 1);
+    m_signalManager->emitStatusChanged(ready);
+    SessionManager::Status authorized;
+    fillStatus(authorized, "authorized", 1);
+    m_signalManager->emitStatusChanged(authorized);
+    QCOMPARE(queue->drain(buf.data(), buf.size()), 2);
+
+    // The consumer falls behind and the next diff is lost
+    SessionManager::Status busy;
+    fillStatus(busy, "busy", 1);
+    m_signalManager->emitStatusChanged(busy);
+    m_signalManager->emitError("first");
+    m_signalManager->emitError("second");
+    QCOMPARE(queue->dropped(), quint64(1));
+
+    m_signalManager->emitStatusChanged(authorized);
+    QCOMPARE(queue->drain(buf.data(), buf.size()), 2);
+    QList<QByteArray> lines = QByteArray(buf.constData()).split('\n');
+    QJsonObject signal = QJsonDocument::fromJson(lines.last()).object();
+    QCOMPARE(signal["type"].toString(), QString("status-changed"));
+    QCOMPARE(signal["event"].toObject()["state"].toString(), QString("authorized"));
+    QCOMPARE(signal["event"].toObject()["metadata"].toObject()["wallets"].toArray().size(), 1);
+
+    m_signalManager->disableQueue();
+}
+
+void TestSignalManager::testStatusStreamsPerContext()
+{
+    SignalManager::StatusDiffs first;
+    SignalManager::StatusDiffs second;
+    SignalManager::setStatusDiffs(first, true);
+
+    SessionManager::Status ready;
+    fillStatus(ready, "ready", 1);
+    m_signalManager->emitStatusChanged(first, ready);
+    m_signalManager->emitStatusChanged(first, ready);
+    QCOMPARE(s_receivedSignals.size(), 1);
+    QCOMPARE(lastSignal()["event"].toObject()["version"].toInteger(), qint64(1));
+
+    // Another context keeps its own format and versions
+    m_signalManager->emitStatusChanged(second, ready);
+    QCOMPARE(s_receivedSignals.size(), 2);
+    QVERIFY(!lastSignal()["event"].toObject().contains("version"));
+    SignalManager::setStatusDiffs(second, true);
+    m_signalManager->emitStatusChanged(second, ready);
+    QCOMPARE(lastSignal()["event"].toObject()["version"].toInteger(), qint64(1));
+    QVERIFY(!m_signalManager->statusDiffs());
+}
+
+void TestSignalManager::testStatusSnapshotFromCallback()
+{
+    SignalManager::StatusDiffs diffs;
+    SignalManager::setStatusDiffs(diffs, true);
+    s_snapshotDiffs = &diffs;
+    m_signalManager->setCallback(snapshotCallback);
+
+    SessionManager::Status ready;
+    fillStatus(ready, "ready", 1);
+    m_signalManager->emitStatusChanged(diffs, ready);
+    SessionManager::Status authorized;
+    fillStatus(authorized, "authorized", 1);
+    m_signalManager->emitStatusChanged(diffs, authorized);
+
+    // The diff was sent with no lock held, so the snapshot went out right away
+    QCOMPARE(s_receivedSignals.size(), 3);
+    QCOMPARE(lastSignal()["type"].toString(), QString("status-changed"));
+    QCOMPARE(lastSignal()["event"].toObject()["version"].toInteger(), qint64(3));
+    s_snapshotDiffs = nullptr;
+}
+
+void TestSignalManager::testStatusCallbackPerContext()
+{
+    s_otherContextSignals.clear();
+    SignalManager::Delivery other;
+    SignalManager::setCallback(other, otherContextCallback);
+    SignalManager::StatusDiffs defaultDiffs;
+    SignalManager::StatusDiffs otherDiffs;
+    SignalManager::setStatusDiffs(defaultDiffs, true);
+    SignalManager::setStatusDiffs(otherDiffs, true);
+
+    // Each context's versioned stream reaches only its own callback
+    SessionManager::Status ready;
+    fillStatus(ready, "ready", 1);
+    SessionManager::Status authorized;
+    fillStatus(authorized, "authorized", 1);
+    m_signalManager->emitStatusChanged(defaultDiffs, ready);
+    m_signalManager->emitStatusChanged(other, otherDiffs, ready);
+    m_signalManager->emitStatusChanged(other, otherDiffs, authorized);
+
+    QCOMPARE(s_receivedSignals.size(), 1);
+    QCOMPARE(s_otherContextSignals.size(), 2);
+    QJsonObject diff = QJsonDocument::fromJson(s_otherContextSignals[1].toUtf8()).object();
+    QCOMPARE(diff["type"].toString(), QString("status-diff"));
+    QCOMPARE(diff["event"].toObject()["baseVersion"].toInteger(), qint64(1));
+
+    // Clearing one context's callback leaves the other alone
+    SignalManager::setCallback(other, nullptr);
+    m_signalManager->emitStatusSnapshot(other, otherDiffs, ready);
+    m_signalManager->emitStatusSnapshot(defaultDiffs, ready);
+    QCOMPARE(s_otherContextSignals.size(), 2);
+    QCOMPARE(s_receivedSignals.size(), 2);
+}
+
 QTEST_MAIN(TestSignalManager)
 #include "test_signal_manager.moc"
 
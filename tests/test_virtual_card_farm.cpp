@@ -0,0 +1,502 @@
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include "mocked/virtual_card_farm.h"
+#include "mocked/virtual_card_crypto.h"
+#include "card_decoder.h"
+#include "storage/file_pairing_storage.h"
+#include <keycard-qt/keycard_channel.h>
+#include <keycard-qt/command_set.h>
+#include <keycard-qt/types.h>
+#include <openssl/evp.h>
+#include <memory>
+
+using namespace StatusKeycard;
+
+class TestVirtualCardFarm : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testInsertRequiresReader();
+    void testInsertEmitsTargetDetected();
+    void testSelectReflectsCardState();
+    void testNotStatusKeycard();
+    void testPairingSlotsExhaust();
+    void testSwapAndUnplugCountEvents();
+    void testSecureChannelRequired();
+    void testSecureChannelSession();
+    void testPinRetries();
+    void testTamperedApduClosesChannel();
+    void testCommandSetSession();
+    void testCommandSetKeyManagement();
+
+private:
+    static QByteArray select(VirtualCardFarm& farm);
+    static std::shared_ptr<Keycard::CommandSet> commandSet(VirtualCardFarm* farm, const QTemporaryDir& dir,
+                                                           const QString& pairingPassword);
+};
+
+namespace {
+
+const QByteArray SW_OK = QByteArray::fromHex("9000");
+
+QByteArray pairingToken(const QString& password)
+{
+    const QByteArray salt = "Keycard Pairing Password Salt";
+    const QByteArray passwordBytes = password.toUtf8();
+    QByteArray token(32, 0);
+    PKCS5_PBKDF2_HMAC(passwordBytes.constData(), passwordBytes.size(),
+                      reinterpret_cast<const unsigned char*>(salt.constData()), salt.size(),
+                      50000, EVP_sha256(), token.size(), reinterpret_cast<unsigned char*>(token.data()));
+    return token;
+}
+
+QByteArray sha256(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+}
+
+/**
+ * Host side of the secure channel, as CommandSet drives it: PAIR, OPEN
+ * SECURE CHANNEL, MUTUALLY AUTHENTICATE, then wrapped commands.
+ */
+class HostSession
+{
+public:
+    explicit HostSession(VirtualCardFarm& farm) : m_farm(farm) {}
+
+    // Both PAIR steps; the card must prove it knows the secret first
+    bool pair(const QByteArray& secret)
+    {
+        QByteArray challenge(32, 0x5A);
+        QByteArray response = m_farm.transmit(QByteArray::fromHex("8012000020") + challenge);
+        if (!response.endsWith(SW_OK) || response.size() != 64 + 2
+            || response.left(32) != sha256(secret + challenge)) {
+            return false;
+        }
+        QByteArray cryptogram = sha256(secret + response.mid(32, 32));
+        response = m_farm.transmit(QByteArray::fromHex("8012010020") + cryptogram);
+        if (!response.endsWith(SW_OK) || response.size() != 33 + 2) {
+            return false;
+        }
+        m_pairingIndex = static_cast<quint8>(response[0]);
+        m_pairingKey = sha256(secret + response.mid(1, 32));
+        return true;
+    }
+
+    bool open()
+    {
+        QByteArray select = m_farm.transmit(QByteArray::fromHex("00A4040000"));
+        QByteArray cardKey = CardDecoder::findTlvTag(CardDecoder::findTlvTag(select.chopped(2), 0xA4), 0x80);
+
+        VirtualCardCrypto::KeyPair hostKey = VirtualCardCrypto::generateKeyPair();
+        QByteArray apdu = QByteArray::fromHex("8010") + char(m_pairingIndex) + QByteArray::fromHex("0041")
+                        + hostKey.publicKey;
+        QByteArray response = m_farm.transmit(apdu);
+        if (!response.endsWith(SW_OK) || response.size() != 48 + 2) {
+            return false;
+        }
+        QByteArray keys = QCryptographicHash::hash(VirtualCardCrypto::ecdh(hostKey.privateKey, cardKey)
+                                                   + m_pairingKey + response.left(32),
+                                                   QCryptographicHash::Sha512);
+        m_encKey = keys.left(32);
+        m_macKey = keys.mid(32);
+        m_iv = response.mid(32, 16);
+        return send(0x11, 0x00, 0x00, QByteArray(32, 0x33)).endsWith(SW_OK);
+    }
+
+    // Wrapped command; returns the card's inner response, SW included
+    QByteArray send(quint8 ins, quint8 p1, quint8 p2, const QByteArray& data)
+    {
+        QByteArray encrypted = VirtualCardCrypto::encrypt(m_encKey, m_iv, data);
+        QByteArray header = QByteArray::fromHex("80") + char(ins) + char(p1) + char(p2)
+                          + char(16 + encrypted.size());
+        QByteArray meta = header + QByteArray(11, 0);
+        QByteArray mac = VirtualCardCrypto::mac(m_macKey, meta, encrypted);
+        m_iv = mac;
+        m_lastApdu = header + mac + encrypted;
+
+        QByteArray response = m_farm.transmit(m_lastApdu);
+        if (!response.endsWith(SW_OK) || response.size() < 16 + 16 + 2) {
+            return response;
+        }
+        QByteArray responseMac = response.left(16);
+        QByteArray payload = response.mid(16, response.size() - 18);
+        QByteArray responseMeta = QByteArray(1, char(16 + payload.size())) + QByteArray(15, 0);
+        QByteArray plain;
+        if (VirtualCardCrypto::mac(m_macKey, responseMeta, payload) != responseMac
+            || !VirtualCardCrypto::decrypt(m_encKey, m_iv, payload, plain)) {
+            return QByteArray();
+        }
+        m_iv = responseMac;
+        return plain;
+    }
+
+    QByteArray lastApdu() const { return m_lastApdu; }
+
+private:
+    VirtualCardFarm& m_farm;
+    quint8 m_pairingIndex = 0;
+    QByteArray m_pairingKey;
+    QByteArray m_encKey;
+    QByteArray m_macKey;
+    QByteArray m_iv;
+    QByteArray m_lastApdu;
+};
+
+QByteArray pathData(const QVector<quint32>& path)
+{
+    QByteArray data;
+    for (quint32 component : path) {
+        char bytes[4];
+        qToBigEndian(component, bytes);
+        data.append(bytes, 4);
+    }
+    return data;
+}
+
+} // namespace
+
+QByteArray TestVirtualCardFarm::select(VirtualCardFarm& farm)
+{
+    return farm.transmit(QByteArray::fromHex("00A4040000"));
+}
+
+// CommandSet over the farm, as the library's own session would drive it
+std::shared_ptr<Keycard::CommandSet> TestVirtualCardFarm::commandSet(VirtualCardFarm* farm, const QTemporaryDir& dir,
+                                                                     const QString& pairingPassword)
+{
+    auto storage = std::make_shared<FilePairingStorage>();
+    storage->setPath(dir.filePath("pairings.json"));
+    auto channel = std::make_shared<Keycard::KeycardChannel>(farm);
+    return std::make_shared<Keycard::CommandSet>(channel, storage, [pairingPassword](const QString&) {
+        return pairingPassword;
+    });
+}
+
+void TestVirtualCardFarm::testInsertRequiresReader()
+{
+    VirtualCardFarm farm;
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::NoReader,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    QVERIFY(!farm.insertCard(0).isEmpty());
+    QVERIFY(farm.plugReader().isEmpty());
+    QVERIFY(!farm.insertCard(7).isEmpty());  // Not registered
+    QVERIFY(farm.insertCard(0).isEmpty());
+    QVERIFY(farm.isConnected());
+}
+
+void TestVirtualCardFarm::testInsertEmitsTargetDetected()
+{
+    VirtualCardFarm farm;
+    QSignalSpy detected(&farm, &Keycard::KeycardChannelBackend::targetDetected);
+    QSignalSpy removed(&farm, &Keycard::KeycardChannelBackend::cardRemoved);
+
+    QJsonObject card;
+    card["instanceUid"] = "0x00112233445566778899aabbccddeeff";
+    farm.startDetection();
+    QVERIFY(farm.registerCard(3, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicOnly, card).isEmpty());
+
+    QVERIFY(detected.wait(1000));
+    QCOMPARE(detected.first().first().toString(), QString("00112233445566778899aabbccddeeff"));
+
+    QVERIFY(farm.removeCard().isEmpty());
+    QVERIFY(removed.wait(1000));
+    QVERIFY(!farm.isConnected());
+}
+
+void TestVirtualCardFarm::testSelectReflectsCardState()
+{
+    VirtualCardFarm farm;
+    QJsonObject card;
+    card["freePairingSlots"] = 4;
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicOnly, card).isEmpty());
+
+    QByteArray response = select(farm);
+    QVERIFY(response.endsWith(QByteArray::fromHex("9000")));
+    QCOMPARE(static_cast<quint8>(response[0]), quint8(0xA4));
+    QVERIFY(response.contains(QByteArray::fromHex("020104")));  // Free slots TLV
+    QVERIFY(response.contains(char(0x8E)));                      // Key UID present
+
+    // Empty keycard: pre-initialized response with only the public key
+    QVERIFY(farm.registerCard(1, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::EmptyKeycard, QJsonObject()).isEmpty());
+    response = select(farm);
+    QCOMPARE(static_cast<quint8>(response[0]), quint8(0x80));
+    QCOMPARE(response.size(), 2 + 65 + 2);
+}
+
+void TestVirtualCardFarm::testNotStatusKeycard()
+{
+    VirtualCardFarm farm;
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::NotStatusKeycard, QJsonObject()).isEmpty());
+    QCOMPARE(select(farm), QByteArray::fromHex("6A82"));
+}
+
+void TestVirtualCardFarm::testPairingSlotsExhaust()
+{
+    VirtualCardFarm farm;
+    QJsonObject card;
+    card["freePairingSlots"] = 1;
+    card["pairingPassword"] = "farm-test";
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicOnly, card).isEmpty());
+
+    // Step 2 without a challenge, and a wrong password, are refused
+    QByteArray step2 = QByteArray::fromHex("8012010020") + QByteArray(32, 0x01);
+    QCOMPARE(farm.transmit(step2), QByteArray::fromHex("6985"));
+    HostSession wrong(farm);
+    QVERIFY(!wrong.pair(pairingToken("other")));
+
+    HostSession host(farm);
+    QVERIFY(host.pair(pairingToken("farm-test")));
+    QVERIFY(select(farm).contains(QByteArray::fromHex("020100")));
+    QCOMPARE(farm.transmit(QByteArray::fromHex("8012000020") + QByteArray(32, 0x01)), QByteArray::fromHex("6A84"));
+}
+
+void TestVirtualCardFarm::testSwapAndUnplugCountEvents()
+{
+    VirtualCardFarm farm;
+    QVERIFY(farm.plugReader().isEmpty());
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(farm.registerCard(i, VirtualCardFarm::ReaderState::NoKeycard,
+                                  VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    }
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(farm.insertCard(i).isEmpty());
+    }
+    QVERIFY(farm.unplugReader().isEmpty());
+
+    QJsonObject stats = farm.stats();
+    QCOMPARE(stats["registered"].toInt(), 100);
+    QCOMPARE(stats["insertions"].toInt(), 100);
+    QCOMPARE(stats["removals"].toInt(), 100);  // 99 swaps + unplug
+    QCOMPARE(stats["insertedCard"].toInt(), -1);
+    QVERIFY(!stats["readerPlugged"].toBool());
+}
+
+void TestVirtualCardFarm::testSecureChannelRequired()
+{
+    VirtualCardFarm farm;
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    select(farm);
+
+    // Plaintext GET STATUS, VERIFY PIN and SIGN are refused; GET DATA is public
+    QCOMPARE(farm.transmit(QByteArray::fromHex("80F2000000")), QByteArray::fromHex("6985"));
+    QCOMPARE(farm.transmit(QByteArray::fromHex("8020000006") + QByteArray("000000")), QByteArray::fromHex("6985"));
+    QCOMPARE(farm.transmit(QByteArray::fromHex("80C0000020") + QByteArray(32, 1)), QByteArray::fromHex("6985"));
+    QCOMPARE(farm.transmit(QByteArray::fromHex("80CA000000")), SW_OK);
+
+    // Unknown pairing index, and a public key that is not on the curve
+    QByteArray badIndex = QByteArray::fromHex("8010030041") + VirtualCardCrypto::generateKeyPair().publicKey;
+    QCOMPARE(farm.transmit(badIndex), QByteArray::fromHex("6A86"));
+    HostSession host(farm);
+    QVERIFY(host.pair(pairingToken("KeycardDefaultPairing")));
+    QByteArray offCurve = QByteArray::fromHex("8010000041") + char(0x04) + QByteArray(64, 0x07);
+    QCOMPARE(farm.transmit(offCurve), QByteArray::fromHex("6A80"));
+
+    // Key management needs the PIN; what is not emulated is refused outright
+    QVERIFY(host.open());
+    QCOMPARE(host.send(0xD4, 0x00, 0x00, QByteArray(16, 1)), QByteArray::fromHex("6985"));
+    QCOMPARE(host.send(0xD5, 0x00, 0x00, QByteArray(16, 1)), QByteArray::fromHex("6D00"));
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "000000"), SW_OK);
+    QCOMPARE(host.send(0xD0, 0x01, 0x00, QByteArray(16, 1)), QByteArray::fromHex("6A86"));
+    QCOMPARE(host.send(0xC0, 0x03, 0x00, QByteArray(32, 1)), QByteArray::fromHex("6A86"));
+}
+
+void TestVirtualCardFarm::testSecureChannelSession()
+{
+    VirtualCardFarm farm;
+    QJsonObject metadata;
+    metadata["name"] = "farm";
+    metadata["wallets"] = QJsonArray {
+        QJsonObject {{"path", "m/44'/60'/0'/0/0"}}, QJsonObject {{"path", "m/44'/60'/0'/0/1"}},
+        QJsonObject {{"path", "m/44'/60'/0'/0/5"}}};
+    QJsonObject card;
+    card["metadata"] = metadata;
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicAndMetadata, card).isEmpty());
+
+    HostSession host(farm);
+    QVERIFY(host.pair(pairingToken("KeycardDefaultPairing")));
+    QVERIFY(host.open());
+
+    // GET STATUS: PIN and PUK retries, key initialized
+    QCOMPARE(host.send(0xF2, 0x00, 0x00, QByteArray()), QByteArray::fromHex("A3090201030201050101FF9000"));
+
+    // Metadata is the binary blob GetMetadataFlow decodes
+    QByteArray blob = host.send(0xCA, 0x00, 0x00, QByteArray());
+    QVERIFY(blob.endsWith(SW_OK));
+    DecodedMetadata decoded;
+    QCOMPARE(CardDecoder::decodeMetadata(blob.chopped(2), decoded), DecodeError::None);
+    QCOMPARE(decoded.name, QString("farm"));
+    QCOMPARE(decoded.walletIndexes(), QVector<quint32>({0, 1, 5}));
+
+    // Keys need the PIN
+    const QVector<quint32> walletPath {0x8000002C, 0x8000003C, 0x80000000, 0, 0};
+    QCOMPARE(host.send(0xC2, 0x01, 0x01, pathData(walletPath)), QByteArray::fromHex("6985"));
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "000000"), SW_OK);
+
+    QByteArray exported = host.send(0xC2, 0x01, 0x02, pathData(walletPath));
+    QVERIFY(exported.endsWith(SW_OK));
+    QByteArray keyTemplate = CardDecoder::findTlvTag(exported.chopped(2), 0xA1);
+    QByteArray publicKey = CardDecoder::findTlvTag(keyTemplate, 0x80);
+    QCOMPARE(publicKey.size(), 65);
+    QCOMPARE(CardDecoder::findTlvTag(keyTemplate, 0x82).size(), 32);
+    QVERIFY(CardDecoder::findTlvTag(keyTemplate, 0x81).isEmpty());
+
+    // Private keys only under the EIP-1581 root
+    QCOMPARE(host.send(0xC2, 0x01, 0x00, pathData(walletPath)), QByteArray::fromHex("6985"));
+    QByteArray eip1581 = host.send(0xC2, 0x01, 0x00, pathData({0x8000002B, 0x8000003C, 0x8000062D, 0x80000000}));
+    QCOMPARE(CardDecoder::findTlvTag(CardDecoder::findTlvTag(eip1581.chopped(2), 0xA1), 0x81).size(), 32);
+
+    // SIGN with the same key: template holds the key and a DER signature
+    QByteArray hash(32, 0x42);
+    QByteArray signature = host.send(0xC0, 0x01, 0x00, hash + pathData(walletPath));
+    QVERIFY(signature.endsWith(SW_OK));
+    QByteArray signatureTemplate = CardDecoder::findTlvTag(signature.chopped(2), 0xA0);
+    QCOMPARE(CardDecoder::findTlvTag(signatureTemplate, 0x80), publicKey);
+    QByteArray r, s;
+    QCOMPARE(CardDecoder::decodeDerSignature(CardDecoder::findTlvTag(signatureTemplate, 0x30), r, s),
+             DecodeError::None);
+
+    // Derive and make current, then read the path back
+    QVERIFY(host.send(0xC2, 0x02, 0x01, pathData(walletPath)).endsWith(SW_OK));
+    QCOMPARE(host.send(0xF2, 0x01, 0x00, QByteArray()), pathData(walletPath) + SW_OK);
+
+    // A new SELECT ends the session
+    select(farm);
+    QCOMPARE(farm.transmit(host.lastApdu()), QByteArray::fromHex("6985"));
+}
+
+void TestVirtualCardFarm::testPinRetries()
+{
+    VirtualCardFarm farm;
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    HostSession host(farm);
+    QVERIFY(host.pair(pairingToken("KeycardDefaultPairing")));
+    QVERIFY(host.open());
+
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "111111"), QByteArray::fromHex("63C2"));
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "000000"), SW_OK);  // Restores the count
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "111111"), QByteArray::fromHex("63C2"));
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "111111"), QByteArray::fromHex("63C1"));
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "111111"), QByteArray::fromHex("63C0"));
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "000000"), QByteArray::fromHex("63C0"));  // Blocked
+    QCOMPARE(host.send(0xF2, 0x00, 0x00, QByteArray()), QByteArray::fromHex("A3090201000201050101FF9000"));
+
+    // The retry count survives a new session
+    QVERIFY(host.open());
+    QCOMPARE(host.send(0x22, 0x00, 0x00, "999999999999" "123456"), QByteArray::fromHex("63C4"));
+    QCOMPARE(host.send(0x22, 0x00, 0x00, "000000000000" "123456"), SW_OK);
+    QCOMPARE(host.send(0x20, 0x00, 0x00, "123456"), SW_OK);
+    QCOMPARE(host.send(0xF2, 0x00, 0x00, QByteArray()), QByteArray::fromHex("A3090201030201050101FF9000"));
+}
+
+void TestVirtualCardFarm::testTamperedApduClosesChannel()
+{
+    VirtualCardFarm farm;
+    QVERIFY(farm.registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                              VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    HostSession host(farm);
+    QVERIFY(host.pair(pairingToken("KeycardDefaultPairing")));
+    QVERIFY(host.open());
+    QVERIFY(host.send(0xF2, 0x00, 0x00, QByteArray()).endsWith(SW_OK));
+
+    // A replayed APDU has a stale IV and fails the MAC; the channel closes
+    QCOMPARE(farm.transmit(host.lastApdu()), QByteArray::fromHex("6982"));
+    QCOMPARE(host.send(0xF2, 0x00, 0x00, QByteArray()), QByteArray::fromHex("6985"));
+
+    QVERIFY(host.open());
+    QVERIFY(host.send(0xF2, 0x00, 0x00, QByteArray()).endsWith(SW_OK));
+}
+
+void TestVirtualCardFarm::testCommandSetSession()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto* farm = new VirtualCardFarm();  // Owned by the channel
+    QVERIFY(farm->registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                               VirtualCardFarm::CardState::KeycardWithMnemonicOnly, QJsonObject()).isEmpty());
+    auto cmdSet = commandSet(farm, dir, "KeycardDefaultPairing");
+
+    Keycard::ApplicationInfo info = cmdSet->select();
+    QVERIFY(info.initialized);
+    QCOMPARE(info.keyUID.size(), 32);
+    QVERIFY2(cmdSet->ensurePairing(), qPrintable(cmdSet->lastError()));
+    QVERIFY2(cmdSet->ensureSecureChannel(), qPrintable(cmdSet->lastError()));
+    QVERIFY(!cmdSet->verifyPIN("111111"));
+    QVERIFY2(cmdSet->verifyPIN("000000"), qPrintable(cmdSet->lastError()));
+
+    const QString walletPath = "m/44'/60'/0'/0/0";
+    QByteArray exported = cmdSet->exportKey(true, false, walletPath, Keycard::APDU::P2ExportKeyPublicOnly);
+    QByteArray publicKey = CardDecoder::findTlvTag(CardDecoder::findTlvTag(exported, 0xA1), 0x80);
+    QCOMPARE(publicKey.size(), 65);
+
+    // Signed by the exported key
+    QByteArray signature = cmdSet->signWithPathFullResponse(QByteArray(32, 0x42), walletPath);
+    QByteArray signatureTemplate = CardDecoder::findTlvTag(signature, 0xA0);
+    QCOMPARE(CardDecoder::findTlvTag(signatureTemplate, 0x80), publicKey);
+    QByteArray r, s;
+    QCOMPARE(CardDecoder::decodeDerSignature(CardDecoder::findTlvTag(signatureTemplate, 0x30), r, s),
+             DecodeError::None);
+
+    // Each command went through the secure channel the card opened
+    QJsonObject commands = farm->stats()["commands"].toObject();
+    QCOMPARE(commands["11"].toInt(), 1);  // MUTUALLY AUTHENTICATE
+    QCOMPARE(commands["c2"].toInt(), 1);
+    QCOMPARE(commands["c0"].toInt(), 1);
+}
+
+void TestVirtualCardFarm::testCommandSetKeyManagement()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto* farm = new VirtualCardFarm();  // Owned by the channel
+    QVERIFY(farm->registerCard(0, VirtualCardFarm::ReaderState::KeycardInserted,
+                               VirtualCardFarm::CardState::EmptyKeycard, QJsonObject()).isEmpty());
+    auto cmdSet = commandSet(farm, dir, "farm-init");
+
+    QVERIFY(!cmdSet->select().initialized);
+    QVERIFY2(cmdSet->init(Keycard::Secrets("123456", "123456789012", "farm-init")),
+             qPrintable(cmdSet->lastError()));
+
+    // Initialized without a key; the new secrets pair and unlock it
+    Keycard::ApplicationInfo info = cmdSet->select();
+    QVERIFY(info.initialized);
+    QVERIFY(info.keyUID.isEmpty());
+    QVERIFY2(cmdSet->ensurePairing(), qPrintable(cmdSet->lastError()));
+    QVERIFY2(cmdSet->ensureSecureChannel(), qPrintable(cmdSet->lastError()));
+    QVERIFY2(cmdSet->verifyPIN("123456"), qPrintable(cmdSet->lastError()));
+
+    QVector<int> indexes = cmdSet->generateMnemonic(4);
+    QCOMPARE(indexes.size(), 12);
+    for (int index : indexes) {
+        QVERIFY(index >= 0 && index < 2048);
+    }
+
+    // LOAD KEY answers the key UID of the seed's master key
+    const QByteArray seed = QCryptographicHash::hash("farm-seed", QCryptographicHash::Sha512);
+    const VirtualCardCrypto::ExtendedKey master = VirtualCardCrypto::masterKey(seed);
+    const QByteArray masterPublicKey = VirtualCardCrypto::publicKey(master.privateKey);
+    QCOMPARE(cmdSet->loadSeed(seed), sha256(masterPublicKey));
+
+    QByteArray exported = cmdSet->exportKey(true, false, "m", Keycard::APDU::P2ExportKeyPublicOnly);
+    QCOMPARE(CardDecoder::findTlvTag(CardDecoder::findTlvTag(exported, 0xA1), 0x80), masterPublicKey);
+
+    QVERIFY2(cmdSet->factoryReset(), qPrintable(cmdSet->lastError()));
+    QVERIFY(!cmdSet->select().initialized);
+}
+
+QTEST_MAIN(TestVirtualCardFarm)
+#include "test_virtual_card_farm.moc"